@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include "PlatformMatrix.h"
+
+namespace Platform
+{
+
+// Local node transforms in structure-of-arrays form, indexed by flattened node position
+struct PLATFORM_API NodePose
+{
+    std::vector<char> useMatrix;
+    std::vector<Matrix4f> matrix;
+    std::vector<Point4f> rotation;
+    std::vector<Point3f> translation;
+    std::vector<Point3f> scale;
+
+    inline size_t Size() const { return useMatrix.size(); }
+
+    void Resize(size_t count);
+    Matrix4f CalcLocalMatrix(size_t idx) const;
+};
+
+// Animation track of one node property
+struct PLATFORM_API AnimationSampler
+{
+    // Assumed it is always linear interpolation here
+    std::vector<float> timeKeys;   // Time key values
+    std::vector<Point4f> keys;      // Key values, released after compression
+
+    // Compressed keys, 3 values per key.
+    // Rotations are stored as smallest three quaternion components, others are quantized in [rangeMin, rangeMin + rangeSize]
+    bool rotation = false;
+    std::vector<UINT16> packedKeys;
+    Point3f rangeMin;
+    Point3f rangeSize;
+
+    inline size_t GetKeyCount() const { return timeKeys.size(); }
+    Point4f GetKey(size_t idx) const;
+
+    // Removes keys, which are restored by interpolation within tolerance, and packs the rest
+    void Compress(bool isRotation, float tolerance);
+};
+
+// Binds sampler to node property
+struct AnimationChannel
+{
+    enum Type
+    {
+        Rotation,
+        Translation,
+        Scale
+    };
+
+    int animSamplerIdx;
+    int nodeIdx;
+    int flatNodeIdx = -1;   // Node position in flattened hierarchy
+    Type type;
+};
+
+// Index of the last key not later than time, time is expected to be not less than the first key.
+// Cursor keeps last found key between calls, so playback is found without search
+PLATFORM_API int FindKey(const std::vector<float>& timeKeys, float time, int& cursor);
+
+// Samples channels at localTime into pose, localTime is expected to be within animation length.
+// Cursors keep last found key per sampler between calls
+PLATFORM_API void SampleAnimation(const std::vector<AnimationSampler>& samplers, const std::vector<AnimationChannel>& channels, float localTime, std::vector<int>& cursors, NodePose& pose);
+
+// World and normal matrices of flattened hierarchy in one linear pass,
+// parent always goes before its children, -1 parent is root
+PLATFORM_API void CalcHierarchyMatrices(const NodePose& pose, const std::vector<int>& flatParents, const Matrix4f& root, const Matrix4f& rootNormals, Matrix4f* pWorld, Matrix4f* pNormals);
+
+} // Platform
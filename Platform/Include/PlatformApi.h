@@ -1,7 +1,10 @@
 #pragma once
 
 // Comment this and switch Platform project to non-DLL config in solution configuration to use static lib version
+// Other compilers (Linux test targets) always use static linking
+#ifdef _MSC_VER
 #define PLATFORM_DLL
+#endif
 
 #ifdef PLATFORM_DLL
 #ifdef PLATFORM_EXPORTS
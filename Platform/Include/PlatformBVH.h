@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+
+#include "PlatformUtil.h"
+#include "PlatformFrustum.h"
+
+namespace Platform
+{
+
+// Bounding volume hierarchy over object boxes, built with binned surface area heuristic.
+// Moved objects are refitted incrementally, nodes on refit path are rotated if it lowers SAH cost.
+// Refit keeps tree topology, so its quality drops as objects move apart, caller rebuilds it by SAH cost.
+// Nodes live in flat array, children of inner node are adjacent, so sibling boxes share cache line
+class PLATFORM_API BVH
+{
+public:
+    static const UINT InvalidIndex = (UINT)-1;
+    static const UINT MaxLeafSize = 4;
+
+    struct Node
+    {
+        Point3f bbMin;
+        UINT index = 0;         // First child for inner node, first object of leaf in objects list
+        Point3f bbMax;
+        UINT count = 0;         // Objects in leaf, zero for inner node
+
+        inline bool IsLeaf() const { return count != 0; }
+    };
+
+    struct Stats
+    {
+        size_t nodes = 0;
+        size_t leaves = 0;
+        size_t depth = 0;
+        float sahCost = 0.0f;   // Expected node and object tests per random query, relative to root
+    };
+
+    BVH();
+    BVH(const BVH&) = delete;
+
+    BVH& operator=(const BVH&) = delete;
+
+    // Object index is its position in boxes
+    void Build(const std::vector<AABB<float>>& boxes);
+    // Builds tree anew over current object boxes, object indices are kept
+    void Rebuild();
+    void Clear();
+
+    inline size_t GetObjectCount() const { return m_boxes.size(); }
+    inline const AABB<float>& GetObjectBox(UINT object) const { return m_boxes[object]; }
+    inline const std::vector<Node>& GetNodes() const { return m_nodes; }
+
+    // Box of all objects, as of the last Build or Refit
+    AABB<float> GetBounds() const;
+
+    // Changes object box, tree is refitted on Refit
+    void Update(UINT object, const AABB<float>& box);
+    // Recalculates boxes of nodes above updated objects, returns refitted node count
+    size_t Refit();
+    inline size_t GetRotationCount() const { return m_rotationCount; }
+    // SAH cost of the tree right after the last Build
+    inline float GetBuildSAHCost() const { return m_buildSAHCost; }
+
+    // Queries append indices of objects, whose boxes pass the test, to objects
+    void QueryFrustum(const Frustum& frustum, std::vector<UINT>& objects) const;
+    void QuerySphere(const Point3f& center, float radius, std::vector<UINT>& objects) const;
+    void QueryBox(const AABB<float>& box, std::vector<UINT>& objects) const;
+    // Returns object with the nearest box hit within maxDist, or InvalidIndex
+    UINT QueryRay(const Point3f& origin, const Point3f& dir, float maxDist, float& hitDist) const;
+
+    Stats CalcStats() const;
+
+private:
+    // Object box with its center, build items are partitioned in place, so nodes read continuous ranges
+    struct BuildItem;
+
+    void BuildNode(UINT nodeIdx, UINT begin, UINT end, UINT depth, std::vector<BuildItem>& items);
+    void MakeLeaf(UINT nodeIdx, UINT begin, UINT end, const std::vector<BuildItem>& items);
+    void UpdateNodeBox(UINT nodeIdx);
+
+    void Rotate(UINT nodeIdx);
+    // Exchanges two subtrees, positions keep their parents
+    void SwapNodes(UINT a, UINT b);
+
+    // Walks nodes and objects with explicit stack. Test returns Frustum::BoxClass,
+    // objects under node, which is inside, are taken with no more tests
+    template <typename BoxTest>
+    void Query(const BoxTest& test, std::vector<UINT>& objects) const;
+
+private:
+    std::vector<Node> m_nodes;
+    std::vector<UINT> m_parents;        // Parent of every node, InvalidIndex for root
+    std::vector<UINT> m_objects;        // Objects of leaves, every leaf owns continuous range
+    std::vector<UINT> m_objectLeaves;   // Leaf of every object
+
+    std::vector<AABB<float>> m_boxes;
+    std::vector<UINT> m_dirtyObjects;   // Updated since the last Refit
+
+    size_t m_rotationCount;             // Rotations since the last Build
+    float m_buildSAHCost;
+};
+
+} // Platform
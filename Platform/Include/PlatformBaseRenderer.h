@@ -7,6 +7,7 @@ namespace Platform
 {
 
 class ShaderCache;
+class PipelineStateCache;
 
 class PLATFORM_API BaseRenderer : public Renderer
 {
@@ -33,6 +34,23 @@ public:
         D3D12_GPU_DESCRIPTOR_HANDLE texturesTableStart = { 0 };
     };
 
+    // Object constant buffer, which is shared by all geometries of an object.
+    // It is uploaded to dynamic heap once per frame and data version
+    struct ObjectCB
+    {
+        UINT64 frame = 0;       // Frame it is uploaded in, zero if never
+        UINT64 version = 0;     // Data version it is uploaded with
+        D3D12_GPU_VIRTUAL_ADDRESS address = 0;
+    };
+
+    // Dynamic constant buffer traffic of a frame
+    struct DynamicCBStats
+    {
+        UINT64 bytes = 0;           // Bytes copied into dynamic heap
+        UINT objectUploads = 0;     // Object CB uploads
+        UINT objectReuses = 0;      // Object CB binds, which reused data uploaded earlier in the frame
+    };
+
     struct BeginRenderParams
     {
         // Input
@@ -79,6 +97,17 @@ public:
         DXGI_FORMAT rtFormat4 = DXGI_FORMAT_UNKNOWN;
     };
 
+    // Geometry states with equal descriptions share root signature and PSO
+    struct PipelineStateStats
+    {
+        UINT rootSignatureHits = 0;
+        UINT rootSignatureMisses = 0;
+        UINT psoHits = 0;
+        UINT psoMisses = 0;
+        UINT libraryHits = 0;   // PSO misses, which are loaded from pipeline cache
+        UINT64 createUSec = 0;  // Time spent in geometry state creation, shader compilation included
+    };
+
     struct TextureParam
     {
         ID3D12Resource* pResource;
@@ -127,6 +156,18 @@ public:
     bool CreateGeometryState(const GeometryStateParams& params, GeometryState& geomState);
     void DestroyGeometryState(GeometryState& geomState);
 
+    const PipelineStateStats& GetPipelineStateStats() const;
+
+    // Stats of the last complete frame
+    inline const DynamicCBStats& GetDynamicCBStats() const { return m_lastDynamicCBStats; }
+    // Stats of the current frame so far
+    inline const DynamicCBStats& GetCurrentDynamicCBStats() const { return m_dynamicCBStats; }
+
+    // Pipeline cache depends on shader binaries, so it should be loaded after shader cache
+    bool LoadPipelineCache(LPCTSTR filename);
+    bool SavePipelineCache(LPCTSTR filename);
+    bool IsPipelineCacheModified() const;
+
     bool BeginGeometryCreation();
     void EndGeometryCreation();
 
@@ -140,6 +181,15 @@ protected:
     bool CreateGeometrySharedState(const GeometryState& srcState, const CreateGeometryParams& params, Geometry& geometry);
 
     void RenderGeometry(const Geometry& geometry, const void* pInstData = nullptr, size_t instDataSize = 0, const GeometryState* pState = nullptr, D3D12_GPU_DESCRIPTOR_HANDLE dynTexturesGpu = {}, const void* pInstObjectData = nullptr, size_t instObjectDataSize = 0);
+    // Binds object data, which is uploaded already with UploadObjectCB or UploadDynamicCB
+    void RenderGeometry(const Geometry& geometry, const void* pInstData, size_t instDataSize, const GeometryState* pState, D3D12_GPU_DESCRIPTOR_HANDLE dynTexturesGpu, D3D12_GPU_VIRTUAL_ADDRESS instObjectAddress, UINT instanceCount = 1);
+    // Binds split and object data, which reside in GPU memory already
+    void RenderGeometry(const Geometry& geometry, D3D12_GPU_VIRTUAL_ADDRESS splitDataAddress, const GeometryState* pState, D3D12_GPU_DESCRIPTOR_HANDLE dynTexturesGpu, D3D12_GPU_VIRTUAL_ADDRESS instObjectAddress, UINT instanceCount = 1);
+
+    // Uploads object data, unless it is uploaded in current frame with the same version already
+    D3D12_GPU_VIRTUAL_ADDRESS UploadObjectCB(ObjectCB& objectCB, const void* pData, size_t size, UINT64 version);
+    // Uploads data to dynamic heap, it is valid until the end of current frame
+    D3D12_GPU_VIRTUAL_ADDRESS UploadDynamicCB(const void* pData, size_t size);
 
     virtual bool Resize(const D3D12_VIEWPORT& viewport, const D3D12_RECT& rect) override;
 
@@ -168,12 +218,17 @@ private:
     Matrix4f m_cubemapFaceVP;
 
     ShaderCache* m_pShaderCache;
+    PipelineStateCache* m_pPipelineStateCache;
 
     UINT m_commonCBCount;
     UINT m_commonTexCount;
     std::vector<UINT> m_commonCBSizes;
 
     UINT m_additionalDSDescCount;
+
+    UINT64 m_frame;
+    DynamicCBStats m_dynamicCBStats;
+    DynamicCBStats m_lastDynamicCBStats;
 };
 
 } // Platform
@@ -128,6 +128,8 @@ public:
     bool AllocateDynamicBuffers(UINT count, const UINT* pSizes, D3D12_GPU_DESCRIPTOR_HANDLE& startHandle, UINT8** ppCPUData, D3D12_CONSTANT_BUFFER_VIEW_DESC* pDescs = nullptr);
     bool AllocateDynamicBuffers(UINT count, const UINT* pSizes, D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle, UINT8** ppCPUData, D3D12_CONSTANT_BUFFER_VIEW_DESC* pDescs = nullptr);
     bool AllocateDynamicBuffer(UINT size, UINT alignment, void** ppCPUData, UINT64& gpuVirtualAddress);
+    // Dynamic heap region as copy source
+    bool AllocateDynamicBuffer(UINT size, UINT alignment, void** ppCPUData, ID3D12Resource** ppDynamicBuffer, UINT64& offset);
     bool AllocateReadbackBuffer(UINT size, UINT alignment, void** ppCPUData, ID3D12Resource** ppReadBackBuffer, UINT64& offset);
     bool AllocateStaticDescriptors(UINT count, D3D12_CPU_DESCRIPTOR_HANDLE& cpuStartHandle, D3D12_GPU_DESCRIPTOR_HANDLE& gpuStartHandle);
     bool AllocateDynamicDescriptors(UINT count, D3D12_CPU_DESCRIPTOR_HANDLE& cpuStartHandle, D3D12_GPU_DESCRIPTOR_HANDLE& gpuStartHandle);
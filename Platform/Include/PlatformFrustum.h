@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+#include "PlatformMatrix.h"
+
+namespace Platform
+{
+
+// Axis aligned boxes in structure-of-arrays form, so they are tested against frustum several at a time
+class PLATFORM_API BoxList
+{
+public:
+    BoxList() = default;
+    BoxList(const BoxList&) = delete;
+
+    BoxList& operator=(const BoxList&) = delete;
+
+    void Clear();
+    // Box is given with center and half size
+    void Add(const Point3f& center, const Point3f& extent);
+
+    inline size_t GetSize() const { return centerX.size(); }
+
+public:
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+};
+
+// Box of bbMin, bbMax, transformed with transform, as center and half size of the box around it
+PLATFORM_API void TransformBox(const Matrix4f& transform, const Point3f& bbMin, const Point3f& bbMax, Point3f& center, Point3f& extent);
+
+// Six planes of view frustum, normals point inside
+class PLATFORM_API Frustum
+{
+public:
+    enum PlaneIndex
+    {
+        PlaneLeft = 0,
+        PlaneRight,
+        PlaneBottom,
+        PlaneTop,
+        PlaneNear,
+        PlaneFar,
+
+        PlaneCount
+    };
+
+    enum BoxClass
+    {
+        BoxOutside = 0,
+        BoxIntersects,
+        BoxInside
+    };
+
+    // Box with this extent is never culled
+    static const float InfiniteExtent;
+
+    Frustum();
+
+    // Planes are extracted from view * projection matrix, D3D clip space with 0 <= z <= w is assumed
+    void Build(const Matrix4f& viewProj);
+
+    inline const Point4f& GetPlane(int idx) const { return m_planes[idx]; }
+    // Plane is normalized, plane with zero normal and positive w never culls
+    void SetPlane(int idx, const Point4f& plane);
+
+    // Returns false only if box is fully outside of some plane, so boxes near frustum corners may pass
+    bool TestBox(const Point3f& center, const Point3f& extent) const;
+    // Box is inside, if it is inside of every plane, so whole hierarchy below it may be accepted without tests
+    BoxClass ClassifyBox(const Point3f& center, const Point3f& extent) const;
+
+    // Writes 1 for visible box and 0 for culled one, returns visible box count.
+    // Boxes are tested with SIMD, result is the same as TestBox gives for every box
+    size_t TestBoxes(const BoxList& boxes, UINT8* pVisible) const;
+
+private:
+    size_t TestBoxesScalar(const BoxList& boxes, size_t begin, size_t end, UINT8* pVisible) const;
+    // Returns index of the first box left for scalar test
+    size_t TestBoxesSIMD(const BoxList& boxes, size_t& visibleCount, UINT8* pVisible) const;
+
+private:
+    Point4f m_planes[PlaneCount];
+};
+
+} // Platform
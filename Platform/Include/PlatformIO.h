@@ -9,4 +9,27 @@ PLATFORM_API bool ReadFileContent(LPCTSTR filename, std::vector<char>& data);
 PLATFORM_API std::vector<std::tstring> ScanFiles(LPCTSTR folder, LPCTSTR mask);
 PLATFORM_API std::vector<std::tstring> ScanDirectories(LPCTSTR folder, LPCTSTR fileToFind);
 
+// Read only file mapped to memory
+class PLATFORM_API MappedFile
+{
+public:
+    MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    virtual ~MappedFile();
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(LPCTSTR filename);
+    void Close();
+
+    inline const char* GetData() const { return m_pData; }
+    inline size_t GetSize() const { return m_size; }
+
+private:
+    HANDLE m_hFile;
+    HANDLE m_hMapping;
+    const char* m_pData;
+    size_t m_size;
+};
+
 } // Platform
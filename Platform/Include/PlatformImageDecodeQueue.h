@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "PlatformApi.h"
+#include "PlatformThreadPool.h"
+
+namespace Platform
+{
+
+struct DecodedImage
+{
+    size_t imageIdx = 0;
+    UINT width = 0;
+    UINT height = 0;
+    UINT mips = 0;
+    std::vector<UINT8> pixels;  // Whole mip chain, empty if image is failed to decode
+};
+
+// Decodes images on thread pool tasks. Decoded images with whole mip chains are large,
+// so only thread count + 1 images are in flight at once
+class PLATFORM_API ImageDecodeQueue
+{
+public:
+    using DecodeFunc = std::function<void(size_t imageIdx, DecodedImage& image)>;
+
+    ImageDecodeQueue();
+    ImageDecodeQueue(const ImageDecodeQueue&) = delete;
+
+    ImageDecodeQueue& operator=(const ImageDecodeQueue&) = delete;
+
+    // Previous decodes should be complete
+    void Start(ThreadPool* pPool, size_t imageCount, const DecodeFunc& decode);
+    // Queues next images, while limit of images in flight allows
+    void Queue();
+    // Takes decoded image in completion order, returns false if none is ready
+    bool Pop(DecodedImage& image);
+    // Waits for queued decodes, decoded images are kept
+    void Wait();
+    void Clear();
+
+private:
+    ThreadPool* m_pPool;
+    DecodeFunc m_decode;
+
+    std::mutex m_mutex;
+    std::condition_variable m_doneCV;
+    std::deque<DecodedImage> m_decodedImages;  // Images ready for upload in completion order
+    size_t m_imageCount;
+    size_t m_nextImage;                         // Next image to queue for decoding
+    size_t m_pendingDecodes;                    // Queued, but not decoded yet
+};
+
+} // Platform
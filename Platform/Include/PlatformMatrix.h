@@ -1,72 +1,14 @@
 #pragma once
 
 #include "PlatformPoint.h"
+#include "PlatformSIMD.h"
 
+// Reference kernels, used for any type and as fallback when no SIMD is available
 template <typename T>
-struct Matrix4
+struct Matrix4Scalar
 {
-    Matrix4()
-    {
-        Identity();
-    }
-
-    void Zero()
-    {
-        memset(m, 0, sizeof(m));
-    }
-
-    void Identity()
-    {
-        Zero();
-        m[0] = m[5] = m[10] = m[15] = T(1);
-    }
-
-    void Rotation(const T& alpha, const Point3<T>& axis)
-    {
-        Identity();
-
-        T c = cos(alpha);
-        T s = sin(alpha);
-
-        m[0] = c + (T(1) - c) * axis.x * axis.x;
-        m[1] = (T(1) - c)*axis.x*axis.y - s * axis.z;
-        m[2] = (T(1) - c)*axis.x*axis.z + s * axis.y;
-
-        m[4] = (T(1) - c)*axis.y*axis.x + s * axis.z;
-        m[5] = c + (T(1) - c)*axis.y*axis.y;
-        m[6] = (T(1) - c)*axis.y*axis.z - s * axis.x;
-
-        m[8] = (T(1) - c)*axis.z*axis.x - s * axis.y;
-        m[9] = (T(1) - c)*axis.z*axis.y + s * axis.x;
-        m[10] = c + (T(1) - c)*axis.z*axis.z;
-    }
-
-    Matrix4<T>& Offset(const Point3<T>& offset)
-    {
-        Identity();
-
-        m[12] = offset.x;
-        m[13] = offset.y;
-        m[14] = offset.z;
-
-        return *this;
-    }
-
-    Matrix4<T>& Scale(T sx, T sy, T sz)
-    {
-        Identity();
-
-        m[0] = sx;
-        m[5] = sy;
-        m[10] = sz;
-
-        return *this;
-    }
-
-    Matrix4<T> operator*(const Matrix4<T>& b) const
+    static void Multiply(const T* a, const T* b, T* res)
     {
-        Matrix4 newM;
-
         for (int i = 0; i < 4; i++)
         {
             for (int j = 0; j < 4; j++)
@@ -74,203 +16,410 @@ struct Matrix4
                 T sum = T(0);
                 for (int k = 0; k < 4; k++)
                 {
-                    sum += m[i * 4 + k] * b.m[k * 4 + j];
+                    sum += a[i * 4 + k] * b[k * 4 + j];
                 }
-                newM.m[i * 4 + j] = sum;
+                res[i * 4 + j] = sum;
             }
         }
-
-        return newM;
     }
 
-    Point4<T> operator*(const Point4<T>& p) const
-    {
-        Point4<T> res = { 0 };
-
-        res.x = m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12] * p.w;
-        res.y = m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13] * p.w;
-        res.z = m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14] * p.w;
-        res.w = m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15] * p.w;
-
-        /*for (int i = 0; i < 4; i++)
-        {
-            res.x += m[i * 4 + 0] * p.x;
-            res.y += m[i * 4 + 1] * p.y;
-            res.z += m[i * 4 + 2] * p.z;
-            res.w += m[i * 4 + 3] * p.w;
-        }*/
-
-        return res;
-    }
-
-    void CoordTransformMatrix(const Point3<T>& xaxis, const Point3<T>& yaxis, const Point3<T>& zaxis, const Point3<T>& origin)
+    static void Transform(const T* m, const T* p, T* res)
     {
-        Identity();
-
-        m[0] = xaxis.x;
-        m[1] = xaxis.y;
-        m[2] = xaxis.z;
-
-        m[4] = yaxis.x;
-        m[5] = yaxis.y;
-        m[6] = yaxis.z;
-
-        m[8] = zaxis.x;
-        m[9] = zaxis.y;
-        m[10] = zaxis.z;
-
-        m[12] = origin.x;
-        m[13] = origin.y;
-        m[14] = origin.z;
+        res[0] = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12] * p[3];
+        res[1] = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13] * p[3];
+        res[2] = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14] * p[3];
+        res[3] = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15] * p[3];
     }
 
-    Matrix4<T> Transpose()
+    static void Transpose(const T* m, T* res)
     {
-        Matrix4<T> trans;
         for (size_t i = 0; i < 4; i++)
         {
             for (size_t j = 0; j < 4; j++)
             {
-                trans.m[i * 4 + j] = m[j * 4 + i];
+                res[i * 4 + j] = m[j * 4 + i];
             }
         }
-
-        return trans;
     }
 
-    Matrix4<T> Inverse() const
+    static void Inverse(const T* m, T* inv)
     {
-        Matrix4<T> inv;
-
-        inv.m[0] = m[5] * m[10] * m[15] -
+        inv[0] = m[5] * m[10] * m[15] -
             m[5] * m[11] * m[14] -
             m[9] * m[6] * m[15] +
             m[9] * m[7] * m[14] +
             m[13] * m[6] * m[11] -
             m[13] * m[7] * m[10];
 
-        inv.m[4] = -m[4] * m[10] * m[15] +
+        inv[4] = -m[4] * m[10] * m[15] +
             m[4] * m[11] * m[14] +
             m[8] * m[6] * m[15] -
             m[8] * m[7] * m[14] -
             m[12] * m[6] * m[11] +
             m[12] * m[7] * m[10];
 
-        inv.m[8] = m[4] * m[9] * m[15] -
+        inv[8] = m[4] * m[9] * m[15] -
             m[4] * m[11] * m[13] -
             m[8] * m[5] * m[15] +
             m[8] * m[7] * m[13] +
             m[12] * m[5] * m[11] -
             m[12] * m[7] * m[9];
 
-        inv.m[12] = -m[4] * m[9] * m[14] +
+        inv[12] = -m[4] * m[9] * m[14] +
             m[4] * m[10] * m[13] +
             m[8] * m[5] * m[14] -
             m[8] * m[6] * m[13] -
             m[12] * m[5] * m[10] +
             m[12] * m[6] * m[9];
 
-        inv.m[1] = -m[1] * m[10] * m[15] +
+        inv[1] = -m[1] * m[10] * m[15] +
             m[1] * m[11] * m[14] +
             m[9] * m[2] * m[15] -
             m[9] * m[3] * m[14] -
             m[13] * m[2] * m[11] +
             m[13] * m[3] * m[10];
 
-        inv.m[5] = m[0] * m[10] * m[15] -
+        inv[5] = m[0] * m[10] * m[15] -
             m[0] * m[11] * m[14] -
             m[8] * m[2] * m[15] +
             m[8] * m[3] * m[14] +
             m[12] * m[2] * m[11] -
             m[12] * m[3] * m[10];
 
-        inv.m[9] = -m[0] * m[9] * m[15] +
+        inv[9] = -m[0] * m[9] * m[15] +
             m[0] * m[11] * m[13] +
             m[8] * m[1] * m[15] -
             m[8] * m[3] * m[13] -
             m[12] * m[1] * m[11] +
             m[12] * m[3] * m[9];
 
-        inv.m[13] = m[0] * m[9] * m[14] -
+        inv[13] = m[0] * m[9] * m[14] -
             m[0] * m[10] * m[13] -
             m[8] * m[1] * m[14] +
             m[8] * m[2] * m[13] +
             m[12] * m[1] * m[10] -
             m[12] * m[2] * m[9];
 
-        inv.m[2] = m[1] * m[6] * m[15] -
+        inv[2] = m[1] * m[6] * m[15] -
             m[1] * m[7] * m[14] -
             m[5] * m[2] * m[15] +
             m[5] * m[3] * m[14] +
             m[13] * m[2] * m[7] -
             m[13] * m[3] * m[6];
 
-        inv.m[6] = -m[0] * m[6] * m[15] +
+        inv[6] = -m[0] * m[6] * m[15] +
             m[0] * m[7] * m[14] +
             m[4] * m[2] * m[15] -
             m[4] * m[3] * m[14] -
             m[12] * m[2] * m[7] +
             m[12] * m[3] * m[6];
 
-        inv.m[10] = m[0] * m[5] * m[15] -
+        inv[10] = m[0] * m[5] * m[15] -
             m[0] * m[7] * m[13] -
             m[4] * m[1] * m[15] +
             m[4] * m[3] * m[13] +
             m[12] * m[1] * m[7] -
             m[12] * m[3] * m[5];
 
-        inv.m[14] = -m[0] * m[5] * m[14] +
+        inv[14] = -m[0] * m[5] * m[14] +
             m[0] * m[6] * m[13] +
             m[4] * m[1] * m[14] -
             m[4] * m[2] * m[13] -
             m[12] * m[1] * m[6] +
             m[12] * m[2] * m[5];
 
-        inv.m[3] = -m[1] * m[6] * m[11] +
+        inv[3] = -m[1] * m[6] * m[11] +
             m[1] * m[7] * m[10] +
             m[5] * m[2] * m[11] -
             m[5] * m[3] * m[10] -
             m[9] * m[2] * m[7] +
             m[9] * m[3] * m[6];
 
-        inv.m[7] = m[0] * m[6] * m[11] -
+        inv[7] = m[0] * m[6] * m[11] -
             m[0] * m[7] * m[10] -
             m[4] * m[2] * m[11] +
             m[4] * m[3] * m[10] +
             m[8] * m[2] * m[7] -
             m[8] * m[3] * m[6];
 
-        inv.m[11] = -m[0] * m[5] * m[11] +
+        inv[11] = -m[0] * m[5] * m[11] +
             m[0] * m[7] * m[9] +
             m[4] * m[1] * m[11] -
             m[4] * m[3] * m[9] -
             m[8] * m[1] * m[7] +
             m[8] * m[3] * m[5];
 
-        inv.m[15] = m[0] * m[5] * m[10] -
+        inv[15] = m[0] * m[5] * m[10] -
             m[0] * m[6] * m[9] -
             m[4] * m[1] * m[10] +
             m[4] * m[2] * m[9] +
             m[8] * m[1] * m[6] -
             m[8] * m[2] * m[5];
 
-        T det = m[0] * inv.m[0] + m[1] * inv.m[4] + m[2] * inv.m[8] + m[3] * inv.m[12];
+        T det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
 
         if (fabs(det) < 0.00001)
         {
-            return inv;
+            return;
         }
 
         det = T(1.0) / det;
 
         for (int i = 0; i < 16; i++)
         {
-            inv.m[i] *= det;
+            inv[i] *= det;
+        }
+    }
+
+    // Upper 3x3 part is orthogonal with equal row lengths, i.e. rotation with uniform scale
+    static bool IsUniformScale(const T* m, T eps)
+    {
+        Point3<T> a0{ m[0], m[1], m[2] };
+        Point3<T> a1{ m[4], m[5], m[6] };
+        Point3<T> a2{ m[8], m[9], m[10] };
+
+        T l0 = a0.lengthSqr();
+        T tol = eps * l0;
+
+        return fabs(a1.lengthSqr() - l0) <= tol && fabs(a2.lengthSqr() - l0) <= tol
+            && fabs(a0.dot(a1)) <= tol && fabs(a0.dot(a2)) <= tol && fabs(a1.dot(a2)) <= tol;
+    }
+
+    // Inverse for matrices with (0,0,0,1) last column, i.e. rotation*scale+translation
+    static void AffineInverse(const T* m, T* inv)
+    {
+        Point3<T> c[3];
+        T w = AffineInverseTranspose3x3(m, c);
+
+        Point3<T> t{ m[12], m[13], m[14] };
+
+        for (int i = 0; i < 3; i++)
+        {
+            inv[i * 4 + 0] = (&c[0].x)[i];
+            inv[i * 4 + 1] = (&c[1].x)[i];
+            inv[i * 4 + 2] = (&c[2].x)[i];
+            inv[i * 4 + 3] = T(0);
+
+            inv[12 + i] = -t.dot(c[i]);
+        }
+        inv[15] = w;
+    }
+
+    // Transposed affine inverse
+    static void NormalMatrix(const T* m, T* res)
+    {
+        Point3<T> c[3];
+        T w = AffineInverseTranspose3x3(m, c);
+
+        Point3<T> t{ m[12], m[13], m[14] };
+
+        for (int i = 0; i < 3; i++)
+        {
+            res[i * 4 + 0] = c[i].x;
+            res[i * 4 + 1] = c[i].y;
+            res[i * 4 + 2] = c[i].z;
+            res[i * 4 + 3] = -t.dot(c[i]);
+
+            res[12 + i] = T(0);
+        }
+        res[15] = w;
+    }
+
+    // Rows of inverse transposed upper 3x3 part, returns value for m[15] of the inverse,
+    // which is determinant for degenerate matrices to match Inverse() behaviour
+    static T AffineInverseTranspose3x3(const T* m, Point3<T> c[3])
+    {
+        Point3<T> a0{ m[0], m[1], m[2] };
+        Point3<T> a1{ m[4], m[5], m[6] };
+        Point3<T> a2{ m[8], m[9], m[10] };
+
+        if (IsUniformScale(m, T(0.0001)))
+        {
+            // Inverse transpose of s*R is R/s, determinant s^3 is checked
+            // against the same threshold as general path, l^3 = det^2
+            T l = a0.lengthSqr();
+            if (l * l * l >= T(0.00001) * T(0.00001))
+            {
+                T invScaleSqr = T(1) / l;
+                c[0] = a0 * invScaleSqr;
+                c[1] = a1 * invScaleSqr;
+                c[2] = a2 * invScaleSqr;
+
+                return T(1);
+            }
+        }
+
+        c[0] = a1.cross(a2);
+        c[1] = a2.cross(a0);
+        c[2] = a0.cross(a1);
+
+        T det = a0.dot(c[0]);
+        if (fabs(det) < 0.00001)
+        {
+            return det;
         }
 
+        T invDet = T(1) / det;
+        c[0] = c[0] * invDet;
+        c[1] = c[1] * invDet;
+        c[2] = c[2] * invDet;
+
+        return T(1);
+    }
+};
+
+template <typename T>
+struct Matrix4Kernel : public Matrix4Scalar<T>
+{
+};
+
+#if PLATFORM_SIMD != PLATFORM_SIMD_NONE
+template <>
+struct Matrix4Kernel<float> : public Matrix4Scalar<float>
+{
+    static void Multiply(const float* a, const float* b, float* res) { SIMD::Matrix4Multiply(a, b, res); }
+    static void Transform(const float* m, const float* p, float* res) { SIMD::Matrix4Transform(m, p, res); }
+    static void Transpose(const float* m, float* res) { SIMD::Matrix4Transpose(m, res); }
+#if PLATFORM_SIMD != PLATFORM_SIMD_NEON
+    static void Inverse(const float* m, float* inv) { SIMD::Matrix4Inverse(m, inv); }
+    static void AffineInverse(const float* m, float* inv) { SIMD::Matrix4AffineInverse(m, inv); }
+    static void NormalMatrix(const float* m, float* res) { SIMD::Matrix4NormalMatrix(m, res); }
+#endif
+};
+#endif
+
+template <typename T>
+struct Matrix4
+{
+    Matrix4()
+    {
+        Identity();
+    }
+
+    void Zero()
+    {
+        memset(m, 0, sizeof(m));
+    }
+
+    void Identity()
+    {
+        Zero();
+        m[0] = m[5] = m[10] = m[15] = T(1);
+    }
+
+    void Rotation(const T& alpha, const Point3<T>& axis)
+    {
+        Identity();
+
+        T c = cos(alpha);
+        T s = sin(alpha);
+
+        m[0] = c + (T(1) - c) * axis.x * axis.x;
+        m[1] = (T(1) - c)*axis.x*axis.y - s * axis.z;
+        m[2] = (T(1) - c)*axis.x*axis.z + s * axis.y;
+
+        m[4] = (T(1) - c)*axis.y*axis.x + s * axis.z;
+        m[5] = c + (T(1) - c)*axis.y*axis.y;
+        m[6] = (T(1) - c)*axis.y*axis.z - s * axis.x;
+
+        m[8] = (T(1) - c)*axis.z*axis.x - s * axis.y;
+        m[9] = (T(1) - c)*axis.z*axis.y + s * axis.x;
+        m[10] = c + (T(1) - c)*axis.z*axis.z;
+    }
+
+    Matrix4<T>& Offset(const Point3<T>& offset)
+    {
+        Identity();
+
+        m[12] = offset.x;
+        m[13] = offset.y;
+        m[14] = offset.z;
+
+        return *this;
+    }
+
+    Matrix4<T>& Scale(T sx, T sy, T sz)
+    {
+        Identity();
+
+        m[0] = sx;
+        m[5] = sy;
+        m[10] = sz;
+
+        return *this;
+    }
+
+    Matrix4<T> operator*(const Matrix4<T>& b) const
+    {
+        Matrix4 newM;
+        Matrix4Kernel<T>::Multiply(m, b.m, newM.m);
+        return newM;
+    }
+
+    Point4<T> operator*(const Point4<T>& p) const
+    {
+        Point4<T> res;
+        Matrix4Kernel<T>::Transform(m, &p.x, &res.x);
+        return res;
+    }
+
+    void CoordTransformMatrix(const Point3<T>& xaxis, const Point3<T>& yaxis, const Point3<T>& zaxis, const Point3<T>& origin)
+    {
+        Identity();
+
+        m[0] = xaxis.x;
+        m[1] = xaxis.y;
+        m[2] = xaxis.z;
+
+        m[4] = yaxis.x;
+        m[5] = yaxis.y;
+        m[6] = yaxis.z;
+
+        m[8] = zaxis.x;
+        m[9] = zaxis.y;
+        m[10] = zaxis.z;
+
+        m[12] = origin.x;
+        m[13] = origin.y;
+        m[14] = origin.z;
+    }
+
+    Matrix4<T> Transpose() const
+    {
+        Matrix4<T> trans;
+        Matrix4Kernel<T>::Transpose(m, trans.m);
+        return trans;
+    }
+
+    Matrix4<T> Inverse() const
+    {
+        Matrix4<T> inv;
+        Matrix4Kernel<T>::Inverse(m, inv.m);
+        return inv;
+    }
+
+    // Upper 3x3 part is orthogonal with equal row lengths, i.e. rotation with uniform scale
+    bool IsUniformScale(T eps = T(0.0001)) const
+    {
+        return Matrix4Scalar<T>::IsUniformScale(m, eps);
+    }
+
+    // Inverse for matrices with (0,0,0,1) last column, i.e. rotation*scale+translation
+    Matrix4<T> AffineInverse() const
+    {
+        Matrix4<T> inv;
+        Matrix4Kernel<T>::AffineInverse(m, inv.m);
         return inv;
     }
 
+    // Same as Inverse().Transpose() for affine matrices, but without full 4x4 inversion
+    Matrix4<T> NormalMatrix() const
+    {
+        Matrix4<T> res;
+        Matrix4Kernel<T>::NormalMatrix(m, res.m);
+        return res;
+    }
+
     void FromQuaternion(const Point4f& q)
     {
         m[0] = 1 - 2 * q.y*q.y - 2 * q.z * q.z;
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "PlatformApi.h"
+
+namespace Platform
+{
+
+// Pixel formats mip chains are generated for, memory layout is the same as of matching DXGI formats
+enum MipPixelFormat
+{
+    MipPixelFormatRGBA8 = 0,
+    MipPixelFormatRGBA8SRGB,
+    MipPixelFormatRGBA16F,
+    MipPixelFormatRGBA32F,
+
+    MipPixelFormatCount
+};
+
+// Mip chain for RGBA8 (linear or sRGB), RGBA16F or RGBA32F image, levels are tightly packed one after another.
+// Mips are box filtered, sRGB color is averaged in linear space, odd sized levels fold extra row and column into the last pixel
+PLATFORM_API size_t CalcTextureSizeWithMips(UINT width, UINT height, MipPixelFormat format, UINT& mipCount);
+PLATFORM_API void GenerateTextureMips(void* pData, UINT width, UINT height, MipPixelFormat format, UINT mipCount);
+
+} // Platform
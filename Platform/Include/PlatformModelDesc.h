@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include "PlatformAnimation.h"
+#include "PlatformMatrix.h"
+
+#include "../../Common/Shaders/GLTFObjectData.h"
+
+namespace Platform
+{
+
+struct GLTFSplitData
+GLTF_SPLIT_DATA
+
+// Device-free part of glTF model: node hierarchy, skin and animation.
+// It is built from glTF source or read from model cache
+struct PLATFORM_API GLTFModelDesc
+{
+    struct Node
+    {
+        bool useMatrix;
+        union
+        {
+            Matrix4f matrix;
+            struct {
+                Point4f rotation;
+                Point3f translation;
+                Point3f scale;
+            } transform;
+        };
+
+        Node(const Matrix4f& matrix = Matrix4f())
+            : useMatrix(true)
+            , matrix(matrix)
+        {}
+
+        Node(const Point4f& rotation, const Point3f& translation, const Point3f& scale)
+            : useMatrix(false)
+        {
+            transform.rotation = rotation;
+            transform.translation = translation;
+            transform.scale = scale;
+        }
+
+        std::vector<int> children;
+    };
+
+    using NodePose = Platform::NodePose;
+
+    using AnimationSampler = Platform::AnimationSampler;
+    using AnimationChannel = Platform::AnimationChannel;
+
+    bool skinned = false;
+
+    int rootNodeIdx;
+    std::vector<Node> nodes;
+    std::vector<Matrix4f> nodeInvBindMatrices;
+    std::vector<int> jointIndices;  // Node index for each skin joint
+
+    float maxAnimationTime = 0.0f;
+    float minAnimationTime = 0.0f;
+    std::vector<AnimationSampler> animationSamplers;
+    std::vector<AnimationChannel> animationChannels;
+
+    // Flattened node hierarchy, parent always goes before its children
+    std::vector<int> flatNodes;     // Node index for each flattened position
+    std::vector<int> flatParents;   // Flattened position of parent node, -1 for root
+    NodePose bindPose;
+
+    void BuildHierarchy();
+};
+
+} // Platform
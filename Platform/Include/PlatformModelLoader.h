@@ -1,26 +1,25 @@
 #pragma once
 
+#include "PlatformAnimation.h"
 #include "PlatformDevice.h"
+#include "PlatformImageDecodeQueue.h"
 #include "PlatformMatrix.h"
+#include "PlatformModelDesc.h"
 #include "PlatformBaseRenderer.h"
+#include "PlatformThreadPool.h"
 #include "PlatformUtil.h"
 
-#include "..\..\Common\Shaders\GLTFObjectData.h"
-
 namespace tinygltf
 {
 class Model;
-struct Image;
-class Node;
 }
 
 namespace Platform
 {
 
 class BaseRenderer;
-
-struct GLTFSplitData
-GLTF_SPLIT_DATA
+struct GLTFModelData;
+struct ModelCacheOptions;
 
 struct GLTFObjectData
 GLTF_OBJECT_DATA
@@ -30,6 +29,8 @@ struct GLTFGeometry : public BaseRenderer::Geometry
     virtual const void* GetObjCB(size_t& size) const override { size = sizeof(splitData); return &splitData; }
 
     GLTFSplitData splitData;
+    // Vertex bounds in node space, empty bounds mean geometry is never culled
+    AABB<float> bounds;
 };
 
 enum ZPassType
@@ -48,64 +49,11 @@ struct ZPassState
     BaseRenderer::GeometryState* states[ZPassTypeCount] = { 0 };
 };
 
-struct PLATFORM_API GLTFModel
+struct PLATFORM_API GLTFModel : public GLTFModelDesc
 {
-    struct Node
-    {
-        bool useMatrix;
-        union
-        {
-            Matrix4f matrix;
-            struct {
-                Point4f rotation;
-                Point3f translation;
-                Point3f scale;
-            } transform;
-        };
-
-        Node(const Matrix4f& matrix = Matrix4f())
-            : useMatrix(true)
-            , matrix(matrix)
-        {}
-
-        Node(const Point4f& rotation, const Point3f& translation, const Point3f& scale)
-            : useMatrix(false)
-        {
-            transform.rotation = rotation;
-            transform.translation = translation;
-            transform.scale = scale;
-        }
-
-        std::vector<int> children;
-    };
-
-    struct AnimationSampler
-    {
-        // Assumed it is always linear interpolation here
-        std::vector<float> timeKeys;   // Time key values
-        std::vector<Point4f> keys;      // Key values
-    };
-
-    struct AnimationChannel
-    {
-        enum Type
-        {
-            Rotation,
-            Translation,
-            Scale
-        };
-
-        int animSamplerIdx;
-        int nodeIdx;
-        Type type;
-    };
-
-    bool skinned = false;
-
-    int rootNodeIdx;
-    std::vector<Node> nodes;
-    std::vector<Matrix4f> nodeInvBindMatrices;
     GLTFObjectData objData;
+    UINT64 objDataVersion = 1;                  // Is incremented on every objData change
+    mutable BaseRenderer::ObjectCB objCB;       // Uploaded objData
 
     std::vector<GLTFGeometry*> geometries;
     std::vector<GLTFGeometry*> blendGeometries;
@@ -122,15 +70,12 @@ struct PLATFORM_API GLTFModel
 
     std::wstring name;
 
-    float maxAnimationTime = 0.0f;
-    float minAnimationTime = 0.0f;
-    std::vector<AnimationSampler> animationSamplers;
-    std::vector<AnimationChannel> animationChannels;
+    std::vector<Matrix4f> nodeMatrices;         // Scratch space for hierarchy update
 
     void Term(BaseRenderer* pRenderer);
 
     void UpdateMatrices();
-    void UpdateNodeMatrices(int nodeIdx, const Matrix4f& parent);
+    void UpdateNodeMatrices(const NodePose& pose, const Matrix4f& root, const Matrix4f& rootNormals, std::vector<Matrix4f>& scratch, GLTFObjectData& data) const;
 };
 
 struct PLATFORM_API GLTFModelInstance
@@ -139,7 +84,7 @@ struct PLATFORM_API GLTFModelInstance
     Point3f pos;
     float angle;
 
-    std::vector<GLTFModel::Node> nodes;
+    GLTFModel::NodePose pose;
 
     float animationTime = 0.0f;
 
@@ -147,6 +92,8 @@ struct PLATFORM_API GLTFModelInstance
     std::vector<GLTFSplitData> instBlendGeomData;
 
     GLTFObjectData instObjData;
+    UINT64 instObjDataVersion = 1;              // Is incremented on every instObjData change
+    mutable BaseRenderer::ObjectCB instObjCB;   // Uploaded instObjData
 
     void SetPos(const Point3f& _pos);
     void SetAngle(float _angle);
@@ -155,19 +102,26 @@ struct PLATFORM_API GLTFModelInstance
 
     void ApplyAnimation();
     void UpdateMatrices();
-    void UpdateNodeMatrices(int nodeIdx, const Matrix4f& parent, const Matrix4f& parentNormals);
 
 private:
     void SetupTransform();
+
+private:
+    std::vector<Matrix4f> m_nodeMatrices; // Scratch space for hierarchy update
+    std::vector<int> m_samplerCursors;    // Last found key per animation sampler
 };
 
 class PLATFORM_API ModelLoader
 {
 public:
     ModelLoader(bool zPassNormals = false);
+    ModelLoader(const ModelLoader&) = delete;
     virtual ~ModelLoader();
 
-    bool Init(BaseRenderer* pRenderer, const std::vector<std::tstring>& modelFiles, const DXGI_FORMAT hdrFormat, const DXGI_FORMAT cubeHDRFormat, bool forDeferred, bool useLocalCubemaps);
+    ModelLoader& operator=(const ModelLoader&) = delete;
+
+    // Model images are decoded and mip mapped on decode pool in parallel, if it is given
+    bool Init(BaseRenderer* pRenderer, const std::vector<std::tstring>& modelFiles, const DXGI_FORMAT hdrFormat, const DXGI_FORMAT cubeHDRFormat, bool forDeferred, bool useLocalCubemaps, ThreadPool* pDecodePool = nullptr);
     void Term();
 
     inline bool HasModelsToLoad() const { return !m_modelFiles.empty(); }
@@ -188,23 +142,23 @@ private:
     struct ModelLoadState
     {
         GLTFModel* pGLTFModel = nullptr;
-        tinygltf::Model* pModel = nullptr;
+        GLTFModelData* pData = nullptr;
+        tinygltf::Model* pModel = nullptr;  // Source model, exists only while model description is built
+        std::tstring folder;
         std::vector<Platform::GPUResource> modelTextures;
-        std::vector<bool> modelSRGB;
-        bool autoscale = true;
-        float scaleValue = 1.0f;
+        size_t loadedTextures = 0;
+        bool fromCache = false;
+        size_t loadUSec = 0;                // Time spent in model load calls
 
         void ClearState();
     };
 
 private:
-    bool LoadModel(const std::tstring& name, tinygltf::Model** ppModel);
-    bool ScanTexture(const tinygltf::Image& image, bool srgb, Platform::GPUResource& texture);
-    bool ScanNode(const tinygltf::Model& model, int nodeIdx, const std::vector<Platform::GPUResource>& textures);
-    AABB<float> CalcModelAABB(const tinygltf::Model& model, int nodeIdx, const Matrix4f* pTransforms);
+    ModelCacheOptions GetCacheOptions() const;
+    bool DecodeImage(size_t imageIdx, DecodedImage& image) const;
+    bool CreateImageTexture(const DecodedImage& image, Platform::GPUResource& texture);
+    bool CreatePrimitive(size_t primIdx);
     void SetupModelScale();
-    void LoadSkins();
-    void LoadAnimations();
 
 private:
     std::vector<GLTFModel*> m_models;
@@ -220,6 +174,11 @@ private:
     ModelLoadState m_modelLoadState;
 
     std::vector<std::string> m_loadedModels;
+
+    // Parallel image decoding
+    ThreadPool* m_pDecodePool;
+    ImageDecodeQueue m_decodeQueue;
+    size_t m_decodeStartUSec;
 };
 
 } // Platform
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+
+#include "PlatformApi.h"
+
+namespace Platform
+{
+
+// Device-free part of PersistentCBStorage: buffer placement in storage and dirty list.
+// Dirty buffers are turned into copy runs of adjacent buffers, which are copied to GPU at once
+class PLATFORM_API PersistentCBAllocator
+{
+public:
+    static const UINT InvalidHandle = (UINT)-1;
+
+    // Same as D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+    static const UINT Alignment = 256;
+
+    struct CopyRun
+    {
+        UINT64 offset = 0;
+        UINT64 size = 0;
+        UINT bufferCount = 0;
+    };
+
+    PersistentCBAllocator();
+
+    void Init(UINT64 capacity);
+    void Term();
+
+    // Buffer size is aligned, InvalidHandle is returned if storage is full.
+    // Buffer is dirty until the first update and copy
+    UINT Allocate(UINT size);
+    void Free(UINT handle);
+
+    // Puts buffer into dirty list
+    void MarkDirty(UINT handle);
+
+    inline bool IsDirty(UINT handle) const { return m_buffers[handle].dirty; }
+    inline size_t GetDirtyCount() const { return m_dirtyBuffers.size(); }
+    inline UINT GetBufferCount() const { return m_bufferCount; }
+    inline UINT64 GetUsedSize() const { return m_usedSize; }
+    inline UINT64 GetCapacity() const { return m_capacity; }
+
+    inline UINT64 GetOffset(UINT handle) const { return m_buffers[handle].offset; }
+    inline UINT GetSize(UINT handle) const { return m_buffers[handle].size; }
+
+    // Drops entries of freed buffers, sorts the rest in address order
+    // and merges adjacent buffers into runs of up to maxCopySize bytes
+    void BuildCopyRuns(UINT64 maxCopySize, std::vector<CopyRun>& runs);
+    // The first runCount of built runs are copied, their buffers become clean, the rest stay in dirty list
+    void CompleteCopyRuns(const std::vector<CopyRun>& runs, size_t runCount);
+
+private:
+    struct Buffer
+    {
+        UINT64 offset = 0;
+        UINT size = 0;
+        bool used = false;
+        bool dirty = false;     // GPU copy is outdated
+        bool queued = false;    // Is in dirty list
+    };
+
+private:
+    UINT64 m_capacity;
+    UINT64 m_top;                       // End of the allocated part
+
+    std::vector<Buffer> m_buffers;
+    std::vector<UINT> m_freeBuffers;    // Freed buffers, they are reused for the allocations of the same size
+    std::vector<UINT> m_dirtyBuffers;   // Updated buffers, entries of freed ones are dropped when runs are built
+
+    UINT m_bufferCount;
+    UINT64 m_usedSize;
+};
+
+} // Platform
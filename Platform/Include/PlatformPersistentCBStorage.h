@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+#include "PlatformDevice.h"
+#include "PlatformPersistentCBAllocator.h"
+
+namespace Platform
+{
+
+// Constant buffers in default heap, which live between frames, for data that rarely changes.
+// Storage keeps CPU copy of every buffer, updated buffers are put into dirty list and copied to GPU on Flush
+class PLATFORM_API PersistentCBStorage
+{
+public:
+    static const UINT InvalidHandle = PersistentCBAllocator::InvalidHandle;
+
+    struct FlushStats
+    {
+        UINT64 bytes = 0;       // Bytes copied to GPU
+        UINT buffers = 0;       // Buffers copied to GPU
+        UINT copies = 0;        // Copy commands, adjacent buffers are copied at once
+        UINT pending = 0;       // Buffers left dirty, as dynamic heap is out of space
+    };
+
+    PersistentCBStorage();
+    PersistentCBStorage(const PersistentCBStorage&) = delete;
+    virtual ~PersistentCBStorage();
+
+    PersistentCBStorage& operator=(const PersistentCBStorage&) = delete;
+
+    // Storage doesn't grow, as buffer can't be moved while frames in flight read it
+    bool Init(Device* pDevice, UINT64 capacity);
+    void Term();
+
+    // Buffer size is aligned to constant buffer placement alignment.
+    // InvalidHandle is returned if storage is full, buffer is dirty until the first Update and Flush
+    UINT Allocate(UINT size);
+    void Free(UINT handle);
+
+    // Copies data of buffer size and puts buffer into dirty list
+    void Update(UINT handle, const void* pData);
+
+    inline bool IsDirty(UINT handle) const { return m_allocator.IsDirty(handle); }
+    inline size_t GetDirtyCount() const { return m_allocator.GetDirtyCount(); }
+    inline UINT GetBufferCount() const { return m_allocator.GetBufferCount(); }
+    inline UINT64 GetUsedSize() const { return m_allocator.GetUsedSize(); }
+
+    D3D12_GPU_VIRTUAL_ADDRESS GetAddress(UINT handle) const;
+
+    // Records copies of dirty buffers through dynamic heap, should be called before command list reads storage
+    bool Flush(ID3D12GraphicsCommandList* pCommandList);
+
+    inline const FlushStats& GetLastFlushStats() const { return m_lastFlushStats; }
+
+private:
+    Device* m_pDevice;
+
+    GPUResource m_buffer;
+    D3D12_RESOURCE_STATES m_state;
+
+    std::vector<UINT8> m_data;          // CPU copy of the whole storage
+
+    PersistentCBAllocator m_allocator;
+    std::vector<PersistentCBAllocator::CopyRun> m_copyRuns;
+
+    FlushStats m_lastFlushStats;
+};
+
+} // Platform
@@ -0,0 +1,328 @@
+#pragma once
+
+// SIMD instruction set selection
+// Chosen at compile time from compiler flags, define PLATFORM_NO_SIMD to force scalar math everywhere
+#define PLATFORM_SIMD_NONE  0
+#define PLATFORM_SIMD_SSE2  1
+#define PLATFORM_SIMD_AVX2  2
+#define PLATFORM_SIMD_NEON  3
+
+#if defined(PLATFORM_NO_SIMD)
+#define PLATFORM_SIMD PLATFORM_SIMD_NONE
+#elif defined(__AVX2__)
+#define PLATFORM_SIMD PLATFORM_SIMD_AVX2
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLATFORM_SIMD PLATFORM_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define PLATFORM_SIMD PLATFORM_SIMD_NEON
+#else
+#define PLATFORM_SIMD PLATFORM_SIMD_NONE
+#endif
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+#include <immintrin.h>
+#include <math.h>
+#elif PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+#include <emmintrin.h>
+#include <math.h>
+#elif PLATFORM_SIMD == PLATFORM_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#define PLATFORM_FORCEINLINE __forceinline
+#else
+#define PLATFORM_FORCEINLINE inline __attribute__((always_inline))
+#endif
+
+namespace SIMD
+{
+
+// Human readable name of selected instruction set
+inline const char* GetName()
+{
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+    return "AVX2";
+#elif PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+    return "SSE2";
+#elif PLATFORM_SIMD == PLATFORM_SIMD_NEON
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_SSE2 || PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+
+#define SIMD_SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define SIMD_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps((v), (v), SIMD_SHUFFLE_MASK(x, y, z, w))
+#define SIMD_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps((a), (b), SIMD_SHUFFLE_MASK(x, y, z, w))
+
+// 2x2 matrices are packed into one register as (m00, m01, m10, m11)
+
+// A * B
+PLATFORM_FORCEINLINE __m128 Mat2Mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, SIMD_SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(SIMD_SWIZZLE(a, 1, 0, 3, 2), SIMD_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adj(A) * B
+PLATFORM_FORCEINLINE __m128 Mat2AdjMul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(SIMD_SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(SIMD_SWIZZLE(a, 1, 1, 2, 2), SIMD_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// A * adj(B)
+PLATFORM_FORCEINLINE __m128 Mat2MulAdj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, SIMD_SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(SIMD_SWIZZLE(a, 1, 0, 3, 2), SIMD_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// res = a * b, row-major 4x4 matrices
+PLATFORM_FORCEINLINE void Matrix4Multiply(const float* a, const float* b, float* res)
+{
+    __m128 b0 = _mm_loadu_ps(b);
+    __m128 b1 = _mm_loadu_ps(b + 4);
+    __m128 b2 = _mm_loadu_ps(b + 8);
+    __m128 b3 = _mm_loadu_ps(b + 12);
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+    // Process two rows of a per iteration, each 128-bit lane handles its own row
+    __m256 bb0 = _mm256_set_m128(b0, b0);
+    __m256 bb1 = _mm256_set_m128(b1, b1);
+    __m256 bb2 = _mm256_set_m128(b2, b2);
+    __m256 bb3 = _mm256_set_m128(b3, b3);
+
+    for (int i = 0; i < 16; i += 8)
+    {
+        __m256 rows = _mm256_loadu_ps(a + i);
+
+        __m256 r = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, SIMD_SHUFFLE_MASK(0, 0, 0, 0)), bb0);
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, SIMD_SHUFFLE_MASK(1, 1, 1, 1)), bb1));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, SIMD_SHUFFLE_MASK(2, 2, 2, 2)), bb2));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, SIMD_SHUFFLE_MASK(3, 3, 3, 3)), bb3));
+
+        _mm256_storeu_ps(res + i, r);
+    }
+#else
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 row = _mm_loadu_ps(a + i);
+
+        __m128 r = _mm_mul_ps(SIMD_SWIZZLE(row, 0, 0, 0, 0), b0);
+        r = _mm_add_ps(r, _mm_mul_ps(SIMD_SWIZZLE(row, 1, 1, 1, 1), b1));
+        r = _mm_add_ps(r, _mm_mul_ps(SIMD_SWIZZLE(row, 2, 2, 2, 2), b2));
+        r = _mm_add_ps(r, _mm_mul_ps(SIMD_SWIZZLE(row, 3, 3, 3, 3), b3));
+
+        _mm_storeu_ps(res + i, r);
+    }
+#endif
+}
+
+// res = p.x * row0 + p.y * row1 + p.z * row2 + p.w * row3
+PLATFORM_FORCEINLINE void Matrix4Transform(const float* m, const float* p, float* res)
+{
+    __m128 v = _mm_loadu_ps(p);
+
+    __m128 r = _mm_mul_ps(SIMD_SWIZZLE(v, 0, 0, 0, 0), _mm_loadu_ps(m));
+    r = _mm_add_ps(r, _mm_mul_ps(SIMD_SWIZZLE(v, 1, 1, 1, 1), _mm_loadu_ps(m + 4)));
+    r = _mm_add_ps(r, _mm_mul_ps(SIMD_SWIZZLE(v, 2, 2, 2, 2), _mm_loadu_ps(m + 8)));
+    r = _mm_add_ps(r, _mm_mul_ps(SIMD_SWIZZLE(v, 3, 3, 3, 3), _mm_loadu_ps(m + 12)));
+
+    _mm_storeu_ps(res, r);
+}
+
+PLATFORM_FORCEINLINE void Matrix4Transpose(const float* m, float* res)
+{
+    __m128 r0 = _mm_loadu_ps(m);
+    __m128 r1 = _mm_loadu_ps(m + 4);
+    __m128 r2 = _mm_loadu_ps(m + 8);
+    __m128 r3 = _mm_loadu_ps(m + 12);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps(res, r0);
+    _mm_storeu_ps(res + 4, r1);
+    _mm_storeu_ps(res + 8, r2);
+    _mm_storeu_ps(res + 12, r3);
+}
+
+// Block-wise 2x2 inverse, matches scalar cofactor expansion including degenerate case,
+// where adjugate matrix is returned unscaled
+PLATFORM_FORCEINLINE void Matrix4Inverse(const float* m, float* res)
+{
+    __m128 r0 = _mm_loadu_ps(m);
+    __m128 r1 = _mm_loadu_ps(m + 4);
+    __m128 r2 = _mm_loadu_ps(m + 8);
+    __m128 r3 = _mm_loadu_ps(m + 12);
+
+    // Sub matrices
+    __m128 A = _mm_movelh_ps(r0, r1);
+    __m128 B = _mm_movehl_ps(r1, r0);
+    __m128 C = _mm_movelh_ps(r2, r3);
+    __m128 D = _mm_movehl_ps(r3, r2);
+
+    // Determinants of sub matrices as (|A|, |B|, |C|, |D|)
+    __m128 detSub = _mm_sub_ps(
+        _mm_mul_ps(SIMD_SHUFFLE(r0, r2, 0, 2, 0, 2), SIMD_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+        _mm_mul_ps(SIMD_SHUFFLE(r0, r2, 1, 3, 1, 3), SIMD_SHUFFLE(r1, r3, 0, 2, 0, 2))
+    );
+    __m128 detA = SIMD_SWIZZLE(detSub, 0, 0, 0, 0);
+    __m128 detB = SIMD_SWIZZLE(detSub, 1, 1, 1, 1);
+    __m128 detC = SIMD_SWIZZLE(detSub, 2, 2, 2, 2);
+    __m128 detD = SIMD_SWIZZLE(detSub, 3, 3, 3, 3);
+
+    __m128 D_C = Mat2AdjMul(D, C);
+    __m128 A_B = Mat2AdjMul(A, B);
+
+    __m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), Mat2Mul(B, D_C));
+    __m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), Mat2Mul(C, A_B));
+    __m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), Mat2MulAdj(D, A_B));
+    __m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), Mat2MulAdj(A, D_C));
+
+    // |M| = |A|*|D| + |B|*|C| - tr(adj(A)B * adj(D)C)
+    __m128 tr = _mm_mul_ps(A_B, SIMD_SWIZZLE(D_C, 0, 2, 1, 3));
+    tr = _mm_add_ps(tr, SIMD_SWIZZLE(tr, 2, 3, 0, 1));
+    tr = _mm_add_ps(tr, SIMD_SWIZZLE(tr, 1, 0, 3, 2));
+
+    __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+    const __m128 adjSignMask = _mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f);
+    __m128 rDetM = fabsf(_mm_cvtss_f32(detM)) < 0.00001f ? adjSignMask : _mm_div_ps(adjSignMask, detM);
+
+    X_ = _mm_mul_ps(X_, rDetM);
+    Y_ = _mm_mul_ps(Y_, rDetM);
+    Z_ = _mm_mul_ps(Z_, rDetM);
+    W_ = _mm_mul_ps(W_, rDetM);
+
+    // Apply adjugate and store
+    _mm_storeu_ps(res, SIMD_SHUFFLE(X_, Y_, 3, 1, 3, 1));
+    _mm_storeu_ps(res + 4, SIMD_SHUFFLE(X_, Y_, 2, 0, 2, 0));
+    _mm_storeu_ps(res + 8, SIMD_SHUFFLE(Z_, W_, 3, 1, 3, 1));
+    _mm_storeu_ps(res + 12, SIMD_SHUFFLE(Z_, W_, 2, 0, 2, 0));
+}
+
+// a x b in xyz lanes, w lane is zero
+PLATFORM_FORCEINLINE __m128 Cross3(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(SIMD_SWIZZLE(a, 1, 2, 0, 3), SIMD_SWIZZLE(b, 2, 0, 1, 3)),
+        _mm_mul_ps(SIMD_SWIZZLE(a, 2, 0, 1, 3), SIMD_SWIZZLE(b, 1, 2, 0, 3)));
+}
+
+// Rows of inverse of affine matrix, i.e. matrix with (0,0,0,1) last column. Upper 3x3 part is
+// transposed cofactors over determinant, translation row is -t * inverse 3x3. Degenerate matrix
+// gets unscaled cofactors and determinant in m[15], as scalar path gives.
+// Uniform scale isn't detected here, the check costs more than cofactors do
+PLATFORM_FORCEINLINE void Matrix4AffineInverseRows(const float* m, __m128& r0, __m128& r1, __m128& r2, __m128& r3)
+{
+    __m128 a0 = _mm_loadu_ps(m);
+    __m128 a1 = _mm_loadu_ps(m + 4);
+    __m128 a2 = _mm_loadu_ps(m + 8);
+    __m128 t = _mm_loadu_ps(m + 12);
+
+    // Rows of inverse transposed 3x3 part
+    __m128 c0 = Cross3(a1, a2);
+    __m128 c1 = Cross3(a2, a0);
+    __m128 c2 = Cross3(a0, a1);
+
+    // Last column is zero, so 4 lane dot gives 3x3 determinant
+    __m128 det = _mm_mul_ps(a0, c0);
+    det = _mm_add_ps(det, SIMD_SWIZZLE(det, 2, 3, 0, 1));
+    det = _mm_add_ps(det, SIMD_SWIZZLE(det, 1, 0, 3, 2));
+
+    const float detValue = _mm_cvtss_f32(det);
+    float w = 1.0f;
+    if (fabsf(detValue) < 0.00001f)
+    {
+        w = detValue;
+    }
+    else
+    {
+        __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        c0 = _mm_mul_ps(c0, invDet);
+        c1 = _mm_mul_ps(c1, invDet);
+        c2 = _mm_mul_ps(c2, invDet);
+    }
+
+    r0 = c0;
+    r1 = c1;
+    r2 = c2;
+    r3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    // -t.x * r0 - t.y * r1 - t.z * r2 in xyz lanes, w in w lane
+    __m128 tr = _mm_mul_ps(SIMD_SWIZZLE(t, 0, 0, 0, 0), r0);
+    tr = _mm_add_ps(tr, _mm_mul_ps(SIMD_SWIZZLE(t, 1, 1, 1, 1), r1));
+    tr = _mm_add_ps(tr, _mm_mul_ps(SIMD_SWIZZLE(t, 2, 2, 2, 2), r2));
+    r3 = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, w), tr);
+}
+
+PLATFORM_FORCEINLINE void Matrix4AffineInverse(const float* m, float* res)
+{
+    __m128 r0, r1, r2, r3;
+    Matrix4AffineInverseRows(m, r0, r1, r2, r3);
+
+    _mm_storeu_ps(res, r0);
+    _mm_storeu_ps(res + 4, r1);
+    _mm_storeu_ps(res + 8, r2);
+    _mm_storeu_ps(res + 12, r3);
+}
+
+// Transposed affine inverse
+PLATFORM_FORCEINLINE void Matrix4NormalMatrix(const float* m, float* res)
+{
+    __m128 r0, r1, r2, r3;
+    Matrix4AffineInverseRows(m, r0, r1, r2, r3);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps(res, r0);
+    _mm_storeu_ps(res + 4, r1);
+    _mm_storeu_ps(res + 8, r2);
+    _mm_storeu_ps(res + 12, r3);
+}
+
+#elif PLATFORM_SIMD == PLATFORM_SIMD_NEON
+
+PLATFORM_FORCEINLINE void Matrix4Multiply(const float* a, const float* b, float* res)
+{
+    float32x4_t b0 = vld1q_f32(b);
+    float32x4_t b1 = vld1q_f32(b + 4);
+    float32x4_t b2 = vld1q_f32(b + 8);
+    float32x4_t b3 = vld1q_f32(b + 12);
+
+    for (int i = 0; i < 16; i += 4)
+    {
+        float32x4_t r = vmulq_n_f32(b0, a[i + 0]);
+        r = vmlaq_n_f32(r, b1, a[i + 1]);
+        r = vmlaq_n_f32(r, b2, a[i + 2]);
+        r = vmlaq_n_f32(r, b3, a[i + 3]);
+
+        vst1q_f32(res + i, r);
+    }
+}
+
+PLATFORM_FORCEINLINE void Matrix4Transform(const float* m, const float* p, float* res)
+{
+    float32x4_t r = vmulq_n_f32(vld1q_f32(m), p[0]);
+    r = vmlaq_n_f32(r, vld1q_f32(m + 4), p[1]);
+    r = vmlaq_n_f32(r, vld1q_f32(m + 8), p[2]);
+    r = vmlaq_n_f32(r, vld1q_f32(m + 12), p[3]);
+
+    vst1q_f32(res, r);
+}
+
+PLATFORM_FORCEINLINE void Matrix4Transpose(const float* m, float* res)
+{
+    // De-interleaving load gives columns directly
+    float32x4x4_t cols = vld4q_f32(m);
+
+    vst1q_f32(res, cols.val[0]);
+    vst1q_f32(res + 4, cols.val[1]);
+    vst1q_f32(res + 8, cols.val[2]);
+    vst1q_f32(res + 12, cols.val[3]);
+}
+
+#endif
+
+} // SIMD
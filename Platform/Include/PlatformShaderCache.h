@@ -23,6 +23,8 @@ public:
     bool LoadCache(LPCTSTR filename);
 
     inline bool IsModified() const { return m_modified; }
+    // Some of cached shader sources are changed since cache was saved
+    inline bool HasUpdatedSources() const { return m_updatedSources; }
 
 private:
     struct ShaderBinaryKey
@@ -52,6 +54,7 @@ private:
 
     std::map<std::tstring, UINT32> m_srcFilesCRC32;
     bool m_modified;
+    bool m_updatedSources;
 };
 
 } // Platform
@@ -5,6 +5,7 @@ struct Point2;
 using Point2i = Point2<int>;
 
 #include "PlatformDevice.h"
+#include "PlatformMips.h"
 
 namespace Platform
 {
@@ -24,9 +25,18 @@ struct CreateTextureParams
     UINT mips = 1;
 };
 
+// Returns false for formats mips cannot be generated for
+PLATFORM_API bool GetMipPixelFormat(DXGI_FORMAT format, MipPixelFormat& mipFormat);
+
+// DXGI format versions of mip chain functions in PlatformMips.h
+PLATFORM_API size_t CalcTextureSizeWithMips(UINT width, UINT height, DXGI_FORMAT format, UINT& mipCount);
+PLATFORM_API void GenerateTextureMips(void* pData, UINT width, UINT height, DXGI_FORMAT format, UINT mipCount);
+
 PLATFORM_API bool CreateTexture(const CreateTextureParams& params, bool generateMips, Device* pDevice, Platform::GPUResource& textureResource, const void* pInitialData = nullptr, size_t initialDataSize = 0);
 PLATFORM_API bool CreateTextureFromFile(LPCTSTR filename, Device* pDevice, Platform::GPUResource& textureResource, bool srgb = false);
 PLATFORM_API bool CreateTextureArrayFromFile(LPCTSTR filename, const Point2i& grid, Device* pDevice, ID3D12GraphicsCommandList* pUploadCommandList, Platform::GPUResource& textureResource, bool srgb = false);
+// Frames of every file are cut by grid and go to array slices, files one after another
+PLATFORM_API bool CreateTextureArrayFromFiles(const std::vector<std::tstring>& filenames, const Point2i& grid, Device* pDevice, ID3D12GraphicsCommandList* pUploadCommandList, Platform::GPUResource& textureResource, bool srgb = false);
 
 PLATFORM_API void CalcHistogram(LPCTSTR filename);
 
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "PlatformApi.h"
+
+namespace Platform
+{
+
+// Fixed set of worker threads for data parallel loops and asynchronous tasks
+class PLATFORM_API ThreadPool
+{
+public:
+    using RangeFunc = std::function<void(size_t begin, size_t end)>;
+    using Task = std::function<void()>;
+
+    ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    virtual ~ThreadPool();
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Zero worker count means one worker per hardware thread, besides the calling one
+    bool Init(size_t workerCount = 0);
+    // Pending tasks are completed before workers exit
+    void Term();
+
+    inline size_t GetThreadCount() const { return m_workers.size() + 1; }
+
+    // Splits [0, count) into ranges of up to grainSize items and processes them on workers and calling thread.
+    // Returns when all ranges are processed, should not be called from within func or task
+    void ParallelFor(size_t count, size_t grainSize, const RangeFunc& func);
+
+    // Queues task to be executed on some worker, executes it in place if there are no workers.
+    // Workers busy with tasks don't take part in ParallelFor until task is complete
+    void AddTask(const Task& task);
+
+private:
+    struct Job
+    {
+        const RangeFunc* pFunc = nullptr;
+        size_t count = 0;
+        size_t grainSize = 1;
+        size_t rangeCount = 0;
+        std::atomic<size_t> nextRange = { 0 };
+        std::atomic<size_t> doneRanges = { 0 };
+    };
+
+private:
+    void WorkerProc();
+    void ProcessRanges(Job& job);
+
+private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_startCV;
+    std::condition_variable m_doneCV;
+
+    // Current job, workers may still hold it for a while after it is complete
+    std::shared_ptr<Job> m_pJob;
+
+    std::deque<Task> m_tasks;
+
+    bool m_terminate;
+};
+
+} // Platform
@@ -47,8 +47,8 @@ template <typename T>
 struct AABB
 {
     AABB()
-        : bbMax{ -std::numeric_limits<T>::max(), -std::numeric_limits<T>::max(), -std::numeric_limits<T>::max() }
-        , bbMin{ std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), std::numeric_limits<T>::max() }
+        : bbMin{ std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), std::numeric_limits<T>::max() }
+        , bbMax{ -std::numeric_limits<T>::max(), -std::numeric_limits<T>::max(), -std::numeric_limits<T>::max() }
     {}
 
     inline void Add(const Point3<T>& p)
@@ -75,5 +75,9 @@ PLATFORM_API std::tstring StripExtension(const std::tstring& filename);
 PLATFORM_API std::tstring ShortFilename(const std::tstring& filename);
 // Parent folder name
 PLATFORM_API std::tstring GetParentName(const std::tstring& filename);
+// Folder path with trailing separator, empty for filename without path
+PLATFORM_API std::tstring GetFolderPath(const std::tstring& filename);
 // Convert default std::tstring to std::string
 PLATFORM_API std::string ToString(const std::tstring& src);
+// Convert std::string to default std::tstring
+PLATFORM_API std::tstring ToTString(const std::string& src);
@@ -0,0 +1,338 @@
+#include "stdafx.h"
+#include "PlatformAnimation.h"
+
+#include "PlatformUtil.h"
+
+#include <algorithm>
+
+namespace Platform
+{
+
+void NodePose::Resize(size_t count)
+{
+    useMatrix.resize(count);
+    matrix.resize(count);
+    rotation.resize(count);
+    translation.resize(count);
+    scale.resize(count);
+}
+
+Matrix4f NodePose::CalcLocalMatrix(size_t idx) const
+{
+    if (useMatrix[idx])
+    {
+        return matrix[idx];
+    }
+
+    // Same as scale * rotation * translation
+    Matrix4f m;
+    m.FromQuaternion(rotation[idx]);
+
+    const Point3f& s = scale[idx];
+    for (int i = 0; i < 3; i++)
+    {
+        m.m[0 + i] *= s.x;
+        m.m[4 + i] *= s.y;
+        m.m[8 + i] *= s.z;
+    }
+
+    m.m[12] = translation[idx].x;
+    m.m[13] = translation[idx].y;
+    m.m[14] = translation[idx].z;
+
+    return m;
+}
+
+Point4f AnimationSampler::GetKey(size_t idx) const
+{
+    if (packedKeys.empty())
+    {
+        return keys[idx];
+    }
+
+    const UINT16* pKey = packedKeys.data() + idx * 3;
+
+    if (rotation)
+    {
+        // Index of dropped component is stored in the top bits of the first two values
+        int maxIdx = ((pKey[0] >> 15) << 1) | (pKey[1] >> 15);
+
+        float q[4];
+        float sum = 0.0f;
+        for (int i = 0, j = 0; i < 4; i++)
+        {
+            if (i != maxIdx)
+            {
+                q[i] = ((pKey[j] & 0x7fff) * (2.0f / 0x7fff) - 1.0f) * (float)M_SQRT1_2;
+                sum += q[i] * q[i];
+                ++j;
+            }
+        }
+        q[maxIdx] = sqrtf(std::max(0.0f, 1.0f - sum));
+
+        return Point4f(q[0], q[1], q[2], q[3]);
+    }
+
+    return Point4f(
+        rangeMin.x + pKey[0] * (rangeSize.x / 0xffff),
+        rangeMin.y + pKey[1] * (rangeSize.y / 0xffff),
+        rangeMin.z + pKey[2] * (rangeSize.z / 0xffff),
+        0.0f
+    );
+}
+
+void AnimationSampler::Compress(bool isRotation, float tolerance)
+{
+    rotation = isRotation;
+
+    const size_t keyCount = keys.size();
+
+    Point4f bbMin = keys.empty() ? Point4f() : keys[0];
+    Point4f bbMax = bbMin;
+    for (const auto& key : keys)
+    {
+        bbMin = Point4f(std::min(bbMin.x, key.x), std::min(bbMin.y, key.y), std::min(bbMin.z, key.z), 0.0f);
+        bbMax = Point4f(std::max(bbMax.x, key.x), std::max(bbMax.y, key.y), std::max(bbMax.z, key.z), 0.0f);
+    }
+
+    // Tolerance is relative to track range for translation and scale, and is angle in radians for rotation
+    const float maxExtent = std::max(std::max(bbMax.x - bbMin.x, bbMax.y - bbMin.y), bbMax.z - bbMin.z);
+    const float absTolerance = std::max(maxExtent * tolerance, 0.000001f);
+    // Rotation angle is compared by chord length between unit quaternions,
+    // cosine of small angle is too close to 1 for float
+    const float maxChord = 2.0f * sinf(tolerance * 0.25f);
+    const float maxChordSqr = maxChord * maxChord;
+
+    auto exceedsTolerance = [&](const Point4f& key, const Point4f& ref) -> bool
+    {
+        if (isRotation)
+        {
+            Point4f unitRef = ref;
+            unitRef.normalize();
+            Point4f diff = key.dot(unitRef) < 0.0f ? key + unitRef : key - unitRef;
+            return diff.dot(diff) > maxChordSqr;
+        }
+        return fabs(key.x - ref.x) > absTolerance || fabs(key.y - ref.y) > absTolerance || fabs(key.z - ref.z) > absTolerance;
+    };
+
+    // Greedily drop keys while all skipped keys are restored by interpolation between neighbour kept ones
+    std::vector<size_t> keptKeys;
+    if (keyCount > 0)
+    {
+        keptKeys.push_back(0);
+
+        size_t lastKept = 0;
+        for (size_t k = 1; k + 1 < keyCount; k++)
+        {
+            const size_t next = k + 1;
+            const float timeRange = timeKeys[next] - timeKeys[lastKept];
+
+            bool canDrop = timeRange > 0.0f;
+            for (size_t j = lastKept + 1; j <= k && canDrop; j++)
+            {
+                float t = (timeKeys[j] - timeKeys[lastKept]) / timeRange;
+                Point4f interpolated = isRotation
+                    ? Point4f::Slerp(keys[lastKept], keys[next], t)
+                    : keys[lastKept] * (1.0f - t) + keys[next] * t;
+                if (isRotation)
+                {
+                    interpolated.normalize();
+                }
+
+                canDrop = !exceedsTolerance(interpolated, keys[j]);
+            }
+
+            if (!canDrop)
+            {
+                keptKeys.push_back(k);
+                lastKept = k;
+            }
+        }
+
+        if (keyCount > 1)
+        {
+            keptKeys.push_back(keyCount - 1);
+        }
+    }
+
+    rangeMin = Point3f(bbMin.x, bbMin.y, bbMin.z);
+    rangeSize = Point3f(bbMax.x - bbMin.x, bbMax.y - bbMin.y, bbMax.z - bbMin.z);
+
+    std::vector<float> newTimeKeys(keptKeys.size());
+    packedKeys.resize(keptKeys.size() * 3);
+    for (size_t i = 0; i < keptKeys.size(); i++)
+    {
+        newTimeKeys[i] = timeKeys[keptKeys[i]];
+
+        Point4f key = keys[keptKeys[i]];
+        UINT16* pKey = packedKeys.data() + i * 3;
+
+        if (isRotation)
+        {
+            key.normalize();
+
+            float q[4] = { key.x, key.y, key.z, key.w };
+
+            int maxIdx = 0;
+            for (int j = 1; j < 4; j++)
+            {
+                if (fabs(q[j]) > fabs(q[maxIdx]))
+                {
+                    maxIdx = j;
+                }
+            }
+            // q and -q are the same rotation, so largest component is always restored as positive
+            float sign = q[maxIdx] < 0.0f ? -1.0f : 1.0f;
+
+            for (int j = 0, k = 0; j < 4; j++)
+            {
+                if (j != maxIdx)
+                {
+                    float v = Clamp(q[j] * sign * (float)M_SQRT2 * 0.5f + 0.5f, 0.0f, 1.0f);
+                    pKey[k++] = (UINT16)(v * 0x7fff + 0.5f);
+                }
+            }
+            pKey[0] |= (UINT16)((maxIdx >> 1) << 15);
+            pKey[1] |= (UINT16)((maxIdx & 1) << 15);
+        }
+        else
+        {
+            const float* pValue = &key.x;
+            const float* pMin = &rangeMin.x;
+            const float* pSize = &rangeSize.x;
+            for (int j = 0; j < 3; j++)
+            {
+                float v = pSize[j] > 0.0f ? (pValue[j] - pMin[j]) / pSize[j] : 0.0f;
+                pKey[j] = (UINT16)(Clamp(v, 0.0f, 1.0f) * 0xffff + 0.5f);
+            }
+        }
+    }
+
+    timeKeys.swap(newTimeKeys);
+
+    keys.clear();
+    keys.shrink_to_fit();
+}
+
+int FindKey(const std::vector<float>& timeKeys, float time, int& cursor)
+{
+    const int lastKey = (int)timeKeys.size() - 1;
+
+    cursor = std::min(cursor, lastKey);
+
+    // Playback usually stays in the same key interval or moves to the next one
+    if (timeKeys[cursor] <= time)
+    {
+        if (cursor == lastKey || time < timeKeys[cursor + 1])
+        {
+            return cursor;
+        }
+        if (cursor + 1 == lastKey || time < timeKeys[cursor + 2])
+        {
+            return ++cursor;
+        }
+    }
+
+    // Seek or loop, fall back to binary search
+    cursor = (int)(std::upper_bound(timeKeys.begin(), timeKeys.end(), time) - timeKeys.begin()) - 1;
+    cursor = std::max(cursor, 0);
+
+    return cursor;
+}
+
+void SampleAnimation(const std::vector<AnimationSampler>& samplers, const std::vector<AnimationChannel>& channels, float localTime, std::vector<int>& cursors, NodePose& pose)
+{
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        const int samplerIdx = channels[i].animSamplerIdx;
+        const AnimationSampler& sampler = samplers[samplerIdx];
+
+        Point4f value;
+        if (sampler.timeKeys.size() == 1)
+        {
+            value = sampler.GetKey(0);
+        }
+        else
+        {
+            int idx0, idx1;
+            float ratio;
+
+            if (localTime < sampler.timeKeys.front())
+            {
+                idx0 = (int)sampler.GetKeyCount() - 1;
+                idx1 = 0;
+
+                ratio = localTime / sampler.timeKeys.front();
+            }
+            else
+            {
+                idx0 = FindKey(sampler.timeKeys, localTime, cursors[samplerIdx]);
+                if (idx0 == (int)sampler.timeKeys.size() - 1)
+                {
+                    // Sampler is shorter than the animation, hold the last key
+                    idx1 = idx0;
+                    ratio = 0.0f;
+                }
+                else
+                {
+                    idx1 = idx0 + 1;
+                    ratio = (localTime - sampler.timeKeys[idx0]) / (sampler.timeKeys[idx1] - sampler.timeKeys[idx0]);
+                }
+            }
+
+            Point4f key0 = sampler.GetKey(idx0);
+            Point4f key1 = sampler.GetKey(idx1);
+            if (channels[i].type == AnimationChannel::Rotation)
+            {
+                value = Point4f::Slerp(key0, key1, ratio);
+            }
+            else
+            {
+                value = key0 * (1.0f - ratio) + key1 * ratio;
+            }
+        }
+
+        const int flatIdx = channels[i].flatNodeIdx;
+        if (flatIdx == -1)
+        {
+            continue;
+        }
+
+        if (pose.useMatrix[flatIdx])
+        {
+            pose.rotation[flatIdx] = Point4f(0, 0, 0, 1);
+            pose.translation[flatIdx] = Point3f(0, 0, 0);
+            pose.scale[flatIdx] = Point3f(1, 1, 1);
+
+            pose.useMatrix[flatIdx] = false;
+        }
+        switch (channels[i].type)
+        {
+            case AnimationChannel::Rotation:
+                pose.rotation[flatIdx] = value;
+                break;
+
+            case AnimationChannel::Translation:
+                pose.translation[flatIdx] = value;
+                break;
+
+            case AnimationChannel::Scale:
+                pose.scale[flatIdx] = value;
+                break;
+        }
+    }
+}
+
+void CalcHierarchyMatrices(const NodePose& pose, const std::vector<int>& flatParents, const Matrix4f& root, const Matrix4f& rootNormals, Matrix4f* pWorld, Matrix4f* pNormals)
+{
+    for (size_t i = 0; i < flatParents.size(); i++)
+    {
+        Matrix4f local = pose.CalcLocalMatrix(i);
+
+        int parentIdx = flatParents[i];
+        pWorld[i] = local * (parentIdx == -1 ? root : pWorld[parentIdx]);
+        pNormals[i] = local * (parentIdx == -1 ? rootNormals : pNormals[parentIdx]);
+    }
+}
+
+} // Platform
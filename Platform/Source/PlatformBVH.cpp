@@ -0,0 +1,654 @@
+#include "stdafx.h"
+#include "PlatformBVH.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+
+const int BinCount = 12;
+// Deeper nodes are split by object median, so degenerate input doesn't make the tree too deep
+const UINT MaxSAHDepth = 48;
+// Rotation should lower parent box area by this part of grandparent box area
+const float RotationThreshold = 0.0001f;
+
+// Marks stack entries of nodes, which are known to be inside of query volume
+const UINT InsideFlag = 0x80000000u;
+
+// Traversal stack, shared by all queries of the thread
+thread_local std::vector<UINT> t_stack;
+
+inline float GetAxis(const Point3f& p, int axis)
+{
+    return axis == 0 ? p.x : (axis == 1 ? p.y : p.z);
+}
+
+inline float CalcArea(const Point3f& bbMin, const Point3f& bbMax)
+{
+    Point3f size = bbMax - bbMin;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+inline void Merge(Point3f& bbMin, Point3f& bbMax, const Point3f& addMin, const Point3f& addMax)
+{
+    bbMin = Point3f{ std::min(bbMin.x, addMin.x), std::min(bbMin.y, addMin.y), std::min(bbMin.z, addMin.z) };
+    bbMax = Point3f{ std::max(bbMax.x, addMax.x), std::max(bbMax.y, addMax.y), std::max(bbMax.z, addMax.z) };
+}
+
+inline float CalcMergedArea(const Platform::BVH::Node& a, const Platform::BVH::Node& b)
+{
+    Point3f bbMin = a.bbMin;
+    Point3f bbMax = a.bbMax;
+    Merge(bbMin, bbMax, b.bbMin, b.bbMax);
+
+    return CalcArea(bbMin, bbMax);
+}
+
+struct Bin
+{
+    Point3f bbMin;
+    Point3f bbMax;
+    UINT count = 0;
+};
+
+}
+
+namespace Platform
+{
+
+struct BVH::BuildItem
+{
+    Point3f bbMin;
+    Point3f bbMax;
+    Point3f center;
+    UINT object;
+};
+
+BVH::BVH()
+    : m_rotationCount(0)
+    , m_buildSAHCost(0.0f)
+{
+}
+
+void BVH::Build(const std::vector<AABB<float>>& boxes)
+{
+    Clear();
+
+    m_boxes = boxes;
+    if (m_boxes.empty())
+    {
+        return;
+    }
+
+    const UINT count = (UINT)m_boxes.size();
+
+    std::vector<BuildItem> items(count);
+    for (UINT i = 0; i < count; i++)
+    {
+        items[i].bbMin = m_boxes[i].bbMin;
+        items[i].bbMax = m_boxes[i].bbMax;
+        items[i].center = (m_boxes[i].bbMin + m_boxes[i].bbMax) * 0.5f;
+        items[i].object = i;
+    }
+
+    m_objects.resize(count);
+    m_objectLeaves.resize(count);
+
+    // Binary tree with up to one object per leaf has less than 2N nodes
+    m_nodes.reserve(2 * count);
+    m_parents.reserve(2 * count);
+
+    m_nodes.resize(1);
+    m_parents.resize(1);
+    m_parents[0] = InvalidIndex;
+
+    BuildNode(0, 0, count, 0, items);
+
+    m_buildSAHCost = CalcStats().sahCost;
+}
+
+void BVH::Rebuild()
+{
+    // Build clears object boxes, so they are taken out first
+    std::vector<AABB<float>> boxes;
+    boxes.swap(m_boxes);
+
+    Build(boxes);
+}
+
+void BVH::Clear()
+{
+    m_nodes.clear();
+    m_parents.clear();
+    m_objects.clear();
+    m_objectLeaves.clear();
+    m_boxes.clear();
+    m_dirtyObjects.clear();
+
+    m_rotationCount = 0;
+    m_buildSAHCost = 0.0f;
+}
+
+AABB<float> BVH::GetBounds() const
+{
+    AABB<float> res;
+    if (!m_nodes.empty())
+    {
+        res.bbMin = m_nodes[0].bbMin;
+        res.bbMax = m_nodes[0].bbMax;
+    }
+
+    return res;
+}
+
+void BVH::Update(UINT object, const AABB<float>& box)
+{
+    assert(object < m_boxes.size());
+
+    m_boxes[object] = box;
+    m_dirtyObjects.push_back(object);
+}
+
+size_t BVH::Refit()
+{
+    size_t refitted = 0;
+
+    for (UINT object : m_dirtyObjects)
+    {
+        UINT nodeIdx = m_objectLeaves[object];
+        while (nodeIdx != InvalidIndex)
+        {
+            const Point3f oldMin = m_nodes[nodeIdx].bbMin;
+            const Point3f oldMax = m_nodes[nodeIdx].bbMax;
+
+            UpdateNodeBox(nodeIdx);
+            ++refitted;
+
+            if (!m_nodes[nodeIdx].IsLeaf())
+            {
+                Rotate(nodeIdx);
+            }
+
+            // Boxes above are up to date, if this one didn't change
+            const Node& node = m_nodes[nodeIdx];
+            if (node.bbMin.x == oldMin.x && node.bbMin.y == oldMin.y && node.bbMin.z == oldMin.z
+                && node.bbMax.x == oldMax.x && node.bbMax.y == oldMax.y && node.bbMax.z == oldMax.z)
+            {
+                break;
+            }
+
+            nodeIdx = m_parents[nodeIdx];
+        }
+    }
+
+    m_dirtyObjects.clear();
+
+    return refitted;
+}
+
+template <typename BoxTest>
+void BVH::Query(const BoxTest& test, std::vector<UINT>& objects) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    std::vector<UINT>& stack = t_stack;
+    stack.clear();
+    stack.push_back(0);
+
+    while (!stack.empty())
+    {
+        UINT nodeIdx = stack.back();
+        stack.pop_back();
+
+        // Nodes below the inside one are marked, they are not tested
+        const bool inside = (nodeIdx & InsideFlag) != 0;
+        const Node& node = m_nodes[nodeIdx & ~InsideFlag];
+
+        const Frustum::BoxClass nodeClass = inside ? Frustum::BoxInside : test(node.bbMin, node.bbMax);
+        if (nodeClass == Frustum::BoxOutside)
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            for (UINT i = node.index; i < node.index + node.count; i++)
+            {
+                const AABB<float>& box = m_boxes[m_objects[i]];
+                if (nodeClass == Frustum::BoxInside || test(box.bbMin, box.bbMax) != Frustum::BoxOutside)
+                {
+                    objects.push_back(m_objects[i]);
+                }
+            }
+        }
+        else
+        {
+            const UINT flag = nodeClass == Frustum::BoxInside ? InsideFlag : 0;
+            stack.push_back((node.index + 1) | flag);
+            stack.push_back(node.index | flag);
+        }
+    }
+}
+
+void BVH::QueryFrustum(const Frustum& frustum, std::vector<UINT>& objects) const
+{
+    Query([&frustum](const Point3f& bbMin, const Point3f& bbMax)
+    {
+        return frustum.ClassifyBox((bbMin + bbMax) * 0.5f, (bbMax - bbMin) * 0.5f);
+    }, objects);
+}
+
+void BVH::QuerySphere(const Point3f& center, float radius, std::vector<UINT>& objects) const
+{
+    const float radiusSq = radius * radius;
+
+    Query([&center, radiusSq](const Point3f& bbMin, const Point3f& bbMax)
+    {
+        // Distances from sphere center to the nearest and the farthest box points
+        Point3f nearest{
+            std::max(std::max(bbMin.x - center.x, center.x - bbMax.x), 0.0f),
+            std::max(std::max(bbMin.y - center.y, center.y - bbMax.y), 0.0f),
+            std::max(std::max(bbMin.z - center.z, center.z - bbMax.z), 0.0f)
+        };
+        if (nearest.lengthSqr() > radiusSq)
+        {
+            return Frustum::BoxOutside;
+        }
+
+        Point3f farthest{
+            std::max(center.x - bbMin.x, bbMax.x - center.x),
+            std::max(center.y - bbMin.y, bbMax.y - center.y),
+            std::max(center.z - bbMin.z, bbMax.z - center.z)
+        };
+        return farthest.lengthSqr() <= radiusSq ? Frustum::BoxInside : Frustum::BoxIntersects;
+    }, objects);
+}
+
+void BVH::QueryBox(const AABB<float>& box, std::vector<UINT>& objects) const
+{
+    Query([&box](const Point3f& bbMin, const Point3f& bbMax)
+    {
+        if (bbMin.x > box.bbMax.x || bbMax.x < box.bbMin.x
+            || bbMin.y > box.bbMax.y || bbMax.y < box.bbMin.y
+            || bbMin.z > box.bbMax.z || bbMax.z < box.bbMin.z)
+        {
+            return Frustum::BoxOutside;
+        }
+
+        return bbMin.x >= box.bbMin.x && bbMax.x <= box.bbMax.x
+            && bbMin.y >= box.bbMin.y && bbMax.y <= box.bbMax.y
+            && bbMin.z >= box.bbMin.z && bbMax.z <= box.bbMax.z ? Frustum::BoxInside : Frustum::BoxIntersects;
+    }, objects);
+}
+
+UINT BVH::QueryRay(const Point3f& origin, const Point3f& dir, float maxDist, float& hitDist) const
+{
+    UINT res = InvalidIndex;
+    hitDist = maxDist;
+
+    if (m_nodes.empty())
+    {
+        return res;
+    }
+
+    const Point3f invDir{ 1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z };
+
+    // Slab test, box is hit if entry distance is not greater than exit one and the nearest hit so far
+    auto hitBox = [&origin, &invDir, &hitDist](const Point3f& bbMin, const Point3f& bbMax, float& dist)
+    {
+        float x0 = (bbMin.x - origin.x) * invDir.x;
+        float x1 = (bbMax.x - origin.x) * invDir.x;
+        float y0 = (bbMin.y - origin.y) * invDir.y;
+        float y1 = (bbMax.y - origin.y) * invDir.y;
+        float z0 = (bbMin.z - origin.z) * invDir.z;
+        float z1 = (bbMax.z - origin.z) * invDir.z;
+
+        float tMin = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+        float tMax = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), hitDist));
+
+        dist = tMin;
+        return tMin <= tMax;
+    };
+
+    std::vector<UINT>& stack = t_stack;
+    stack.clear();
+    stack.push_back(0);
+
+    while (!stack.empty())
+    {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        float dist = 0.0f;
+        if (!hitBox(node.bbMin, node.bbMax, dist))
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            for (UINT i = node.index; i < node.index + node.count; i++)
+            {
+                const AABB<float>& box = m_boxes[m_objects[i]];
+                if (hitBox(box.bbMin, box.bbMax, dist))
+                {
+                    hitDist = dist;
+                    res = m_objects[i];
+                }
+            }
+        }
+        else
+        {
+            // Nearer child is visited first, so the farther one is likely skipped
+            float dist0 = 0.0f;
+            float dist1 = 0.0f;
+            bool hit0 = hitBox(m_nodes[node.index].bbMin, m_nodes[node.index].bbMax, dist0);
+            bool hit1 = hitBox(m_nodes[node.index + 1].bbMin, m_nodes[node.index + 1].bbMax, dist1);
+
+            UINT nearIdx = node.index;
+            UINT farIdx = node.index + 1;
+            if (hit1 && (!hit0 || dist1 < dist0))
+            {
+                std::swap(nearIdx, farIdx);
+                std::swap(hit0, hit1);
+            }
+
+            if (hit1)
+            {
+                stack.push_back(farIdx);
+            }
+            if (hit0)
+            {
+                stack.push_back(nearIdx);
+            }
+        }
+    }
+
+    return res;
+}
+
+BVH::Stats BVH::CalcStats() const
+{
+    Stats stats;
+    if (m_nodes.empty())
+    {
+        return stats;
+    }
+
+    stats.nodes = m_nodes.size();
+
+    const float rootArea = CalcArea(m_nodes[0].bbMin, m_nodes[0].bbMax);
+
+    std::vector<std::pair<UINT, UINT>> stack;
+    stack.push_back(std::make_pair(0u, 1u));
+    while (!stack.empty())
+    {
+        const Node& node = m_nodes[stack.back().first];
+        const UINT depth = stack.back().second;
+        stack.pop_back();
+
+        stats.depth = std::max(stats.depth, (size_t)depth);
+
+        const float area = rootArea > 0.0f ? CalcArea(node.bbMin, node.bbMax) / rootArea : 1.0f;
+        if (node.IsLeaf())
+        {
+            ++stats.leaves;
+            stats.sahCost += area * node.count;
+        }
+        else
+        {
+            stats.sahCost += area;
+            stack.push_back(std::make_pair(node.index, depth + 1));
+            stack.push_back(std::make_pair(node.index + 1, depth + 1));
+        }
+    }
+
+    return stats;
+}
+
+void BVH::BuildNode(UINT nodeIdx, UINT begin, UINT end, UINT depth, std::vector<BuildItem>& items)
+{
+    const UINT count = end - begin;
+
+    Point3f bbMin = items[begin].bbMin;
+    Point3f bbMax = items[begin].bbMax;
+    Point3f centerMin = items[begin].center;
+    Point3f centerMax = centerMin;
+    for (UINT i = begin + 1; i < end; i++)
+    {
+        Merge(bbMin, bbMax, items[i].bbMin, items[i].bbMax);
+        Merge(centerMin, centerMax, items[i].center, items[i].center);
+    }
+
+    m_nodes[nodeIdx].bbMin = bbMin;
+    m_nodes[nodeIdx].bbMax = bbMax;
+
+    if (count == 1)
+    {
+        MakeLeaf(nodeIdx, begin, end, items);
+        return;
+    }
+
+    // Binned SAH, split cost is one node test plus object tests of both children, weighted by their areas
+    int bestBin = -1;
+    float bestCost = std::numeric_limits<float>::max();
+
+    const Point3f centerSize = centerMax - centerMin;
+
+    // Only the largest axis of centers is binned, it costs a third of all axes and gives close tree quality
+    const int axis = centerSize.x >= centerSize.y && centerSize.x >= centerSize.z ? 0 : (centerSize.y >= centerSize.z ? 1 : 2);
+    const float axisMin = GetAxis(centerMin, axis);
+    const float axisSize = GetAxis(centerSize, axis);
+    const float binScale = axisSize > 0.0f ? BinCount / axisSize : 0.0f;
+
+    if (depth < MaxSAHDepth && axisSize > 0.0f)
+    {
+        Bin bins[BinCount];
+        for (UINT i = begin; i < end; i++)
+        {
+            const BuildItem& item = items[i];
+
+            Bin& bin = bins[std::min((int)((GetAxis(item.center, axis) - axisMin) * binScale), BinCount - 1)];
+            if (bin.count == 0)
+            {
+                bin.bbMin = item.bbMin;
+                bin.bbMax = item.bbMax;
+            }
+            else
+            {
+                Merge(bin.bbMin, bin.bbMax, item.bbMin, item.bbMax);
+            }
+            ++bin.count;
+        }
+
+        // Left sides are accumulated in forward pass, right sides in backward one
+        float leftCost[BinCount - 1];
+        Bin left;
+        for (int i = 0; i < BinCount - 1; i++)
+        {
+            if (bins[i].count != 0)
+            {
+                if (left.count == 0)
+                {
+                    left = bins[i];
+                }
+                else
+                {
+                    Merge(left.bbMin, left.bbMax, bins[i].bbMin, bins[i].bbMax);
+                    left.count += bins[i].count;
+                }
+            }
+            leftCost[i] = left.count != 0 ? CalcArea(left.bbMin, left.bbMax) * left.count : 0.0f;
+        }
+
+        Bin right;
+        for (int i = BinCount - 1; i > 0; i--)
+        {
+            if (bins[i].count != 0)
+            {
+                if (right.count == 0)
+                {
+                    right = bins[i];
+                }
+                else
+                {
+                    Merge(right.bbMin, right.bbMax, bins[i].bbMin, bins[i].bbMax);
+                    right.count += bins[i].count;
+                }
+            }
+
+            // Split goes between bins i - 1 and i
+            if (right.count != 0 && right.count != count)
+            {
+                float cost = leftCost[i - 1] + CalcArea(right.bbMin, right.bbMax) * right.count;
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestBin = i;
+                }
+            }
+        }
+    }
+
+    const float area = CalcArea(bbMin, bbMax);
+    if (count <= MaxLeafSize && (bestBin == -1 || area + bestCost >= area * count))
+    {
+        MakeLeaf(nodeIdx, begin, end, items);
+        return;
+    }
+
+    UINT mid = begin + count / 2;
+    if (bestBin != -1)
+    {
+        auto midIt = std::partition(items.begin() + begin, items.begin() + end, [&](const BuildItem& item)
+        {
+            return std::min((int)((GetAxis(item.center, axis) - axisMin) * binScale), BinCount - 1) < bestBin;
+        });
+        mid = (UINT)(midIt - items.begin());
+    }
+    else
+    {
+        // Object median, when SAH is off or all centers coincide
+        std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end, [axis](const BuildItem& a, const BuildItem& b)
+        {
+            return GetAxis(a.center, axis) < GetAxis(b.center, axis);
+        });
+    }
+
+    const UINT childIdx = (UINT)m_nodes.size();
+    m_nodes.resize(m_nodes.size() + 2);
+    m_parents.resize(m_parents.size() + 2, nodeIdx);
+
+    m_nodes[nodeIdx].index = childIdx;
+    m_nodes[nodeIdx].count = 0;
+
+    BuildNode(childIdx, begin, mid, depth + 1, items);
+    BuildNode(childIdx + 1, mid, end, depth + 1, items);
+}
+
+void BVH::MakeLeaf(UINT nodeIdx, UINT begin, UINT end, const std::vector<BuildItem>& items)
+{
+    m_nodes[nodeIdx].index = begin;
+    m_nodes[nodeIdx].count = end - begin;
+
+    for (UINT i = begin; i < end; i++)
+    {
+        m_objects[i] = items[i].object;
+        m_objectLeaves[items[i].object] = nodeIdx;
+    }
+}
+
+void BVH::UpdateNodeBox(UINT nodeIdx)
+{
+    Node& node = m_nodes[nodeIdx];
+    if (node.IsLeaf())
+    {
+        node.bbMin = m_boxes[m_objects[node.index]].bbMin;
+        node.bbMax = m_boxes[m_objects[node.index]].bbMax;
+        for (UINT i = node.index + 1; i < node.index + node.count; i++)
+        {
+            Merge(node.bbMin, node.bbMax, m_boxes[m_objects[i]].bbMin, m_boxes[m_objects[i]].bbMax);
+        }
+    }
+    else
+    {
+        node.bbMin = m_nodes[node.index].bbMin;
+        node.bbMax = m_nodes[node.index].bbMax;
+        Merge(node.bbMin, node.bbMax, m_nodes[node.index + 1].bbMin, m_nodes[node.index + 1].bbMax);
+    }
+}
+
+void BVH::Rotate(UINT nodeIdx)
+{
+    // Child is swapped with grandchild from the other side, if it shrinks the other child box the most
+    const UINT left = m_nodes[nodeIdx].index;
+    const UINT right = left + 1;
+
+    UINT swapA = InvalidIndex;
+    UINT swapB = InvalidIndex;
+    UINT changed = InvalidIndex;
+    float bestGain = RotationThreshold * CalcArea(m_nodes[nodeIdx].bbMin, m_nodes[nodeIdx].bbMax);
+
+    for (int side = 0; side < 2; side++)
+    {
+        const UINT child = side == 0 ? left : right;
+        const UINT other = side == 0 ? right : left;
+        if (m_nodes[other].IsLeaf())
+        {
+            continue;
+        }
+
+        const float otherArea = CalcArea(m_nodes[other].bbMin, m_nodes[other].bbMax);
+        for (int i = 0; i < 2; i++)
+        {
+            // Grandchild moves up, child takes its place next to grandchild sibling
+            const UINT grandchild = m_nodes[other].index + i;
+            const UINT sibling = m_nodes[other].index + 1 - i;
+
+            float gain = otherArea - CalcMergedArea(m_nodes[child], m_nodes[sibling]);
+            if (gain > bestGain)
+            {
+                bestGain = gain;
+                swapA = child;
+                swapB = grandchild;
+                changed = other;
+            }
+        }
+    }
+
+    if (changed != InvalidIndex)
+    {
+        SwapNodes(swapA, swapB);
+        UpdateNodeBox(changed);
+
+        ++m_rotationCount;
+    }
+}
+
+void BVH::SwapNodes(UINT a, UINT b)
+{
+    std::swap(m_nodes[a], m_nodes[b]);
+
+    for (UINT nodeIdx : { a, b })
+    {
+        const Node& node = m_nodes[nodeIdx];
+        if (node.IsLeaf())
+        {
+            for (UINT i = node.index; i < node.index + node.count; i++)
+            {
+                m_objectLeaves[m_objects[i]] = nodeIdx;
+            }
+        }
+        else
+        {
+            m_parents[node.index] = nodeIdx;
+            m_parents[node.index + 1] = nodeIdx;
+        }
+    }
+}
+
+} // Platform
@@ -3,6 +3,9 @@
 
 #include "Platform.h"
 #include "PlatformShaderCache.h"
+#include "PlatformPipelineStateCache.h"
+
+#include <chrono>
 
 namespace
 {
@@ -28,10 +31,12 @@ BaseRenderer::BaseRenderer(Device* pDevice, UINT commonCBCount, UINT commonTexCo
     , m_pDSVHeap(nullptr)
     , m_depthBuffer()
     , m_pShaderCache(nullptr)
+    , m_pPipelineStateCache(nullptr)
     , m_commonCBCount(commonCBCount)
     , m_commonTexCount(commonTexCount)
     , m_commonCBSizes(commonCBSizes)
     , m_additionalDSDescCount(additionalDSDescCount)
+    , m_frame(0)
 {
 }
 
@@ -43,6 +48,7 @@ BaseRenderer::~BaseRenderer()
     assert(m_pCurrentBackBuffer == nullptr);
     assert(m_pDSVHeap == nullptr);
     assert(m_pShaderCache == nullptr);
+    assert(m_pPipelineStateCache == nullptr);
 }
 
 bool BaseRenderer::Init(HWND hWnd)
@@ -52,6 +58,9 @@ bool BaseRenderer::Init(HWND hWnd)
     {
         m_pShaderCache = new ShaderCache();
         m_pShaderCache->Init(GetDevice());
+
+        m_pPipelineStateCache = new PipelineStateCache();
+        m_pPipelineStateCache->Init(GetDevice());
     }
     if (res)
     {
@@ -101,6 +110,21 @@ bool BaseRenderer::Init(HWND hWnd)
 
 void BaseRenderer::Term()
 {
+    if (m_pPipelineStateCache != nullptr)
+    {
+        const PipelineStateStats& stats = m_pPipelineStateCache->GetStats();
+
+        TCHAR buffer[256];
+        _stprintf_s(buffer, _T("Pipeline states: %d requested, %d created, %d of them loaded from cache. Root signatures: %d requested, %d created\n"),
+            (int)(stats.psoHits + stats.psoMisses), (int)stats.psoMisses, (int)stats.libraryHits,
+            (int)(stats.rootSignatureHits + stats.rootSignatureMisses), (int)stats.rootSignatureMisses
+        );
+        OutputDebugString(buffer);
+
+        m_pPipelineStateCache->Term();
+        delete m_pPipelineStateCache;
+        m_pPipelineStateCache = nullptr;
+    }
     if (m_pShaderCache != nullptr)
     {
         m_pShaderCache->Term();
@@ -119,6 +143,10 @@ bool BaseRenderer::BeginRender(BeginRenderParams& params)
 {
     D3D12_RECT rect = GetRect();
 
+    ++m_frame;
+    m_lastDynamicCBStats = m_dynamicCBStats;
+    m_dynamicCBStats = DynamicCBStats();
+
     m_pCurrentRootSignature = nullptr;
     m_currentCommonTableStart = {};
 
@@ -260,10 +288,17 @@ bool BaseRenderer::BeginGeometryCreation()
 
 bool BaseRenderer::CreateGeometryState(const GeometryStateParams& params, GeometryState& geomState)
 {
+    assert(m_pPipelineStateCache != nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+
     bool res = true;
 
+    std::string rootSignatureKey = PipelineStateCache::BuildRootSignatureKey(m_commonCBCount, m_commonTexCount, params);
+    geomState.pRootSignature = m_pPipelineStateCache->FindRootSignature(rootSignatureKey);
+
     // Create root signature
-    if (res)
+    if (res && geomState.pRootSignature == nullptr)
     {
         std::vector<D3D12_ROOT_PARAMETER> rootSignatureParams;
 
@@ -355,12 +390,21 @@ bool BaseRenderer::CreateGeometryState(const GeometryStateParams& params, Geomet
         rootSignatureDesc.Init((UINT)rootSignatureParams.size(), rootSignatureParams.data(), 5, staticSamplers, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
         res = GetDevice()->CreateRootSignature(rootSignatureDesc, &geomState.pRootSignature);
+        if (res)
+        {
+            m_pPipelineStateCache->AddRootSignature(rootSignatureKey, geomState.pRootSignature);
+        }
     }
 
+    std::string psoKey = PipelineStateCache::BuildPSOKey(rootSignatureKey, params);
+    geomState.pPSO = m_pPipelineStateCache->FindPSO(psoKey);
+
+    bool createPSO = geomState.pPSO == nullptr;
+
     // Create shaders
     ID3DBlob* pVertexShaderBinary = nullptr;
     ID3DBlob* pPixelShaderBinary = nullptr;
-    if (res)
+    if (res && createPSO)
     {
         if (m_pShaderCache != nullptr)
         {
@@ -371,7 +415,7 @@ bool BaseRenderer::CreateGeometryState(const GeometryStateParams& params, Geomet
             res = GetDevice()->CompileShader(params.pShaderSourceName, params.shaderDefines, Platform::Device::Vertex, &pVertexShaderBinary);
         }
     }
-    if (res)
+    if (res && createPSO)
     {
         if (m_pShaderCache != nullptr)
         {
@@ -384,7 +428,7 @@ bool BaseRenderer::CreateGeometryState(const GeometryStateParams& params, Geomet
     }
 
     // Create PSO
-    if (res)
+    if (res && createPSO)
     {
         std::vector<D3D12_INPUT_ELEMENT_DESC> inputElementDescs;
         for (const auto& attribute : params.geomAttributes)
@@ -429,22 +473,28 @@ bool BaseRenderer::CreateGeometryState(const GeometryStateParams& params, Geomet
         psoDesc.DSVFormat = params.dsFormat;
         psoDesc.SampleDesc.Count = 1;
 
-        res = GetDevice()->CreatePSO(psoDesc, &geomState.pPSO);
+        res = m_pPipelineStateCache->CreatePSO(psoKey, psoDesc, &geomState.pPSO);
+        if (res)
+        {
+            m_pPipelineStateCache->AddPSO(psoKey, geomState.pPSO);
+
+            if (GetDevice()->IsDebug())
+            {
+                geomState.pPSO->SetName(params.pShaderSourceName);
+            }
+        }
     }
 
     if (res)
     {
         geomState.primType = params.primTopologyType;
-
-        if (GetDevice()->IsDebug())
-        {
-            geomState.pPSO->SetName(params.pShaderSourceName);
-        }
     }
 
     D3D_RELEASE(pVertexShaderBinary);
     D3D_RELEASE(pPixelShaderBinary);
 
+    m_pPipelineStateCache->AddCreateTime(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
     return res;
 }
 
@@ -471,6 +521,29 @@ bool BaseRenderer::CreateGeometrySharedState(const GeometryState& srcState, cons
     return CreateGeometryBuffers(params, geometry);
 }
 
+const BaseRenderer::PipelineStateStats& BaseRenderer::GetPipelineStateStats() const
+{
+    return m_pPipelineStateCache->GetStats();
+}
+
+bool BaseRenderer::LoadPipelineCache(LPCTSTR filename)
+{
+    // Library can't drop single pipelines, so it is rebuilt from scratch, when any shader source changes
+    bool discard = m_pShaderCache != nullptr && m_pShaderCache->HasUpdatedSources();
+
+    return m_pPipelineStateCache->LoadCache(filename, discard);
+}
+
+bool BaseRenderer::SavePipelineCache(LPCTSTR filename)
+{
+    return m_pPipelineStateCache->SaveCache(filename);
+}
+
+bool BaseRenderer::IsPipelineCacheModified() const
+{
+    return m_pPipelineStateCache->IsModified();
+}
+
 void BaseRenderer::DestroyGeometryState(GeometryState& geomState)
 {
     D3D_RELEASE(geomState.pPSO);
@@ -532,22 +605,18 @@ void BaseRenderer::SetupGeometryState(const GeometryState& geomState)
 
 void BaseRenderer::RenderGeometry(const Geometry& geometry, const void* pInstData, size_t instDataSize, const GeometryState* pState, D3D12_GPU_DESCRIPTOR_HANDLE dynTexturesGpu, const void* pInstObjectData, size_t instObjectDataSize)
 {
-    if (pState != nullptr)
+    D3D12_GPU_VIRTUAL_ADDRESS instObjectAddress = 0;
+    if (pInstObjectData != nullptr && instObjectDataSize != 0)
     {
-        SetupGeometryState(*pState);
-    }
-    else
-    {
-        SetupGeometryState(geometry);
+        instObjectAddress = UploadDynamicCB(pInstObjectData, instObjectDataSize);
     }
 
-    if (geometry.texturesTableStart.ptr != 0)
-    {
-        m_pCurrentRenderCommandList->SetGraphicsRootDescriptorTable(3, geometry.texturesTableStart);
-    }
+    RenderGeometry(geometry, pInstData, instDataSize, pState, dynTexturesGpu, instObjectAddress);
+}
 
-    D3D12_GPU_DESCRIPTOR_HANDLE dynCBStartHandle = {};
-    D3D12_CONSTANT_BUFFER_VIEW_DESC descs[2] = {};
+void BaseRenderer::RenderGeometry(const Geometry& geometry, const void* pInstData, size_t instDataSize, const GeometryState* pState, D3D12_GPU_DESCRIPTOR_HANDLE dynTexturesGpu, D3D12_GPU_VIRTUAL_ADDRESS instObjectAddress, UINT instanceCount)
+{
+    D3D12_GPU_VIRTUAL_ADDRESS splitDataAddress = 0;
 
     size_t splitDataSize = 0;
     const void* pSplitData = nullptr;
@@ -562,23 +631,35 @@ void BaseRenderer::RenderGeometry(const Geometry& geometry, const void* pInstDat
     }
     if (pSplitData != nullptr && splitDataSize != 0)
     {
-        UINT8* dynCBData[2] = {};
-        UINT sizes[2] = { (UINT)splitDataSize, (UINT)instObjectDataSize };
-        bool res = GetDevice()->AllocateDynamicBuffers(instObjectDataSize == 0 ? 1 : 2, sizes, dynCBStartHandle, dynCBData, descs);
-        assert(res);
-        memcpy(dynCBData[0], pSplitData, splitDataSize);
-        if (pInstObjectData != nullptr)
-        {
-            memcpy(dynCBData[1], pInstObjectData, instObjectDataSize);
-        }
+        splitDataAddress = UploadDynamicCB(pSplitData, splitDataSize);
+    }
+
+    RenderGeometry(geometry, splitDataAddress, pState, dynTexturesGpu, instObjectAddress, instanceCount);
+}
+
+void BaseRenderer::RenderGeometry(const Geometry& geometry, D3D12_GPU_VIRTUAL_ADDRESS splitDataAddress, const GeometryState* pState, D3D12_GPU_DESCRIPTOR_HANDLE dynTexturesGpu, D3D12_GPU_VIRTUAL_ADDRESS instObjectAddress, UINT instanceCount)
+{
+    if (pState != nullptr)
+    {
+        SetupGeometryState(*pState);
+    }
+    else
+    {
+        SetupGeometryState(geometry);
     }
-    if (descs[0].BufferLocation != 0)
+
+    if (geometry.texturesTableStart.ptr != 0)
     {
-        m_pCurrentRenderCommandList->SetGraphicsRootConstantBufferView(1, descs[0].BufferLocation);
+        m_pCurrentRenderCommandList->SetGraphicsRootDescriptorTable(3, geometry.texturesTableStart);
     }
-    if (descs[1].BufferLocation != 0)
+
+    if (splitDataAddress != 0)
     {
-        m_pCurrentRenderCommandList->SetGraphicsRootConstantBufferView(2, descs[1].BufferLocation);
+        m_pCurrentRenderCommandList->SetGraphicsRootConstantBufferView(1, splitDataAddress);
+    }
+    if (instObjectAddress != 0)
+    {
+        m_pCurrentRenderCommandList->SetGraphicsRootConstantBufferView(2, instObjectAddress);
     }
 
     if (dynTexturesGpu.ptr != 0)
@@ -589,7 +670,42 @@ void BaseRenderer::RenderGeometry(const Geometry& geometry, const void* pInstDat
     m_pCurrentRenderCommandList->IASetVertexBuffers(0, 1, &geometry.vertexBufferView);
     m_pCurrentRenderCommandList->IASetIndexBuffer(&geometry.indexBufferView);
 
-    m_pCurrentRenderCommandList->DrawIndexedInstanced(geometry.indexCount, 1, 0, 0, 0);
+    m_pCurrentRenderCommandList->DrawIndexedInstanced(geometry.indexCount, instanceCount, 0, 0, 0);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS BaseRenderer::UploadObjectCB(ObjectCB& objectCB, const void* pData, size_t size, UINT64 version)
+{
+    // Dynamic heap memory is recycled as frames complete, so data is uploaded at least once per frame
+    if (objectCB.frame == m_frame && objectCB.version == version)
+    {
+        ++m_dynamicCBStats.objectReuses;
+        return objectCB.address;
+    }
+
+    objectCB.frame = m_frame;
+    objectCB.version = version;
+    objectCB.address = UploadDynamicCB(pData, size);
+
+    ++m_dynamicCBStats.objectUploads;
+
+    return objectCB.address;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS BaseRenderer::UploadDynamicCB(const void* pData, size_t size)
+{
+    void* pCPUData = nullptr;
+    UINT64 address = 0;
+    bool res = GetDevice()->AllocateDynamicBuffer((UINT)size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, &pCPUData, address);
+    assert(res);
+    if (!res)
+    {
+        return 0;
+    }
+
+    memcpy(pCPUData, pData, size);
+    m_dynamicCBStats.bytes += size;
+
+    return address;
 }
 
 bool BaseRenderer::Resize(const D3D12_VIEWPORT& viewport, const D3D12_RECT& rect)
@@ -736,6 +736,10 @@ HRESULT Device::UpdateTexture(ID3D12GraphicsCommandList* pCommandList, ID3D12Res
             pixelSize = 1;
             break;
 
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            pixelSize = 8;
+            break;
+
         case DXGI_FORMAT_R32G32B32_FLOAT:
             pixelSize = 12;
             break;
@@ -1024,6 +1028,21 @@ bool Device::AllocateDynamicBuffer(UINT size, UINT alignment, void** ppCPUData,
     return res == RingBufferResult::Ok;
 }
 
+bool Device::AllocateDynamicBuffer(UINT size, UINT alignment, void** ppCPUData, ID3D12Resource** ppDynamicBuffer, UINT64& offset)
+{
+    UINT alignedSize = Align(size, (UINT)alignment);
+
+    UINT64 allocStartOffset = 0;
+    RingBufferResult res = m_pDynamicBuffer->Alloc(alignedSize, allocStartOffset, *((UINT8**)ppCPUData), alignment);
+    if (res == RingBufferResult::Ok)
+    {
+        offset = allocStartOffset;
+        *ppDynamicBuffer = m_pDynamicBuffer->GetBuffer();
+    }
+
+    return res == RingBufferResult::Ok;
+}
+
 bool Device::AllocateReadbackBuffer(UINT size, UINT alignment, void** ppCPUData, ID3D12Resource** ppReadBackBuffer, UINT64& offset)
 {
     UINT alignedSize = Align(size, (UINT)alignment);
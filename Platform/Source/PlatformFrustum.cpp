@@ -0,0 +1,236 @@
+#include "stdafx.h"
+#include "PlatformFrustum.h"
+
+#include "PlatformSIMD.h"
+
+namespace
+{
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+
+using Vec = __m256;
+const size_t VecWidth = 8;
+
+PLATFORM_FORCEINLINE Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+PLATFORM_FORCEINLINE Vec Set(float v) { return _mm256_set1_ps(v); }
+PLATFORM_FORCEINLINE Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Or(Vec a, Vec b) { return _mm256_or_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Less(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+PLATFORM_FORCEINLINE int MoveMask(Vec v) { return _mm256_movemask_ps(v); }
+
+#elif PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+
+using Vec = __m128;
+const size_t VecWidth = 4;
+
+PLATFORM_FORCEINLINE Vec Load(const float* p) { return _mm_loadu_ps(p); }
+PLATFORM_FORCEINLINE Vec Set(float v) { return _mm_set1_ps(v); }
+PLATFORM_FORCEINLINE Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Or(Vec a, Vec b) { return _mm_or_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Less(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+PLATFORM_FORCEINLINE int MoveMask(Vec v) { return _mm_movemask_ps(v); }
+
+#endif
+
+}
+
+namespace Platform
+{
+
+void BoxList::Clear()
+{
+    for (auto pArray : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+    {
+        pArray->clear();
+    }
+}
+
+void BoxList::Add(const Point3f& center, const Point3f& extent)
+{
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+
+    extentX.push_back(extent.x);
+    extentY.push_back(extent.y);
+    extentZ.push_back(extent.z);
+}
+
+void TransformBox(const Matrix4f& transform, const Point3f& bbMin, const Point3f& bbMax, Point3f& center, Point3f& extent)
+{
+    const float* m = transform.m;
+
+    Point4f c = transform * Point4f{ (bbMin.x + bbMax.x) * 0.5f, (bbMin.y + bbMax.y) * 0.5f, (bbMin.z + bbMax.z) * 0.5f, 1.0f };
+    Point3f e = (bbMax - bbMin) * 0.5f;
+
+    // Half size along every axis is the sum of transformed box axes projections onto it
+    center = c;
+    extent.x = fabsf(m[0]) * e.x + fabsf(m[4]) * e.y + fabsf(m[8]) * e.z;
+    extent.y = fabsf(m[1]) * e.x + fabsf(m[5]) * e.y + fabsf(m[9]) * e.z;
+    extent.z = fabsf(m[2]) * e.x + fabsf(m[6]) * e.y + fabsf(m[10]) * e.z;
+}
+
+const float Frustum::InfiniteExtent = 1e30f;
+
+Frustum::Frustum()
+{
+}
+
+void Frustum::Build(const Matrix4f& viewProj)
+{
+    const float* m = viewProj.m;
+
+    // Row of clip space coordinate
+    Point4f rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = Point4f{ m[i], m[4 + i], m[8 + i], m[12 + i] };
+    }
+
+    m_planes[PlaneLeft] = rows[3] + rows[0];
+    m_planes[PlaneRight] = rows[3] - rows[0];
+    m_planes[PlaneBottom] = rows[3] + rows[1];
+    m_planes[PlaneTop] = rows[3] - rows[1];
+    m_planes[PlaneNear] = rows[2];
+    m_planes[PlaneFar] = rows[3] - rows[2];
+
+    // Normalized planes give distances in world units
+    for (int i = 0; i < PlaneCount; i++)
+    {
+        SetPlane(i, m_planes[i]);
+    }
+}
+
+void Frustum::SetPlane(int idx, const Point4f& plane)
+{
+    float len = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+    m_planes[idx] = len > 0.0f ? plane * (1.0f / len) : plane;
+}
+
+bool Frustum::TestBox(const Point3f& center, const Point3f& extent) const
+{
+    for (int i = 0; i < PlaneCount; i++)
+    {
+        const Point4f& p = m_planes[i];
+
+        float dist = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+        float radius = fabsf(p.x) * extent.x + fabsf(p.y) * extent.y + fabsf(p.z) * extent.z;
+        if (dist + radius < 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Frustum::BoxClass Frustum::ClassifyBox(const Point3f& center, const Point3f& extent) const
+{
+    BoxClass res = BoxInside;
+    for (int i = 0; i < PlaneCount; i++)
+    {
+        const Point4f& p = m_planes[i];
+
+        float dist = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+        float radius = fabsf(p.x) * extent.x + fabsf(p.y) * extent.y + fabsf(p.z) * extent.z;
+        if (dist + radius < 0.0f)
+        {
+            return BoxOutside;
+        }
+        if (dist - radius < 0.0f)
+        {
+            res = BoxIntersects;
+        }
+    }
+
+    return res;
+}
+
+size_t Frustum::TestBoxes(const BoxList& boxes, UINT8* pVisible) const
+{
+    size_t visibleCount = 0;
+
+    size_t first = TestBoxesSIMD(boxes, visibleCount, pVisible);
+    visibleCount += TestBoxesScalar(boxes, first, boxes.GetSize(), pVisible);
+
+    return visibleCount;
+}
+
+size_t Frustum::TestBoxesScalar(const BoxList& boxes, size_t begin, size_t end, UINT8* pVisible) const
+{
+    size_t visibleCount = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        bool visible = TestBox(
+            Point3f{ boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i] },
+            Point3f{ boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i] }
+        );
+
+        pVisible[i] = visible ? 1 : 0;
+        visibleCount += visible ? 1 : 0;
+    }
+
+    return visibleCount;
+}
+
+size_t Frustum::TestBoxesSIMD(const BoxList& boxes, size_t& visibleCount, UINT8* pVisible) const
+{
+    size_t i = 0;
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2 || PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+    // Plane components are broadcasted once, operations go in the same order as in TestBox
+    Vec nx[PlaneCount], ny[PlaneCount], nz[PlaneCount], nw[PlaneCount];
+    Vec ax[PlaneCount], ay[PlaneCount], az[PlaneCount];
+    for (int j = 0; j < PlaneCount; j++)
+    {
+        nx[j] = Set(m_planes[j].x);
+        ny[j] = Set(m_planes[j].y);
+        nz[j] = Set(m_planes[j].z);
+        nw[j] = Set(m_planes[j].w);
+
+        ax[j] = Set(fabsf(m_planes[j].x));
+        ay[j] = Set(fabsf(m_planes[j].y));
+        az[j] = Set(fabsf(m_planes[j].z));
+    }
+    const Vec zero = Set(0.0f);
+
+    const size_t count = boxes.GetSize();
+    for (; i + VecWidth <= count; i += VecWidth)
+    {
+        Vec cx = Load(&boxes.centerX[i]);
+        Vec cy = Load(&boxes.centerY[i]);
+        Vec cz = Load(&boxes.centerZ[i]);
+        Vec ex = Load(&boxes.extentX[i]);
+        Vec ey = Load(&boxes.extentY[i]);
+        Vec ez = Load(&boxes.extentZ[i]);
+
+        Vec culled = Less(Set(1.0f), zero);
+        for (int j = 0; j < PlaneCount; j++)
+        {
+            Vec dist = Add(Add(Add(Mul(nx[j], cx), Mul(ny[j], cy)), Mul(nz[j], cz)), nw[j]);
+            Vec radius = Add(Add(Mul(ax[j], ex), Mul(ay[j], ey)), Mul(az[j], ez));
+            culled = Or(culled, Less(Add(dist, radius), zero));
+        }
+
+        int mask = MoveMask(culled);
+        for (size_t k = 0; k < VecWidth; k++)
+        {
+            UINT8 visible = (mask & (1 << k)) == 0 ? 1 : 0;
+            pVisible[i + k] = visible;
+            visibleCount += visible;
+        }
+    }
+#else
+    // No SIMD kernel, scalar test processes all boxes
+    (void)boxes;
+    (void)visibleCount;
+    (void)pVisible;
+#endif
+
+    return i;
+}
+
+} // Platform
@@ -148,4 +148,73 @@ std::vector<std::tstring> ScanDirectories(LPCTSTR folder, LPCTSTR fileToFind)
     return res;
 }
 
+MappedFile::MappedFile()
+    : m_hFile(INVALID_HANDLE_VALUE)
+    , m_hMapping(nullptr)
+    , m_pData(nullptr)
+    , m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(LPCTSTR filename)
+{
+    Close();
+
+    m_hFile = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    bool res = m_hFile != INVALID_HANDLE_VALUE;
+    if (res)
+    {
+        LARGE_INTEGER size;
+        res = GetFileSizeEx(m_hFile, &size) != FALSE;
+        m_size = (size_t)size.QuadPart;
+    }
+    // Empty file cannot be mapped, but it is still valid
+    if (res && m_size > 0)
+    {
+        m_hMapping = CreateFileMapping(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        res = m_hMapping != nullptr;
+        if (res)
+        {
+            m_pData = static_cast<const char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+            res = m_pData != nullptr;
+        }
+    }
+
+    if (!res)
+    {
+        OutputDebugString(_T("Cannot map file "));
+        OutputDebugString(filename);
+        OutputDebugString(_T(".\n"));
+
+        Close();
+    }
+
+    return res;
+}
+
+void MappedFile::Close()
+{
+    if (m_pData != nullptr)
+    {
+        UnmapViewOfFile(m_pData);
+        m_pData = nullptr;
+    }
+    if (m_hMapping != nullptr)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = nullptr;
+    }
+    if (m_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hFile);
+        m_hFile = INVALID_HANDLE_VALUE;
+    }
+    m_size = 0;
+}
+
 } // Platform
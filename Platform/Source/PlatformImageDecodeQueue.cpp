@@ -0,0 +1,85 @@
+#include "stdafx.h"
+#include "PlatformImageDecodeQueue.h"
+
+namespace Platform
+{
+
+ImageDecodeQueue::ImageDecodeQueue()
+    : m_pPool(nullptr)
+    , m_imageCount(0)
+    , m_nextImage(0)
+    , m_pendingDecodes(0)
+{
+}
+
+void ImageDecodeQueue::Start(ThreadPool* pPool, size_t imageCount, const DecodeFunc& decode)
+{
+    assert(m_pendingDecodes == 0);
+
+    m_pPool = pPool;
+    m_decode = decode;
+    m_imageCount = imageCount;
+    m_nextImage = 0;
+
+    Queue();
+}
+
+void ImageDecodeQueue::Queue()
+{
+    const size_t maxImagesInFlight = m_pPool->GetThreadCount() + 1;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_nextImage < m_imageCount && m_pendingDecodes + m_decodedImages.size() < maxImagesInFlight)
+    {
+        size_t imageIdx = m_nextImage++;
+        ++m_pendingDecodes;
+
+        // Task may be executed right in place
+        lock.unlock();
+        m_pPool->AddTask([this, imageIdx]()
+        {
+            DecodedImage image;
+            image.imageIdx = imageIdx;
+            m_decode(imageIdx, image);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decodedImages.push_back(std::move(image));
+            --m_pendingDecodes;
+            m_doneCV.notify_all();
+        });
+        lock.lock();
+    }
+}
+
+bool ImageDecodeQueue::Pop(DecodedImage& image)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_decodedImages.empty())
+    {
+        return false;
+    }
+
+    image = std::move(m_decodedImages.front());
+    m_decodedImages.pop_front();
+
+    return true;
+}
+
+void ImageDecodeQueue::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCV.wait(lock, [this]() { return m_pendingDecodes == 0; });
+}
+
+void ImageDecodeQueue::Clear()
+{
+    Wait();
+
+    m_decodedImages.clear();
+    m_imageCount = 0;
+    m_nextImage = 0;
+    m_pPool = nullptr;
+    m_decode = nullptr;
+}
+
+} // Platform
@@ -0,0 +1,555 @@
+#include "stdafx.h"
+#include "PlatformMips.h"
+
+#include <algorithm>
+#include <float.h>
+
+#include "PlatformSIMD.h"
+#include "PlatformUtil.h"
+
+namespace
+{
+
+// Mip levels are stored as rows of float4 pixels, components are in [0, 1] range for UNORM formats
+struct MipFormat
+{
+    UINT pixelSize;
+    void (*LoadRow)(const UINT8* pSrc, UINT width, float* pDst);
+    void (*StoreRow)(const float* pSrc, UINT width, UINT8* pDst);
+};
+
+float SRGBToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+// sRGB conversion tables
+struct SRGBTables
+{
+    static const int FromLinearSize = 4096;
+
+    float toLinear[256];
+    float thresholds[256];              // Linear values of sRGB values halfway between adjacent codes, the last one is never reached
+    UINT8 fromLinear[FromLinearSize];   // The lowest sRGB code for uniformly split linear range, is refined with thresholds
+
+    SRGBTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            toLinear[i] = SRGBToLinear(i / 255.0f);
+        }
+        for (int i = 0; i < 255; i++)
+        {
+            thresholds[i] = SRGBToLinear((i + 0.5f) / 255.0f);
+        }
+        thresholds[255] = FLT_MAX;
+
+        int code = 0;
+        for (int i = 0; i < FromLinearSize; i++)
+        {
+            while (thresholds[code] <= (float)i / FromLinearSize)
+            {
+                ++code;
+            }
+            fromLinear[i] = (UINT8)code;
+        }
+    }
+
+    inline UINT8 FromLinear(float value) const
+    {
+        int idx = std::min(std::max((int)(value * FromLinearSize), 0), FromLinearSize - 1);
+        int code = fromLinear[idx];
+        while (thresholds[code] <= value)
+        {
+            ++code;
+        }
+        return (UINT8)code;
+    }
+};
+
+const SRGBTables& GetSRGBTables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_SSE2 || PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+// Linear to sRGB for [0, 1] range. Curve part is fit of 1.055 * x^(1/2.4) - 0.055 on square, 4th and 8th roots,
+// error is below 0.01 of 8-bit code, so it rounds as the table of scalar path but for values right at halfway
+PLATFORM_FORCEINLINE __m128 LinearToSRGB(__m128 value)
+{
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+    const __m128 s1 = _mm_sqrt_ps(value);
+    const __m128 s2 = _mm_sqrt_ps(s1);
+    const __m128 s3 = _mm_sqrt_ps(s2);
+
+    __m128 curve = _mm_add_ps(_mm_mul_ps(s1, _mm_set1_ps(0.653978665f)), _mm_mul_ps(s2, _mm_set1_ps(0.688732352f)));
+    curve = _mm_add_ps(curve, _mm_mul_ps(s3, _mm_set1_ps(-0.318492375f)));
+    curve = _mm_add_ps(curve, _mm_mul_ps(value, _mm_set1_ps(-0.0201875278f)));
+    curve = _mm_add_ps(curve, _mm_set1_ps(-0.00406251435f));
+
+    const __m128 isLinear = _mm_cmple_ps(value, _mm_set1_ps(0.0031308f));
+    return _mm_or_ps(_mm_and_ps(isLinear, _mm_mul_ps(value, _mm_set1_ps(12.92f))), _mm_andnot_ps(isLinear, curve));
+}
+#endif
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+// Half conversion of four values in 32 bit lanes, bit exact with F16C instructions of AVX2 build.
+// Denormal halves are scaled into normal floats by exponent rebias multiplier
+PLATFORM_FORCEINLINE __m128 HalfToFloat(__m128i h)
+{
+    const __m128i expMantissa = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+    const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expMantissa), 16);
+    const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMantissa, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+
+    // Inf and NaN keep maximum exponent
+    const __m128i infNan = _mm_and_si128(_mm_cmpgt_epi32(expMantissa, _mm_set1_epi32(0x7BFF)), _mm_set1_epi32(0x7F800000));
+    return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infNan)));
+}
+
+// Rounds to nearest even, result is in low 16 bits of 32 bit lanes
+PLATFORM_FORCEINLINE __m128i FloatToHalf(__m128 value)
+{
+    const __m128i bits = _mm_castps_si128(value);
+    const __m128i sign = _mm_and_si128(bits, _mm_set1_epi32(0x80000000));
+    const __m128i absBits = _mm_xor_si128(bits, sign);
+
+    // Half denormal, adding magic number rounds mantissa at half denormal unit
+    const __m128i denormalMagic = _mm_set1_epi32(126 << 23);
+    const __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(absBits), _mm_castsi128_ps(denormalMagic))), denormalMagic);
+
+    // Rebias exponent and round to nearest even
+    const __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(absBits, 13), _mm_set1_epi32(1));
+    const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(absBits, _mm_set1_epi32(0xC8000FFF)), mantissaOdd), 13);
+
+    // Too large values round to Inf, NaN keeps quiet bit
+    const __m128i isNan = _mm_cmpgt_epi32(absBits, _mm_set1_epi32(0x7F800000));
+    const __m128i infNan = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNan, _mm_set1_epi32(0x200)));
+
+    const __m128i isDenormal = _mm_cmplt_epi32(absBits, _mm_set1_epi32(0x38800000));
+    const __m128i isRegular = _mm_cmplt_epi32(absBits, _mm_set1_epi32(0x47800000));
+    __m128i res = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+    res = _mm_or_si128(_mm_and_si128(isRegular, res), _mm_andnot_si128(isRegular, infNan));
+    return _mm_or_si128(res, _mm_srli_epi32(sign, 16));
+}
+
+// Two vectors of 32 bit lanes with values in low 16 bits into eight 16 bit lanes, packs saturate so values are sign extended first
+PLATFORM_FORCEINLINE __m128i PackLow16(__m128i a, __m128i b)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+}
+#elif PLATFORM_SIMD != PLATFORM_SIMD_AVX2
+float HalfToFloat(UINT16 h)
+{
+    UINT32 sign = (UINT32)(h & 0x8000) << 16;
+    UINT32 exponent = (h >> 10) & 0x1F;
+    UINT32 mantissa = h & 0x3FF;
+
+    UINT32 bits = 0;
+    if (exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else
+    {
+        // Zero or denormal
+        float value = mantissa * (1.0f / (1 << 24));
+        memcpy(&bits, &value, sizeof(bits));
+        bits |= sign;
+    }
+
+    float res;
+    memcpy(&res, &bits, sizeof(res));
+    return res;
+}
+
+UINT16 FloatToHalf(float value)
+{
+    UINT32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    UINT16 sign = (UINT16)((bits >> 16) & 0x8000);
+    bits &= 0x7FFFFFFF;
+
+    if (bits >= 0x7F800000)
+    {
+        return sign | 0x7C00 | (bits > 0x7F800000 ? 0x200 : 0); // Inf or NaN
+    }
+    if (bits >= 0x477FF000)
+    {
+        return sign | 0x7C00; // Too large, rounds to Inf
+    }
+    if (bits < 0x38800000)
+    {
+        // Half denormal, adding 0.5 leaves mantissa unit of 2^-24 and rounds to nearest even
+        float absValue;
+        memcpy(&absValue, &bits, sizeof(absValue));
+        absValue += 0.5f;
+        memcpy(&bits, &absValue, sizeof(bits));
+        return sign | (UINT16)(bits - 0x3F000000);
+    }
+
+    // Rebias exponent and round to nearest even
+    bits += 0xC8000FFF + ((bits >> 13) & 1);
+    return sign | (UINT16)(bits >> 13);
+}
+#endif
+
+void LoadRowRGBA8(const UINT8* pSrc, UINT width, float* pDst)
+{
+    UINT x = 0;
+#if PLATFORM_SIMD == PLATFORM_SIMD_SSE2 || PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+    // Four pixels at once
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    for (; x + 4 <= width; x += 4, pSrc += 16, pDst += 16)
+    {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+        const __m128i lo = _mm_unpacklo_epi8(p, zero);
+        const __m128i hi = _mm_unpackhi_epi8(p, zero);
+        _mm_storeu_ps(pDst, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+        _mm_storeu_ps(pDst + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+        _mm_storeu_ps(pDst + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+        _mm_storeu_ps(pDst + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+    }
+#endif
+    for (UINT i = 0; i < (width - x) * 4; i++)
+    {
+        pDst[i] = pSrc[i] * (1.0f / 255.0f);
+    }
+}
+
+void StoreRowRGBA8(const float* pSrc, UINT width, UINT8* pDst)
+{
+    UINT x = 0;
+#if PLATFORM_SIMD == PLATFORM_SIMD_SSE2 || PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+    // Four pixels at once, rounds to nearest, packs saturate
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (; x + 4 <= width; x += 4, pSrc += 16, pDst += 16)
+    {
+        const __m128i p0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(pSrc), scale));
+        const __m128i p1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(pSrc + 4), scale));
+        const __m128i p2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(pSrc + 8), scale));
+        const __m128i p3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(pSrc + 12), scale));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3)));
+    }
+#endif
+    for (UINT i = 0; i < (width - x) * 4; i++)
+    {
+        pDst[i] = (UINT8)(std::min(std::max(pSrc[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+// Color is averaged in linear space, alpha is stored linearly anyway.
+// Table lookup is kept in SIMD build too, it is cheaper than polynomial of the curve for 8-bit input
+void LoadRowRGBA8SRGB(const UINT8* pSrc, UINT width, float* pDst)
+{
+    const SRGBTables& tables = GetSRGBTables();
+    for (UINT x = 0; x < width; x++, pSrc += 4, pDst += 4)
+    {
+        pDst[0] = tables.toLinear[pSrc[0]];
+        pDst[1] = tables.toLinear[pSrc[1]];
+        pDst[2] = tables.toLinear[pSrc[2]];
+        pDst[3] = pSrc[3] * (1.0f / 255.0f);
+    }
+}
+
+void StoreRowRGBA8SRGB(const float* pSrc, UINT width, UINT8* pDst)
+{
+    UINT x = 0;
+#if PLATFORM_SIMD == PLATFORM_SIMD_SSE2 || PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+    // Four pixels at once, alpha lane keeps linear value
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+    const __m128 scale = _mm_set1_ps(255.0f);
+    auto convert = [&](const float* pPixel)
+    {
+        const __m128 value = _mm_loadu_ps(pPixel);
+        const __m128 alpha = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        const __m128 res = _mm_or_ps(_mm_and_ps(alphaMask, alpha), _mm_andnot_ps(alphaMask, LinearToSRGB(value)));
+        return _mm_cvtps_epi32(_mm_mul_ps(res, scale));
+    };
+    for (; x + 4 <= width; x += 4, pSrc += 16, pDst += 16)
+    {
+        const __m128i p01 = _mm_packs_epi32(convert(pSrc), convert(pSrc + 4));
+        const __m128i p23 = _mm_packs_epi32(convert(pSrc + 8), convert(pSrc + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_packus_epi16(p01, p23));
+    }
+    for (; x < width; x++, pSrc += 4, pDst += 4)
+    {
+        const __m128i p = _mm_packs_epi32(convert(pSrc), _mm_setzero_si128());
+        const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(p, p));
+        memcpy(pDst, &packed, sizeof(packed));
+    }
+#else
+    const SRGBTables& tables = GetSRGBTables();
+    for (; x < width; x++, pSrc += 4, pDst += 4)
+    {
+        pDst[0] = tables.FromLinear(pSrc[0]);
+        pDst[1] = tables.FromLinear(pSrc[1]);
+        pDst[2] = tables.FromLinear(pSrc[2]);
+        pDst[3] = (UINT8)(std::min(std::max(pSrc[3], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+#endif
+}
+
+void LoadRowRGBA16F(const UINT8* pSrc, UINT width, float* pDst)
+{
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+    UINT x = 0;
+    for (; x + 2 <= width; x += 2, pSrc += 16, pDst += 8)
+    {
+        _mm256_storeu_ps(pDst, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc))));
+    }
+    for (; x < width; x++, pSrc += 8, pDst += 4)
+    {
+        _mm_storeu_ps(pDst, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc))));
+    }
+#elif PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+    // Two pixels at once
+    UINT x = 0;
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 2 <= width; x += 2, pSrc += 16, pDst += 8)
+    {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+        _mm_storeu_ps(pDst, HalfToFloat(_mm_unpacklo_epi16(h, zero)));
+        _mm_storeu_ps(pDst + 4, HalfToFloat(_mm_unpackhi_epi16(h, zero)));
+    }
+    for (; x < width; x++, pSrc += 8, pDst += 4)
+    {
+        _mm_storeu_ps(pDst, HalfToFloat(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc)), zero)));
+    }
+#else
+    const UINT16* pHalf = reinterpret_cast<const UINT16*>(pSrc);
+    for (UINT i = 0; i < width * 4; i++)
+    {
+        pDst[i] = HalfToFloat(pHalf[i]);
+    }
+#endif
+}
+
+void StoreRowRGBA16F(const float* pSrc, UINT width, UINT8* pDst)
+{
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+    UINT x = 0;
+    for (; x + 2 <= width; x += 2, pSrc += 8, pDst += 16)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm256_cvtps_ph(_mm256_loadu_ps(pSrc), _MM_FROUND_TO_NEAREST_INT));
+    }
+    for (; x < width; x++, pSrc += 4, pDst += 8)
+    {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), _mm_cvtps_ph(_mm_loadu_ps(pSrc), _MM_FROUND_TO_NEAREST_INT));
+    }
+#elif PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+    // Two pixels at once
+    UINT x = 0;
+    for (; x + 2 <= width; x += 2, pSrc += 8, pDst += 16)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), PackLow16(FloatToHalf(_mm_loadu_ps(pSrc)), FloatToHalf(_mm_loadu_ps(pSrc + 4))));
+    }
+    for (; x < width; x++, pSrc += 4, pDst += 8)
+    {
+        const __m128i h = FloatToHalf(_mm_loadu_ps(pSrc));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), PackLow16(h, h));
+    }
+#else
+    UINT16* pHalf = reinterpret_cast<UINT16*>(pDst);
+    for (UINT i = 0; i < width * 4; i++)
+    {
+        pHalf[i] = FloatToHalf(pSrc[i]);
+    }
+#endif
+}
+
+void LoadRowRGBA32F(const UINT8* pSrc, UINT width, float* pDst)
+{
+    memcpy(pDst, pSrc, width * 16);
+}
+
+void StoreRowRGBA32F(const float* pSrc, UINT width, UINT8* pDst)
+{
+    memcpy(pDst, pSrc, width * 16);
+}
+
+const MipFormat* GetMipFormat(Platform::MipPixelFormat format)
+{
+    // In MipPixelFormat order
+    static const MipFormat Formats[Platform::MipPixelFormatCount] = {
+        { 4, &LoadRowRGBA8, &StoreRowRGBA8 },
+        { 4, &LoadRowRGBA8SRGB, &StoreRowRGBA8SRGB },
+        { 8, &LoadRowRGBA16F, &StoreRowRGBA16F },
+        { 16, &LoadRowRGBA32F, &StoreRowRGBA32F }
+    };
+
+    return format < Platform::MipPixelFormatCount ? &Formats[format] : nullptr;
+}
+
+// Sums rows and then pixel pairs of the sum, the last destination pixel takes three source ones for odd width.
+// Every build adds in the same order, so float results are the same
+void ReduceRows(const float* const* ppRows, UINT rowCount, UINT srcWidth, float* pDst)
+{
+    const UINT dstWidth = std::max(srcWidth / 2, 1u);
+    const UINT pairWidth = srcWidth & 1 ? dstWidth - 1 : dstWidth;
+    const float pairWeight = 1.0f / (rowCount * 2);
+
+    UINT x = 0;
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+    // Two destination pixels at once, lane halves are pixels
+    const __m256 pairWeight8 = _mm256_set1_ps(pairWeight);
+    for (; x + 2 <= pairWidth; x += 2)
+    {
+        __m256 a = _mm256_loadu_ps(ppRows[0] + x * 8);
+        __m256 b = _mm256_loadu_ps(ppRows[0] + x * 8 + 8);
+        for (UINT j = 1; j < rowCount; j++)
+        {
+            a = _mm256_add_ps(a, _mm256_loadu_ps(ppRows[j] + x * 8));
+            b = _mm256_add_ps(b, _mm256_loadu_ps(ppRows[j] + x * 8 + 8));
+        }
+        const __m256 sum = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+        _mm256_storeu_ps(pDst + x * 4, _mm256_mul_ps(sum, pairWeight8));
+    }
+#elif PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+    // Two destination pixels at once
+    const __m128 pairWeight4 = _mm_set1_ps(pairWeight);
+    for (; x + 2 <= pairWidth; x += 2)
+    {
+        __m128 p0 = _mm_loadu_ps(ppRows[0] + x * 8);
+        __m128 p1 = _mm_loadu_ps(ppRows[0] + x * 8 + 4);
+        __m128 p2 = _mm_loadu_ps(ppRows[0] + x * 8 + 8);
+        __m128 p3 = _mm_loadu_ps(ppRows[0] + x * 8 + 12);
+        for (UINT j = 1; j < rowCount; j++)
+        {
+            p0 = _mm_add_ps(p0, _mm_loadu_ps(ppRows[j] + x * 8));
+            p1 = _mm_add_ps(p1, _mm_loadu_ps(ppRows[j] + x * 8 + 4));
+            p2 = _mm_add_ps(p2, _mm_loadu_ps(ppRows[j] + x * 8 + 8));
+            p3 = _mm_add_ps(p3, _mm_loadu_ps(ppRows[j] + x * 8 + 12));
+        }
+        _mm_storeu_ps(pDst + x * 4, _mm_mul_ps(_mm_add_ps(p0, p1), pairWeight4));
+        _mm_storeu_ps(pDst + x * 4 + 4, _mm_mul_ps(_mm_add_ps(p2, p3), pairWeight4));
+    }
+#else
+    for (; x < pairWidth; x++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            float left = ppRows[0][x * 8 + i];
+            float right = ppRows[0][x * 8 + 4 + i];
+            for (UINT j = 1; j < rowCount; j++)
+            {
+                left += ppRows[j][x * 8 + i];
+                right += ppRows[j][x * 8 + 4 + i];
+            }
+            pDst[x * 4 + i] = (left + right) * pairWeight;
+        }
+    }
+#endif
+
+    // The rest of pairs, odd tail pixel takes three source ones
+    for (; x < dstWidth; x++)
+    {
+        const UINT count = x < pairWidth ? 2 : srcWidth - x * 2;
+        const float weight = x < pairWidth ? pairWeight : 1.0f / (rowCount * count);
+        for (int i = 0; i < 4; i++)
+        {
+            float sum = 0.0f;
+            for (UINT k = 0; k < count; k++)
+            {
+                float column = ppRows[0][(x * 2 + k) * 4 + i];
+                for (UINT j = 1; j < rowCount; j++)
+                {
+                    column += ppRows[j][(x * 2 + k) * 4 + i];
+                }
+                sum = k == 0 ? column : sum + column;
+            }
+            pDst[x * 4 + i] = sum * weight;
+        }
+    }
+}
+
+UINT CalcMipCount(UINT width, UINT height)
+{
+    DWORD mips = 0;
+    _BitScanForward(&mips, std::min(NearestPowerOf2(height), NearestPowerOf2(width)));
+
+    UINT mipCount = (UINT)mips + 1;
+    if (mipCount > 2)
+    {
+        mipCount -= 2; // Skip last two mips, as texture cannot be less than 4x4 pixels
+    }
+
+    return mipCount;
+}
+
+}
+
+namespace Platform
+{
+
+size_t CalcTextureSizeWithMips(UINT width, UINT height, MipPixelFormat format, UINT& mipCount)
+{
+    const MipFormat* pFormat = GetMipFormat(format);
+    assert(pFormat != nullptr);
+
+    mipCount = CalcMipCount(width, height);
+
+    size_t res = 0;
+    for (UINT i = 0; i < mipCount; i++)
+    {
+        res += (size_t)std::max(width >> i, 1u) * std::max(height >> i, 1u) * pFormat->pixelSize;
+    }
+
+    return res;
+}
+
+void GenerateTextureMips(void* pData, UINT width, UINT height, MipPixelFormat format, UINT mipCount)
+{
+    const MipFormat* pFormat = GetMipFormat(format);
+    assert(pFormat != nullptr);
+    if (pFormat == nullptr)
+    {
+        return;
+    }
+
+    // Box filter in float, every level is built from the previous one
+    std::vector<float> rows[3];
+    for (auto& row : rows)
+    {
+        row.resize(width * 4);
+    }
+    const float* ppRows[3] = { rows[0].data(), rows[1].data(), rows[2].data() };
+    std::vector<float> dstRow(std::max(width / 2, 1u) * 4);
+
+    UINT8* pSrc = static_cast<UINT8*>(pData);
+    for (UINT i = 1; i < mipCount; i++)
+    {
+        UINT dstWidth = std::max(width / 2, 1u);
+        UINT dstHeight = std::max(height / 2, 1u);
+        size_t srcPitch = (size_t)width * pFormat->pixelSize;
+        size_t dstPitch = (size_t)dstWidth * pFormat->pixelSize;
+
+        UINT8* pDst = pSrc + srcPitch * height;
+        for (UINT y = 0; y < dstHeight; y++)
+        {
+            // The last destination row takes three source ones for odd height
+            UINT rowCount = (y == dstHeight - 1) ? height - y * 2 : 2;
+
+            for (UINT j = 0; j < rowCount; j++)
+            {
+                pFormat->LoadRow(pSrc + srcPitch * (y * 2 + j), width, rows[j].data());
+            }
+
+            ReduceRows(ppRows, rowCount, width, dstRow.data());
+            pFormat->StoreRow(dstRow.data(), dstWidth, pDst + dstPitch * y);
+        }
+
+        pSrc = pDst;
+        width = dstWidth;
+        height = dstHeight;
+    }
+}
+
+} // Platform
@@ -0,0 +1,259 @@
+#include "stdafx.h"
+#include "PlatformModelCache.h"
+
+#include "PlatformIO.h"
+#include "PlatformModelCacheFile.h"
+
+namespace Platform
+{
+
+bool SaveModelCache(const std::tstring& cacheFilename, const std::tstring& modelFilename, const ModelCacheOptions& options, const GLTFModelDesc& model, const GLTFModelData& data)
+{
+    CacheWriter writer;
+
+    if (!WriteModelCacheHeader(writer, options, GetFolderPath(modelFilename), data.sources))
+    {
+        return false;
+    }
+
+    // Common parameters
+    writer.Write((UINT32)data.autoscale);
+    writer.Write(data.scaleValue);
+    writer.Write(data.bb);
+    writer.Write((UINT32)model.skinned);
+    writer.Write(model.rootNodeIdx);
+
+    // Node hierarchy
+    writer.Write((UINT32)model.nodes.size());
+    for (const auto& node : model.nodes)
+    {
+        writer.Write((UINT32)node.useMatrix);
+        if (node.useMatrix)
+        {
+            writer.Write(node.matrix);
+        }
+        else
+        {
+            writer.Write(node.transform.rotation);
+            writer.Write(node.transform.translation);
+            writer.Write(node.transform.scale);
+        }
+        writer.WriteVector(node.children);
+    }
+
+    // Skin
+    writer.WriteVector(model.nodeInvBindMatrices);
+    writer.WriteVector(model.jointIndices);
+
+    // Animation
+    writer.Write(model.minAnimationTime);
+    writer.Write(model.maxAnimationTime);
+    writer.Write((UINT32)model.animationSamplers.size());
+    for (const auto& sampler : model.animationSamplers)
+    {
+        writer.WriteVector(sampler.timeKeys);
+        writer.WriteVector(sampler.keys);
+        writer.Write((UINT32)sampler.rotation);
+        writer.WriteVector(sampler.packedKeys);
+        writer.Write(sampler.rangeMin);
+        writer.Write(sampler.rangeSize);
+    }
+    writer.Write((UINT32)model.animationChannels.size());
+    for (const auto& channel : model.animationChannels)
+    {
+        writer.Write(channel.animSamplerIdx);
+        writer.Write(channel.nodeIdx);
+        writer.Write((UINT32)channel.type);
+    }
+
+    // Images
+    writer.Write((UINT32)data.images.size());
+    for (const auto& image : data.images)
+    {
+        writer.WriteString(image.uri);
+        writer.WriteStream(image.data.GetData(), image.data.GetSize());
+        writer.Write((UINT32)image.srgb);
+    }
+
+    // Primitives
+    writer.Write((UINT32)data.primitives.size());
+    for (const auto& prim : data.primitives)
+    {
+        writer.Write(prim.flags);
+        writer.Write(prim.textures);
+        writer.Write(prim.splitData);
+        writer.Write(prim.vertexStride);
+        writer.WriteStream(prim.vertices.GetData(), prim.vertices.GetSize());
+        writer.Write(prim.indexSize);
+        writer.WriteStream(prim.indices.GetData(), prim.indices.GetSize());
+    }
+
+    // Cache folder is created on first use
+    CreateDirectory(GetFolderPath(cacheFilename).c_str(), nullptr);
+
+    FILE* pFile = _tfopen(cacheFilename.c_str(), _T("wb"));
+    if (pFile != nullptr)
+    {
+        size_t written = fwrite(writer.GetData().data(), 1, writer.GetData().size(), pFile);
+        fclose(pFile);
+
+        return written == writer.GetData().size();
+    }
+
+    OutputDebugString(_T("Cannot write model cache file: "));
+    OutputDebugString(cacheFilename.c_str());
+    OutputDebugString(_T("\n"));
+
+    return false;
+}
+
+bool ReadModelCache(const char* pCache, size_t cacheSize, const std::tstring& modelFilename, const ModelCacheOptions& options, GLTFModelDesc& model, GLTFModelData& data)
+{
+    CacheReader reader(pCache, cacheSize);
+
+    bool res = ReadModelCacheHeader(reader, options, GetFolderPath(modelFilename), data.sources);
+
+    // Common parameters
+    UINT32 flag = 0;
+    UINT32 count = 0;
+    if (res)
+    {
+        res = reader.Read(flag);
+        data.autoscale = flag != 0;
+    }
+    res = res && reader.Read(data.scaleValue);
+    res = res && reader.Read(data.bb);
+    if (res)
+    {
+        res = reader.Read(flag);
+        model.skinned = flag != 0;
+    }
+    res = res && reader.Read(model.rootNodeIdx);
+
+    // Node hierarchy
+    res = res && reader.Read(count);
+    if (res)
+    {
+        model.nodes.resize(count);
+    }
+    for (UINT32 i = 0; i < count && res; i++)
+    {
+        GLTFModelDesc::Node& node = model.nodes[i];
+
+        res = reader.Read(flag);
+        if (res)
+        {
+            node.useMatrix = flag != 0;
+            if (node.useMatrix)
+            {
+                res = reader.Read(node.matrix);
+            }
+            else
+            {
+                res = reader.Read(node.transform.rotation)
+                    && reader.Read(node.transform.translation)
+                    && reader.Read(node.transform.scale);
+            }
+        }
+        res = res && reader.ReadVector(node.children);
+    }
+
+    // Skin
+    res = res && reader.ReadVector(model.nodeInvBindMatrices);
+    res = res && reader.ReadVector(model.jointIndices);
+
+    // Animation
+    res = res && reader.Read(model.minAnimationTime);
+    res = res && reader.Read(model.maxAnimationTime);
+    res = res && reader.Read(count);
+    if (res)
+    {
+        model.animationSamplers.resize(count);
+    }
+    for (UINT32 i = 0; i < count && res; i++)
+    {
+        GLTFModelDesc::AnimationSampler& sampler = model.animationSamplers[i];
+
+        res = reader.ReadVector(sampler.timeKeys)
+            && reader.ReadVector(sampler.keys)
+            && reader.Read(flag)
+            && reader.ReadVector(sampler.packedKeys)
+            && reader.Read(sampler.rangeMin)
+            && reader.Read(sampler.rangeSize);
+        sampler.rotation = flag != 0;
+    }
+    res = res && reader.Read(count);
+    if (res)
+    {
+        model.animationChannels.resize(count);
+    }
+    for (UINT32 i = 0; i < count && res; i++)
+    {
+        GLTFModelDesc::AnimationChannel& channel = model.animationChannels[i];
+
+        res = reader.Read(channel.animSamplerIdx)
+            && reader.Read(channel.nodeIdx)
+            && reader.Read(flag);
+        channel.type = (GLTFModelDesc::AnimationChannel::Type)flag;
+    }
+
+    // Images
+    res = res && reader.Read(count);
+    if (res)
+    {
+        data.images.resize(count);
+    }
+    for (UINT32 i = 0; i < count && res; i++)
+    {
+        GLTFModelData::Image& image = data.images[i];
+
+        res = reader.ReadString(image.uri)
+            && reader.ReadStream(image.data.pMapped, image.data.mappedSize)
+            && reader.Read(flag);
+        image.srgb = flag != 0;
+    }
+
+    // Primitives
+    res = res && reader.Read(count);
+    if (res)
+    {
+        data.primitives.resize(count);
+    }
+    for (UINT32 i = 0; i < count && res; i++)
+    {
+        GLTFModelData::Primitive& prim = data.primitives[i];
+
+        res = reader.Read(prim.flags)
+            && reader.Read(prim.textures)
+            && reader.Read(prim.splitData)
+            && reader.Read(prim.vertexStride)
+            && reader.ReadStream(prim.vertices.pMapped, prim.vertices.mappedSize)
+            && reader.Read(prim.indexSize)
+            && reader.ReadStream(prim.indices.pMapped, prim.indices.mappedSize);
+    }
+
+    return res;
+}
+
+bool LoadModelCache(const std::tstring& cacheFilename, const std::tstring& modelFilename, const ModelCacheOptions& options, GLTFModelDesc& model, GLTFModelData& data)
+{
+    if (GetFileAttributes(cacheFilename.c_str()) == INVALID_FILE_ATTRIBUTES)
+    {
+        return false;
+    }
+
+    // Cache file stays mapped while model data is alive, geometry streams are uploaded right from it
+    bool res = data.cacheFile.Open(cacheFilename.c_str());
+    res = res && ReadModelCache(data.cacheFile.GetData(), data.cacheFile.GetSize(), modelFilename, options, model, data);
+
+    if (!res)
+    {
+        OutputDebugString(_T("Model cache is outdated or broken: "));
+        OutputDebugString(cacheFilename.c_str());
+        OutputDebugString(_T("\n"));
+    }
+
+    return res;
+}
+
+} // Platform
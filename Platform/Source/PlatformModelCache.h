@@ -0,0 +1,100 @@
+#pragma once
+
+#include "PlatformIO.h"
+#include "PlatformModelCacheFile.h"
+#include "PlatformModelDesc.h"
+#include "PlatformUtil.h"
+
+namespace tinygltf
+{
+class Model;
+}
+
+namespace Platform
+{
+
+// Max error allowed when dropping animation keys
+const float AnimationRotationTolerance = 0.001f;    // Radians
+const float AnimationRangeTolerance = 0.0005f;      // Fraction of track range
+
+// CPU side model description, which is either built from glTF source or read from binary cache
+struct GLTFModelData
+{
+    enum PrimitiveFlags
+    {
+        PrimitiveSkinned        = 1 << 0,
+        PrimitiveMaterial       = 1 << 1,
+        PrimitiveKHRSpecGloss   = 1 << 2,
+        PrimitiveBlend          = 1 << 3,
+        PrimitiveAlphaKill      = 1 << 4,
+        PrimitiveNormalMap      = 1 << 5,
+        PrimitiveEmissive       = 1 << 6
+    };
+
+    enum MaterialTexture
+    {
+        TextureDiffuse = 0,
+        TextureFeature,
+        TextureNormal,
+        TextureEmissive,
+
+        TextureCount
+    };
+
+    // Data stream, which is either owned or points into mapped cache file
+    struct Stream
+    {
+        std::vector<char> data;
+        const char* pMapped = nullptr;
+        size_t mappedSize = 0;
+
+        inline const char* GetData() const { return pMapped != nullptr ? pMapped : data.data(); }
+        inline size_t GetSize() const { return pMapped != nullptr ? mappedSize : data.size(); }
+    };
+
+    struct Image
+    {
+        std::tstring uri;   // Path relative to model folder, empty for embedded image
+        Stream data;        // Encoded embedded image
+        bool srgb = false;
+    };
+
+    struct Primitive
+    {
+        UINT32 flags = 0;
+        int textures[TextureCount] = { -1, -1, -1, -1 };   // Image indices, -1 stands for dummy texture
+        GLTFSplitData splitData;                            // Material factors and node index
+
+        UINT32 vertexStride = 0;
+        Stream vertices;                                    // Interleaved vertex stream
+        UINT32 indexSize = sizeof(UINT16);                  // 2 or 4 bytes per index
+        Stream indices;
+    };
+
+    bool autoscale = true;
+    float scaleValue = 1.0f;
+
+    std::vector<Image> images;
+    std::vector<Primitive> primitives;
+
+    AABB<float> bb; // Bind pose bounding box, empty until calculated
+
+    // Source files relative to model folder, cache is valid while their content is unchanged
+    std::vector<std::tstring> sources;
+
+    // Keeps streams read from cache alive
+    MappedFile cacheFile;
+};
+
+// glTF source with embedded images kept encoded, they are decoded on texture creation
+bool LoadGLTFSource(const std::tstring& modelFilename, tinygltf::Model& source);
+// Model description from glTF source, animations are compressed with options' tolerances
+bool ScanGLTFSource(const tinygltf::Model& source, const std::tstring& modelFilename, const ModelCacheOptions& options, GLTFModelDesc& model, GLTFModelData& data);
+
+// Binary model cache, see GetModelCacheFilename for its location
+bool SaveModelCache(const std::tstring& cacheFilename, const std::tstring& modelFilename, const ModelCacheOptions& options, const GLTFModelDesc& model, const GLTFModelData& data);
+// Streams point into cache content, which is to outlive model data
+bool ReadModelCache(const char* pCache, size_t cacheSize, const std::tstring& modelFilename, const ModelCacheOptions& options, GLTFModelDesc& model, GLTFModelData& data);
+bool LoadModelCache(const std::tstring& cacheFilename, const std::tstring& modelFilename, const ModelCacheOptions& options, GLTFModelDesc& model, GLTFModelData& data);
+
+} // Platform
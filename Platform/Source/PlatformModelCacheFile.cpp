@@ -0,0 +1,189 @@
+#include "stdafx.h"
+#include "PlatformModelCacheFile.h"
+
+#include "PlatformIO.h"
+
+namespace
+{
+
+const UINT32 ModelCacheMagic = 0x43444D47; // 'GMDC'
+const UINT32 ModelCacheVersion = 4;
+
+// Streams are aligned in cache file, so mapped vertex data may be read in place
+const size_t ModelCacheStreamAlignment = 16;
+
+inline size_t AlignUp(size_t offset)
+{
+    return (offset + ModelCacheStreamAlignment - 1) & ~(ModelCacheStreamAlignment - 1);
+}
+
+}
+
+namespace Platform
+{
+
+UINT64 CalcContentHash(const char* pData, size_t size)
+{
+    UINT64 hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (UINT8)pData[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+bool CalcSourceHash(const std::tstring& filename, UINT64& hash)
+{
+    MappedFile file;
+    bool res = file.Open(filename.c_str());
+    if (res)
+    {
+        hash = CalcContentHash(file.GetData(), file.GetSize());
+    }
+    return res;
+}
+
+std::tstring GetModelCacheFilename(const std::tstring& cacheFolder, const std::tstring& modelFilename)
+{
+    // Leading "./" and "../" don't make name unique
+    size_t start = modelFilename.find_first_not_of(_T("./\\"));
+    std::tstring name = start == std::tstring::npos ? modelFilename : modelFilename.substr(start);
+    for (auto& c : name)
+    {
+        if (c == _T('/') || c == _T('\\') || c == _T(':'))
+        {
+            c = _T('_');
+        }
+    }
+
+    return cacheFolder + _T("/") + name + _T(".cache");
+}
+
+void CacheWriter::WriteString(const std::tstring& str)
+{
+    Write((UINT32)str.length());
+    WriteBytes(str.c_str(), str.length() * sizeof(TCHAR));
+}
+
+void CacheWriter::WriteStream(const char* pData, size_t size)
+{
+    Write((UINT64)size);
+    m_data.resize(AlignUp(m_data.size()));
+    WriteBytes(pData, size);
+}
+
+void CacheWriter::WriteBytes(const void* pData, size_t size)
+{
+    const char* pBytes = static_cast<const char*>(pData);
+    m_data.insert(m_data.end(), pBytes, pBytes + size);
+}
+
+bool CacheReader::ReadString(std::tstring& str)
+{
+    UINT32 len = 0;
+    bool res = Read(len) && len * sizeof(TCHAR) <= m_size - m_offset;
+    if (res)
+    {
+        str.resize(len);
+        res = ReadBytes(&str[0], len * sizeof(TCHAR));
+    }
+    return res;
+}
+
+bool CacheReader::ReadStream(const char*& pData, size_t& size)
+{
+    UINT64 streamSize = 0;
+    bool res = Read(streamSize);
+    if (res)
+    {
+        m_offset = std::min(AlignUp(m_offset), m_size);
+        res = streamSize <= m_size - m_offset;
+    }
+    if (res)
+    {
+        pData = m_pData + m_offset;
+        size = (size_t)streamSize;
+        m_offset += (size_t)streamSize;
+    }
+    return res;
+}
+
+bool CacheReader::ReadBytes(void* pData, size_t size)
+{
+    if (size > m_size - m_offset)
+    {
+        return false;
+    }
+    memcpy(pData, m_pData + m_offset, size);
+    m_offset += size;
+
+    return true;
+}
+
+bool WriteModelCacheHeader(CacheWriter& writer, const ModelCacheOptions& options, const std::tstring& folder, const std::vector<std::tstring>& sources)
+{
+    writer.Write(ModelCacheMagic);
+    writer.Write(ModelCacheVersion);
+    writer.Write(options);
+
+    writer.Write((UINT32)sources.size());
+    for (const auto& source : sources)
+    {
+        UINT64 hash = 0;
+        if (!CalcSourceHash(folder + source, hash))
+        {
+            return false;
+        }
+        writer.WriteString(source);
+        writer.Write(hash);
+    }
+
+    return true;
+}
+
+bool ReadModelCacheHeader(CacheReader& reader, const ModelCacheOptions& options, const std::tstring& folder, std::vector<std::tstring>& sources)
+{
+    UINT32 magic = 0;
+    UINT32 version = 0;
+    bool res = reader.Read(magic) && reader.Read(version) && magic == ModelCacheMagic && version == ModelCacheVersion;
+    if (!res)
+    {
+        OutputDebugString(_T("Model cache version is not supported\n"));
+    }
+
+    ModelCacheOptions storedOptions;
+    if (res)
+    {
+        res = reader.Read(storedOptions) && memcmp(&storedOptions, &options, sizeof(options)) == 0;
+        if (!res)
+        {
+            OutputDebugString(_T("Model cache is built with other loader options\n"));
+        }
+    }
+
+    UINT32 count = 0;
+    res = res && reader.Read(count);
+    for (UINT32 i = 0; i < count && res; i++)
+    {
+        std::tstring source;
+        UINT64 storedHash = 0;
+        UINT64 hash = 0;
+        res = reader.ReadString(source) && reader.Read(storedHash) && CalcSourceHash(folder + source, hash) && hash == storedHash;
+        if (res)
+        {
+            sources.push_back(source);
+        }
+        else
+        {
+            OutputDebugString(_T("Source file: "));
+            OutputDebugString(source.c_str());
+            OutputDebugString(_T(" is updated\n"));
+        }
+    }
+
+    return res;
+}
+
+} // Platform
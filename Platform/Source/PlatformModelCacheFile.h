@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+
+namespace Platform
+{
+
+// Loader settings and constants, which cached model description depends on.
+// Cache written with other options is rebuilt
+struct ModelCacheOptions
+{
+    UINT32 zPassNormals = 0;
+    UINT32 forDeferred = 0;
+    UINT32 useLocalCubemaps = 0;
+    float animationRotationTolerance = 0.0f;
+    float animationRangeTolerance = 0.0f;
+};
+
+// FNV-1a hash of data
+UINT64 CalcContentHash(const char* pData, size_t size);
+// Content hash of the whole file
+bool CalcSourceHash(const std::tstring& filename, UINT64& hash);
+
+// Cache files are kept in separate folder, name is made of model path,
+// so equally named models from different folders don't collide
+std::tstring GetModelCacheFilename(const std::tstring& cacheFolder, const std::tstring& modelFilename);
+
+class CacheWriter
+{
+public:
+    template <typename T>
+    void Write(const T& value)
+    {
+        WriteBytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void WriteVector(const std::vector<T>& values)
+    {
+        Write((UINT32)values.size());
+        WriteBytes(values.data(), values.size() * sizeof(T));
+    }
+
+    void WriteString(const std::tstring& str);
+    // Stream is aligned in cache file, so mapped data may be read in place
+    void WriteStream(const char* pData, size_t size);
+    void WriteBytes(const void* pData, size_t size);
+
+    inline const std::vector<char>& GetData() const { return m_data; }
+
+private:
+    std::vector<char> m_data;
+};
+
+class CacheReader
+{
+public:
+    CacheReader(const char* pData, size_t size)
+        : m_pData(pData)
+        , m_size(size)
+        , m_offset(0)
+    {}
+
+    template <typename T>
+    bool Read(T& value)
+    {
+        return ReadBytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    bool ReadVector(std::vector<T>& values)
+    {
+        UINT32 count = 0;
+        bool res = Read(count) && count * sizeof(T) <= m_size - m_offset;
+        if (res)
+        {
+            values.resize(count);
+            res = ReadBytes(values.data(), count * sizeof(T));
+        }
+        return res;
+    }
+
+    bool ReadString(std::tstring& str);
+    // Stream is not copied, it points to cache data
+    bool ReadStream(const char*& pData, size_t& size);
+    bool ReadBytes(void* pData, size_t size);
+
+private:
+    const char* m_pData;
+    size_t m_size;
+    size_t m_offset;
+};
+
+// Format version, loader options and source files, relative to model folder, with their content hashes
+bool WriteModelCacheHeader(CacheWriter& writer, const ModelCacheOptions& options, const std::tstring& folder, const std::vector<std::tstring>& sources);
+// Fails if cache is written by other version, with other options or any source file is changed
+bool ReadModelCacheHeader(CacheReader& reader, const ModelCacheOptions& options, const std::tstring& folder, std::vector<std::tstring>& sources);
+
+} // Platform
@@ -0,0 +1,734 @@
+#include "stdafx.h"
+#include "PlatformModelCache.h"
+
+// glTF parsing is device-free, images are decoded by loader, so stb isn't needed here
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include "tiny_gltf.h"
+
+namespace
+{
+
+using namespace Platform;
+
+// Keeps embedded image encoded, it is decoded on texture creation
+bool KeepEncodedImage(tinygltf::Image* pImage, const int, std::string*, std::string*, int, int, const unsigned char* pBytes, int size, void*)
+{
+    pImage->image.assign(pBytes, pBytes + size);
+    return true;
+}
+
+void ScanSources(const tinygltf::Model& source, const std::tstring& modelFilename, GLTFModelData& data)
+{
+    // Model description depends on model file itself and external buffers
+    data.sources.push_back(ShortFilename(modelFilename));
+    for (const auto& buffer : source.buffers)
+    {
+        if (!buffer.uri.empty() && !tinygltf::IsDataURI(buffer.uri))
+        {
+            data.sources.push_back(ToTString(tinygltf::dlib::urldecode(buffer.uri)));
+        }
+    }
+
+    // External images are referenced by path, embedded ones are kept encoded
+    data.images.resize(source.images.size());
+    for (size_t i = 0; i < source.images.size(); i++)
+    {
+        if (!source.images[i].uri.empty() && !tinygltf::IsDataURI(source.images[i].uri))
+        {
+            data.images[i].uri = ToTString(tinygltf::dlib::urldecode(source.images[i].uri));
+        }
+        else
+        {
+            data.images[i].data.data.assign(source.images[i].image.begin(), source.images[i].image.end());
+        }
+    }
+
+    for (size_t i = 0; i < source.materials.size(); i++)
+    {
+        int diffuseIdx = -1;
+        int specGlossIdx = -1;
+        const tinygltf::Material& material = source.materials[i];
+        if (material.extensions.find("KHR_materials_pbrSpecularGlossiness") != material.extensions.end())
+        {
+            const tinygltf::Value& diff = material.extensions.at("KHR_materials_pbrSpecularGlossiness").Get("diffuseTexture");
+            if (diff.IsObject())
+            {
+                diffuseIdx = diff.Get("index").GetNumberAsInt();
+            }
+
+            const tinygltf::Value& specGlos = material.extensions.at("KHR_materials_pbrSpecularGlossiness").Get("specularGlossinessTexture");
+            if (specGlos.IsObject())
+            {
+                specGlossIdx = specGlos.Get("index").GetNumberAsInt();
+            }
+        }
+        else
+        {
+            diffuseIdx = material.pbrMetallicRoughness.baseColorTexture.index;
+        }
+
+        if (diffuseIdx != -1)
+        {
+            int imageIdx = source.textures[diffuseIdx].source;
+            data.images[imageIdx].srgb = true;
+        }
+        if (specGlossIdx != -1)
+        {
+            int imageIdx = source.textures[specGlossIdx].source;
+            data.images[imageIdx].srgb = true;
+        }
+    }
+}
+
+bool ScanNode(const tinygltf::Model& source, int nodeIdx, GLTFModelDesc& model, GLTFModelData& data)
+{
+    const tinygltf::Node& node = source.nodes[nodeIdx];
+
+    struct NormalVertex
+    {
+        Point3f pos;
+        Point3f normal;
+        Point4f tangent;
+        Point2f uv;
+    };
+
+    struct NormalWeightedVertex
+    {
+        Point3f pos;
+        Point3f normal;
+        Point4f tangent;
+        Point2f uv;
+        Point4<unsigned short> joints;
+        Point4f weights;
+    };
+
+    bool res = true;
+
+    if ((size_t)nodeIdx >= model.nodes.size())
+    {
+        model.nodes.resize(nodeIdx + 1);
+    }
+
+    if (node.matrix.size() != 0)
+    {
+        assert(node.matrix.size() == 16);
+        Matrix4f nodeMatrix;
+        for (int i = 0; i < 16; i++)
+        {
+            nodeMatrix.m[i] = (float)node.matrix[i];
+        }
+        model.nodes[nodeIdx] = GLTFModelDesc::Node(nodeMatrix);
+    }
+    else
+    {
+        Point4f r = Point4f(0, 0, 0, 1);    // Identity rotation
+        Point3f t = Point3f(0, 0, 0);       // No translation
+        Point3f s = Point3f(1, 1, 1);       // No scaling
+
+        if (node.rotation.size() != 0)
+        {
+            assert(node.rotation.size() == 4);
+            r = Point4f((float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2], (float)node.rotation[3]);
+        }
+        if (node.translation.size() != 0)
+        {
+            assert(node.translation.size() == 3);
+            t = Point3f((float)node.translation[0], (float)node.translation[1], (float)node.translation[2]);
+        }
+        if (node.scale.size() != 0)
+        {
+            assert(node.scale.size() == 3);
+            s = Point3f((float)node.scale[0], (float)node.scale[1], (float)node.scale[2]);
+        }
+
+        model.nodes[nodeIdx] = GLTFModelDesc::Node(r, t, s);
+    }
+
+    if (node.mesh != -1)
+    {
+        const tinygltf::Mesh& mesh = source.meshes[node.mesh];
+
+        for (size_t i = 0; i < mesh.primitives.size(); i++)
+        {
+            const tinygltf::Primitive& prim = mesh.primitives[i];
+            assert(prim.mode == TINYGLTF_MODE_TRIANGLES);
+
+            int posIdx = prim.attributes.find("POSITION")->second;
+            int normIdx = prim.attributes.find("NORMAL")->second;
+            int uvIdx = prim.attributes.find("TEXCOORD_0")->second;
+            int tgIdx = -1;
+            if (prim.attributes.find("TANGENT") != prim.attributes.end())
+            {
+                tgIdx = prim.attributes.find("TANGENT")->second;
+            }
+            int jointsIdx = -1;
+            if (prim.attributes.find("JOINTS_0") != prim.attributes.end())
+            {
+                jointsIdx = prim.attributes.find("JOINTS_0")->second;
+            }
+            int weightsIdx = -1;
+            if (prim.attributes.find("WEIGHTS_0") != prim.attributes.end())
+            {
+                weightsIdx = prim.attributes.find("WEIGHTS_0")->second;
+            }
+            int idxIdx = prim.indices;
+
+            const tinygltf::Accessor& pos = source.accessors[posIdx];
+            const tinygltf::Accessor& norm = source.accessors[normIdx];
+            const tinygltf::Accessor& uv = source.accessors[uvIdx];
+            const tinygltf::Accessor& indices = source.accessors[idxIdx];
+
+            const tinygltf::Accessor* pTg = tgIdx == -1 ? nullptr : &source.accessors[tgIdx];
+            const tinygltf::Accessor* pJoints = jointsIdx == -1 ? nullptr : &source.accessors[jointsIdx];
+            const tinygltf::Accessor* pWeights = weightsIdx == -1 ? nullptr : &source.accessors[weightsIdx];
+
+            assert(pos.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+            assert(pos.type == TINYGLTF_TYPE_VEC3);
+            assert(indices.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT || indices.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+            assert(indices.type == TINYGLTF_TYPE_SCALAR);
+
+            assert(pJoints == nullptr || pJoints->componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+            assert(pJoints == nullptr || pJoints->type == TINYGLTF_TYPE_VEC4);
+            assert(pWeights == nullptr || pWeights->componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+            assert(pWeights == nullptr || pWeights->type == TINYGLTF_TYPE_VEC4);
+            if (pTg != nullptr)
+            {
+                assert(pTg == nullptr || pTg->componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+                assert(pTg == nullptr || pTg->type == TINYGLTF_TYPE_VEC4);
+            }
+
+            const tinygltf::BufferView& posView = source.bufferViews[pos.bufferView];
+            const tinygltf::BufferView& normView = source.bufferViews[norm.bufferView];
+            const tinygltf::BufferView& uvView = source.bufferViews[uv.bufferView];
+            const tinygltf::BufferView& indicesView = source.bufferViews[indices.bufferView];
+
+            const tinygltf::BufferView* pTgView = tgIdx == -1 ? nullptr : &source.bufferViews[pTg->bufferView];
+            const tinygltf::BufferView* pJointsView = jointsIdx == -1 ? nullptr : &source.bufferViews[pJoints->bufferView];
+            const tinygltf::BufferView* pWeightsView = weightsIdx == -1 ? nullptr : &source.bufferViews[pWeights->bufferView];
+
+            const char* pIndices = reinterpret_cast<const char*>(source.buffers[indicesView.buffer].data.data() + indicesView.byteOffset + indices.byteOffset);
+            const Point3f* pPos = reinterpret_cast<const Point3f*>(source.buffers[posView.buffer].data.data() + posView.byteOffset + pos.byteOffset);
+            const Point3f* pNorm = reinterpret_cast<const Point3f*>(source.buffers[normView.buffer].data.data() + normView.byteOffset + norm.byteOffset);
+            const Point2f* pUV = reinterpret_cast<const Point2f*>(source.buffers[uvView.buffer].data.data() + uvView.byteOffset + uv.byteOffset);
+
+            const Point4f* pTang = tgIdx == -1 ? nullptr : reinterpret_cast<const Point4f*>(source.buffers[pTgView->buffer].data.data() + pTgView->byteOffset + pTg->byteOffset);
+            const Point4<unsigned short>* pJointsValues = jointsIdx == -1 ? nullptr : reinterpret_cast<const Point4<unsigned short>*>(source.buffers[pJointsView->buffer].data.data() + pJointsView->byteOffset + pJoints->byteOffset);
+            const Point4f* pWeightsValues = weightsIdx == -1 ? nullptr : reinterpret_cast<const Point4f*>(source.buffers[pWeightsView->buffer].data.data() + pWeightsView->byteOffset + pWeights->byteOffset);
+
+            GLTFModelData::Primitive primData;
+
+            // Interleave vertex attributes right into primitive vertex stream
+            if (pJointsValues == nullptr)
+            {
+                primData.vertexStride = sizeof(NormalVertex);
+                primData.vertices.data.resize(pos.count * sizeof(NormalVertex));
+
+                NormalVertex* pVertices = reinterpret_cast<NormalVertex*>(primData.vertices.data.data());
+                for (size_t i = 0; i < pos.count; i++)
+                {
+                    pVertices[i].pos = pPos[i];
+                    pVertices[i].normal = pNorm[i];
+                    if (pTang != nullptr)
+                    {
+                        pVertices[i].tangent = pTang[i];
+                    }
+                    pVertices[i].uv = pUV[i];
+                }
+            }
+            else
+            {
+                primData.flags |= GLTFModelData::PrimitiveSkinned;
+                primData.vertexStride = sizeof(NormalWeightedVertex);
+                primData.vertices.data.resize(pos.count * sizeof(NormalWeightedVertex));
+
+                NormalWeightedVertex* pVertices = reinterpret_cast<NormalWeightedVertex*>(primData.vertices.data.data());
+                for (size_t i = 0; i < pos.count; i++)
+                {
+                    pVertices[i].pos = pPos[i];
+                    pVertices[i].normal = pNorm[i];
+                    if (pTang != nullptr)
+                    {
+                        pVertices[i].tangent = pTang[i];
+                    }
+                    pVertices[i].uv = pUV[i];
+
+                    pVertices[i].joints = pJointsValues[i];
+                    pVertices[i].weights = pWeightsValues[i];
+                }
+            }
+
+            primData.indexSize = indices.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ? sizeof(UINT32) : sizeof(UINT16);
+            primData.indices.data.assign(pIndices, pIndices + indices.count * primData.indexSize);
+
+            Point4f emissiveFactor = {};
+
+            if (prim.material != -1)
+            {
+                const tinygltf::Material& material = source.materials[prim.material];
+
+                primData.flags |= GLTFModelData::PrimitiveMaterial;
+
+                // Parse KHR_materials_pbrSpecularGlossiness extension
+                const tinygltf::Value* pKHRSpecGloss = nullptr;
+                bool isKHRSpecGloss = material.extensions.find("KHR_materials_pbrSpecularGlossiness") != material.extensions.end();
+                if (isKHRSpecGloss)
+                {
+                    pKHRSpecGloss = &material.extensions.at("KHR_materials_pbrSpecularGlossiness");
+                    primData.flags |= GLTFModelData::PrimitiveKHRSpecGloss;
+                }
+
+                if (material.alphaMode == "BLEND")
+                {
+                    primData.flags |= GLTFModelData::PrimitiveBlend;
+                }
+                else if (material.alphaMode == "MASK")
+                {
+                    primData.flags |= GLTFModelData::PrimitiveAlphaKill;
+                }
+
+                int diffuseIdx = -1;
+                if (!isKHRSpecGloss)
+                {
+                    diffuseIdx = material.pbrMetallicRoughness.baseColorTexture.index;
+                }
+                else
+                {
+                    const tinygltf::Value& diff = pKHRSpecGloss->Get("diffuseTexture");
+                    if (diff.IsObject())
+                    {
+                        diffuseIdx = diff.Get("index").GetNumberAsInt();
+                    }
+                }
+                if (diffuseIdx != -1)
+                {
+                    primData.textures[GLTFModelData::TextureDiffuse] = source.textures[diffuseIdx].source;
+                }
+
+                int featureIdx = -1;
+                if (!isKHRSpecGloss)
+                {
+                    featureIdx = material.pbrMetallicRoughness.metallicRoughnessTexture.index;
+                }
+                else
+                {
+                    const tinygltf::Value& specGlos = pKHRSpecGloss->Get("specularGlossinessTexture");
+                    if (specGlos.IsObject())
+                    {
+                        featureIdx = specGlos.Get("index").GetNumberAsInt();
+                    }
+                }
+                if (featureIdx != -1)
+                {
+                    primData.textures[GLTFModelData::TextureFeature] = source.textures[featureIdx].source;
+                }
+
+                if (material.normalTexture.index != -1 && tgIdx != -1)
+                {
+                    primData.flags |= GLTFModelData::PrimitiveNormalMap;
+                    primData.textures[GLTFModelData::TextureNormal] = source.textures[material.normalTexture.index].source;
+                }
+
+                if (material.emissiveTexture.index != -1)
+                {
+                    primData.textures[GLTFModelData::TextureEmissive] = source.textures[material.emissiveTexture.index].source;
+                }
+
+                emissiveFactor = Point4f{
+                    (float)material.emissiveFactor[0],
+                    (float)material.emissiveFactor[1],
+                    (float)material.emissiveFactor[2],
+                    0.0f
+                };
+                if (emissiveFactor.lengthSqr() > 0.01f)
+                {
+                    primData.flags |= GLTFModelData::PrimitiveEmissive;
+                }
+
+                primData.splitData.metalF0 = Point4f{
+                    (float)material.pbrMetallicRoughness.baseColorFactor[0],
+                    (float)material.pbrMetallicRoughness.baseColorFactor[1],
+                    (float)material.pbrMetallicRoughness.baseColorFactor[2],
+                    (float)material.pbrMetallicRoughness.baseColorFactor[3]
+                };
+
+                primData.splitData.pbr.x = (float)material.pbrMetallicRoughness.roughnessFactor;
+                primData.splitData.pbr.y = (float)material.pbrMetallicRoughness.metallicFactor;
+                primData.splitData.pbr.w = (float)pow(material.alphaCutoff, 2.2); // Take srgb texture reading into account
+
+                if (isKHRSpecGloss)
+                {
+                    const tinygltf::Value& ksg = *pKHRSpecGloss;
+                    if (ksg.Has("diffuseFactor"))
+                    {
+                        const tinygltf::Value& diffFactor = ksg.Get("diffuseFactor");
+                        primData.splitData.ksgDiffFactor = Point4f{
+                            (float)diffFactor.Get(0).GetNumberAsDouble(),
+                            (float)diffFactor.Get(1).GetNumberAsDouble(),
+                            (float)diffFactor.Get(2).GetNumberAsDouble(),
+                            (float)diffFactor.Get(3).GetNumberAsDouble(),
+                        };
+                    }
+                    Point4f specGlosFactor = Point4f{ 1,1,1,1 };
+                    if (ksg.Has("specularFactor"))
+                    {
+                        const tinygltf::Value& specFactor = ksg.Get("specularFactor");
+                        specGlosFactor.x = (float)specFactor.Get(0).GetNumberAsDouble();
+                        specGlosFactor.y = (float)specFactor.Get(1).GetNumberAsDouble();
+                        specGlosFactor.z = (float)specFactor.Get(2).GetNumberAsDouble();
+                    }
+                    if (ksg.Has("glossinessFactor"))
+                    {
+                        const tinygltf::Value& glosFactor = ksg.Get("glossinessFactor");
+                        specGlosFactor.w = (float)glosFactor.GetNumberAsDouble();
+                    }
+                    primData.splitData.ksgSpecGlossFactor = specGlosFactor;
+                }
+            }
+
+            primData.splitData.nodeIndex = Point4i(nodeIdx);
+
+            primData.splitData.pbr.z = 0.04f;
+
+            primData.splitData.emissiveFactor = emissiveFactor;
+
+            data.primitives.push_back(std::move(primData));
+        }
+    }
+
+    for (size_t i = 0; i < node.children.size() && res; i++)
+    {
+        model.nodes[nodeIdx].children.push_back(node.children[i]);
+
+        res = ScanNode(source, node.children[i], model, data);
+    }
+
+    return res;
+}
+
+void CompressAnimations(const ModelCacheOptions& options, GLTFModelDesc& model)
+{
+
+    std::vector<bool> rotationSamplers(model.animationSamplers.size(), false);
+    for (const auto& channel : model.animationChannels)
+    {
+        if (channel.type == GLTFModelDesc::AnimationChannel::Rotation)
+        {
+            rotationSamplers[channel.animSamplerIdx] = true;
+        }
+    }
+
+    size_t srcKeyCount = 0;
+    size_t srcSize = 0;
+    size_t dstKeyCount = 0;
+    size_t dstSize = 0;
+
+    for (size_t i = 0; i < model.animationSamplers.size(); i++)
+    {
+        GLTFModelDesc::AnimationSampler& sampler = model.animationSamplers[i];
+
+        srcKeyCount += sampler.GetKeyCount();
+        srcSize += sampler.timeKeys.size() * sizeof(float) + sampler.keys.size() * sizeof(Point4f);
+
+        sampler.Compress(rotationSamplers[i], rotationSamplers[i] ? options.animationRotationTolerance : options.animationRangeTolerance);
+
+        dstKeyCount += sampler.GetKeyCount();
+        dstSize += sampler.timeKeys.size() * sizeof(float) + sampler.packedKeys.size() * sizeof(UINT16);
+    }
+
+    TCHAR buffer[256];
+    _stprintf_s(buffer, _T("Animation compressed: %d -> %d keys, %d -> %d bytes\n"), (int)srcKeyCount, (int)dstKeyCount, (int)srcSize, (int)dstSize);
+    OutputDebugString(buffer);
+}
+
+void LoadSkins(const tinygltf::Model& source, GLTFModelDesc& model)
+{
+    if (!source.skins.empty())
+    {
+        model.skinned = true;
+
+        assert(source.skins.size() == 1);
+
+        const tinygltf::Accessor& invBindMatricesAccessor = source.accessors[source.skins[0].inverseBindMatrices];
+
+        assert(invBindMatricesAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+        assert(invBindMatricesAccessor.type == TINYGLTF_TYPE_MAT4);
+
+        const tinygltf::BufferView& invBindMatricesView = source.bufferViews[invBindMatricesAccessor.bufferView];
+        const tinygltf::Buffer& invBindMatricesBuffer = source.buffers[invBindMatricesView.buffer];
+
+        const Matrix4f* pInvBindMatrices = reinterpret_cast<const Matrix4f*>(invBindMatricesBuffer.data.data() + invBindMatricesView.byteOffset + invBindMatricesAccessor.byteOffset);
+
+        assert(source.skins[0].joints.size() <= MAX_NODES);
+
+        for (size_t i = 0; i < source.skins[0].joints.size(); i++)
+        {
+            model.jointIndices.push_back(source.skins[0].joints[i]);
+
+            int nodeIdx = source.skins[0].joints[i];
+
+            if ((size_t)nodeIdx >= model.nodeInvBindMatrices.size())
+            {
+                model.nodeInvBindMatrices.resize(nodeIdx + 1, Matrix4f());
+            }
+            model.nodeInvBindMatrices[nodeIdx] = pInvBindMatrices[i];
+        }
+    }
+}
+
+void LoadAnimations(const tinygltf::Model& source, const ModelCacheOptions& options, GLTFModelDesc& model)
+{
+    if (!source.animations.empty())
+    {
+        model.maxAnimationTime = 0.0f;
+        model.minAnimationTime = std::numeric_limits<float>::max();
+
+        assert(source.animations.size() == 1);
+
+        for (size_t i = 0; i < source.animations[0].samplers.size(); i++)
+        {
+            GLTFModelDesc::AnimationSampler animSampler;
+
+            const tinygltf::Accessor& timeKeysAccessor = source.accessors[source.animations[0].samplers[i].input];
+
+            assert(timeKeysAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+            assert(timeKeysAccessor.type == TINYGLTF_TYPE_SCALAR);
+
+            const tinygltf::BufferView& timeKeysView = source.bufferViews[timeKeysAccessor.bufferView];
+            const tinygltf::Buffer& timeKeysBuffer = source.buffers[timeKeysView.buffer];
+
+            const float* timeKeys = reinterpret_cast<const float*>(timeKeysBuffer.data.data() + timeKeysView.byteOffset + timeKeysAccessor.byteOffset);
+
+            animSampler.timeKeys.resize(timeKeysAccessor.count);
+            for (size_t j = 0; j < timeKeysAccessor.count; j++)
+            {
+                animSampler.timeKeys[j] = timeKeys[j];
+            }
+
+            model.maxAnimationTime = std::max(model.maxAnimationTime, animSampler.timeKeys.back());
+            model.minAnimationTime = std::min(model.minAnimationTime, animSampler.timeKeys.front());
+
+            const tinygltf::Accessor& keysAccessor = source.accessors[source.animations[0].samplers[i].output];
+
+            assert(keysAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+            assert(keysAccessor.type == TINYGLTF_TYPE_VEC3 || keysAccessor.type == TINYGLTF_TYPE_VEC4);
+
+            const tinygltf::BufferView& keysView = source.bufferViews[keysAccessor.bufferView];
+            const tinygltf::Buffer& keysBuffer = source.buffers[keysView.buffer];
+
+            const Point3f* keys3f = nullptr;
+            const Point4f* keys4f = nullptr;
+
+            if (keysAccessor.type == TINYGLTF_TYPE_VEC3)
+            {
+                keys3f = reinterpret_cast<const Point3f*>(keysBuffer.data.data() + keysView.byteOffset + keysAccessor.byteOffset);
+            }
+            else if (keysAccessor.type == TINYGLTF_TYPE_VEC4)
+            {
+                keys4f = reinterpret_cast<const Point4f*>(keysBuffer.data.data() + keysView.byteOffset + keysAccessor.byteOffset);
+            }
+
+            assert(timeKeysAccessor.count == keysAccessor.count);
+            animSampler.keys.resize(keysAccessor.count);
+            for (size_t j = 0; j < timeKeysAccessor.count; j++)
+            {
+                if (keys3f)
+                {
+                    animSampler.keys[j] = Point4f(keys3f[j].x, keys3f[j].y, keys3f[j].z, 0.0f);
+                }
+                else if (keys4f)
+                {
+                    animSampler.keys[j] = keys4f[j];
+                }
+            }
+
+            model.animationSamplers.push_back(animSampler);
+        }
+
+        for (auto& animSampler : model.animationSamplers)
+        {
+            for (auto& timeKey : animSampler.timeKeys)
+            {
+                timeKey -= model.minAnimationTime;
+            }
+        }
+        model.maxAnimationTime -= model.minAnimationTime;
+        model.minAnimationTime = 0.0f;
+
+        for (size_t i = 0; i < source.animations[0].channels.size(); i++)
+        {
+            GLTFModelDesc::AnimationChannel animChannel;
+
+            if (source.animations[0].channels[i].target_path == "rotation")
+            {
+                animChannel.type = GLTFModelDesc::AnimationChannel::Rotation;
+            }
+            else if (source.animations[0].channels[i].target_path == "translation")
+            {
+                animChannel.type = GLTFModelDesc::AnimationChannel::Translation;
+            }
+            else if (source.animations[0].channels[i].target_path == "scale")
+            {
+                animChannel.type = GLTFModelDesc::AnimationChannel::Scale;
+            }
+            animChannel.animSamplerIdx = source.animations[0].channels[i].sampler;
+            animChannel.nodeIdx = source.animations[0].channels[i].target_node;
+
+            model.animationChannels.push_back(animChannel);
+        }
+
+        CompressAnimations(options, model);
+    }
+}
+
+// Bind pose bounds of all primitives, with the same root transform as GLTFModel::UpdateMatrices before scaling
+AABB<float> CalcModelAABB(const GLTFModelDesc& model, const GLTFModelData& data)
+{
+    Matrix4f root;
+    root.Identity();
+    root.m[0] = -root.m[0];
+
+    std::vector<Matrix4f> world(model.flatNodes.size() * 2);
+    CalcHierarchyMatrices(model.bindPose, model.flatParents, root, root, world.data(), world.data() + model.flatNodes.size());
+
+    std::vector<Matrix4f> nodeTransforms(model.nodes.size());
+    for (size_t i = 0; i < model.flatNodes.size(); i++)
+    {
+        int nodeIdx = model.flatNodes[i];
+        nodeTransforms[nodeIdx] = model.nodeInvBindMatrices[nodeIdx] * world[i];
+    }
+
+    AABB<float> res;
+
+    for (const auto& prim : data.primitives)
+    {
+        const Matrix4f& m = nodeTransforms[prim.splitData.nodeIndex.x];
+
+        // Position is always the first vertex attribute
+        size_t vertexCount = prim.vertices.GetSize() / prim.vertexStride;
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            const Point3f& pos = *reinterpret_cast<const Point3f*>(prim.vertices.GetData() + i * prim.vertexStride);
+
+            Point4f mp = m * Point4f{ pos.x, pos.y, pos.z, 1.0f };
+
+            res.Add(Point3f{ mp.x, mp.y, mp.z });
+        }
+    }
+
+    return res;
+}
+
+}
+
+namespace Platform
+{
+
+void GLTFModelDesc::BuildHierarchy()
+{
+    flatNodes.clear();
+    flatParents.clear();
+
+    std::vector<int> flatIdx(nodes.size(), -1);
+
+    if (!nodes.empty())
+    {
+        // Breadth-first order, so every parent is placed before its children
+        flatNodes.push_back(rootNodeIdx);
+        flatParents.push_back(-1);
+        for (size_t i = 0; i < flatNodes.size(); i++)
+        {
+            flatIdx[flatNodes[i]] = (int)i;
+            for (auto child : nodes[flatNodes[i]].children)
+            {
+                flatNodes.push_back(child);
+                flatParents.push_back((int)i);
+            }
+        }
+    }
+
+    bindPose.Resize(flatNodes.size());
+    for (size_t i = 0; i < flatNodes.size(); i++)
+    {
+        const Node& node = nodes[flatNodes[i]];
+
+        bindPose.useMatrix[i] = node.useMatrix;
+        if (node.useMatrix)
+        {
+            bindPose.matrix[i] = node.matrix;
+            bindPose.rotation[i] = Point4f(0, 0, 0, 1);
+            bindPose.translation[i] = Point3f(0, 0, 0);
+            bindPose.scale[i] = Point3f(1, 1, 1);
+        }
+        else
+        {
+            bindPose.rotation[i] = node.transform.rotation;
+            bindPose.translation[i] = node.transform.translation;
+            bindPose.scale[i] = node.transform.scale;
+        }
+    }
+
+    for (auto& channel : animationChannels)
+    {
+        channel.flatNodeIdx = channel.nodeIdx < (int)flatIdx.size() ? flatIdx[channel.nodeIdx] : -1;
+    }
+}
+
+bool LoadGLTFSource(const std::tstring& modelFilename, tinygltf::Model& source)
+{
+    tinygltf::TinyGLTF loader;
+    std::string err;
+    std::string warn;
+
+    loader.SetImageLoader(KeepEncodedImage, nullptr);
+
+    bool res = loader.LoadASCIIFromFile(&source, &err, &warn, ToString(modelFilename));
+    if (!res)
+    {
+        OutputDebugString(_T("Cannot load model: "));
+        OutputDebugString(modelFilename.c_str());
+        OutputDebugString(_T("\n"));
+    }
+
+    return res;
+}
+
+bool ScanGLTFSource(const tinygltf::Model& source, const std::tstring& modelFilename, const ModelCacheOptions& options, GLTFModelDesc& model, GLTFModelData& data)
+{
+    if (source.asset.extras.IsObject())
+    {
+        const tinygltf::Value& scaleFlag = source.asset.extras.Get("autoscale");
+        if (scaleFlag.IsBool())
+        {
+            data.autoscale = scaleFlag.Get<bool>();
+        }
+
+        const tinygltf::Value& scaleValue = source.asset.extras.Get("scale");
+        if (scaleValue.IsNumber())
+        {
+            data.scaleValue = (float)scaleValue.Get<double>();
+        }
+    }
+
+    ScanSources(source, modelFilename, data);
+
+    LoadSkins(source, model);
+    LoadAnimations(source, options, model);
+
+    model.rootNodeIdx = source.scenes[0].nodes[0];
+
+    bool res = ScanNode(source, model.rootNodeIdx, model, data);
+    if (res)
+    {
+        model.nodeInvBindMatrices.resize(model.nodes.size());
+
+        model.BuildHierarchy();
+        data.bb = CalcModelAABB(model, data);
+    }
+
+    return res;
+}
+
+} // Platform
@@ -0,0 +1,153 @@
+#include "stdafx.h"
+#include "PlatformPersistentCBAllocator.h"
+
+#include "PlatformUtil.h"
+
+#include <algorithm>
+
+namespace Platform
+{
+
+PersistentCBAllocator::PersistentCBAllocator()
+    : m_capacity(0)
+    , m_top(0)
+    , m_bufferCount(0)
+    , m_usedSize(0)
+{
+}
+
+void PersistentCBAllocator::Init(UINT64 capacity)
+{
+    m_capacity = capacity;
+}
+
+void PersistentCBAllocator::Term()
+{
+    m_buffers.clear();
+    m_freeBuffers.clear();
+    m_dirtyBuffers.clear();
+
+    m_capacity = 0;
+    m_top = 0;
+    m_bufferCount = 0;
+    m_usedSize = 0;
+}
+
+UINT PersistentCBAllocator::Allocate(UINT size)
+{
+    size = DivUp(size, Alignment) * Alignment;
+
+    UINT handle = InvalidHandle;
+
+    auto it = std::find_if(m_freeBuffers.begin(), m_freeBuffers.end(), [this, size](UINT idx) { return m_buffers[idx].size == size; });
+    if (it != m_freeBuffers.end())
+    {
+        handle = *it;
+        m_freeBuffers.erase(it);
+    }
+    else if (m_top + size <= m_capacity)
+    {
+        Buffer buffer;
+        buffer.offset = m_top;
+        buffer.size = size;
+
+        handle = (UINT)m_buffers.size();
+        m_buffers.push_back(buffer);
+
+        m_top += size;
+    }
+
+    if (handle != InvalidHandle)
+    {
+        m_buffers[handle].used = true;
+        m_buffers[handle].dirty = true;
+
+        ++m_bufferCount;
+        m_usedSize += size;
+    }
+
+    return handle;
+}
+
+void PersistentCBAllocator::Free(UINT handle)
+{
+    assert(handle < m_buffers.size() && m_buffers[handle].used);
+
+    Buffer& buffer = m_buffers[handle];
+    buffer.used = false;
+    buffer.dirty = false;
+    buffer.queued = false;
+
+    m_freeBuffers.push_back(handle);
+
+    --m_bufferCount;
+    m_usedSize -= buffer.size;
+}
+
+void PersistentCBAllocator::MarkDirty(UINT handle)
+{
+    assert(handle < m_buffers.size() && m_buffers[handle].used);
+
+    Buffer& buffer = m_buffers[handle];
+
+    // Buffer, which is dirty since allocation, is not in the list yet
+    if (!buffer.queued)
+    {
+        m_dirtyBuffers.push_back(handle);
+        buffer.queued = true;
+    }
+    buffer.dirty = true;
+}
+
+void PersistentCBAllocator::BuildCopyRuns(UINT64 maxCopySize, std::vector<CopyRun>& runs)
+{
+    runs.clear();
+
+    // Entries of freed buffers are dropped, buffer reallocated after free may be listed twice.
+    // The rest is copied in address order, so adjacent buffers form single copy
+    m_dirtyBuffers.erase(std::remove_if(m_dirtyBuffers.begin(), m_dirtyBuffers.end(), [this](UINT idx) { return !m_buffers[idx].queued; }), m_dirtyBuffers.end());
+    std::sort(m_dirtyBuffers.begin(), m_dirtyBuffers.end(), [this](UINT a, UINT b) { return m_buffers[a].offset < m_buffers[b].offset; });
+    m_dirtyBuffers.erase(std::unique(m_dirtyBuffers.begin(), m_dirtyBuffers.end()), m_dirtyBuffers.end());
+
+    size_t first = 0;
+    while (first < m_dirtyBuffers.size())
+    {
+        CopyRun run;
+        run.offset = m_buffers[m_dirtyBuffers[first]].offset;
+        run.size = m_buffers[m_dirtyBuffers[first]].size;
+
+        size_t last = first + 1;
+        while (last < m_dirtyBuffers.size()
+            && m_buffers[m_dirtyBuffers[last]].offset == run.offset + run.size
+            && run.size + m_buffers[m_dirtyBuffers[last]].size <= maxCopySize)
+        {
+            run.size += m_buffers[m_dirtyBuffers[last]].size;
+            ++last;
+        }
+        run.bufferCount = (UINT)(last - first);
+
+        runs.push_back(run);
+
+        first = last;
+    }
+}
+
+void PersistentCBAllocator::CompleteCopyRuns(const std::vector<CopyRun>& runs, size_t runCount)
+{
+    size_t bufferCount = 0;
+    for (size_t i = 0; i < runCount; i++)
+    {
+        bufferCount += runs[i].bufferCount;
+    }
+    assert(bufferCount <= m_dirtyBuffers.size());
+
+    for (size_t i = 0; i < bufferCount; i++)
+    {
+        m_buffers[m_dirtyBuffers[i]].dirty = false;
+        m_buffers[m_dirtyBuffers[i]].queued = false;
+    }
+
+    m_dirtyBuffers.erase(m_dirtyBuffers.begin(), m_dirtyBuffers.begin() + bufferCount);
+}
+
+} // Platform
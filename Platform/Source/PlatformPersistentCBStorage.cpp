@@ -0,0 +1,138 @@
+#include "stdafx.h"
+#include "PlatformPersistentCBStorage.h"
+
+#include "Platform.h"
+
+namespace
+{
+
+// Large runs of adjacent buffers are split, so single copy doesn't take too much of dynamic heap
+const UINT MaxCopySize = 4 * 1024 * 1024;
+
+static_assert(Platform::PersistentCBAllocator::Alignment == D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, "Allocator alignment should match constant buffer placement");
+
+}
+
+namespace Platform
+{
+
+PersistentCBStorage::PersistentCBStorage()
+    : m_pDevice(nullptr)
+    , m_state(D3D12_RESOURCE_STATE_COMMON)
+{
+}
+
+PersistentCBStorage::~PersistentCBStorage()
+{
+    assert(m_buffer.pResource == nullptr);
+}
+
+bool PersistentCBStorage::Init(Device* pDevice, UINT64 capacity)
+{
+    m_pDevice = pDevice;
+
+    capacity = Align(capacity, (UINT64)D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+    // Buffer is transited explicitly around copies, so its state doesn't decay and it doesn't depend on promotion
+    bool res = m_pDevice->CreateGPUResource(CD3DX12_RESOURCE_DESC::Buffer(capacity), D3D12_RESOURCE_STATE_COMMON, nullptr, m_buffer);
+    if (res)
+    {
+        m_state = D3D12_RESOURCE_STATE_COMMON;
+        m_data.resize((size_t)capacity, 0);
+        m_allocator.Init(capacity);
+    }
+
+    return res;
+}
+
+void PersistentCBStorage::Term()
+{
+    if (m_pDevice != nullptr && m_buffer.pResource != nullptr)
+    {
+        m_pDevice->ReleaseGPUResource(m_buffer);
+    }
+
+    m_data.clear();
+    m_allocator.Term();
+    m_copyRuns.clear();
+
+    m_pDevice = nullptr;
+}
+
+UINT PersistentCBStorage::Allocate(UINT size)
+{
+    return m_allocator.Allocate(size);
+}
+
+void PersistentCBStorage::Free(UINT handle)
+{
+    m_allocator.Free(handle);
+}
+
+void PersistentCBStorage::Update(UINT handle, const void* pData)
+{
+    m_allocator.MarkDirty(handle);
+
+    memcpy(m_data.data() + m_allocator.GetOffset(handle), pData, m_allocator.GetSize(handle));
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS PersistentCBStorage::GetAddress(UINT handle) const
+{
+    return m_buffer.pResource->GetGPUVirtualAddress() + m_allocator.GetOffset(handle);
+}
+
+bool PersistentCBStorage::Flush(ID3D12GraphicsCommandList* pCommandList)
+{
+    m_lastFlushStats = FlushStats();
+
+    m_allocator.BuildCopyRuns(MaxCopySize, m_copyRuns);
+    if (m_copyRuns.empty())
+    {
+        return true;
+    }
+
+    bool res = true;
+
+    if (m_state != D3D12_RESOURCE_STATE_COPY_DEST)
+    {
+        res = m_pDevice->TransitResourceState(pCommandList, m_buffer.pResource, m_state, D3D12_RESOURCE_STATE_COPY_DEST);
+        m_state = D3D12_RESOURCE_STATE_COPY_DEST;
+    }
+
+    size_t copiedRuns = 0;
+    while (res && copiedRuns < m_copyRuns.size())
+    {
+        const PersistentCBAllocator::CopyRun& run = m_copyRuns[copiedRuns];
+
+        void* pCPUData = nullptr;
+        ID3D12Resource* pUploadBuffer = nullptr;
+        UINT64 uploadOffset = 0;
+        if (!m_pDevice->AllocateDynamicBuffer((UINT)run.size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, &pCPUData, &pUploadBuffer, uploadOffset))
+        {
+            // The rest stays dirty until the next flush
+            break;
+        }
+
+        memcpy(pCPUData, m_data.data() + run.offset, (size_t)run.size);
+        pCommandList->CopyBufferRegion(m_buffer.pResource, run.offset, pUploadBuffer, uploadOffset, run.size);
+
+        m_lastFlushStats.bytes += run.size;
+        m_lastFlushStats.buffers += run.bufferCount;
+        ++m_lastFlushStats.copies;
+
+        ++copiedRuns;
+    }
+
+    m_allocator.CompleteCopyRuns(m_copyRuns, copiedRuns);
+    m_lastFlushStats.pending = (UINT)m_allocator.GetDirtyCount();
+
+    if (res)
+    {
+        res = m_pDevice->TransitResourceState(pCommandList, m_buffer.pResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+        m_state = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+    }
+
+    return res;
+}
+
+} // Platform
@@ -0,0 +1,348 @@
+#include "stdafx.h"
+#include "PlatformPipelineStateCache.h"
+
+#include "Platform.h"
+#include "PlatformIO.h"
+#include "PlatformPipelineStateKey.h"
+
+namespace
+{
+
+const UINT32 PipelineCacheMagic = 0x434C5047; // 'GPLC'
+const UINT32 PipelineCacheVersion = 1;
+
+struct PipelineCacheHeader
+{
+    UINT32 magic;
+    UINT32 version;
+    UINT64 librarySize;
+};
+
+}
+
+namespace Platform
+{
+
+PipelineStateCache::PipelineStateCache()
+    : m_pDevice(nullptr)
+    , m_pDevice1(nullptr)
+    , m_pLibrary(nullptr)
+    , m_modified(false)
+{
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+    assert(m_rootSignatures.empty());
+    assert(m_psos.empty());
+    assert(m_pLibrary == nullptr);
+    assert(m_pDevice1 == nullptr);
+}
+
+bool PipelineStateCache::Init(Device* pDevice)
+{
+    m_pDevice = pDevice;
+    m_modified = false;
+
+    // Pipeline library is optional, PSOs are just created every time without it
+    HRESULT hr = m_pDevice->GetDXDevice()->QueryInterface(__uuidof(ID3D12Device1), (void**)&m_pDevice1);
+    if (SUCCEEDED(hr))
+    {
+        CreateLibrary(nullptr, 0);
+    }
+    else
+    {
+        OutputDebugString(_T("Pipeline library is not supported\n"));
+    }
+
+    return true;
+}
+
+void PipelineStateCache::Term()
+{
+    for (auto& pso : m_psos)
+    {
+        pso.second->Release();
+    }
+    m_psos.clear();
+
+    for (auto& rootSignature : m_rootSignatures)
+    {
+        rootSignature.second->Release();
+    }
+    m_rootSignatures.clear();
+
+    D3D_RELEASE(m_pLibrary);
+    D3D_RELEASE(m_pDevice1);
+    m_libraryData.clear();
+
+    m_pDevice = nullptr;
+}
+
+bool PipelineStateCache::LoadCache(LPCTSTR filename, bool discard)
+{
+    if (m_pDevice1 == nullptr)
+    {
+        return true;
+    }
+
+    std::vector<char> data;
+    if (discard)
+    {
+        OutputDebugString(_T("Shader sources are updated, pipeline cache is discarded\n"));
+    }
+    else if (ReadFileContent(filename, data))
+    {
+        PipelineCacheHeader header = {};
+        if (data.size() >= sizeof(header))
+        {
+            memcpy(&header, data.data(), sizeof(header));
+        }
+        if (header.magic == PipelineCacheMagic && header.version == PipelineCacheVersion && header.librarySize == data.size() - sizeof(header))
+        {
+            data.erase(data.begin(), data.begin() + sizeof(header));
+        }
+        else
+        {
+            OutputDebugString(_T("Pipeline cache version is not supported\n"));
+            data.clear();
+        }
+    }
+    else
+    {
+        OutputDebugString(_T("Cannot open pipeline cache file: "));
+        OutputDebugString(filename);
+        OutputDebugString(_T("\n"));
+    }
+
+    if (!data.empty())
+    {
+        // Library may be refused by driver, then it is rebuilt
+        std::swap(m_libraryData, data);
+        if (!CreateLibrary(m_libraryData.data(), m_libraryData.size()))
+        {
+            OutputDebugString(_T("Pipeline cache is made by another driver or adapter\n"));
+
+            m_libraryData.clear();
+            CreateLibrary(nullptr, 0);
+            m_modified = true;
+        }
+    }
+    else
+    {
+        CreateLibrary(nullptr, 0);
+        m_modified = true;
+    }
+
+    return true;
+}
+
+bool PipelineStateCache::SaveCache(LPCTSTR filename)
+{
+    if (m_pLibrary == nullptr)
+    {
+        return false;
+    }
+
+    PipelineCacheHeader header = { PipelineCacheMagic, PipelineCacheVersion, (UINT64)m_pLibrary->GetSerializedSize() };
+
+    std::vector<char> data(sizeof(header) + (size_t)header.librarySize);
+    memcpy(data.data(), &header, sizeof(header));
+
+    HRESULT hr = S_OK;
+    D3D_CHECK(m_pLibrary->Serialize(data.data() + sizeof(header), (SIZE_T)header.librarySize));
+    if (FAILED(hr))
+    {
+        return false;
+    }
+
+    FILE* pFile = _tfopen(filename, _T("wb"));
+    assert(pFile != nullptr);
+    if (pFile != nullptr)
+    {
+        fwrite(data.data(), 1, data.size(), pFile);
+        fclose(pFile);
+
+        m_modified = false;
+
+        return true;
+    }
+
+    return false;
+}
+
+std::string PipelineStateCache::BuildRootSignatureKey(UINT commonCBCount, UINT commonTexCount, const BaseRenderer::GeometryStateParams& params)
+{
+    return Platform::BuildRootSignatureKey(commonCBCount, commonTexCount, params.geomStaticTexturesCount, params.geomDynamicTexturesCount);
+}
+
+std::string PipelineStateCache::BuildPSOKey(const std::string& rootSignatureKey, const BaseRenderer::GeometryStateParams& params)
+{
+    PSOKeyParams keyParams;
+    keyParams.primTopologyType = params.primTopologyType;
+    keyParams.pShaderSourceName = params.pShaderSourceName;
+    keyParams.shaderDefines = params.shaderDefines;
+
+    keyParams.geomAttributes.resize(params.geomAttributes.size());
+    for (size_t i = 0; i < params.geomAttributes.size(); i++)
+    {
+        keyParams.geomAttributes[i].semanticName = params.geomAttributes[i].SemanticName;
+        keyParams.geomAttributes[i].semanticIndex = params.geomAttributes[i].SemanticIndex;
+        keyParams.geomAttributes[i].format = params.geomAttributes[i].Format;
+        keyParams.geomAttributes[i].alignedByteOffset = params.geomAttributes[i].AlignedByteOffset;
+    }
+
+    const D3D12_BLEND_DESC& blend = params.blendState;
+    keyParams.blendState.alphaToCoverageEnable = blend.AlphaToCoverageEnable != FALSE;
+    keyParams.blendState.independentBlendEnable = blend.IndependentBlendEnable != FALSE;
+    for (int i = 0; i < 8; i++)
+    {
+        const D3D12_RENDER_TARGET_BLEND_DESC& src = blend.RenderTarget[i];
+        PSOKeyRenderTargetBlend& dst = keyParams.blendState.renderTarget[i];
+        dst.blendEnable = src.BlendEnable != FALSE;
+        dst.logicOpEnable = src.LogicOpEnable != FALSE;
+        dst.srcBlend = src.SrcBlend;
+        dst.destBlend = src.DestBlend;
+        dst.blendOp = src.BlendOp;
+        dst.srcBlendAlpha = src.SrcBlendAlpha;
+        dst.destBlendAlpha = src.DestBlendAlpha;
+        dst.blendOpAlpha = src.BlendOpAlpha;
+        dst.logicOp = src.LogicOp;
+        dst.renderTargetWriteMask = src.RenderTargetWriteMask;
+    }
+
+    const D3D12_RASTERIZER_DESC& raster = params.rasterizerState;
+    keyParams.rasterizerState.fillMode = raster.FillMode;
+    keyParams.rasterizerState.cullMode = raster.CullMode;
+    keyParams.rasterizerState.frontCounterClockwise = raster.FrontCounterClockwise != FALSE;
+    keyParams.rasterizerState.depthBias = raster.DepthBias;
+    keyParams.rasterizerState.depthBiasClamp = raster.DepthBiasClamp;
+    keyParams.rasterizerState.slopeScaledDepthBias = raster.SlopeScaledDepthBias;
+    keyParams.rasterizerState.depthClipEnable = raster.DepthClipEnable != FALSE;
+    keyParams.rasterizerState.multisampleEnable = raster.MultisampleEnable != FALSE;
+    keyParams.rasterizerState.antialiasedLineEnable = raster.AntialiasedLineEnable != FALSE;
+    keyParams.rasterizerState.forcedSampleCount = raster.ForcedSampleCount;
+    keyParams.rasterizerState.conservativeRaster = raster.ConservativeRaster;
+
+    const D3D12_DEPTH_STENCIL_DESC& depthStencil = params.depthStencilState;
+    keyParams.depthStencilState.depthEnable = depthStencil.DepthEnable != FALSE;
+    keyParams.depthStencilState.depthWriteMask = depthStencil.DepthWriteMask;
+    keyParams.depthStencilState.depthFunc = depthStencil.DepthFunc;
+    keyParams.depthStencilState.stencilEnable = depthStencil.StencilEnable != FALSE;
+    keyParams.depthStencilState.stencilReadMask = depthStencil.StencilReadMask;
+    keyParams.depthStencilState.stencilWriteMask = depthStencil.StencilWriteMask;
+    const D3D12_DEPTH_STENCILOP_DESC* stencilOps[2] = { &depthStencil.FrontFace, &depthStencil.BackFace };
+    PSOKeyStencilOp* keyStencilOps[2] = { &keyParams.depthStencilState.frontFace, &keyParams.depthStencilState.backFace };
+    for (int i = 0; i < 2; i++)
+    {
+        keyStencilOps[i]->stencilFailOp = stencilOps[i]->StencilFailOp;
+        keyStencilOps[i]->stencilDepthFailOp = stencilOps[i]->StencilDepthFailOp;
+        keyStencilOps[i]->stencilPassOp = stencilOps[i]->StencilPassOp;
+        keyStencilOps[i]->stencilFunc = stencilOps[i]->StencilFunc;
+    }
+
+    keyParams.rtFormats[0] = params.rtFormat;
+    keyParams.rtFormats[1] = params.rtFormat2;
+    keyParams.rtFormats[2] = params.rtFormat3;
+    keyParams.rtFormats[3] = params.rtFormat4;
+    keyParams.dsFormat = params.dsFormat;
+
+    return Platform::BuildPSOKey(rootSignatureKey, keyParams);
+}
+
+UINT64 PipelineStateCache::CalcHash(const std::string& key)
+{
+    return CalcPipelineKeyHash(key);
+}
+
+ID3D12RootSignature* PipelineStateCache::FindRootSignature(const std::string& key)
+{
+    auto it = m_rootSignatures.find(key);
+    if (it == m_rootSignatures.end())
+    {
+        ++m_stats.rootSignatureMisses;
+        return nullptr;
+    }
+
+    ++m_stats.rootSignatureHits;
+    it->second->AddRef();
+    return it->second;
+}
+
+ID3D12PipelineState* PipelineStateCache::FindPSO(const std::string& key)
+{
+    auto it = m_psos.find(key);
+    if (it == m_psos.end())
+    {
+        ++m_stats.psoMisses;
+        return nullptr;
+    }
+
+    ++m_stats.psoHits;
+    it->second->AddRef();
+    return it->second;
+}
+
+void PipelineStateCache::AddRootSignature(const std::string& key, ID3D12RootSignature* pRootSignature)
+{
+    assert(m_rootSignatures.find(key) == m_rootSignatures.end());
+
+    pRootSignature->AddRef();
+    m_rootSignatures[key] = pRootSignature;
+}
+
+void PipelineStateCache::AddPSO(const std::string& key, ID3D12PipelineState* pPSO)
+{
+    assert(m_psos.find(key) == m_psos.end());
+
+    pPSO->AddRef();
+    m_psos[key] = pPSO;
+}
+
+bool PipelineStateCache::CreatePSO(const std::string& key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc, ID3D12PipelineState** ppPSO)
+{
+    if (m_pLibrary == nullptr)
+    {
+        return m_pDevice->CreatePSO(psoDesc, ppPSO);
+    }
+
+    // Library entry is named after full description, shader bytecode included,
+    // so changed shaders never pick up stale pipeline
+    std::string fullKey = key;
+    fullKey.append(static_cast<const char*>(psoDesc.VS.pShaderBytecode), psoDesc.VS.BytecodeLength);
+    fullKey.append(static_cast<const char*>(psoDesc.PS.pShaderBytecode), psoDesc.PS.BytecodeLength);
+
+    wchar_t name[32];
+    swprintf_s(name, L"%016llx", CalcHash(fullKey));
+
+    HRESULT hr = m_pLibrary->LoadGraphicsPipeline(name, &psoDesc, __uuidof(ID3D12PipelineState), (void**)ppPSO);
+    if (SUCCEEDED(hr))
+    {
+        ++m_stats.libraryHits;
+        return true;
+    }
+
+    bool res = m_pDevice->CreatePSO(psoDesc, ppPSO);
+    if (res)
+    {
+        // Failure is not fatal, PSO is just created again next time
+        hr = m_pLibrary->StorePipeline(name, *ppPSO);
+        if (SUCCEEDED(hr))
+        {
+            m_modified = true;
+        }
+    }
+
+    return res;
+}
+
+bool PipelineStateCache::CreateLibrary(const void* pData, size_t size)
+{
+    D3D_RELEASE(m_pLibrary);
+
+    HRESULT hr = m_pDevice1->CreatePipelineLibrary(pData, size, __uuidof(ID3D12PipelineLibrary), (void**)&m_pLibrary);
+
+    return SUCCEEDED(hr);
+}
+
+} // Platform
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "PlatformBaseRenderer.h"
+
+namespace Platform
+{
+
+// Shares root signatures and PSOs between geometry states with identical descriptions.
+// Cache holds its own reference to every object, users add theirs.
+// Created PSOs are also stored in pipeline library, which persists between launches, if device supports it
+class PipelineStateCache
+{
+public:
+    PipelineStateCache();
+    ~PipelineStateCache();
+
+    bool Init(Device* pDevice);
+    void Term();
+
+    // Library is started from scratch, if discard is set or file is missing, outdated or made by another driver
+    bool LoadCache(LPCTSTR filename, bool discard);
+    bool SaveCache(LPCTSTR filename);
+
+    inline bool IsModified() const { return m_modified; }
+
+    // Canonical keys, equivalent descriptions give equal keys. Key layout is in PlatformPipelineStateKey.h
+    static std::string BuildRootSignatureKey(UINT commonCBCount, UINT commonTexCount, const BaseRenderer::GeometryStateParams& params);
+    static std::string BuildPSOKey(const std::string& rootSignatureKey, const BaseRenderer::GeometryStateParams& params);
+
+    // FNV-1a hash of key
+    static UINT64 CalcHash(const std::string& key);
+
+    // Returned object is referenced for caller, nullptr is returned on miss
+    ID3D12RootSignature* FindRootSignature(const std::string& key);
+    ID3D12PipelineState* FindPSO(const std::string& key);
+
+    void AddRootSignature(const std::string& key, ID3D12RootSignature* pRootSignature);
+    void AddPSO(const std::string& key, ID3D12PipelineState* pPSO);
+
+    // Loads PSO from library or creates it with device and stores into library
+    bool CreatePSO(const std::string& key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc, ID3D12PipelineState** ppPSO);
+
+    // Accumulates time spent on pipeline state creation
+    inline void AddCreateTime(UINT64 usec) { m_stats.createUSec += usec; }
+
+    inline const BaseRenderer::PipelineStateStats& GetStats() const { return m_stats; }
+
+private:
+    struct KeyHash
+    {
+        inline size_t operator()(const std::string& key) const { return (size_t)CalcHash(key); }
+    };
+
+private:
+    bool CreateLibrary(const void* pData, size_t size);
+
+private:
+    Device* m_pDevice;
+
+    ID3D12Device1* m_pDevice1;
+    ID3D12PipelineLibrary* m_pLibrary;
+    std::vector<char> m_libraryData; // Library references serialized data while it is alive
+    bool m_modified;
+
+    std::unordered_map<std::string, ID3D12RootSignature*, KeyHash> m_rootSignatures;
+    std::unordered_map<std::string, ID3D12PipelineState*, KeyHash> m_psos;
+
+    BaseRenderer::PipelineStateStats m_stats;
+};
+
+} // Platform
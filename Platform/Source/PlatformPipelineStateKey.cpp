@@ -0,0 +1,193 @@
+#include "stdafx.h"
+#include "PlatformPipelineStateKey.h"
+
+#include <algorithm>
+#include <wchar.h>
+
+namespace
+{
+
+// Appends fields to key one by one, so struct padding never gets into it
+class KeyWriter
+{
+public:
+    KeyWriter(std::string& key) : m_key(key) {}
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        m_key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void WriteString(const char* str)
+    {
+        size_t length = str != nullptr ? strlen(str) : 0;
+        Write((UINT32)length);
+        m_key.append(str, length);
+    }
+
+    void WriteString(const wchar_t* str)
+    {
+        size_t length = str != nullptr ? wcslen(str) : 0;
+        Write((UINT32)length);
+        m_key.append(reinterpret_cast<const char*>(str), length * sizeof(wchar_t));
+    }
+
+private:
+    std::string& m_key;
+};
+
+void WriteBlendState(KeyWriter& writer, const Platform::PSOKeyBlend& desc)
+{
+    writer.Write(desc.alphaToCoverageEnable);
+    writer.Write(desc.independentBlendEnable);
+
+    // Only the first render target state is used, unless independent blend is enabled
+    int count = desc.independentBlendEnable ? 8 : 1;
+    for (int i = 0; i < count; i++)
+    {
+        const Platform::PSOKeyRenderTargetBlend& rt = desc.renderTarget[i];
+
+        writer.Write(rt.blendEnable);
+        writer.Write(rt.logicOpEnable);
+        if (rt.blendEnable)
+        {
+            writer.Write(rt.srcBlend);
+            writer.Write(rt.destBlend);
+            writer.Write(rt.blendOp);
+            writer.Write(rt.srcBlendAlpha);
+            writer.Write(rt.destBlendAlpha);
+            writer.Write(rt.blendOpAlpha);
+        }
+        if (rt.logicOpEnable)
+        {
+            writer.Write(rt.logicOp);
+        }
+        writer.Write(rt.renderTargetWriteMask);
+    }
+}
+
+void WriteRasterizerState(KeyWriter& writer, const Platform::PSOKeyRasterizer& desc)
+{
+    writer.Write(desc.fillMode);
+    writer.Write(desc.cullMode);
+    writer.Write(desc.frontCounterClockwise);
+    writer.Write(desc.depthBias);
+    writer.Write(desc.depthBiasClamp);
+    writer.Write(desc.slopeScaledDepthBias);
+    writer.Write(desc.depthClipEnable);
+    writer.Write(desc.multisampleEnable);
+    writer.Write(desc.antialiasedLineEnable);
+    writer.Write(desc.forcedSampleCount);
+    writer.Write(desc.conservativeRaster);
+}
+
+void WriteStencilOp(KeyWriter& writer, const Platform::PSOKeyStencilOp& desc)
+{
+    writer.Write(desc.stencilFailOp);
+    writer.Write(desc.stencilDepthFailOp);
+    writer.Write(desc.stencilPassOp);
+    writer.Write(desc.stencilFunc);
+}
+
+void WriteDepthStencilState(KeyWriter& writer, const Platform::PSOKeyDepthStencil& desc)
+{
+    writer.Write(desc.depthEnable);
+    if (desc.depthEnable)
+    {
+        writer.Write(desc.depthWriteMask);
+        writer.Write(desc.depthFunc);
+    }
+    writer.Write(desc.stencilEnable);
+    if (desc.stencilEnable)
+    {
+        writer.Write(desc.stencilReadMask);
+        writer.Write(desc.stencilWriteMask);
+        WriteStencilOp(writer, desc.frontFace);
+        WriteStencilOp(writer, desc.backFace);
+    }
+}
+
+}
+
+namespace Platform
+{
+
+std::string BuildRootSignatureKey(UINT commonCBCount, UINT commonTexCount, UINT geomStaticTexturesCount, UINT geomDynamicTexturesCount)
+{
+    std::string key;
+    KeyWriter writer(key);
+
+    writer.Write(commonCBCount);
+    writer.Write(commonTexCount);
+    writer.Write(geomStaticTexturesCount);
+    writer.Write(geomDynamicTexturesCount);
+
+    return key;
+}
+
+std::string BuildPSOKey(const std::string& rootSignatureKey, const PSOKeyParams& params)
+{
+    std::string key;
+    KeyWriter writer(key);
+
+    writer.Write((UINT32)rootSignatureKey.size());
+    key.append(rootSignatureKey);
+
+    writer.Write(params.primTopologyType);
+
+    // Order of defines doesn't affect compiled shaders
+    writer.WriteString(params.pShaderSourceName);
+    std::vector<std::string> defines(params.shaderDefines.begin(), params.shaderDefines.end());
+    std::sort(defines.begin(), defines.end());
+    writer.Write((UINT32)defines.size());
+    for (const auto& define : defines)
+    {
+        writer.WriteString(define.c_str());
+    }
+
+    writer.Write((UINT32)params.geomAttributes.size());
+    for (const auto& attribute : params.geomAttributes)
+    {
+        writer.WriteString(attribute.semanticName);
+        writer.Write(attribute.semanticIndex);
+        writer.Write(attribute.format);
+        writer.Write(attribute.alignedByteOffset);
+    }
+
+    WriteBlendState(writer, params.blendState);
+    WriteRasterizerState(writer, params.rasterizerState);
+    WriteDepthStencilState(writer, params.depthStencilState);
+
+    // Trailing unknown render targets are not used
+    UINT rtCount = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (params.rtFormats[i] != 0)
+        {
+            rtCount = i + 1;
+        }
+    }
+    writer.Write(rtCount);
+    for (UINT i = 0; i < rtCount; i++)
+    {
+        writer.Write(params.rtFormats[i]);
+    }
+    writer.Write(params.dsFormat);
+
+    return key;
+}
+
+UINT64 CalcPipelineKeyHash(const std::string& key)
+{
+    UINT64 hash = 0xcbf29ce484222325ull;
+    for (char c : key)
+    {
+        hash ^= (UINT8)c;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+} // Platform
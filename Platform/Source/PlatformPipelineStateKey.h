@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Platform
+{
+
+// Device-free copies of pipeline description fields, which PSO key is made of.
+// Enumerations are kept as their values, so keys are the same as if they were written from D3D12 descriptions
+struct PSOKeyRenderTargetBlend
+{
+    bool blendEnable = false;
+    bool logicOpEnable = false;
+    UINT srcBlend = 0;
+    UINT destBlend = 0;
+    UINT blendOp = 0;
+    UINT srcBlendAlpha = 0;
+    UINT destBlendAlpha = 0;
+    UINT blendOpAlpha = 0;
+    UINT logicOp = 0;
+    UINT8 renderTargetWriteMask = 0;
+};
+
+struct PSOKeyBlend
+{
+    bool alphaToCoverageEnable = false;
+    bool independentBlendEnable = false;
+    PSOKeyRenderTargetBlend renderTarget[8];
+};
+
+struct PSOKeyRasterizer
+{
+    UINT fillMode = 0;
+    UINT cullMode = 0;
+    bool frontCounterClockwise = false;
+    INT depthBias = 0;
+    float depthBiasClamp = 0.0f;
+    float slopeScaledDepthBias = 0.0f;
+    bool depthClipEnable = false;
+    bool multisampleEnable = false;
+    bool antialiasedLineEnable = false;
+    UINT forcedSampleCount = 0;
+    UINT conservativeRaster = 0;
+};
+
+struct PSOKeyStencilOp
+{
+    UINT stencilFailOp = 0;
+    UINT stencilDepthFailOp = 0;
+    UINT stencilPassOp = 0;
+    UINT stencilFunc = 0;
+};
+
+struct PSOKeyDepthStencil
+{
+    bool depthEnable = false;
+    UINT depthWriteMask = 0;
+    UINT depthFunc = 0;
+    bool stencilEnable = false;
+    UINT8 stencilReadMask = 0;
+    UINT8 stencilWriteMask = 0;
+    PSOKeyStencilOp frontFace;
+    PSOKeyStencilOp backFace;
+};
+
+struct PSOKeyAttribute
+{
+    LPCSTR semanticName = nullptr;
+    UINT semanticIndex = 0;
+    UINT format = 0;
+    UINT alignedByteOffset = 0;
+};
+
+struct PSOKeyParams
+{
+    UINT primTopologyType = 0;
+
+    LPCTSTR pShaderSourceName = nullptr;
+    std::vector<LPCSTR> shaderDefines;
+
+    std::vector<PSOKeyAttribute> geomAttributes;
+
+    PSOKeyBlend blendState;
+    PSOKeyRasterizer rasterizerState;
+    PSOKeyDepthStencil depthStencilState;
+
+    UINT rtFormats[4] = {};     // Unknown format is zero
+    UINT dsFormat = 0;
+};
+
+// Canonical keys, equivalent descriptions give equal keys
+std::string BuildRootSignatureKey(UINT commonCBCount, UINT commonTexCount, UINT geomStaticTexturesCount, UINT geomDynamicTexturesCount);
+std::string BuildPSOKey(const std::string& rootSignatureKey, const PSOKeyParams& params);
+
+// FNV-1a hash of key
+UINT64 CalcPipelineKeyHash(const std::string& key);
+
+} // Platform
@@ -92,6 +92,7 @@ bool ShaderCache::ShaderBinaryKey::operator<(const ShaderBinaryKey& rhs) const
 ShaderCache::ShaderCache()
     : m_pDevice(nullptr)
     , m_modified(false)
+    , m_updatedSources(false)
 {}
 
 ShaderCache::~ShaderCache()
@@ -104,6 +105,7 @@ bool ShaderCache::Init(Device* pDevice)
 {
     m_pDevice = pDevice;
     m_modified = false;
+    m_updatedSources = false;
 
     return true;
 }
@@ -268,6 +270,8 @@ bool ShaderCache::LoadCache(LPCTSTR filename)
                 }
                 else
                 {
+                    m_updatedSources = true;
+
                     OutputDebugString(_T("Source file: "));
                     OutputDebugString(srcFilename.c_str());
                     OutputDebugString(_T(" is updated\n"));
@@ -7,93 +7,66 @@
 #include "PlatformIO.h"
 #include "PlatformUtil.h"
 
-namespace
+namespace Platform
 {
 
-size_t CalculateSizeWithMips(UINT32 width, UINT32 height, size_t stride, UINT32 componentSize, UINT& mipCount)
+bool GetMipPixelFormat(DXGI_FORMAT format, MipPixelFormat& mipFormat)
 {
-    DWORD mips = 0;
-    _BitScanForward(&mips, std::min(NearestPowerOf2(height), NearestPowerOf2(width)));
-
-    mipCount = (UINT)mips + 1;
-    if (mipCount > 2)
-    {
-        mipCount -= 2; // Skip last two mips, as texture cannot be less than 4x4 pixels
-    }
-
-    size_t res = 0;
-    for (UINT i = 0; i < mipCount; i++)
+    switch (format)
     {
-        res += componentSize * height * stride;
-        height /= 2;
-        stride /= 2;
-    }
-
-    return res;
-}
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            mipFormat = MipPixelFormatRGBA8;
+            return true;
 
-size_t CalculateSizeWithMips(const png_image& image, UINT& mipCount)
-{
-    return CalculateSizeWithMips(image.width, image.height, PNG_IMAGE_ROW_STRIDE(image), PNG_IMAGE_PIXEL_COMPONENT_SIZE(image.format), mipCount);
-}
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            mipFormat = MipPixelFormatRGBA8SRGB;
+            return true;
 
-void GenerateMips(void* pInitialData, UINT32 width, UINT32 height, size_t stride, UINT32 componentSize, UINT mipsToGenerate)
-{
-    UINT8* pData = static_cast<UINT8*>(pInitialData);
-
-    for (UINT i = 0; i < mipsToGenerate; i++)
-    {
-        const UINT8* pSrcData = pData;
-        pData += componentSize * height * stride;
-        height /= 2;
-        width /= 2;
-        stride /= 2;
-
-        for (int y = 0; y < (int)height; y++)
-        {
-            for (int x = 0; x < (int)width; x++)
-            {
-                for (int i = 0; i < 4; i++)
-                {
-                    int accum = 0;
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            mipFormat = MipPixelFormatRGBA16F;
+            return true;
 
-                    accum += *(pSrcData + ((stride * 2) * (y * 2 + 0) + (x * 2 + 0) * 4) * componentSize + i);
-                    accum += *(pSrcData + ((stride * 2) * (y * 2 + 1) + (x * 2 + 0) * 4) * componentSize + i);
-                    accum += *(pSrcData + ((stride * 2) * (y * 2 + 0) + (x * 2 + 1) * 4) * componentSize + i);
-                    accum += *(pSrcData + ((stride * 2) * (y * 2 + 1) + (x * 2 + 1) * 4) * componentSize + i);
-                    accum /= 4;
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            mipFormat = MipPixelFormatRGBA32F;
+            return true;
 
-                    pData[(stride * y + x * 4) * componentSize + i] = (UINT8)accum;
-                }
-            }
-        }
+        default:
+            break;
     }
+
+    return false;
 }
 
-void GenerateMips(void* pInitialData, const png_image& image, UINT mipsToGenerate)
+size_t CalcTextureSizeWithMips(UINT width, UINT height, DXGI_FORMAT format, UINT& mipCount)
 {
-    assert(image.format == PNG_FORMAT_RGBA);
+    MipPixelFormat mipFormat = MipPixelFormatRGBA8;
+    bool res = GetMipPixelFormat(format, mipFormat);
+    assert(res);
 
-    return GenerateMips(pInitialData, image.width, image.height, PNG_IMAGE_ROW_STRIDE(image), PNG_IMAGE_PIXEL_COMPONENT_SIZE(image.format), mipsToGenerate);
+    return CalcTextureSizeWithMips(width, height, mipFormat, mipCount);
 }
 
-}
-
-namespace Platform
+void GenerateTextureMips(void* pData, UINT width, UINT height, DXGI_FORMAT format, UINT mipCount)
 {
+    MipPixelFormat mipFormat = MipPixelFormatRGBA8;
+    bool res = GetMipPixelFormat(format, mipFormat);
+    assert(res);
+    if (res)
+    {
+        GenerateTextureMips(pData, width, height, mipFormat, mipCount);
+    }
+}
 
 bool CreateTexture(const CreateTextureParams& params, bool generateMips, Device* pDevice, Platform::GPUResource& textureResource, const void* pInitialData, size_t initialDataSize)
 {
     if (generateMips)
     {
-        assert(params.format == DXGI_FORMAT_R8G8B8A8_UNORM || params.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
-
         UINT mips = 0;
-        size_t dataSize = CalculateSizeWithMips(params.width, params.height, params.width * 4, 1, mips);
+        size_t dataSize = CalcTextureSizeWithMips(params.width, params.height, params.format, mips);
         UINT8* pBuffer = new UINT8[dataSize];
         memcpy(pBuffer, pInitialData, initialDataSize);
 
-        GenerateMips(pBuffer, params.width, params.height, params.width * 4, 1, mips - 1);
+        GenerateTextureMips(pBuffer, params.width, params.height, params.format, mips);
 
         HRESULT hr = pDevice->CreateGPUResource(CD3DX12_RESOURCE_DESC::Tex2D(params.format, params.width, params.height, 1, mips), D3D12_RESOURCE_STATE_COMMON, nullptr, textureResource, pBuffer, dataSize);
 
@@ -139,25 +112,27 @@ bool CreateTextureFromFile(LPCTSTR filename, Device* pDevice, Platform::GPUResou
 
         if (pngRes != 0)
         {
-            UINT pitch = PNG_IMAGE_ROW_STRIDE(image);
+            assert(image.format == PNG_FORMAT_RGBA);
+
+            DXGI_FORMAT format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
 
             UINT mips = 0;
-            size_t dataSize = CalculateSizeWithMips(image, mips);
+            size_t dataSize = CalcTextureSizeWithMips(image.width, image.height, format, mips);
 
             UINT8* pBuffer = new UINT8[dataSize];
 
             pngRes = png_image_finish_read(&image, NULL, pBuffer, 0, NULL);
 
-            GenerateMips(pBuffer, image, mips - 1);
+            GenerateTextureMips(pBuffer, image.width, image.height, format, mips);
 
             bool res = false;
             if (image.height == 1)
             {
-                res = pDevice->CreateGPUResource(CD3DX12_RESOURCE_DESC::Tex1D(srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM, image.width, 1, mips), D3D12_RESOURCE_STATE_COMMON, nullptr, textureResource, pBuffer, dataSize);
+                res = pDevice->CreateGPUResource(CD3DX12_RESOURCE_DESC::Tex1D(format, image.width, 1, mips), D3D12_RESOURCE_STATE_COMMON, nullptr, textureResource, pBuffer, dataSize);
             }
             else
             {
-                res = pDevice->CreateGPUResource(CD3DX12_RESOURCE_DESC::Tex2D(srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM, image.width, image.height, 1, mips), D3D12_RESOURCE_STATE_COMMON, nullptr, textureResource, pBuffer, dataSize);
+                res = pDevice->CreateGPUResource(CD3DX12_RESOURCE_DESC::Tex2D(format, image.width, image.height, 1, mips), D3D12_RESOURCE_STATE_COMMON, nullptr, textureResource, pBuffer, dataSize);
             }
 
             delete[] pBuffer;
@@ -172,9 +147,30 @@ bool CreateTextureFromFile(LPCTSTR filename, Device* pDevice, Platform::GPUResou
 
 bool CreateTextureArrayFromFile(LPCTSTR filename, const Point2i& grid, Device* pDevice, ID3D12GraphicsCommandList* pUploadCommandList, Platform::GPUResource& textureResource, bool srgb)
 {
-    std::vector<char> data;
-    if (Platform::ReadFileContent(filename, data))
+    return CreateTextureArrayFromFiles({ filename }, grid, pDevice, pUploadCommandList, textureResource, srgb);
+}
+
+bool CreateTextureArrayFromFiles(const std::vector<std::tstring>& filenames, const Point2i& grid, Device* pDevice, ID3D12GraphicsCommandList* pUploadCommandList, Platform::GPUResource& textureResource, bool srgb)
+{
+    const UINT tileCount = grid.x * grid.y;
+    const DXGI_FORMAT format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+
+    UINT tileWidth = 0;
+    UINT tileHeight = 0;
+    UINT mips = 0;
+    size_t tileDataSize = 0;
+    UINT8* pTileBuffer = nullptr;
+
+    bool res = !filenames.empty();
+    for (size_t f = 0; f < filenames.size() && res; f++)
     {
+        std::vector<char> data;
+        res = Platform::ReadFileContent(filenames[f].c_str(), data);
+        if (!res)
+        {
+            break;
+        }
+
         png_image image;
         memset(&image, 0, sizeof(png_image));
         image.version = PNG_IMAGE_VERSION;
@@ -182,61 +178,80 @@ bool CreateTextureArrayFromFile(LPCTSTR filename, const Point2i& grid, Device* p
         int pngRes = png_image_begin_read_from_memory(&image, &data[0], data.size());
         assert(pngRes != 0);
 
+        res = pngRes != 0;
+        if (!res)
+        {
+            break;
+        }
+
+        UINT initialDataSize = image.height * PNG_IMAGE_ROW_STRIDE(image) * PNG_IMAGE_PIXEL_SIZE(image.format);
+        UINT8* pBuffer = new UINT8[initialDataSize];
+        pngRes = png_image_finish_read(&image, NULL, pBuffer, 0, NULL);
+        UINT imagePitch = PNG_IMAGE_ROW_STRIDE(image);
+        UINT imagePixelSize = PNG_IMAGE_PIXEL_SIZE(image.format);
+
         if (pngRes != 0)
         {
-            UINT initialDataSize = image.height * PNG_IMAGE_ROW_STRIDE(image) * PNG_IMAGE_PIXEL_SIZE(image.format);
-            UINT8* pBuffer = new UINT8[initialDataSize];
-            pngRes = png_image_finish_read(&image, NULL, pBuffer, 0, NULL);
-            UINT imagePitch = PNG_IMAGE_ROW_STRIDE(image);
-            UINT imagePixelSize = PNG_IMAGE_PIXEL_SIZE(image.format);
+            assert(image.format == PNG_FORMAT_RGBA);
 
-            bool res = true;
-            if (pngRes != 0)
-            {
-                png_image imageTile = image;
-                imageTile.width /= grid.x;
-                imageTile.height /= grid.y;
-                UINT tilePitch = PNG_IMAGE_ROW_STRIDE(imageTile);
+            png_image imageTile = image;
+            imageTile.width /= grid.x;
+            imageTile.height /= grid.y;
+            UINT tilePitch = PNG_IMAGE_ROW_STRIDE(imageTile);
 
-                UINT mips = 0;
-                size_t tileDataSize = CalculateSizeWithMips(imageTile, mips);
+            // Sequences of all files go one after another, so they must have the same tile size
+            if (f == 0)
+            {
+                tileWidth = imageTile.width;
+                tileHeight = imageTile.height;
+                tileDataSize = CalcTextureSizeWithMips(tileWidth, tileHeight, format, mips);
 
                 res = pDevice->CreateGPUResource(
-                    CD3DX12_RESOURCE_DESC::Tex2D(srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM, imageTile.width, imageTile.height, grid.x * grid.y, mips), D3D12_RESOURCE_STATE_COMMON, nullptr, textureResource
+                    CD3DX12_RESOURCE_DESC::Tex2D(format, tileWidth, tileHeight, (UINT16)(tileCount * filenames.size()), mips), D3D12_RESOURCE_STATE_COMMON, nullptr, textureResource
                 );
                 if (res)
                 {
-                    UINT8* pTileBuffer = new UINT8[tileDataSize];
-                    for (int j = 0; j < grid.y && res; j++)
-                    {
-                        for (int i = 0; i < grid.x && res; i++)
-                        {
-                            const UINT8* pTileSrc = &pBuffer[j*imageTile.height*imagePitch + i * imageTile.width * imagePixelSize];
-                            UINT8* pTileDst = pTileBuffer;
-                            for (UINT k = 0; k < imageTile.height; k++)
-                            {
-                                memcpy(pTileDst, pTileSrc, tilePitch);
-                                pTileDst += tilePitch;
-                                pTileSrc += imagePitch;
-                            }
-                            GenerateMips(pTileBuffer, imageTile, mips - 1);
-
-                            res = SUCCEEDED(pDevice->UpdateTexture(pUploadCommandList, textureResource.pResource, pTileBuffer, tileDataSize, (j * grid.x + i) * mips));
-                        }
-                    }
-                    delete[] pTileBuffer;
-                    pTileBuffer = nullptr;
+                    pTileBuffer = new UINT8[tileDataSize];
                 }
             }
+            else
+            {
+                assert(imageTile.width == tileWidth && imageTile.height == tileHeight);
+                res = imageTile.width == tileWidth && imageTile.height == tileHeight;
+            }
 
-            delete[] pBuffer;
-            pBuffer = nullptr;
+            for (int j = 0; j < grid.y && res; j++)
+            {
+                for (int i = 0; i < grid.x && res; i++)
+                {
+                    const UINT8* pTileSrc = &pBuffer[j*imageTile.height*imagePitch + i * imageTile.width * imagePixelSize];
+                    UINT8* pTileDst = pTileBuffer;
+                    for (UINT k = 0; k < imageTile.height; k++)
+                    {
+                        memcpy(pTileDst, pTileSrc, tilePitch);
+                        pTileDst += tilePitch;
+                        pTileSrc += imagePitch;
+                    }
+                    GenerateTextureMips(pTileBuffer, imageTile.width, imageTile.height, format, mips);
 
-            return res;
+                    const UINT slice = (UINT)f * tileCount + j * grid.x + i;
+                    res = SUCCEEDED(pDevice->UpdateTexture(pUploadCommandList, textureResource.pResource, pTileBuffer, tileDataSize, slice * mips));
+                }
+            }
+        }
+        else
+        {
+            res = false;
         }
+
+        delete[] pBuffer;
+        pBuffer = nullptr;
     }
 
-    return false;
+    delete[] pTileBuffer;
+    pTileBuffer = nullptr;
+
+    return res;
 }
 
 void CalcHistogram(LPCTSTR filename)
@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "PlatformThreadPool.h"
+
+#include "PlatformUtil.h"
+
+#include <algorithm>
+
+namespace Platform
+{
+
+ThreadPool::ThreadPool()
+    : m_terminate(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    assert(m_workers.empty());
+}
+
+bool ThreadPool::Init(size_t workerCount)
+{
+    if (workerCount == 0)
+    {
+        size_t hwThreads = std::thread::hardware_concurrency();
+        workerCount = hwThreads > 1 ? hwThreads - 1 : 0;
+    }
+
+    m_terminate = false;
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        m_workers.push_back(std::thread(&ThreadPool::WorkerProc, this));
+    }
+
+    return true;
+}
+
+void ThreadPool::Term()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_terminate = true;
+    }
+    m_startCV.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+
+    assert(m_tasks.empty());
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const RangeFunc& func)
+{
+    grainSize = std::max(grainSize, (size_t)1);
+
+    // Not worth waking anybody up
+    if (m_workers.empty() || count <= grainSize)
+    {
+        if (count > 0)
+        {
+            func(0, count);
+        }
+        return;
+    }
+
+    std::shared_ptr<Job> pJob = std::make_shared<Job>();
+    pJob->pFunc = &func;
+    pJob->count = count;
+    pJob->grainSize = grainSize;
+    pJob->rangeCount = DivUp(count, grainSize);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pJob = pJob;
+    }
+    m_startCV.notify_all();
+
+    ProcessRanges(*pJob);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCV.wait(lock, [&pJob]() { return pJob->doneRanges == pJob->rangeCount; });
+
+    m_pJob.reset();
+}
+
+void ThreadPool::AddTask(const Task& task)
+{
+    if (m_workers.empty())
+    {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(task);
+    }
+    m_startCV.notify_one();
+}
+
+void ThreadPool::WorkerProc()
+{
+    while (true)
+    {
+        std::shared_ptr<Job> pJob;
+        Task task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCV.wait(lock, [this]()
+            {
+                return m_terminate || !m_tasks.empty() || (m_pJob != nullptr && m_pJob->nextRange < m_pJob->rangeCount);
+            });
+
+            // Parallel loop is waited for by somebody, so it goes first
+            if (m_pJob != nullptr && m_pJob->nextRange < m_pJob->rangeCount)
+            {
+                pJob = m_pJob;
+            }
+            else if (!m_tasks.empty())
+            {
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            else if (m_terminate)
+            {
+                return;
+            }
+        }
+
+        if (pJob != nullptr)
+        {
+            ProcessRanges(*pJob);
+        }
+        else if (task)
+        {
+            task();
+        }
+    }
+}
+
+void ThreadPool::ProcessRanges(Job& job)
+{
+    size_t rangeIdx = job.nextRange++;
+    while (rangeIdx < job.rangeCount)
+    {
+        size_t begin = rangeIdx * job.grainSize;
+        size_t end = std::min(begin + job.grainSize, job.count);
+
+        (*job.pFunc)(begin, end);
+
+        if (++job.doneRanges == job.rangeCount)
+        {
+            // Lock is needed for waiting thread not to miss notification
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_doneCV.notify_one();
+        }
+
+        rangeIdx = job.nextRange++;
+    }
+}
+
+} // Platform
@@ -66,6 +66,18 @@ std::tstring GetParentName(const std::tstring& filename)
     }
 }
 
+// Folder path with trailing separator, empty for filename without path
+std::tstring GetFolderPath(const std::tstring& filename)
+{
+    size_t slashPos = filename.find_last_of(_T("/\\"));
+    if (slashPos == std::string::npos)
+    {
+        return _T("");
+    }
+
+    return filename.substr(0, slashPos + 1);
+}
+
 // Convert default std::tstring to std::string
 std::string ToString(const std::tstring& src)
 {
@@ -78,6 +90,22 @@ std::string ToString(const std::tstring& src)
 
     return buffer.data();
 #else
-    return sec;
+    return src;
+#endif
+}
+
+// Convert std::string to default std::tstring
+std::tstring ToTString(const std::string& src)
+{
+#ifdef _UNICODE
+    std::vector<wchar_t> buffer(src.length() + 1);
+
+    size_t converted = 0;
+    errno_t res = mbstowcs_s(&converted, buffer.data(), src.length() + 1, src.c_str(), src.length());
+    assert(res == 0);
+
+    return buffer.data();
+#else
+    return src;
 #endif
 }
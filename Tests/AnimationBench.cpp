@@ -0,0 +1,223 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformAnimation.h"
+#include "PlatformThreadPool.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+namespace
+{
+
+const size_t AnimationGrainSize = 8; // Same as a8.Particles renderer
+
+// Skinned character alike model, every node has animated rotation and translation
+struct Model
+{
+    std::vector<int> flatParents;
+    std::vector<Matrix4f> invBind;
+    NodePose bindPose;
+    std::vector<AnimationSampler> samplers;
+    std::vector<AnimationChannel> channels;
+    float maxAnimationTime = 0.0f;
+};
+
+struct Instance
+{
+    NodePose pose;
+    float animationTime = 0.0f;
+    std::vector<int> cursors;
+    std::vector<Matrix4f> scratch;
+    std::vector<Matrix4f> transforms;   // Node transforms, then normal transforms
+};
+
+Model BuildModel(int nodeCount, int keyCount, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    Model model;
+    model.flatParents.resize(nodeCount);
+    model.invBind.resize(nodeCount);
+    model.bindPose.Resize(nodeCount);
+    for (int i = 0; i < nodeCount; i++)
+    {
+        // Five chains from root, as limbs and spine
+        model.flatParents[i] = i == 0 ? -1 : (i <= 5 ? 0 : i - 5);
+        model.invBind[i].Offset(Point3f(dist(random), dist(random), dist(random)));
+        model.bindPose.useMatrix[i] = false;
+        model.bindPose.rotation[i] = Point4f(0, 0, 0, 1);
+        model.bindPose.scale[i] = Point3f(1, 1, 1);
+    }
+
+    const float keyTime = 1.0f / 30.0f;
+    model.maxAnimationTime = (keyCount - 1) * keyTime;
+
+    for (int i = 0; i < nodeCount; i++)
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            AnimationSampler sampler;
+            sampler.timeKeys.resize(keyCount);
+            sampler.keys.resize(keyCount);
+
+            // Smooth motion with some noise
+            float phase = dist(random) * 3.0f;
+            for (int k = 0; k < keyCount; k++)
+            {
+                float t = k * keyTime;
+                sampler.timeKeys[k] = t;
+                float angle = sinf(t * 2.0f + phase) + dist(random) * 0.01f;
+                if (c == 0)
+                {
+                    sampler.keys[k] = Point4f(sinf(angle * 0.5f), 0.0f, 0.0f, cosf(angle * 0.5f));
+                }
+                else
+                {
+                    sampler.keys[k] = Point4f(angle, cosf(t + phase), 0.0f, 0.0f);
+                }
+            }
+            // Loader tolerances
+            sampler.Compress(c == 0, c == 0 ? 0.001f : 0.0005f);
+
+            AnimationChannel channel;
+            channel.animSamplerIdx = (int)model.samplers.size();
+            channel.nodeIdx = i;
+            channel.flatNodeIdx = i;
+            channel.type = c == 0 ? AnimationChannel::Rotation : AnimationChannel::Translation;
+
+            model.samplers.push_back(sampler);
+            model.channels.push_back(channel);
+        }
+    }
+
+    return model;
+}
+
+// Same as GLTFModelInstance::ApplyAnimation and UpdateMatrices
+void UpdateInstance(const Model& model, Instance& inst, float deltaSec)
+{
+    inst.animationTime += deltaSec;
+
+    float localTime = inst.animationTime;
+    while (localTime > model.maxAnimationTime)
+    {
+        localTime -= int(localTime / model.maxAnimationTime) * model.maxAnimationTime;
+    }
+
+    inst.cursors.resize(model.samplers.size(), 0);
+    SampleAnimation(model.samplers, model.channels, localTime, inst.cursors, inst.pose);
+
+    const size_t count = model.flatParents.size();
+    inst.scratch.resize(count * 2);
+    Matrix4f root;
+    root.m[0] = -1.0f;
+    CalcHierarchyMatrices(inst.pose, model.flatParents, root, root, inst.scratch.data(), inst.scratch.data() + count);
+
+    inst.transforms.resize(count * 2);
+    for (size_t i = 0; i < count; i++)
+    {
+        inst.transforms[i] = model.invBind[i] * inst.scratch[i];
+        inst.transforms[count + i] = (model.invBind[i] * inst.scratch[count + i]).NormalMatrix();
+    }
+}
+
+std::vector<Instance> CreateInstances(const Model& model, size_t count)
+{
+    std::vector<Instance> instances(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        instances[i].pose = model.bindPose;
+        instances[i].animationTime = (float)i * 0.37f;
+    }
+    return instances;
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int frameCount = quick ? 2 : 30;
+    const float deltaSec = 1.0f / 60.0f;
+
+    std::mt19937 random(1234);
+    Model model = BuildModel(50, 300, random);
+
+    std::vector<size_t> threadCounts;
+    const size_t hwThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t threads = 1; threads < hwThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hwThreads);
+    if (quick && hwThreads == 1)
+    {
+        // Still runs pool code path
+        threadCounts.push_back(2);
+    }
+
+    std::vector<size_t> instanceCounts = { 1000, 2500, 5000, 10000 };
+    if (quick)
+    {
+        instanceCounts = { 100 };
+    }
+
+    printf("%zu nodes, %zu channels, %d frames, %zu hardware threads\n", model.flatParents.size(), model.channels.size(), frameCount, hwThreads);
+    printf("%-10s %8s %12s %12s %9s\n", "instances", "threads", "ms/frame", "us/instance", "scaling");
+
+    for (size_t instanceCount : instanceCounts)
+    {
+        double singleMs = 0.0;
+        std::vector<Instance> reference;
+
+        for (size_t threads : threadCounts)
+        {
+            // Pool without workers runs everything on calling thread
+            ThreadPool pool;
+            if (threads > 1)
+            {
+                pool.Init(threads - 1);
+            }
+
+            std::vector<Instance> instances = CreateInstances(model, instanceCount);
+
+            Test::Timer timer;
+            for (int frame = 0; frame < frameCount; frame++)
+            {
+                pool.ParallelFor(instances.size(), AnimationGrainSize, [&](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        UpdateInstance(model, instances[i], deltaSec);
+                    }
+                });
+            }
+            double frameMs = timer.ElapsedMs() / frameCount;
+
+            pool.Term();
+
+            // Instances don't share mutable state, so result doesn't depend on thread count
+            if (reference.empty())
+            {
+                singleMs = frameMs;
+                reference = std::move(instances);
+            }
+            else
+            {
+                bool equal = true;
+                for (size_t i = 0; i < instanceCount && equal; i++)
+                {
+                    equal = memcmp(reference[i].transforms.data(), instances[i].transforms.data(), reference[i].transforms.size() * sizeof(Matrix4f)) == 0;
+                }
+                TEST_CHECK(equal);
+            }
+
+            printf("%-10zu %8zu %12.3f %12.3f %8.2fx\n", instanceCount, threads, frameMs, frameMs * 1000.0 / instanceCount, singleMs / frameMs);
+        }
+    }
+
+    return Test::Result("animation_bench");
+}
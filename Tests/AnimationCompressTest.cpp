@@ -0,0 +1,252 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformAnimation.h"
+#include "PlatformModelCache.h"
+
+#include "GLTFAnimation.h"
+#include "TestUtil.h"
+
+using namespace Platform;
+
+namespace
+{
+
+// Smallest three components are stored in 15 bits over [-1/sqrt(2), 1/sqrt(2)], half step per component at most
+const float RotationQuantizationError = 3.0f * (float)M_SQRT2 / 0x7fff;   // Radians, with rounding of the restored component
+
+std::mt19937 s_random(1234);
+
+float RandomFloat(float low, float high)
+{
+    return std::uniform_real_distribution<float>(low, high)(s_random);
+}
+
+Point4f RandomQuaternion()
+{
+    Point4f q(RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f));
+    q.normalize();
+    return q;
+}
+
+// Angle between two rotations, q and -q are the same rotation.
+// It is found from chord length in double, acos of dot product loses small angles
+float CalcRotationError(const Point4f& a, const Point4f& b)
+{
+    const double sign = a.dot(b) < 0.0f ? -1.0 : 1.0;
+    const double la = sqrt((double)a.dot(a));
+    const double lb = sqrt((double)b.dot(b)) * sign;
+    const double dx = a.x / la - b.x / lb;
+    const double dy = a.y / la - b.y / lb;
+    const double dz = a.z / la - b.z / lb;
+    const double dw = a.w / la - b.w / lb;
+    return (float)(4.0 * asin(std::min(1.0, sqrt(dx * dx + dy * dy + dz * dz + dw * dw) * 0.5)));
+}
+
+float CalcRangeError(const Point4f& a, const Point4f& b)
+{
+    return std::max(std::max(fabsf(a.x - b.x), fabsf(a.y - b.y)), fabsf(a.z - b.z));
+}
+
+// Same interpolation as SampleAnimation
+Point4f SampleTrack(const AnimationSampler& sampler, float time)
+{
+    if (sampler.GetKeyCount() == 1)
+    {
+        return sampler.GetKey(0);
+    }
+
+    int cursor = 0;
+    const int idx0 = FindKey(sampler.timeKeys, time, cursor);
+    if (idx0 == (int)sampler.GetKeyCount() - 1)
+    {
+        return sampler.GetKey(idx0);
+    }
+
+    const float ratio = (time - sampler.timeKeys[idx0]) / (sampler.timeKeys[idx0 + 1] - sampler.timeKeys[idx0]);
+    const Point4f key0 = sampler.GetKey(idx0);
+    const Point4f key1 = sampler.GetKey(idx0 + 1);
+
+    return sampler.rotation ? Point4f::Slerp(key0, key1, ratio) : key0 * (1.0f - ratio) + key1 * ratio;
+}
+
+// Kept keys are packed and restored within quantization error, both signs of quaternion give the same rotation
+void TestSmallestThree()
+{
+    for (int i = 0; i < 10000; i++)
+    {
+        AnimationSampler sampler;
+        sampler.timeKeys = std::vector<float>{ 0.0f, 1.0f };
+        sampler.keys = { RandomQuaternion(), RandomQuaternion() };
+        if (i % 2 != 0)
+        {
+            sampler.keys[1] = sampler.keys[1] * -1.0f;
+        }
+        const std::vector<Point4f> keys = sampler.keys;
+
+        sampler.Compress(true, AnimationRotationTolerance);
+        TEST_CHECK(sampler.GetKeyCount() == 2 && sampler.keys.empty());
+        for (size_t k = 0; k < 2; k++)
+        {
+            const Point4f key = sampler.GetKey(k);
+            TEST_CHECK(CalcRotationError(key, keys[k]) <= RotationQuantizationError);
+            TEST_CHECK(fabsf(key.length() - 1.0f) < 1e-4f);
+        }
+    }
+
+    // Every component may be the largest one, including negative ones
+    for (int maxIdx = 0; maxIdx < 4; maxIdx++)
+    {
+        float q[4] = { 0.1f, -0.2f, 0.3f, -0.1f };
+        q[maxIdx] = -0.9f;
+        AnimationSampler sampler;
+        sampler.timeKeys = std::vector<float>(1, 0.0f);
+        sampler.keys = { Point4f(q[0], q[1], q[2], q[3]) };
+        sampler.keys[0].normalize();
+        const Point4f key = sampler.keys[0];
+
+        sampler.Compress(true, AnimationRotationTolerance);
+        TEST_CHECK(CalcRotationError(sampler.GetKey(0), key) <= RotationQuantizationError);
+    }
+}
+
+// Values are quantized in 16 bits over track range, constant components are restored exactly
+void TestRangeQuantization()
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        const Point3f center(RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f));
+        const float extent = RandomFloat(0.001f, 50.0f);
+
+        AnimationSampler sampler;
+        for (int k = 0; k < 2; k++)
+        {
+            sampler.timeKeys.push_back((float)k);
+            sampler.keys.push_back(Point4f(center.x + RandomFloat(-extent, extent), center.y + RandomFloat(-extent, extent), center.z, 0.0f));
+        }
+        const std::vector<Point4f> keys = sampler.keys;
+
+        sampler.Compress(false, AnimationRangeTolerance);
+
+        // Half quantization step, and float rounding of values
+        const float maxSize = std::max(sampler.rangeSize.x, sampler.rangeSize.y);
+        const float eps = maxSize / 0xffff * 0.5f + 200.0f * std::numeric_limits<float>::epsilon();
+        for (size_t k = 0; k < 2; k++)
+        {
+            const Point4f key = sampler.GetKey(k);
+            TEST_CHECK(CalcRangeError(key, keys[k]) <= eps);
+            TEST_CHECK(key.z == center.z);
+        }
+        TEST_CHECK(sampler.rangeSize.z == 0.0f);
+    }
+}
+
+// Dropped keys are restored by interpolation within tolerance, constant track keeps its ends only
+void TestKeyDropping()
+{
+    AnimationSampler sampler;
+    for (int k = 0; k < 100; k++)
+    {
+        sampler.timeKeys.push_back(k / 30.0f);
+        sampler.keys.push_back(Point4f(1.0f + k * 0.5f, 2.0f, 3.0f, 0.0f));
+    }
+    sampler.Compress(false, AnimationRangeTolerance);
+    TEST_CHECK(sampler.GetKeyCount() == 2);
+
+    AnimationSampler constant;
+    constant.timeKeys = std::vector<float>{ 0.0f, 1.0f, 2.0f, 3.0f };
+    constant.keys.assign(4, Point4f(0.0f, 0.0f, 0.0f, 1.0f));
+    constant.Compress(true, AnimationRotationTolerance);
+    TEST_CHECK(constant.GetKeyCount() == 2);
+    TEST_CHECK(CalcRotationError(constant.GetKey(1), Point4f(0.0f, 0.0f, 0.0f, 1.0f)) <= RotationQuantizationError);
+}
+
+// Every source key of bundled clips is restored within loader tolerance plus quantization error
+void TestBundledClips()
+{
+    const std::string modelFilename = std::string(REPO_ROOT) + "/Common/PlayerModels/MechDrone/scene.gltf";
+
+    tinygltf::Model source;
+    TEST_CHECK(LoadGLTFSource(modelFilename, source));
+
+    ModelCacheOptions options;
+    options.animationRotationTolerance = AnimationRotationTolerance;
+    options.animationRangeTolerance = AnimationRangeTolerance;
+
+    GLTFModelDesc model;
+    GLTFModelData data;
+    TEST_CHECK(ScanGLTFSource(source, modelFilename, options, model, data));
+
+    const std::vector<AnimationSampler> srcSamplers = Test::ReadSourceSamplers(source);
+    TEST_CHECK(!srcSamplers.empty() && srcSamplers.size() == model.animationSamplers.size());
+
+    float maxRotationRatio = 0.0f;
+    float maxRangeRatio = 0.0f;
+    size_t rotationTracks = 0;
+    for (size_t i = 0; i < std::min(srcSamplers.size(), model.animationSamplers.size()); i++)
+    {
+        const AnimationSampler& src = srcSamplers[i];
+        const AnimationSampler& packed = model.animationSamplers[i];
+        TEST_CHECK(src.rotation == packed.rotation);
+        TEST_CHECK(packed.GetKeyCount() <= src.GetKeyCount());
+
+        float maxValue = 0.0f;
+        for (const auto& key : src.keys)
+        {
+            maxValue = std::max(maxValue, std::max(std::max(fabsf(key.x), fabsf(key.y)), fabsf(key.z)));
+        }
+
+        // Tolerance of key dropping, then quantization of kept keys
+        float tolerance = 0.0f;
+        if (src.rotation)
+        {
+            tolerance = AnimationRotationTolerance + RotationQuantizationError;
+            ++rotationTracks;
+        }
+        else
+        {
+            Point4f bbMin = src.keys[0];
+            Point4f bbMax = src.keys[0];
+            for (const auto& key : src.keys)
+            {
+                bbMin = Point4f(std::min(bbMin.x, key.x), std::min(bbMin.y, key.y), std::min(bbMin.z, key.z), 0.0f);
+                bbMax = Point4f(std::max(bbMax.x, key.x), std::max(bbMax.y, key.y), std::max(bbMax.z, key.z), 0.0f);
+            }
+            const float range = std::max(std::max(bbMax.x - bbMin.x, bbMax.y - bbMin.y), bbMax.z - bbMin.z);
+            tolerance = std::max(range * AnimationRangeTolerance, 0.000001f) + range / 0xffff + maxValue * 8.0f * std::numeric_limits<float>::epsilon();
+        }
+
+        float maxError = 0.0f;
+        for (size_t k = 0; k < src.GetKeyCount(); k++)
+        {
+            const Point4f value = SampleTrack(packed, src.timeKeys[k]);
+            maxError = std::max(maxError, src.rotation ? CalcRotationError(value, src.keys[k]) : CalcRangeError(value, src.keys[k]));
+        }
+        TEST_CHECK(maxError <= tolerance);
+
+        if (src.rotation)
+        {
+            maxRotationRatio = std::max(maxRotationRatio, maxError / tolerance);
+        }
+        else
+        {
+            maxRangeRatio = std::max(maxRangeRatio, maxError / tolerance);
+        }
+    }
+
+    printf("MechDrone: %zu tracks, %zu rotation, max error of rotation %.2f, of translation and scale %.2f of bound\n",
+        srcSamplers.size(), rotationTracks, maxRotationRatio, maxRangeRatio);
+}
+
+} // anonymous
+
+int main()
+{
+    TestSmallestThree();
+    TestRangeQuantization();
+    TestKeyDropping();
+    TestBundledClips();
+
+    return Test::Result("animation_compress_test");
+}
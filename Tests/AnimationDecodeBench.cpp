@@ -0,0 +1,127 @@
+#include "stdafx.h"
+
+#include "PlatformAnimation.h"
+#include "PlatformModelCache.h"
+
+#include "GLTFAnimation.h"
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Decode cost and size of compressed animation against source keys, on bundled animated model
+namespace
+{
+
+struct Clip
+{
+    const char* name;
+    std::vector<AnimationSampler> samplers;
+};
+
+size_t CalcKeyCount(const std::vector<AnimationSampler>& samplers)
+{
+    size_t count = 0;
+    for (const auto& sampler : samplers)
+    {
+        count += sampler.GetKeyCount();
+    }
+    return count;
+}
+
+// Same as AnimationSampler storage, source keys are Point4f, packed ones are 3 UINT16
+size_t CalcBytes(const std::vector<AnimationSampler>& samplers)
+{
+    size_t bytes = 0;
+    for (const auto& sampler : samplers)
+    {
+        bytes += sampler.timeKeys.size() * sizeof(float) + sampler.keys.size() * sizeof(Point4f) + sampler.packedKeys.size() * sizeof(UINT16);
+    }
+    return bytes;
+}
+
+// Every key of every sampler, ns per key
+double MeasureGetKey(const std::vector<AnimationSampler>& samplers, int repeats)
+{
+    const size_t keyCount = CalcKeyCount(samplers);
+    const double ms = Test::MeasureMs(repeats, [&]()
+    {
+        Point4f sum;
+        for (int pass = 0; pass < 100; pass++)
+        {
+            for (const auto& sampler : samplers)
+            {
+                for (size_t k = 0; k < sampler.GetKeyCount(); k++)
+                {
+                    sum = sum + sampler.GetKey(k);
+                }
+            }
+        }
+        Test::KeepAlive(sum);
+    });
+    return ms * 1e6 / (keyCount * 100.0);
+}
+
+// Same as GLTFModelInstance::ApplyAnimation for instances playing at different times, us per instance and frame
+double MeasureApplyAnimation(const GLTFModelDesc& model, const std::vector<AnimationSampler>& samplers, size_t instanceCount, int frameCount, int repeats)
+{
+    std::vector<NodePose> poses(instanceCount, model.bindPose);
+    std::vector<std::vector<int>> cursors(instanceCount, std::vector<int>(samplers.size(), 0));
+
+    const double ms = Test::MeasureMs(repeats, [&]()
+    {
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            for (size_t i = 0; i < instanceCount; i++)
+            {
+                float localTime = (float)i * 0.37f + frame / 60.0f;
+                localTime -= int(localTime / model.maxAnimationTime) * model.maxAnimationTime;
+
+                SampleAnimation(samplers, model.animationChannels, localTime, cursors[i], poses[i]);
+            }
+        }
+        Test::KeepAlive(poses);
+    });
+    return ms * 1000.0 / (instanceCount * frameCount);
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int repeats = quick ? 1 : 5;
+    const size_t instanceCount = quick ? 10 : 1000;
+    const int frameCount = quick ? 2 : 60;
+
+    const std::string modelFilename = std::string(REPO_ROOT) + "/Common/PlayerModels/MechDrone/scene.gltf";
+
+    tinygltf::Model source;
+    TEST_CHECK(LoadGLTFSource(modelFilename, source));
+
+    ModelCacheOptions options;
+    options.animationRotationTolerance = AnimationRotationTolerance;
+    options.animationRangeTolerance = AnimationRangeTolerance;
+
+    // Loaded model has packed samplers, source ones are read before compression
+    GLTFModelDesc model;
+    GLTFModelData data;
+    TEST_CHECK(ScanGLTFSource(source, modelFilename, options, model, data));
+
+    Clip clips[] = {
+        { "source", Test::ReadSourceSamplers(source) },
+        { "packed", model.animationSamplers }
+    };
+    TEST_CHECK(clips[0].samplers.size() == clips[1].samplers.size() && model.maxAnimationTime > 0.0f);
+
+    printf("MechDrone: %zu samplers, %zu channels, %zu nodes, %zu instances, %d frames\n",
+        model.animationSamplers.size(), model.animationChannels.size(), model.flatNodes.size(), instanceCount, frameCount);
+    printf("%-8s %8s %10s %12s %16s\n", "keys", "count", "bytes", "GetKey ns", "ApplyAnim us");
+    for (const auto& clip : clips)
+    {
+        const double getKeyNs = MeasureGetKey(clip.samplers, repeats);
+        const double applyUs = MeasureApplyAnimation(model, clip.samplers, instanceCount, frameCount, repeats);
+        printf("%-8s %8zu %10zu %12.2f %16.2f\n", clip.name, CalcKeyCount(clip.samplers), CalcBytes(clip.samplers), getKeyNs, applyUs);
+    }
+
+    return Test::Result("animation_decode_bench");
+}
@@ -0,0 +1,189 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformBVH.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Scene BVH build, refit of moving objects and queries. Objects drift over frames, tree is rebuilt
+// by the same SAH cost rule as Renderer::UpdateSceneBVH uses
+namespace
+{
+
+const float RebuildCostRatio = 1.5f;    // Same as Renderer::BVHRebuildCostRatio
+const float SceneSize = 200.0f;
+
+std::mt19937 s_random(1234);
+
+float RandomFloat(float low, float high)
+{
+    return std::uniform_real_distribution<float>(low, high)(s_random);
+}
+
+AABB<float> MakeBox(const Point3f& center, float size)
+{
+    AABB<float> box;
+    box.Add(center - Point3f{ size, size, size });
+    box.Add(center + Point3f{ size, size, size });
+    return box;
+}
+
+std::vector<UINT> BruteForceSphere(const std::vector<AABB<float>>& boxes, const Point3f& center, float radius)
+{
+    std::vector<UINT> res;
+    for (UINT i = 0; i < (UINT)boxes.size(); i++)
+    {
+        Point3f nearest{
+            std::max(std::max(boxes[i].bbMin.x - center.x, center.x - boxes[i].bbMax.x), 0.0f),
+            std::max(std::max(boxes[i].bbMin.y - center.y, center.y - boxes[i].bbMax.y), 0.0f),
+            std::max(std::max(boxes[i].bbMin.z - center.z, center.z - boxes[i].bbMax.z), 0.0f)
+        };
+        if (nearest.lengthSqr() <= radius * radius)
+        {
+            res.push_back(i);
+        }
+    }
+    return res;
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int frameCount = quick ? 10 : 300;
+    const int queryCount = quick ? 10 : 1000;
+
+    std::vector<size_t> counts = { 1000, 10000, 100000 };
+    if (quick)
+    {
+        counts = { 1000 };
+    }
+
+    // Camera frustum at scene center, 90 degrees field of view, looks along z
+    Matrix4f proj;
+    proj.Zero();
+    proj.m[0] = 1.0f;
+    proj.m[5] = 1.0f;
+    proj.m[10] = 100.0f / (100.0f - 0.1f);
+    proj.m[11] = 1.0f;
+    proj.m[14] = -0.1f * 100.0f / (100.0f - 0.1f);
+    Frustum frustum;
+    frustum.Build(proj);
+
+    printf("%-8s %9s %9s %10s %9s %9s %9s %9s %9s %8s\n", "objects", "build ms", "refit us", "frustum us", "visible",
+        "sphere us", "ray us", "SAH", "max SAH", "rebuilds");
+
+    for (size_t count : counts)
+    {
+        // A quarter of objects moves, velocities are random, so moving objects leave their neighbours
+        std::vector<AABB<float>> boxes(count);
+        std::vector<Point3f> centers(count);
+        std::vector<Point3f> velocities(count);
+        std::vector<float> sizes(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            centers[i] = Point3f{ RandomFloat(-SceneSize, SceneSize), RandomFloat(-5.0f, 5.0f), RandomFloat(-SceneSize, SceneSize) };
+            sizes[i] = RandomFloat(0.5f, 3.0f);
+            const float speed = i % 4 == 0 ? 20.0f : 0.0f;
+            velocities[i] = Point3f{ RandomFloat(-speed, speed), 0.0f, RandomFloat(-speed, speed) };
+            boxes[i] = MakeBox(centers[i], sizes[i]);
+        }
+
+        BVH bvh;
+        double buildMs = Test::MeasureMs(quick ? 1 : 5, [&]() { bvh.Build(boxes); });
+        const float buildCost = bvh.GetBuildSAHCost();
+        TEST_CHECK(buildCost > 0.0f && buildCost == bvh.CalcStats().sahCost);
+
+        // Frames move objects, refit tree and rebuild it once it gets too expensive
+        double refitMs = 0.0;
+        float maxCost = buildCost;
+        int rebuilds = 0;
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            Test::Timer timer;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (velocities[i].x != 0.0f || velocities[i].z != 0.0f)
+                {
+                    centers[i] = centers[i] + velocities[i] * (1.0f / 60.0f);
+                    boxes[i] = MakeBox(centers[i], sizes[i]);
+                    bvh.Update((UINT)i, boxes[i]);
+                }
+            }
+            const size_t refitted = bvh.Refit();
+
+            const float cost = bvh.CalcStats().sahCost;
+            maxCost = std::max(maxCost, cost);
+            if (refitted != 0 && cost > bvh.GetBuildSAHCost() * RebuildCostRatio)
+            {
+                bvh.Rebuild();
+                ++rebuilds;
+
+                // Objects keep their indices and boxes
+                TEST_CHECK(bvh.GetObjectCount() == count);
+                TEST_CHECK(memcmp(&bvh.GetObjectBox((UINT)(count - 1)), &boxes[count - 1], sizeof(AABB<float>)) == 0);
+                TEST_CHECK(bvh.CalcStats().sahCost <= cost);
+            }
+            refitMs += timer.ElapsedMs();
+        }
+
+        // Queries over refitted tree
+        std::vector<UINT> objects;
+        size_t frustumHits = 0;
+        double frustumMs = Test::MeasureMs(quick ? 1 : 20, [&]()
+        {
+            objects.clear();
+            bvh.QueryFrustum(frustum, objects);
+            frustumHits = objects.size();
+        });
+
+        std::vector<Point3f> queryPoints(queryCount);
+        for (auto& point : queryPoints)
+        {
+            point = Point3f{ RandomFloat(-SceneSize, SceneSize), 0.0f, RandomFloat(-SceneSize, SceneSize) };
+        }
+
+        double sphereMs = Test::MeasureMs(quick ? 1 : 5, [&]()
+        {
+            for (const auto& point : queryPoints)
+            {
+                objects.clear();
+                bvh.QuerySphere(point, 10.0f, objects);
+            }
+        });
+
+        // Sphere query gives the same objects as brute force test
+        objects.clear();
+        bvh.QuerySphere(queryPoints[0], 10.0f, objects);
+        std::sort(objects.begin(), objects.end());
+        TEST_CHECK(objects == BruteForceSphere(boxes, queryPoints[0], 10.0f));
+
+        UINT hits = 0;
+        double rayMs = Test::MeasureMs(quick ? 1 : 5, [&]()
+        {
+            hits = 0;
+            for (const auto& point : queryPoints)
+            {
+                float dist = 0.0f;
+                Point3f dir{ -point.x, 0.01f, -point.z };
+                dir.normalize();
+                hits += bvh.QueryRay(Point3f{ point.x, 0.0f, point.z }, dir, 1000.0f, dist) != BVH::InvalidIndex ? 1 : 0;
+            }
+        });
+        TEST_CHECK(hits > 0);
+
+        const BVH::Stats stats = bvh.CalcStats();
+        printf("%-8zu %9.2f %9.1f %10.1f %9zu %9.2f %9.2f %9.1f %9.1f %8d\n", count, buildMs, refitMs * 1000.0 / frameCount,
+            frustumMs * 1000.0, frustumHits, sphereMs * 1000.0 / queryCount, rayMs * 1000.0 / queryCount, stats.sahCost, maxCost, rebuilds);
+
+        // Refit alone lets cost grow over the guard, rebuild brings it back
+        TEST_CHECK(quick || rebuilds > 0);
+        TEST_CHECK(stats.sahCost <= bvh.GetBuildSAHCost() * RebuildCostRatio);
+    }
+
+    return Test::Result("bvh_bench");
+}
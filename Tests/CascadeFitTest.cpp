@@ -0,0 +1,189 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "CascadeFit.h"
+
+#include "TestUtil.h"
+
+namespace
+{
+
+const UINT MapSize = 2048;              // Same as Renderer::ShadowSplitMapSize
+
+std::mt19937 s_random(1234);
+
+float RandomFloat(float low, float high)
+{
+    return std::uniform_real_distribution<float>(low, high)(s_random);
+}
+
+// Distance from sphere center to the farthest corner of the slice, computed in double
+double CalcMaxCornerDist(const CascadeSphere& sphere, float nearPlane, float farPlane, float tanHalfX, float tanHalfY)
+{
+    double maxDist = 0.0;
+    for (float dist : { nearPlane, farPlane })
+    {
+        const double x = (double)dist * tanHalfX;
+        const double y = (double)dist * tanHalfY;
+        const double z = (double)dist - sphere.centerDist;
+        maxDist = std::max(maxDist, sqrt(x * x + y * y + z * z));
+    }
+    return maxDist;
+}
+
+// All slice corners are inside the sphere, the farthest ones are on it
+void TestSphere()
+{
+    for (int i = 0; i < 10000; i++)
+    {
+        const float tanHalfX = tanf(RandomFloat(0.1f, 1.4f));
+        const float tanHalfY = tanHalfX * RandomFloat(0.3f, 1.0f);
+        const float tanHalfDiag = sqrtf(tanHalfX * tanHalfX + tanHalfY * tanHalfY);
+
+        const float nearPlane = RandomFloat(0.0f, 100.0f);
+        const float farPlane = nearPlane + RandomFloat(0.01f, 200.0f);
+
+        const CascadeSphere sphere = CalcCascadeSphere(nearPlane, farPlane, tanHalfDiag);
+        TEST_CHECK(sphere.centerDist > nearPlane && sphere.centerDist <= farPlane);
+
+        const double maxDist = CalcMaxCornerDist(sphere, nearPlane, farPlane, tanHalfX, tanHalfY);
+        TEST_CHECK(maxDist <= sphere.radius * (1.0 + 1e-5));
+        TEST_CHECK(maxDist >= sphere.radius * (1.0 - 1e-5));
+    }
+
+    // Narrow slice has center in between planes, wide one has it on far plane
+    const CascadeSphere narrow = CalcCascadeSphere(10.0f, 20.0f, 0.5f);
+    TEST_CHECK(narrow.centerDist > 10.0f && narrow.centerDist < 20.0f);
+    const CascadeSphere wide = CalcCascadeSphere(1.0f, 20.0f, 2.0f);
+    TEST_CHECK(wide.centerDist == 20.0f);
+    TEST_CHECK(fabsf(wide.radius - 40.0f) < 1e-4f);
+}
+
+// Rect covers circle, its size is fixed and it moves by whole texels, as its center moves
+void TestRect()
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        const float radius = RandomFloat(1.0f, 200.0f);
+        const float halfSize = radius * MapSize / (MapSize - 1);
+        const float texelSize = 2.0f * halfSize / MapSize;
+
+        // Light space scene spreads over a few split sizes, farther float position has no texel precision
+        Point2f center{ RandomFloat(-20.0f, 20.0f) * radius, RandomFloat(-20.0f, 20.0f) * radius };
+        const Point2f step{ RandomFloat(-0.5f, 0.5f) * texelSize, RandomFloat(-0.5f, 0.5f) * texelSize };
+
+        Point2f prevMin{ 0.0f, 0.0f };
+        for (int frame = 0; frame < 64; frame++)
+        {
+            Point2f bbMin, bbMax;
+            CalcCascadeRect(center, radius, MapSize, bbMin, bbMax);
+
+            // Margin is half texel, it is what snapping may move center by, so circle stays inside up to rounding
+            const float eps = std::max(fabsf(center.x), fabsf(center.y)) * 1e-6f + radius * 1e-6f;
+            TEST_CHECK(bbMin.x <= center.x - radius + eps && bbMin.y <= center.y - radius + eps);
+            TEST_CHECK(bbMax.x >= center.x + radius - eps && bbMax.y >= center.y + radius - eps);
+
+            const float sizeEps = halfSize * 1e-5f + std::max(fabsf(bbMin.x), fabsf(bbMin.y)) * 1e-6f;
+            TEST_CHECK(fabsf(bbMax.x - bbMin.x - 2.0f * halfSize) < sizeEps);
+            TEST_CHECK(fabsf(bbMax.y - bbMin.y - 2.0f * halfSize) < sizeEps);
+
+            if (frame > 0)
+            {
+                // Shift is whole number of texels, rounding error of grid position aside
+                for (float shift : { (bbMin.x - prevMin.x) / texelSize, (bbMin.y - prevMin.y) / texelSize })
+                {
+                    TEST_CHECK(fabsf(shift - roundf(shift)) < 1e-2f);
+                    TEST_CHECK(fabsf(shift) <= 1.0f + 1e-2f);
+                }
+            }
+
+            prevMin = bbMin;
+            center = Point2f{ center.x + step.x, center.y + step.y };
+        }
+    }
+
+    // Center within the same texel gives the same rect bit for bit
+    Point2f bbMin0, bbMax0, bbMin1, bbMax1;
+    const float texelSize = 2.0f * 10.0f * MapSize / (MapSize - 1) / MapSize;
+    CalcCascadeRect(Point2f{ 5.0f * texelSize, 7.0f * texelSize }, 10.0f, MapSize, bbMin0, bbMax0);
+    CalcCascadeRect(Point2f{ 5.2f * texelSize, 6.7f * texelSize }, 10.0f, MapSize, bbMin1, bbMax1);
+    TEST_CHECK(bbMin0.x == bbMin1.x && bbMin0.y == bbMin1.y && bbMax0.x == bbMax1.x && bbMax0.y == bbMax1.y);
+}
+
+// Splits grow from minDist to maxDist for any blend weight, ends are the same as of uniform and logarithmic ones
+void TestSplitDists()
+{
+    const UINT SplitCount = 4;
+    for (int i = 0; i < 1000; i++)
+    {
+        const float minDist = RandomFloat(0.01f, 10.0f);
+        const float maxDist = minDist + RandomFloat(0.1f, 1000.0f);
+        const float logWeight = i == 0 ? 0.0f : (i == 1 ? 1.0f : RandomFloat(0.0f, 1.0f));
+
+        float dists[SplitCount];
+        CalcSplitDists(minDist, maxDist, logWeight, SplitCount, dists);
+
+        TEST_CHECK(dists[0] > minDist);
+        for (UINT j = 1; j < SplitCount; j++)
+        {
+            TEST_CHECK(dists[j] > dists[j - 1]);
+        }
+        TEST_CHECK(fabsf(dists[SplitCount - 1] - maxDist) <= maxDist * 1e-5f);
+
+        // Logarithmic splits are never farther than uniform ones, blend is in between
+        float uniform[SplitCount];
+        float logarithmic[SplitCount];
+        CalcSplitDists(minDist, maxDist, 0.0f, SplitCount, uniform);
+        CalcSplitDists(minDist, maxDist, 1.0f, SplitCount, logarithmic);
+        for (UINT j = 0; j < SplitCount; j++)
+        {
+            const float eps = maxDist * 1e-5f;
+            TEST_CHECK(logarithmic[j] <= uniform[j] + eps);
+            TEST_CHECK(dists[j] >= logarithmic[j] - eps && dists[j] <= uniform[j] + eps);
+        }
+    }
+}
+
+// Quantized distance is on 1/8 grid of its power of two range, distance rounds to the side given
+void TestQuantize()
+{
+    float prevDown = 0.0f;
+    float prevUp = 0.0f;
+    for (float dist = 0.01f; dist < 1000.0f; dist *= 1.001f)
+    {
+        const float down = QuantizeSplitDist(dist, false);
+        const float up = QuantizeSplitDist(dist, true);
+        const float step = ldexpf(1.0f, ilogbf(dist) - 3);
+
+        TEST_CHECK(down <= dist && dist - down < step);
+        TEST_CHECK(up >= dist && up - dist < step);
+        TEST_CHECK(up - down <= dist * 0.125f);
+
+        // Grid values stay as they are, the result doesn't decrease, as distance grows
+        TEST_CHECK(QuantizeSplitDist(down, false) == down && QuantizeSplitDist(up, true) == up);
+        TEST_CHECK(down >= prevDown && up >= prevUp);
+        prevDown = down;
+        prevUp = up;
+    }
+
+    // Small change of distance keeps the result
+    TEST_CHECK(QuantizeSplitDist(50.0f, true) == QuantizeSplitDist(51.5f, true));
+    TEST_CHECK(QuantizeSplitDist(51.5f, true) == 52.0f);
+    TEST_CHECK(QuantizeSplitDist(51.5f, false) == 48.0f);
+
+    TEST_CHECK(QuantizeSplitDist(0.0f, true) == 0.0f);
+    TEST_CHECK(QuantizeSplitDist(-1.0f, false) == -1.0f);
+}
+
+} // anonymous
+
+int main()
+{
+    TestSphere();
+    TestRect();
+    TestSplitDists();
+    TestQuantize();
+
+    return Test::Result("cascade_fit_test");
+}
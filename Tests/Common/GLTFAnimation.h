@@ -0,0 +1,67 @@
+#pragma once
+
+#include "PlatformAnimation.h"
+
+#include "tiny_gltf.h"
+
+namespace Test
+{
+
+// Samplers of the first glTF animation before compression, time starts at zero, as loader shifts it.
+// Sampler order is the same as in loaded model
+inline std::vector<Platform::AnimationSampler> ReadSourceSamplers(const tinygltf::Model& source)
+{
+    std::vector<Platform::AnimationSampler> samplers;
+    if (source.animations.empty())
+    {
+        return samplers;
+    }
+
+    const tinygltf::Animation& animation = source.animations[0];
+
+    float minTime = std::numeric_limits<float>::max();
+    for (const auto& srcSampler : animation.samplers)
+    {
+        const tinygltf::Accessor& timeAccessor = source.accessors[srcSampler.input];
+        const tinygltf::BufferView& timeView = source.bufferViews[timeAccessor.bufferView];
+        const float* pTimes = reinterpret_cast<const float*>(source.buffers[timeView.buffer].data.data() + timeView.byteOffset + timeAccessor.byteOffset);
+
+        const tinygltf::Accessor& keyAccessor = source.accessors[srcSampler.output];
+        const tinygltf::BufferView& keyView = source.bufferViews[keyAccessor.bufferView];
+        const float* pKeys = reinterpret_cast<const float*>(source.buffers[keyView.buffer].data.data() + keyView.byteOffset + keyAccessor.byteOffset);
+        const size_t components = keyAccessor.type == TINYGLTF_TYPE_VEC4 ? 4 : 3;
+
+        Platform::AnimationSampler sampler;
+        sampler.timeKeys.resize(timeAccessor.count);
+        sampler.keys.resize(keyAccessor.count);
+        for (size_t i = 0; i < keyAccessor.count; i++)
+        {
+            const float* pKey = pKeys + i * components;
+            sampler.timeKeys[i] = pTimes[i];
+            sampler.keys[i] = Point4f(pKey[0], pKey[1], pKey[2], components == 4 ? pKey[3] : 0.0f);
+        }
+
+        minTime = std::min(minTime, sampler.timeKeys.front());
+        samplers.push_back(sampler);
+    }
+
+    for (auto& sampler : samplers)
+    {
+        for (auto& time : sampler.timeKeys)
+        {
+            time -= minTime;
+        }
+    }
+
+    for (const auto& channel : animation.channels)
+    {
+        if (channel.target_path == "rotation")
+        {
+            samplers[channel.sampler].rotation = true;
+        }
+    }
+
+    return samplers;
+}
+
+} // Test
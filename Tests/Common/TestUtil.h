@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+// Minimal check and timing helpers shared by test and benchmark targets
+namespace Test
+{
+
+inline int& FailureCount()
+{
+    static int count = 0;
+    return count;
+}
+
+inline void Fail(const char* expr, const char* file, int line)
+{
+    printf("%s(%d): check failed: %s\n", file, line, expr);
+    ++FailureCount();
+}
+
+// Process exit code, non-zero if any check failed
+inline int Result(const char* name)
+{
+    if (FailureCount() != 0)
+    {
+        printf("%s: %d check(s) failed\n", name, FailureCount());
+        return 1;
+    }
+
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+// Benchmarks run with reduced sizes under ctest, so they are kept buildable and runnable
+inline bool IsQuick(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+class Timer
+{
+public:
+    Timer() : m_start(std::chrono::high_resolution_clock::now()) {}
+
+    double ElapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::high_resolution_clock::time_point m_start;
+};
+
+// Best time of several runs, milliseconds
+template <typename Func>
+double MeasureMs(int repeats, Func func)
+{
+    double best = 0.0;
+    for (int i = 0; i < repeats; i++)
+    {
+        Timer timer;
+        func();
+        double time = timer.ElapsedMs();
+        best = i == 0 ? time : std::min(best, time);
+    }
+    return best;
+}
+
+// Keeps benchmarked results from being optimized out
+template <typename T>
+inline void KeepAlive(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+} // Test
+
+#define TEST_CHECK(cond) ((cond) ? (void)0 : Test::Fail(#cond, __FILE__, __LINE__))
@@ -0,0 +1,133 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformAnimation.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+namespace
+{
+
+// Key search before cursors were added
+int FindKeyBinary(const std::vector<float>& timeKeys, float time)
+{
+    int idx = (int)(std::upper_bound(timeKeys.begin(), timeKeys.end(), time) - timeKeys.begin()) - 1;
+    return std::max(idx, 0);
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int keyCount = 10000;
+    const int samplerCount = 16;
+    const int instanceCount = quick ? 16 : 1000;
+    const int frameCount = quick ? 10 : 600;
+    const float frameTime = 1.0f / 60.0f;
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    // Irregular key spacing, about 30 keys per second
+    std::vector<std::vector<float>> samplers(samplerCount);
+    float clipLength = 0.0f;
+    for (auto& timeKeys : samplers)
+    {
+        timeKeys.resize(keyCount);
+        float time = 0.0f;
+        for (auto& key : timeKeys)
+        {
+            key = time;
+            time += 0.01f + dist(random) * 0.05f;
+        }
+        clipLength = clipLength == 0.0f ? timeKeys.back() : std::min(clipLength, timeKeys.back());
+    }
+
+    std::vector<float> startTimes(instanceCount);
+    for (auto& time : startTimes)
+    {
+        time = dist(random) * clipLength;
+    }
+
+    std::vector<int> cursors(instanceCount * samplerCount, 0);
+    long long cursorSum = 0;
+    long long binarySum = 0;
+
+    // Playback, instances advance by frame time and loop
+    auto localTime = [&](int instance, int frame)
+    {
+        return fmodf(startTimes[instance] + frame * frameTime, clipLength);
+    };
+
+    double cursorMs = Test::MeasureMs(1, [&]()
+    {
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            for (int i = 0; i < instanceCount; i++)
+            {
+                float time = localTime(i, frame);
+                for (int s = 0; s < samplerCount; s++)
+                {
+                    cursorSum += FindKey(samplers[s], time, cursors[i * samplerCount + s]);
+                }
+            }
+        }
+    });
+    double binaryMs = Test::MeasureMs(1, [&]()
+    {
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            for (int i = 0; i < instanceCount; i++)
+            {
+                float time = localTime(i, frame);
+                for (int s = 0; s < samplerCount; s++)
+                {
+                    binarySum += FindKeyBinary(samplers[s], time);
+                }
+            }
+        }
+    });
+    TEST_CHECK(cursorSum == binarySum);
+
+    // Random seeks hit binary search fallback
+    std::vector<float> seekTimes(instanceCount * frameCount);
+    for (auto& time : seekTimes)
+    {
+        time = dist(random) * clipLength;
+    }
+    long long seekCursorSum = 0;
+    long long seekBinarySum = 0;
+    double seekCursorMs = Test::MeasureMs(1, [&]()
+    {
+        for (size_t i = 0; i < seekTimes.size(); i++)
+        {
+            for (int s = 0; s < samplerCount; s++)
+            {
+                seekCursorSum += FindKey(samplers[s], seekTimes[i], cursors[(i % instanceCount) * samplerCount + s]);
+            }
+        }
+    });
+    double seekBinaryMs = Test::MeasureMs(1, [&]()
+    {
+        for (size_t i = 0; i < seekTimes.size(); i++)
+        {
+            for (int s = 0; s < samplerCount; s++)
+            {
+                seekBinarySum += FindKeyBinary(samplers[s], seekTimes[i]);
+            }
+        }
+    });
+    TEST_CHECK(seekCursorSum == seekBinarySum);
+
+    const double lookups = (double)frameCount * instanceCount * samplerCount;
+    printf("%d keys per sampler, %d samplers, %d instances, %d frames\n", keyCount, samplerCount, instanceCount, frameCount);
+    printf("%-10s %12s %12s %9s\n", "ns/lookup", "cursor", "binary", "speedup");
+    printf("%-10s %12.2f %12.2f %8.2fx\n", "playback", cursorMs * 1000000.0 / lookups, binaryMs * 1000000.0 / lookups, binaryMs / cursorMs);
+    printf("%-10s %12.2f %12.2f %8.2fx\n", "seek", seekCursorMs * 1000000.0 / lookups, seekBinaryMs * 1000000.0 / lookups, seekBinaryMs / seekCursorMs);
+
+    return Test::Result("findkey_bench");
+}
@@ -0,0 +1,80 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformFrustum.h"
+#include "PlatformSIMD.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Camera frustum culling of instance boxes, SIMD TestBoxes against per box TestBox
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int repeats = quick ? 1 : 50;
+
+    std::vector<size_t> counts = { 1000, 10000, 100000 };
+    if (quick)
+    {
+        counts = { 1000 };
+    }
+
+    // Camera at origin looks along z with 90 degree field of view, scene spreads around it
+    Matrix4f proj;
+    proj.Zero();
+    proj.m[0] = 1.0f / 1.7778f;
+    proj.m[5] = 1.0f;
+    proj.m[10] = 200.0f / (200.0f - 0.1f);
+    proj.m[11] = 1.0f;
+    proj.m[14] = -0.1f * 200.0f / (200.0f - 0.1f);
+
+    Frustum frustum;
+    frustum.Build(proj);
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> pos(-150.0f, 150.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+
+    printf("%s\n", SIMD::GetName());
+    printf("%-10s %10s %12s %12s %12s %9s\n", "boxes", "visible", "scalar us", "SIMD us", "ns/box", "speedup");
+
+    for (size_t count : counts)
+    {
+        BoxList boxes;
+        for (size_t i = 0; i < count; i++)
+        {
+            boxes.Add(Point3f{ pos(random), pos(random) * 0.1f, pos(random) }, Point3f{ size(random), size(random), size(random) });
+        }
+
+        std::vector<UINT8> visible(count);
+        std::vector<UINT8> expected(count);
+
+        size_t scalarCount = 0;
+        double scalarMs = Test::MeasureMs(repeats, [&]()
+        {
+            scalarCount = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                expected[i] = frustum.TestBox(Point3f{ boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i] },
+                    Point3f{ boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i] }) ? 1 : 0;
+                scalarCount += expected[i];
+            }
+        });
+
+        size_t visibleCount = 0;
+        double simdMs = Test::MeasureMs(repeats, [&]()
+        {
+            visibleCount = frustum.TestBoxes(boxes, visible.data());
+        });
+
+        TEST_CHECK(visibleCount == scalarCount);
+        TEST_CHECK(visible == expected);
+
+        printf("%-10zu %10zu %12.1f %12.1f %12.2f %8.2fx\n", count, visibleCount, scalarMs * 1000.0, simdMs * 1000.0,
+            simdMs * 1e6 / count, scalarMs / simdMs);
+    }
+
+    return Test::Result("frustum_bench");
+}
@@ -0,0 +1,193 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformFrustum.h"
+#include "PlatformSIMD.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+namespace
+{
+
+std::mt19937 s_random(1234);
+
+float RandomFloat(float low, float high)
+{
+    return std::uniform_real_distribution<float>(low, high)(s_random);
+}
+
+// D3D perspective projection, camera looks along z, rotated and moved in world
+Matrix4f CameraViewProj(float fovY, float aspect, float nearZ, float farZ, const Point3f& axis, float angle, const Point3f& pos)
+{
+    Matrix4f proj;
+    proj.Zero();
+    const float f = 1.0f / tanf(fovY * 0.5f);
+    proj.m[0] = f / aspect;
+    proj.m[5] = f;
+    proj.m[10] = farZ / (farZ - nearZ);
+    proj.m[11] = 1.0f;
+    proj.m[14] = -nearZ * farZ / (farZ - nearZ);
+
+    Matrix4f offset;
+    offset.Offset(Point3f{ -pos.x, -pos.y, -pos.z });
+    Matrix4f rotation;
+    rotation.Rotation(angle, axis);
+
+    return offset * rotation * proj;
+}
+
+// Box is outside, if all its corners are outside of some plane. Computed in double,
+// margin is the smallest distance, by which corners of the box miss or hit the culling plane
+bool BruteForceVisible(const Frustum& frustum, const Point3f& center, const Point3f& extent, double& margin)
+{
+    margin = std::numeric_limits<double>::max();
+    for (int i = 0; i < Frustum::PlaneCount; i++)
+    {
+        const Point4f& p = frustum.GetPlane(i);
+
+        double maxDist = -std::numeric_limits<double>::max();
+        for (int corner = 0; corner < 8; corner++)
+        {
+            const double x = (double)center.x + ((corner & 1) ? extent.x : -extent.x);
+            const double y = (double)center.y + ((corner & 2) ? extent.y : -extent.y);
+            const double z = (double)center.z + ((corner & 4) ? extent.z : -extent.z);
+            maxDist = std::max(maxDist, (double)p.x * x + (double)p.y * y + (double)p.z * z + (double)p.w);
+        }
+
+        margin = std::min(margin, fabs(maxDist));
+        if (maxDist < 0.0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Random boxes around frustum, count is not multiple of vector width, so scalar tail is tested too
+void FillBoxes(BoxList& boxes, size_t count, const Point3f& cameraPos)
+{
+    boxes.Clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        Point3f center{ cameraPos.x + RandomFloat(-120.0f, 120.0f), cameraPos.y + RandomFloat(-120.0f, 120.0f), cameraPos.z + RandomFloat(-120.0f, 120.0f) };
+        Point3f extent{ RandomFloat(0.0f, 5.0f), RandomFloat(0.0f, 5.0f), RandomFloat(0.0f, 5.0f) };
+        if (i % 97 == 0)
+        {
+            // Huge boxes intersect frustum from outside of it
+            extent = Point3f{ 200.0f, 0.5f, 0.5f };
+        }
+        if (i % 101 == 0)
+        {
+            // Flat boxes
+            extent.y = 0.0f;
+        }
+        boxes.Add(center, extent);
+    }
+}
+
+void TestBoxes()
+{
+    const size_t count = 100003;
+
+    int frustumCount = 0;
+    size_t visibleTotal = 0;
+    size_t borderline = 0;
+    for (; frustumCount < 8; frustumCount++)
+    {
+        Point3f axis{ RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f) };
+        axis.normalize();
+        const Point3f cameraPos{ RandomFloat(-50.0f, 50.0f), RandomFloat(-50.0f, 50.0f), RandomFloat(-50.0f, 50.0f) };
+
+        Frustum frustum;
+        frustum.Build(CameraViewProj(RandomFloat(0.5f, 1.5f), RandomFloat(1.0f, 2.0f), 0.1f, 100.0f, axis, RandomFloat(0.0f, 6.28f), cameraPos));
+
+        BoxList boxes;
+        FillBoxes(boxes, count, cameraPos);
+
+        std::vector<UINT8> visible(count, 0xFF);
+        const size_t visibleCount = frustum.TestBoxes(boxes, visible.data());
+
+        size_t expectedCount = 0;
+        bool sameAsTestBox = true;
+        bool sameAsBruteForce = true;
+        for (size_t i = 0; i < count; i++)
+        {
+            const Point3f center{ boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i] };
+            const Point3f extent{ boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i] };
+
+            // SIMD result is the same as TestBox gives, bit for bit
+            const bool testBox = frustum.TestBox(center, extent);
+            sameAsTestBox = sameAsTestBox && visible[i] == (testBox ? 1 : 0);
+            expectedCount += testBox ? 1 : 0;
+
+            // Float and double may disagree only for boxes, which touch culling plane
+            double margin = 0.0;
+            const bool bruteForce = BruteForceVisible(frustum, center, extent, margin);
+            if (margin < 1e-3)
+            {
+                ++borderline;
+            }
+            else
+            {
+                sameAsBruteForce = sameAsBruteForce && bruteForce == testBox;
+            }
+        }
+        TEST_CHECK(sameAsTestBox);
+        TEST_CHECK(sameAsBruteForce);
+        TEST_CHECK(visibleCount == expectedCount);
+
+        visibleTotal += visibleCount;
+    }
+
+    // Frustums see some boxes, not all of them
+    TEST_CHECK(visibleTotal > 0 && visibleTotal < count * frustumCount);
+    printf("%s, %zu of %zu boxes visible, %zu borderline\n", SIMD::GetName(), visibleTotal, count * frustumCount, borderline);
+}
+
+// Boxes, which are exactly at known places relative to axis aligned frustum
+void TestKnownBoxes()
+{
+    Frustum frustum;
+    frustum.Build(CameraViewProj(1.5707964f, 1.0f, 1.0f, 10.0f, Point3f{ 0,1,0 }, 0.0f, Point3f{ 0,0,0 }));
+
+    BoxList boxes;
+    boxes.Add(Point3f{ 0,0,5 }, Point3f{ 0.1f,0.1f,0.1f });          // Inside
+    boxes.Add(Point3f{ 0,0,-5 }, Point3f{ 0.1f,0.1f,0.1f });         // Behind camera
+    boxes.Add(Point3f{ 0,0,12 }, Point3f{ 1,1,1 });                  // Beyond far plane
+    boxes.Add(Point3f{ 0,0,11 }, Point3f{ 1,1,1.5f });               // Crosses far plane
+    boxes.Add(Point3f{ 20,0,5 }, Point3f{ 1,1,1 });                  // Right of frustum
+    boxes.Add(Point3f{ 0,0,-5 }, Point3f{ Frustum::InfiniteExtent, Frustum::InfiniteExtent, Frustum::InfiniteExtent });
+    boxes.Add(Point3f{ 0,-8,5 }, Point3f{ 0,4,0 });                  // Flat box, which reaches bottom plane
+    boxes.Add(Point3f{ 0,0,0.5f }, Point3f{ 0,0,0.4f });             // Between camera and near plane
+    boxes.Add(Point3f{ 0,0,5 }, Point3f{ 0.1f,0.1f,0.1f });
+
+    const UINT8 expected[] = { 1, 0, 0, 1, 0, 1, 1, 0, 1 };
+
+    std::vector<UINT8> visible(boxes.GetSize(), 0xFF);
+    TEST_CHECK(frustum.TestBoxes(boxes, visible.data()) == 5);
+    for (size_t i = 0; i < boxes.GetSize(); i++)
+    {
+        TEST_CHECK(visible[i] == expected[i]);
+    }
+
+    // Plane with zero normal and positive w doesn't cull anything
+    for (int i = 0; i < Frustum::PlaneCount; i++)
+    {
+        frustum.SetPlane(i, Point4f{ 0,0,0,1 });
+    }
+    TEST_CHECK(frustum.TestBoxes(boxes, visible.data()) == boxes.GetSize());
+}
+
+} // anonymous
+
+int main()
+{
+    TestKnownBoxes();
+    TestBoxes();
+
+    return Test::Result("frustum_test");
+}
@@ -0,0 +1,229 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformAnimation.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+namespace
+{
+
+struct Node
+{
+    Point4f rotation;
+    Point3f translation;
+    Point3f scale;
+    std::vector<int> children;
+};
+
+struct Hierarchy
+{
+    std::vector<Node> nodes;
+    std::vector<Matrix4f> invBind;
+
+    std::vector<int> flatNodes;
+    std::vector<int> flatParents;
+    NodePose pose;
+};
+
+// Random tree, node 0 is root
+Hierarchy BuildHierarchy(int nodeCount, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    Hierarchy h;
+    h.nodes.resize(nodeCount);
+    h.invBind.resize(nodeCount);
+    for (int i = 0; i < nodeCount; i++)
+    {
+        Point4f q(dist(random), dist(random), dist(random), dist(random));
+        q.normalize();
+
+        h.nodes[i].rotation = q;
+        h.nodes[i].translation = Point3f(dist(random), dist(random), dist(random));
+        h.nodes[i].scale = Point3f(1.0f, 1.0f, 1.0f);
+        h.invBind[i].Offset(Point3f(dist(random), dist(random), dist(random)));
+
+        if (i > 0)
+        {
+            // Mostly chains, as in skeletons
+            int parent = random() % 4 == 0 ? (int)(random() % i) : i - 1;
+            h.nodes[parent].children.push_back(i);
+        }
+    }
+
+    // Same breadth-first flattening as GLTFModel::BuildHierarchy
+    h.flatNodes.push_back(0);
+    h.flatParents.push_back(-1);
+    for (size_t i = 0; i < h.flatNodes.size(); i++)
+    {
+        for (auto child : h.nodes[h.flatNodes[i]].children)
+        {
+            h.flatNodes.push_back(child);
+            h.flatParents.push_back((int)i);
+        }
+    }
+
+    h.pose.Resize(nodeCount);
+    for (int i = 0; i < nodeCount; i++)
+    {
+        const Node& node = h.nodes[h.flatNodes[i]];
+        h.pose.useMatrix[i] = false;
+        h.pose.rotation[i] = node.rotation;
+        h.pose.translation[i] = node.translation;
+        h.pose.scale[i] = node.scale;
+    }
+
+    return h;
+}
+
+// Hierarchy update before flattening, kept as reference
+void UpdateRecursive(const Hierarchy& h, int nodeIdx, const Matrix4f& parent, const Matrix4f& parentNormals, Matrix4f* pTransforms, Matrix4f* pNormalTransforms)
+{
+    const Node& node = h.nodes[nodeIdx];
+
+    Matrix4f rotationMatrix;
+    Matrix4f translationMatrix;
+    Matrix4f scaleMatrix;
+
+    rotationMatrix.FromQuaternion(node.rotation);
+    translationMatrix.Offset(node.translation);
+    scaleMatrix.Scale(node.scale.x, node.scale.y, node.scale.z);
+
+    Matrix4f m = scaleMatrix * rotationMatrix * translationMatrix;
+
+    Matrix4f normM = m * parentNormals;
+    m = m * parent;
+
+    pTransforms[nodeIdx] = h.invBind[nodeIdx] * m;
+    pNormalTransforms[nodeIdx] = (h.invBind[nodeIdx] * normM).NormalMatrix();
+
+    for (auto idx : node.children)
+    {
+        UpdateRecursive(h, idx, m, normM, pTransforms, pNormalTransforms);
+    }
+}
+
+// Same as GLTFModel::UpdateNodeMatrices, normal matrices are either affine ones or taken from general 4x4 inverse
+void UpdateFlat(const Hierarchy& h, const Matrix4f& root, std::vector<Matrix4f>& scratch, Matrix4f* pTransforms, Matrix4f* pNormalTransforms,
+    bool affine = true)
+{
+    const size_t count = h.flatNodes.size();
+
+    scratch.resize(count * 2);
+    Matrix4f* pWorld = scratch.data();
+    Matrix4f* pNormals = pWorld + count;
+
+    CalcHierarchyMatrices(h.pose, h.flatParents, root, root, pWorld, pNormals);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        int nodeIdx = h.flatNodes[i];
+        pTransforms[nodeIdx] = h.invBind[nodeIdx] * pWorld[i];
+        pNormalTransforms[nodeIdx] = affine ? (h.invBind[nodeIdx] * pNormals[i]).NormalMatrix() : (h.invBind[nodeIdx] * pNormals[i]).Inverse().Transpose();
+    }
+}
+
+float MaxDiff(const std::vector<Matrix4f>& a, const std::vector<Matrix4f>& b)
+{
+    float maxDiff = 0.0f;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        for (int j = 0; j < 16; j++)
+        {
+            maxDiff = std::max(maxDiff, fabsf(a[i].m[j] - b[i].m[j]) / std::max(1.0f, fabsf(b[i].m[j])));
+        }
+    }
+    return maxDiff;
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int totalNodes = quick ? 4096 : 1 << 20;
+    const int repeats = quick ? 1 : 5;
+
+    std::mt19937 random(1234);
+
+    Matrix4f root;
+    root.m[0] = -1.0f;
+
+    printf("%-8s %10s %14s %14s %9s\n", "nodes", "instances", "recursive ns", "flat ns", "speedup");
+
+    const int nodeCounts[] = { 16, 64, 256, 4096 };
+    for (int nodeCount : nodeCounts)
+    {
+        Hierarchy h = BuildHierarchy(nodeCount, random);
+        const int instances = std::max(1, totalNodes / nodeCount);
+
+        std::vector<Matrix4f> recursive(nodeCount * 2);
+        std::vector<Matrix4f> flat(nodeCount * 2);
+        std::vector<Matrix4f> scratch;
+
+        double recursiveMs = Test::MeasureMs(repeats, [&]()
+        {
+            for (int i = 0; i < instances; i++)
+            {
+                UpdateRecursive(h, 0, root, root, recursive.data(), recursive.data() + nodeCount);
+            }
+        });
+        double flatMs = Test::MeasureMs(repeats, [&]()
+        {
+            for (int i = 0; i < instances; i++)
+            {
+                UpdateFlat(h, root, scratch, flat.data(), flat.data() + nodeCount);
+            }
+        });
+        Test::KeepAlive(recursive);
+        Test::KeepAlive(flat);
+
+        // Local matrix is built without matrix products, so results match within rounding
+        TEST_CHECK(MaxDiff(flat, recursive) < 0.001f);
+
+        double nodesDone = (double)instances * nodeCount;
+        printf("%-8d %10d %14.2f %14.2f %8.2fx\n", nodeCount, instances, recursiveMs * 1000000.0 / nodesDone, flatMs * 1000000.0 / nodesDone, recursiveMs / flatMs);
+    }
+
+    // Whole skeleton update of MechDrone size, normal matrices by affine path and by general inverse
+    const int SkeletonNodes = 68;
+    Hierarchy skeleton = BuildHierarchy(SkeletonNodes, random);
+    for (int i = 0; i < SkeletonNodes; i++)
+    {
+        skeleton.pose.scale[i] = i % 3 == 0 ? Point3f(1.0f, 2.0f, 1.0f) : Point3f(1.5f, 1.5f, 1.5f);
+    }
+    const int skeletons = std::max(1, totalNodes / SkeletonNodes);
+
+    std::vector<Matrix4f> affine(SkeletonNodes * 2);
+    std::vector<Matrix4f> general(SkeletonNodes * 2);
+    std::vector<Matrix4f> scratch;
+
+    double affineMs = Test::MeasureMs(repeats, [&]()
+    {
+        for (int i = 0; i < skeletons; i++)
+        {
+            UpdateFlat(skeleton, root, scratch, affine.data(), affine.data() + SkeletonNodes, true);
+        }
+    });
+    double generalMs = Test::MeasureMs(repeats, [&]()
+    {
+        for (int i = 0; i < skeletons; i++)
+        {
+            UpdateFlat(skeleton, root, scratch, general.data(), general.data() + SkeletonNodes, false);
+        }
+    });
+    Test::KeepAlive(affine);
+    Test::KeepAlive(general);
+
+    TEST_CHECK(MaxDiff(affine, general) < 0.001f);
+
+    printf("\n%s, %d node skeleton, ns per skeleton update\n", SIMD::GetName(), SkeletonNodes);
+    printf("%-10s %14s %14s %9s\n", "skeletons", "affine ns", "inverse ns", "speedup");
+    printf("%-10d %14.1f %14.1f %8.2fx\n", skeletons, affineMs * 1000000.0 / skeletons, generalMs * 1000000.0 / skeletons, generalMs / affineMs);
+
+    return Test::Result("hierarchy_bench");
+}
@@ -0,0 +1,187 @@
+#include "stdafx.h"
+
+#include <random>
+#include <thread>
+
+#include "PlatformImageDecodeQueue.h"
+#include "PlatformMips.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Decode time of model images vs decode pool thread count, with upload loop of ModelLoader
+namespace
+{
+
+void AppendBytes(void* pContext, void* pData, int size)
+{
+    std::vector<UINT8>* pEncoded = static_cast<std::vector<UINT8>*>(pContext);
+    pEncoded->insert(pEncoded->end(), static_cast<UINT8*>(pData), static_cast<UINT8*>(pData) + size);
+}
+
+// Texture alike content, smooth gradients with noise, odd images are PNG, even are JPEG as in sample models
+std::vector<std::vector<UINT8>> EncodeImages(size_t count, int size, std::mt19937& random)
+{
+    std::uniform_int_distribution<int> noise(0, 15);
+
+    std::vector<std::vector<UINT8>> images(count);
+    std::vector<UINT8> pixels((size_t)size * size * 4);
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                UINT8* pPixel = &pixels[((size_t)y * size + x) * 4];
+                pPixel[0] = (UINT8)((x * 255 / size + noise(random)) & 0xff);
+                pPixel[1] = (UINT8)((y * 255 / size + noise(random)) & 0xff);
+                pPixel[2] = (UINT8)(((x + y) * 127 / size + (int)i * 16) & 0xff);
+                pPixel[3] = 255;
+            }
+        }
+        if (i % 2 == 1)
+        {
+            stbi_write_png_to_func(AppendBytes, &images[i], size, size, 4, pixels.data(), size * 4);
+        }
+        else
+        {
+            stbi_write_jpg_to_func(AppendBytes, &images[i], size, size, 4, pixels.data(), 90);
+        }
+    }
+
+    return images;
+}
+
+// Same as ModelLoader::DecodeImage
+void DecodeImage(const std::vector<UINT8>& encoded, DecodedImage& image)
+{
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    stbi_uc* pPixels = stbi_load_from_memory(encoded.data(), (int)encoded.size(), &width, &height, &components, 4);
+    if (pPixels == nullptr)
+    {
+        return;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(CalcTextureSizeWithMips(image.width, image.height, MipPixelFormatRGBA8SRGB, image.mips));
+    memcpy(image.pixels.data(), pPixels, (size_t)width * height * 4);
+
+    stbi_image_free(pPixels);
+
+    GenerateTextureMips(image.pixels.data(), image.width, image.height, MipPixelFormatRGBA8SRGB, image.mips);
+}
+
+UINT64 CalcChecksum(const std::vector<UINT8>& pixels)
+{
+    UINT64 sum = 0;
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        sum = sum * 31 + pixels[i];
+    }
+    return sum;
+}
+
+// Same as ModelLoader::ProcessModelLoad, one image is taken per call, render thread polls for ready ones
+std::vector<UINT64> DecodeAll(ThreadPool& pool, const std::vector<std::vector<UINT8>>& images)
+{
+    std::vector<UINT64> checksums(images.size(), 0);
+
+    ImageDecodeQueue queue;
+    queue.Start(&pool, images.size(), [&images](size_t imageIdx, DecodedImage& image)
+    {
+        DecodeImage(images[imageIdx], image);
+    });
+
+    size_t loaded = 0;
+    while (loaded < images.size())
+    {
+        DecodedImage image;
+        if (queue.Pop(image))
+        {
+            TEST_CHECK(!image.pixels.empty() && checksums[image.imageIdx] == 0);
+            checksums[image.imageIdx] = CalcChecksum(image.pixels);
+            ++loaded;
+
+            queue.Queue();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    queue.Wait();
+    queue.Clear();
+
+    return checksums;
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const size_t imageCount = quick ? 4 : 16;
+    const int imageSize = quick ? 64 : 2048;
+
+    std::mt19937 random(1234);
+    std::vector<std::vector<UINT8>> images = EncodeImages(imageCount, imageSize, random);
+
+    size_t encodedBytes = 0;
+    for (const auto& image : images)
+    {
+        encodedBytes += image.size();
+    }
+
+    std::vector<size_t> threadCounts;
+    const size_t hwThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t threads = 1; threads < hwThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hwThreads);
+    if (quick && hwThreads == 1)
+    {
+        // Still runs pool code path
+        threadCounts.push_back(2);
+    }
+
+    printf("%zu images %dx%d, %.2f MB encoded, %zu hardware threads\n", imageCount, imageSize, imageSize, encodedBytes / 1048576.0, hwThreads);
+    printf("%8s %10s %12s %9s\n", "threads", "ms", "ms/image", "scaling");
+
+    double singleMs = 0.0;
+    std::vector<UINT64> reference;
+    for (size_t threads : threadCounts)
+    {
+        // Pool without workers decodes in place, as loader without decode pool does
+        ThreadPool pool;
+        if (threads > 1)
+        {
+            pool.Init(threads - 1);
+        }
+
+        std::vector<UINT64> checksums;
+        double ms = Test::MeasureMs(quick ? 1 : 3, [&]() { checksums = DecodeAll(pool, images); });
+
+        pool.Term();
+
+        if (reference.empty())
+        {
+            singleMs = ms;
+            reference = checksums;
+        }
+        TEST_CHECK(checksums == reference);
+
+        printf("%8zu %10.2f %12.2f %8.2fx\n", threads, ms, ms / imageCount, singleMs / ms);
+    }
+
+    return Test::Result("image_decode_bench");
+}
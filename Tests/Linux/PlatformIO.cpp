@@ -0,0 +1,71 @@
+#include "stdafx.h"
+#include "PlatformIO.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// POSIX implementation of MappedFile for Linux test targets, file descriptor is kept in place of file handle
+namespace Platform
+{
+
+MappedFile::MappedFile()
+    : m_hFile(nullptr)
+    , m_hMapping(nullptr)
+    , m_pData(nullptr)
+    , m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(LPCTSTR filename)
+{
+    Close();
+
+    int fd = open(filename, O_RDONLY);
+    bool res = fd != -1;
+    if (res)
+    {
+        m_hFile = (HANDLE)(intptr_t)(fd + 1);
+
+        struct stat st;
+        res = fstat(fd, &st) == 0;
+        m_size = res ? (size_t)st.st_size : 0;
+    }
+    // Empty file cannot be mapped, but it is still valid
+    if (res && m_size > 0)
+    {
+        void* pData = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        res = pData != MAP_FAILED;
+        m_pData = res ? static_cast<const char*>(pData) : nullptr;
+    }
+
+    if (!res)
+    {
+        Close();
+    }
+
+    return res;
+}
+
+void MappedFile::Close()
+{
+    if (m_pData != nullptr)
+    {
+        munmap(const_cast<char*>(m_pData), m_size);
+        m_pData = nullptr;
+    }
+    if (m_hFile != nullptr)
+    {
+        close((int)(intptr_t)m_hFile - 1);
+        m_hFile = nullptr;
+    }
+    m_size = 0;
+}
+
+} // Platform
@@ -0,0 +1,77 @@
+#pragma once
+
+// Replacement of projects' precompiled headers for Linux test targets.
+// Sources are copied out of their folders by CMake, so "stdafx.h" resolves here
+// and device-free code compiles without Windows SDK
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+typedef unsigned char BYTE;
+typedef unsigned char UINT8;
+typedef unsigned short UINT16;
+typedef int INT;
+typedef unsigned int UINT;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int64_t INT64;
+typedef uint32_t DWORD;
+
+typedef void* HANDLE;
+
+typedef char TCHAR;
+typedef const char* LPCSTR;
+typedef const char* LPCTSTR;
+
+#define _T(x) x
+
+#define OutputDebugString(str) fputs(str, stderr)
+
+#define _tfopen fopen
+#define _stprintf_s(buffer, ...) snprintf(buffer, sizeof(buffer), __VA_ARGS__)
+
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+
+inline DWORD GetFileAttributes(LPCTSTR filename)
+{
+    struct stat st;
+    return stat(filename, &st) == 0 ? (DWORD)st.st_mode : INVALID_FILE_ATTRIBUTES;
+}
+
+inline int CreateDirectory(LPCTSTR path, void*)
+{
+    return mkdir(path, 0755) == 0;
+}
+
+inline unsigned char _BitScanReverse(DWORD* pIndex, DWORD mask)
+{
+    if (mask == 0)
+    {
+        return 0;
+    }
+    *pIndex = 31 - __builtin_clz(mask);
+    return 1;
+}
+
+inline unsigned char _BitScanForward(DWORD* pIndex, DWORD mask)
+{
+    if (mask == 0)
+    {
+        return 0;
+    }
+    *pIndex = __builtin_ctz(mask);
+    return 1;
+}
+
+#include "PlatformApi.h"
@@ -0,0 +1,124 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformMatrix.h"
+
+#include "TestUtil.h"
+
+namespace
+{
+
+struct BenchData
+{
+    std::vector<Matrix4f> a;
+    std::vector<Matrix4f> b;
+    std::vector<Matrix4f> res;
+    std::vector<Point4f> points;
+    std::vector<Point4f> resPoints;
+};
+
+// Nanoseconds per call of func(i) over whole data set
+template <typename Func>
+double MeasureNs(size_t count, int repeats, Func func)
+{
+    double ms = Test::MeasureMs(repeats, [&]()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            func(i);
+        }
+    });
+    return ms * 1000000.0 / count;
+}
+
+void Report(const char* name, double simdNs, double scalarNs)
+{
+    printf("%-12s %10.2f %10.2f %8.2fx\n", name, simdNs, scalarNs, scalarNs / simdNs);
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const size_t count = Test::IsQuick(argc, argv) ? 1024 : 1 << 16;
+    const int repeats = Test::IsQuick(argc, argv) ? 1 : 20;
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+
+    BenchData data;
+    data.a.resize(count);
+    data.b.resize(count);
+    data.res.resize(count);
+    data.points.resize(count);
+    data.resPoints.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int j = 0; j < 16; j++)
+        {
+            data.a[i].m[j] = dist(random);
+            data.b[i].m[j] = dist(random);
+        }
+        data.points[i] = Point4f(dist(random), dist(random), dist(random), 1.0f);
+    }
+
+    printf("SIMD: %s, %zu matrices\n", SIMD::GetName(), count);
+    printf("%-12s %10s %10s %9s\n", "ns/op", "SIMD", "scalar", "speedup");
+
+    double simd = MeasureNs(count, repeats, [&](size_t i) { Matrix4Kernel<float>::Multiply(data.a[i].m, data.b[i].m, data.res[i].m); });
+    double scalar = MeasureNs(count, repeats, [&](size_t i) { Matrix4Scalar<float>::Multiply(data.a[i].m, data.b[i].m, data.res[i].m); });
+    Test::KeepAlive(data.res);
+    Report("Multiply", simd, scalar);
+
+    simd = MeasureNs(count, repeats, [&](size_t i) { Matrix4Kernel<float>::Inverse(data.a[i].m, data.res[i].m); });
+    scalar = MeasureNs(count, repeats, [&](size_t i) { Matrix4Scalar<float>::Inverse(data.a[i].m, data.res[i].m); });
+    Test::KeepAlive(data.res);
+    Report("Inverse", simd, scalar);
+
+    simd = MeasureNs(count, repeats, [&](size_t i) { Matrix4Kernel<float>::Transform(data.a[i].m, &data.points[i].x, &data.resPoints[i].x); });
+    scalar = MeasureNs(count, repeats, [&](size_t i) { Matrix4Scalar<float>::Transform(data.a[i].m, &data.points[i].x, &data.resPoints[i].x); });
+    Test::KeepAlive(data.resPoints);
+    Report("Transform", simd, scalar);
+
+    simd = MeasureNs(count, repeats, [&](size_t i) { Matrix4Kernel<float>::Transpose(data.a[i].m, data.res[i].m); });
+    scalar = MeasureNs(count, repeats, [&](size_t i) { Matrix4Scalar<float>::Transpose(data.a[i].m, data.res[i].m); });
+    Test::KeepAlive(data.res);
+    Report("Transpose", simd, scalar);
+
+    // Affine matrices: rotation * scale + translation, half of them with uniform scale
+    for (size_t i = 0; i < count; i++)
+    {
+        Point3f axis{ dist(random), dist(random), dist(random) };
+        axis.normalize();
+
+        Matrix4f rotation;
+        rotation.Rotation(dist(random), axis);
+        Matrix4f scale;
+        float s = 1.0f + fabsf(dist(random));
+        scale.Scale(s, i % 2 == 0 ? s : s * 2.0f, s);
+        Matrix4f offset;
+        offset.Offset({ dist(random), dist(random), dist(random) });
+
+        data.a[i] = scale * rotation * offset;
+    }
+
+    simd = MeasureNs(count, repeats, [&](size_t i) { Matrix4Kernel<float>::NormalMatrix(data.a[i].m, data.res[i].m); });
+    scalar = MeasureNs(count, repeats, [&](size_t i) { Matrix4Scalar<float>::NormalMatrix(data.a[i].m, data.res[i].m); });
+    Test::KeepAlive(data.res);
+    Report("NormalMatrix", simd, scalar);
+
+    printf("\n%-14s %10s %10s %9s\n", "ns/op", "affine", "general", "speedup");
+
+    double affine = MeasureNs(count, repeats, [&](size_t i) { data.res[i] = data.a[i].AffineInverse(); });
+    double general = MeasureNs(count, repeats, [&](size_t i) { data.res[i] = data.a[i].Inverse(); });
+    Test::KeepAlive(data.res);
+    printf("%-14s %10.2f %10.2f %8.2fx\n", "Inverse", affine, general, general / affine);
+
+    affine = MeasureNs(count, repeats, [&](size_t i) { data.res[i] = data.a[i].NormalMatrix(); });
+    general = MeasureNs(count, repeats, [&](size_t i) { data.res[i] = data.a[i].Inverse().Transpose(); });
+    Test::KeepAlive(data.res);
+    printf("%-14s %10.2f %10.2f %8.2fx\n", "NormalMatrix", affine, general, general / affine);
+
+    return 0;
+}
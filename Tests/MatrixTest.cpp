@@ -0,0 +1,208 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformMatrix.h"
+
+#include "TestUtil.h"
+
+namespace
+{
+
+std::mt19937 s_random(1234);
+
+float RandomFloat(float low, float high)
+{
+    return std::uniform_real_distribution<float>(low, high)(s_random);
+}
+
+Matrix4f RandomMatrix()
+{
+    Matrix4f m;
+    for (int i = 0; i < 16; i++)
+    {
+        m.m[i] = RandomFloat(-2.0f, 2.0f);
+    }
+    return m;
+}
+
+// rotation * scale + translation
+Matrix4f RandomAffine(bool uniformScale)
+{
+    Point3f axis{ RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f) };
+    axis.normalize();
+
+    Matrix4f rotation;
+    rotation.Rotation(RandomFloat(0.0f, 6.28f), axis);
+
+    float s = RandomFloat(0.1f, 10.0f);
+    Matrix4f scale;
+    if (uniformScale)
+    {
+        scale.Scale(s, s, s);
+    }
+    else
+    {
+        scale.Scale(s, RandomFloat(0.1f, 10.0f), RandomFloat(0.1f, 10.0f));
+    }
+
+    Matrix4f offset;
+    offset.Offset({ RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f) });
+
+    return scale * rotation * offset;
+}
+
+float MaxRelDiff(const float* a, const float* b, int count)
+{
+    float maxDiff = 0.0f;
+    for (int i = 0; i < count; i++)
+    {
+        float scale = std::max(1.0f, std::max(fabsf(a[i]), fabsf(b[i])));
+        maxDiff = std::max(maxDiff, fabsf(a[i] - b[i]) / scale);
+    }
+    return maxDiff;
+}
+
+bool IsIdentity(const Matrix4f& m, float eps)
+{
+    Matrix4f identity;
+    return MaxRelDiff(m.m, identity.m, 16) <= eps;
+}
+
+// SIMD kernels evaluate products in same order as reference ones
+void TestMultiplyTransform()
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        Matrix4f a = RandomMatrix();
+        Matrix4f b = RandomMatrix();
+
+        float simd[16];
+        float scalar[16];
+        Matrix4Kernel<float>::Multiply(a.m, b.m, simd);
+        Matrix4Scalar<float>::Multiply(a.m, b.m, scalar);
+        TEST_CHECK(memcmp(simd, scalar, sizeof(simd)) == 0);
+
+        Matrix4Kernel<float>::Transpose(a.m, simd);
+        Matrix4Scalar<float>::Transpose(a.m, scalar);
+        TEST_CHECK(memcmp(simd, scalar, sizeof(simd)) == 0);
+
+        float p[4] = { RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), 1.0f };
+        Matrix4Kernel<float>::Transform(a.m, p, simd);
+        Matrix4Scalar<float>::Transform(a.m, p, scalar);
+        TEST_CHECK(memcmp(simd, scalar, 4 * sizeof(float)) == 0);
+    }
+}
+
+void TestInverse()
+{
+    float maxDiff = 0.0f;
+    for (int i = 0; i < 1000; i++)
+    {
+        Matrix4f m = i % 2 == 0 ? RandomMatrix() : RandomAffine(false);
+
+        float simd[16];
+        float scalar[16];
+        Matrix4Scalar<float>::Inverse(m.m, scalar);
+        Matrix4Kernel<float>::Inverse(m.m, simd);
+
+        // Random matrices may be badly conditioned, only well conditioned ones are compared
+        Matrix4f inv;
+        memcpy(inv.m, scalar, sizeof(scalar));
+        if (IsIdentity(m * inv, 0.0001f))
+        {
+            maxDiff = std::max(maxDiff, MaxRelDiff(simd, scalar, 16));
+        }
+    }
+    printf("Inverse max SIMD-scalar difference: %g\n", maxDiff);
+    TEST_CHECK(maxDiff < 0.001f);
+
+    // Degenerate matrix gives unscaled adjugate on both paths
+    Matrix4f singular = RandomMatrix();
+    for (int i = 0; i < 4; i++)
+    {
+        singular.m[4 + i] = singular.m[i] * 2.0f;
+    }
+    float simd[16];
+    float scalar[16];
+    Matrix4Scalar<float>::Inverse(singular.m, scalar);
+    Matrix4Kernel<float>::Inverse(singular.m, simd);
+    TEST_CHECK(MaxRelDiff(simd, scalar, 16) < 0.001f);
+}
+
+void TestAffineInverse()
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        bool uniform = i % 2 == 0;
+        Matrix4f m = RandomAffine(uniform);
+        TEST_CHECK(!uniform || m.IsUniformScale());
+
+        Matrix4f inv = m.Inverse();
+        Matrix4f affineInv = m.AffineInverse();
+        TEST_CHECK(IsIdentity(m * affineInv, 0.0001f));
+        TEST_CHECK(MaxRelDiff(inv.m, affineInv.m, 16) < 0.0001f);
+
+        Matrix4f normal = m.NormalMatrix();
+        Matrix4f invTrans = inv.Transpose();
+        TEST_CHECK(MaxRelDiff(normal.m, invTrans.m, 16) < 0.0001f);
+    }
+
+    // Uniform and general paths share degenerate threshold on determinant
+    const float scales[] = { 0.01f, 0.02f, 0.03f, 1.0f };
+    for (float s : scales)
+    {
+        Matrix4f m;
+        m.Scale(s, s, s);
+        TEST_CHECK(m.IsUniformScale());
+
+        Matrix4f inv = m.Inverse();
+        Matrix4f affineInv = m.AffineInverse();
+        TEST_CHECK(MaxRelDiff(inv.m, affineInv.m, 16) < 0.0001f);
+    }
+
+    // SIMD kernels take cofactor path for uniform scale too, so they match scalar ones within rounding
+    float maxDiff = 0.0f;
+    for (int i = 0; i < 1000; i++)
+    {
+        Matrix4f m = RandomAffine(i % 2 == 0);
+
+        float simd[16];
+        float scalar[16];
+        Matrix4Kernel<float>::AffineInverse(m.m, simd);
+        Matrix4Scalar<float>::AffineInverse(m.m, scalar);
+        maxDiff = std::max(maxDiff, MaxRelDiff(simd, scalar, 16));
+
+        Matrix4Kernel<float>::NormalMatrix(m.m, simd);
+        Matrix4Scalar<float>::NormalMatrix(m.m, scalar);
+        maxDiff = std::max(maxDiff, MaxRelDiff(simd, scalar, 16));
+    }
+    printf("Affine inverse max SIMD-scalar difference: %g\n", maxDiff);
+    TEST_CHECK(maxDiff < 0.0001f);
+
+    // Degenerate matrix gives unscaled cofactors and determinant in m[15] on both paths
+    Matrix4f flat;
+    flat.Scale(2.0f, 0.0f, 3.0f);
+    flat.m[12] = 5.0f;
+    float simd[16];
+    float scalar[16];
+    Matrix4Kernel<float>::AffineInverse(flat.m, simd);
+    Matrix4Scalar<float>::AffineInverse(flat.m, scalar);
+    TEST_CHECK(MaxRelDiff(simd, scalar, 16) == 0.0f && scalar[15] == 0.0f);
+    Matrix4Kernel<float>::NormalMatrix(flat.m, simd);
+    Matrix4Scalar<float>::NormalMatrix(flat.m, scalar);
+    TEST_CHECK(MaxRelDiff(simd, scalar, 16) == 0.0f && scalar[15] == 0.0f);
+}
+
+} // anonymous
+
+int main()
+{
+    printf("SIMD: %s\n", SIMD::GetName());
+
+    TestMultiplyTransform();
+    TestInverse();
+    TestAffineInverse();
+
+    return Test::Result("matrix_test");
+}
@@ -0,0 +1,279 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformMips.h"
+#include "PlatformSIMD.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Mip chain generation throughput on 4K images for every supported format
+namespace
+{
+
+struct FormatInfo
+{
+    MipPixelFormat format;
+    const char* name;
+    UINT pixelSize;
+};
+
+const FormatInfo Formats[] = {
+    { MipPixelFormatRGBA8, "RGBA8", 4 },
+    { MipPixelFormatRGBA8SRGB, "RGBA8_SRGB", 4 },
+    { MipPixelFormatRGBA16F, "RGBA16F", 8 },
+    { MipPixelFormatRGBA32F, "RGBA32F", 16 }
+};
+
+UINT16 HalfOf(float value)
+{
+    // Values used here are exact in half, [0, 1] range with 1/256 step
+    UINT32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (value == 0.0f)
+    {
+        return 0;
+    }
+    return (UINT16)((((bits >> 23) & 0xFF) - 112) << 10 | ((bits >> 13) & 0x3FF));
+}
+
+void FillLevel(std::vector<UINT8>& data, UINT width, UINT height, const FormatInfo& info, std::mt19937& random, bool uniform)
+{
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (size_t i = 0; i < (size_t)width * height * 4; i++)
+    {
+        int value = uniform ? (int)(i % 4) * 60 + 10 : dist(random);
+        switch (info.pixelSize)
+        {
+            case 4:
+                data[i] = (UINT8)value;
+                break;
+
+            case 8:
+            {
+                UINT16 half = HalfOf(value / 256.0f);
+                memcpy(&data[i * 2], &half, sizeof(half));
+                break;
+            }
+
+            case 16:
+            {
+                float f = value / 256.0f;
+                memcpy(&data[i * 4], &f, sizeof(f));
+                break;
+            }
+        }
+    }
+}
+
+// Uniform image keeps its color on every level, 3x3 folded odd tails included
+void TestUniform(const FormatInfo& info, UINT width, UINT height)
+{
+    std::mt19937 random(1);
+
+    UINT mips = 0;
+    std::vector<UINT8> data(CalcTextureSizeWithMips(width, height, info.format, mips));
+    FillLevel(data, width, height, info, random, true);
+    GenerateTextureMips(data.data(), width, height, info.format, mips);
+
+    bool equal = true;
+    for (size_t offset = 0; offset < data.size() && equal; offset += info.pixelSize)
+    {
+        equal = memcmp(&data[offset], &data[0], info.pixelSize) == 0;
+    }
+    TEST_CHECK(equal);
+}
+
+float HalfToFloat(UINT16 h)
+{
+    const int exponent = (h >> 10) & 0x1F;
+    const float mantissa = (float)(h & 0x3FF);
+    const float value = exponent == 0 ? ldexpf(mantissa, -24) : ldexpf(mantissa + 1024.0f, exponent - 25);
+    return h & 0x8000 ? -value : value;
+}
+
+double SRGBToLinear(double value)
+{
+    return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+}
+
+double LinearToSRGB(double value)
+{
+    return value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+}
+
+// Every 2x2 block of the first level has single value, so the next level keeps it: every 8-bit code,
+// and every half except NaNs go through conversion both ways. 32-bit floats are not converted
+void TestBlocks(const FormatInfo& info)
+{
+    if (info.pixelSize == 16)
+    {
+        return;
+    }
+
+    const UINT blockCount = info.pixelSize == 8 ? 0x10000 / 4 : 256;
+    const UINT width = blockCount * 2;
+
+    std::vector<UINT8> data((size_t)width * 2 * info.pixelSize + blockCount * info.pixelSize);
+    std::vector<UINT8> blocks(blockCount * info.pixelSize);
+    for (UINT i = 0; i < blockCount; i++)
+    {
+        for (UINT c = 0; c < 4; c++)
+        {
+            if (info.pixelSize == 8)
+            {
+                UINT16 half = (UINT16)(i * 4 + c);
+                half = (half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0 ? 0 : half;
+                memcpy(&blocks[i * 8 + c * 2], &half, sizeof(half));
+            }
+            else
+            {
+                blocks[i * 4 + c] = (UINT8)i;
+            }
+        }
+    }
+
+    for (UINT y = 0; y < 2; y++)
+    {
+        for (UINT x = 0; x < width; x++)
+        {
+            memcpy(&data[((size_t)y * width + x) * info.pixelSize], &blocks[x / 2 * info.pixelSize], info.pixelSize);
+        }
+    }
+    GenerateTextureMips(data.data(), width, 2, info.format, 2);
+
+    TEST_CHECK(memcmp(&data[(size_t)width * 2 * info.pixelSize], blocks.data(), blocks.size()) == 0);
+}
+
+// Random image against box filter in double, 8-bit results are within one code,
+// so SIMD sRGB conversion can round differently right at halfway between codes
+void TestReference(const FormatInfo& info)
+{
+    const UINT width = 67;
+    const UINT height = 33;
+    std::mt19937 random(5);
+
+    UINT mips = 0;
+    std::vector<UINT8> data(CalcTextureSizeWithMips(width, height, info.format, mips));
+    FillLevel(data, width, height, info, random, false);
+
+    std::vector<double> src((size_t)width * height * 4);
+    for (size_t i = 0; i < src.size(); i++)
+    {
+        switch (info.pixelSize)
+        {
+            case 4:
+                src[i] = data[i] / 255.0;
+                src[i] = info.format == MipPixelFormatRGBA8SRGB && i % 4 != 3 ? SRGBToLinear(src[i]) : src[i];
+                break;
+
+            case 8:
+            {
+                UINT16 half;
+                memcpy(&half, &data[i * 2], sizeof(half));
+                src[i] = HalfToFloat(half);
+                break;
+            }
+
+            case 16:
+            {
+                float f;
+                memcpy(&f, &data[i * 4], sizeof(f));
+                src[i] = f;
+                break;
+            }
+        }
+    }
+
+    GenerateTextureMips(data.data(), width, height, info.format, 2);
+
+    const UINT dstWidth = width / 2;
+    const UINT dstHeight = height / 2;
+    const UINT8* pDst = &data[(size_t)width * height * info.pixelSize];
+    for (UINT y = 0; y < dstHeight; y++)
+    {
+        for (UINT x = 0; x < dstWidth; x++)
+        {
+            // Odd sizes fold extra row and column into the last pixel
+            const UINT countX = x == dstWidth - 1 ? width - x * 2 : 2;
+            const UINT countY = y == dstHeight - 1 ? height - y * 2 : 2;
+            for (UINT c = 0; c < 4; c++)
+            {
+                double sum = 0.0;
+                for (UINT j = 0; j < countY; j++)
+                {
+                    for (UINT k = 0; k < countX; k++)
+                    {
+                        sum += src[(((size_t)y * 2 + j) * width + x * 2 + k) * 4 + c];
+                    }
+                }
+                const double ref = sum / (countX * countY);
+
+                const size_t idx = ((size_t)y * dstWidth + x) * 4 + c;
+                switch (info.pixelSize)
+                {
+                    case 4:
+                    {
+                        const double code = (info.format == MipPixelFormatRGBA8SRGB && c != 3 ? LinearToSRGB(ref) : ref) * 255.0;
+                        TEST_CHECK(fabs(pDst[idx] - code) <= 1.0);
+                        break;
+                    }
+
+                    case 8:
+                    {
+                        UINT16 half;
+                        memcpy(&half, &pDst[idx * 2], sizeof(half));
+                        TEST_CHECK(fabs(HalfToFloat(half) - ref) <= ref / 1024.0 + 1e-7);
+                        break;
+                    }
+
+                    case 16:
+                    {
+                        float f;
+                        memcpy(&f, &pDst[idx * 4], sizeof(f));
+                        TEST_CHECK(fabs(f - ref) <= ref * 1e-6);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const UINT size = quick ? 256 : 4096;
+    const int repeats = quick ? 1 : 5;
+
+    for (const auto& info : Formats)
+    {
+        TestUniform(info, 37, 21);
+        TestUniform(info, 64, 64);
+        TestBlocks(info);
+        TestReference(info);
+    }
+
+    printf("%s, %ux%u input\n", SIMD::GetName(), size, size);
+    printf("%-12s %6s %10s %12s %12s\n", "format", "mips", "ms", "MB/s in", "Mpix/s in");
+
+    std::mt19937 random(1234);
+    for (const auto& info : Formats)
+    {
+        UINT mips = 0;
+        std::vector<UINT8> data(CalcTextureSizeWithMips(size, size, info.format, mips));
+        FillLevel(data, size, size, info, random, false);
+
+        double ms = Test::MeasureMs(repeats, [&]() { GenerateTextureMips(data.data(), size, size, info.format, mips); });
+        Test::KeepAlive(data);
+
+        double inputMB = (double)size * size * info.pixelSize / 1048576.0;
+        printf("%-12s %6u %10.2f %12.1f %12.1f\n", info.name, mips, ms, inputMB * 1000.0 / ms, (double)size * size / 1000.0 / ms);
+    }
+
+    return Test::Result("mip_bench");
+}
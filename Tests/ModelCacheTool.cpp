@@ -0,0 +1,400 @@
+#include "stdafx.h"
+
+#include "PlatformIO.h"
+#include "PlatformModelCache.h"
+#include "PlatformUtil.h"
+
+#include "tiny_gltf.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Builds, validates and times model caches without device.
+// Cold load parses glTF and writes cache, as ModelLoader does on the first run, warm load reads it back
+namespace
+{
+
+const char* CacheFolder = "ModelCacheTest";
+
+// Same vertex layouts as ModelLoader::CreatePrimitive expects
+const UINT32 VertexStride = 48;
+const UINT32 SkinnedVertexStride = 72;
+
+ModelCacheOptions GetOptions()
+{
+    ModelCacheOptions options;
+    options.animationRotationTolerance = AnimationRotationTolerance;
+    options.animationRangeTolerance = AnimationRangeTolerance;
+    return options;
+}
+
+// Cold load, parses glTF, builds model description and writes cache
+bool BuildCache(const std::string& modelFilename, const ModelCacheOptions& options, GLTFModelDesc& model, GLTFModelData& data)
+{
+    tinygltf::Model source;
+    bool res = LoadGLTFSource(modelFilename, source);
+    res = res && ScanGLTFSource(source, modelFilename, options, model, data);
+    res = res && SaveModelCache(GetModelCacheFilename(CacheFolder, modelFilename), modelFilename, options, model, data);
+    return res;
+}
+
+// Warm load, validates cache and maps streams
+bool LoadCache(const std::string& modelFilename, const ModelCacheOptions& options, GLTFModelDesc& model, GLTFModelData& data)
+{
+    bool res = LoadModelCache(GetModelCacheFilename(CacheFolder, modelFilename), modelFilename, options, model, data);
+    if (res)
+    {
+        model.BuildHierarchy();
+    }
+    return res;
+}
+
+bool SameStream(const GLTFModelData::Stream& a, const GLTFModelData::Stream& b)
+{
+    return a.GetSize() == b.GetSize() && memcmp(a.GetData(), b.GetData(), a.GetSize()) == 0;
+}
+
+template <typename T>
+bool SameBytes(const T& a, const T& b)
+{
+    return memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+template <typename T>
+bool SameVector(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+// Model description is consistent: indices are within their arrays, streams match vertex layouts
+void ValidateModel(const GLTFModelDesc& model, const GLTFModelData& data)
+{
+    TEST_CHECK(model.nodes.size() <= MAX_NODES);
+    TEST_CHECK(model.rootNodeIdx >= 0 && model.rootNodeIdx < (int)model.nodes.size());
+    TEST_CHECK(model.nodeInvBindMatrices.size() == model.nodes.size());
+    TEST_CHECK(model.flatNodes.size() == model.flatParents.size() && model.flatNodes.size() <= model.nodes.size());
+    for (const auto& node : model.nodes)
+    {
+        for (int child : node.children)
+        {
+            TEST_CHECK(child >= 0 && child < (int)model.nodes.size());
+        }
+    }
+
+    TEST_CHECK(model.skinned == !model.jointIndices.empty());
+    for (int joint : model.jointIndices)
+    {
+        TEST_CHECK(joint >= 0 && joint < (int)model.nodes.size());
+    }
+
+    for (const auto& sampler : model.animationSamplers)
+    {
+        // Source keys are released after compression
+        TEST_CHECK(sampler.keys.empty());
+        TEST_CHECK(sampler.packedKeys.size() == sampler.timeKeys.size() * 3);
+        TEST_CHECK(!sampler.timeKeys.empty() && sampler.timeKeys.front() >= model.minAnimationTime && sampler.timeKeys.back() <= model.maxAnimationTime);
+        TEST_CHECK(std::is_sorted(sampler.timeKeys.begin(), sampler.timeKeys.end()));
+    }
+    for (const auto& channel : model.animationChannels)
+    {
+        TEST_CHECK(channel.animSamplerIdx >= 0 && channel.animSamplerIdx < (int)model.animationSamplers.size());
+        TEST_CHECK(channel.flatNodeIdx != -1);
+    }
+
+    for (const auto& prim : data.primitives)
+    {
+        const bool skinned = (prim.flags & GLTFModelData::PrimitiveSkinned) != 0;
+        TEST_CHECK(prim.vertexStride == (skinned ? SkinnedVertexStride : VertexStride));
+        TEST_CHECK(prim.vertices.GetSize() % prim.vertexStride == 0);
+        TEST_CHECK(prim.indexSize == sizeof(UINT16) || prim.indexSize == sizeof(UINT32));
+        TEST_CHECK(prim.indices.GetSize() % (prim.indexSize * 3) == 0);
+        TEST_CHECK(prim.splitData.nodeIndex.x >= 0 && prim.splitData.nodeIndex.x < (int)model.nodes.size());
+        for (int texture : prim.textures)
+        {
+            TEST_CHECK(texture >= -1 && texture < (int)data.images.size());
+        }
+
+        const size_t vertexCount = prim.vertices.GetSize() / prim.vertexStride;
+        const size_t indexCount = prim.indices.GetSize() / prim.indexSize;
+        size_t maxIndex = 0;
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            UINT32 index = 0;
+            memcpy(&index, prim.indices.GetData() + i * prim.indexSize, prim.indexSize);
+            maxIndex = std::max(maxIndex, (size_t)index);
+        }
+        TEST_CHECK(indexCount == 0 || maxIndex < vertexCount);
+    }
+    TEST_CHECK(data.primitives.empty() || !data.bb.IsEmpty());
+
+    for (const auto& image : data.images)
+    {
+        TEST_CHECK(image.uri.empty() != (image.data.GetSize() == 0));
+    }
+}
+
+// Model read from cache is the same as model built from source, bit to bit
+void CompareModels(const GLTFModelDesc& built, const GLTFModelData& builtData, const GLTFModelDesc& loaded, const GLTFModelData& loadedData)
+{
+    TEST_CHECK(built.skinned == loaded.skinned);
+    TEST_CHECK(built.rootNodeIdx == loaded.rootNodeIdx);
+    TEST_CHECK(built.nodes.size() == loaded.nodes.size());
+    for (size_t i = 0; i < std::min(built.nodes.size(), loaded.nodes.size()); i++)
+    {
+        const GLTFModelDesc::Node& a = built.nodes[i];
+        const GLTFModelDesc::Node& b = loaded.nodes[i];
+        TEST_CHECK(a.useMatrix == b.useMatrix);
+        TEST_CHECK(a.useMatrix ? SameBytes(a.matrix, b.matrix) : SameBytes(a.transform, b.transform));
+        TEST_CHECK(a.children == b.children);
+    }
+    TEST_CHECK(SameVector(built.nodeInvBindMatrices, loaded.nodeInvBindMatrices));
+    TEST_CHECK(built.jointIndices == loaded.jointIndices);
+    TEST_CHECK(built.flatNodes == loaded.flatNodes && built.flatParents == loaded.flatParents);
+
+    TEST_CHECK(built.minAnimationTime == loaded.minAnimationTime && built.maxAnimationTime == loaded.maxAnimationTime);
+    TEST_CHECK(built.animationSamplers.size() == loaded.animationSamplers.size());
+    for (size_t i = 0; i < std::min(built.animationSamplers.size(), loaded.animationSamplers.size()); i++)
+    {
+        const GLTFModelDesc::AnimationSampler& a = built.animationSamplers[i];
+        const GLTFModelDesc::AnimationSampler& b = loaded.animationSamplers[i];
+        TEST_CHECK(a.rotation == b.rotation);
+        TEST_CHECK(SameVector(a.timeKeys, b.timeKeys) && SameVector(a.keys, b.keys) && SameVector(a.packedKeys, b.packedKeys));
+        TEST_CHECK(SameBytes(a.rangeMin, b.rangeMin) && SameBytes(a.rangeSize, b.rangeSize));
+    }
+    TEST_CHECK(built.animationChannels.size() == loaded.animationChannels.size());
+    for (size_t i = 0; i < std::min(built.animationChannels.size(), loaded.animationChannels.size()); i++)
+    {
+        const GLTFModelDesc::AnimationChannel& a = built.animationChannels[i];
+        const GLTFModelDesc::AnimationChannel& b = loaded.animationChannels[i];
+        TEST_CHECK(a.animSamplerIdx == b.animSamplerIdx && a.nodeIdx == b.nodeIdx && a.flatNodeIdx == b.flatNodeIdx && a.type == b.type);
+    }
+
+    TEST_CHECK(builtData.autoscale == loadedData.autoscale && builtData.scaleValue == loadedData.scaleValue);
+    TEST_CHECK(SameBytes(builtData.bb, loadedData.bb));
+    TEST_CHECK(builtData.sources == loadedData.sources);
+
+    TEST_CHECK(builtData.images.size() == loadedData.images.size());
+    for (size_t i = 0; i < std::min(builtData.images.size(), loadedData.images.size()); i++)
+    {
+        const GLTFModelData::Image& a = builtData.images[i];
+        const GLTFModelData::Image& b = loadedData.images[i];
+        TEST_CHECK(a.uri == b.uri && a.srgb == b.srgb && SameStream(a.data, b.data));
+    }
+
+    TEST_CHECK(builtData.primitives.size() == loadedData.primitives.size());
+    for (size_t i = 0; i < std::min(builtData.primitives.size(), loadedData.primitives.size()); i++)
+    {
+        const GLTFModelData::Primitive& a = builtData.primitives[i];
+        const GLTFModelData::Primitive& b = loadedData.primitives[i];
+        TEST_CHECK(a.flags == b.flags && SameBytes(a.textures, b.textures) && SameBytes(a.splitData, b.splitData));
+        TEST_CHECK(a.vertexStride == b.vertexStride && SameStream(a.vertices, b.vertices));
+        TEST_CHECK(a.indexSize == b.indexSize && SameStream(a.indices, b.indices));
+    }
+
+    // Streams are read in place from mapped cache, with the alignment cache file gives them
+    for (const auto& prim : loadedData.primitives)
+    {
+        TEST_CHECK(prim.vertices.pMapped != nullptr && ((size_t)prim.vertices.pMapped & 15) == 0);
+        TEST_CHECK(prim.indices.pMapped != nullptr && ((size_t)prim.indices.pMapped & 15) == 0);
+    }
+}
+
+size_t CalcStreamBytes(const GLTFModelData& data)
+{
+    size_t bytes = 0;
+    for (const auto& image : data.images)
+    {
+        bytes += image.data.GetSize();
+    }
+    for (const auto& prim : data.primitives)
+    {
+        bytes += prim.vertices.GetSize() + prim.indices.GetSize();
+    }
+    return bytes;
+}
+
+bool WriteFile(const std::string& filename, const std::string& content)
+{
+    FILE* pFile = fopen(filename.c_str(), "wb");
+    if (pFile != nullptr)
+    {
+        fwrite(content.data(), 1, content.size(), pFile);
+        fclose(pFile);
+    }
+    return pFile != nullptr;
+}
+
+// Small model with external buffer, which is modified to check validation
+void TestValidation()
+{
+    const std::string folder = "ModelCacheTestModel/";
+    mkdir(folder.c_str(), 0755);
+
+    // One triangle of a node, which is the child of root node
+    std::string bin(1024, '\0');
+    const float positions[] = { 0, 0, 0, 1, 0, 0, 0, 2, 0 };
+    const float normals[] = { 0, 0, 1, 0, 0, 1, 0, 0, 1 };
+    const float uvs[] = { 0, 0, 1, 0, 0, 1 };
+    const UINT16 indices[] = { 0, 1, 2 };
+    memcpy(&bin[0], positions, sizeof(positions));
+    memcpy(&bin[36], normals, sizeof(normals));
+    memcpy(&bin[72], uvs, sizeof(uvs));
+    memcpy(&bin[96], indices, sizeof(indices));
+    for (size_t i = 128; i < bin.size(); i++)
+    {
+        bin[i] = (char)i;
+    }
+    TEST_CHECK(WriteFile(folder + "tiny.bin", bin));
+    TEST_CHECK(WriteFile(folder + "tiny.gltf",
+        "{\"asset\":{\"version\":\"2.0\"},\"scenes\":[{\"nodes\":[0]}],"
+        "\"nodes\":[{\"children\":[1]},{\"mesh\":0,\"translation\":[0,1,0]}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+        "\"accessors\":["
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\",\"min\":[0,0,0],\"max\":[1,2,0]},"
+        "{\"bufferView\":0,\"byteOffset\":36,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+        "{\"bufferView\":0,\"byteOffset\":72,\"componentType\":5126,\"count\":3,\"type\":\"VEC2\"},"
+        "{\"bufferView\":0,\"byteOffset\":96,\"componentType\":5123,\"count\":3,\"type\":\"SCALAR\"}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteLength\":1024}],"
+        "\"buffers\":[{\"uri\":\"tiny.bin\",\"byteLength\":1024}]}"));
+
+    const std::string modelFilename = folder + "tiny.gltf";
+    const ModelCacheOptions options = GetOptions();
+
+    GLTFModelDesc built;
+    GLTFModelData builtData;
+    TEST_CHECK(BuildCache(modelFilename, options, built, builtData));
+    TEST_CHECK(builtData.sources.size() == 2 && builtData.primitives.size() == 1);
+    TEST_CHECK(built.flatNodes.size() == 2 && built.flatParents[1] == 0);
+    ValidateModel(built, builtData);
+
+    // Bind pose box is in node space of mirrored root
+    TEST_CHECK(builtData.bb.bbMin.x == -1.0f && builtData.bb.bbMin.y == 1.0f && builtData.bb.bbMin.z == 0.0f);
+    TEST_CHECK(builtData.bb.bbMax.x == 0.0f && builtData.bb.bbMax.y == 3.0f && builtData.bb.bbMax.z == 0.0f);
+
+    GLTFModelDesc loaded;
+    GLTFModelData loadedData;
+    TEST_CHECK(LoadCache(modelFilename, options, loaded, loadedData));
+    CompareModels(built, builtData, loaded, loadedData);
+
+    // Any option or tolerance change invalidates cache
+    ModelCacheOptions otherOptions = options;
+    otherOptions.animationRotationTolerance *= 2.0f;
+    {
+        GLTFModelDesc model;
+        GLTFModelData data;
+        TEST_CHECK(!LoadCache(modelFilename, otherOptions, model, data));
+    }
+    otherOptions = options;
+    otherOptions.forDeferred = 1;
+    {
+        GLTFModelDesc model;
+        GLTFModelData data;
+        TEST_CHECK(!LoadCache(modelFilename, otherOptions, model, data));
+    }
+
+    // Source change invalidates cache
+    bin[200] ^= 1;
+    TEST_CHECK(WriteFile(folder + "tiny.bin", bin));
+    {
+        GLTFModelDesc model;
+        GLTFModelData data;
+        TEST_CHECK(!LoadCache(modelFilename, options, model, data));
+    }
+    {
+        GLTFModelDesc model;
+        GLTFModelData data;
+        TEST_CHECK(BuildCache(modelFilename, options, model, data));
+    }
+    {
+        GLTFModelDesc model;
+        GLTFModelData data;
+        TEST_CHECK(LoadCache(modelFilename, options, model, data));
+    }
+
+    // Equally named models from different folders get different caches
+    TEST_CHECK(GetModelCacheFilename(CacheFolder, "../Common/SceneModels/Well/scene.gltf") != GetModelCacheFilename(CacheFolder, "../Common/PlayerModels/Well/scene.gltf"));
+    TEST_CHECK(GetModelCacheFilename(CacheFolder, "../Common/SceneModels/Well/scene.gltf") == std::string(CacheFolder) + "/Common_SceneModels_Well_scene.gltf.cache");
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+
+    mkdir(CacheFolder, 0755);
+
+    TestValidation();
+
+    // Models from command line or samples' models, quick run takes the only animated one
+    std::vector<std::string> models;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") != 0)
+        {
+            models.push_back(argv[i]);
+        }
+    }
+    const bool explicitModels = !models.empty();
+    if (models.empty())
+    {
+        const char* sampleModels[] = {
+            "Common/PlayerModels/MechDrone/scene.gltf",
+            "Common/Models/LightSaber/scene.gltf",
+            "Common/Models/Porsche930/scene.gltf",
+            "Common/SceneModels/GuardTower/scene.gltf",
+            "Common/SceneModels/Market/scene.gltf",
+            "Common/SceneModels/Well/scene.gltf"
+        };
+        for (auto model : sampleModels)
+        {
+            models.push_back(std::string(REPO_ROOT) + "/" + model);
+            if (quick)
+            {
+                break;
+            }
+        }
+    }
+
+    printf("%-40s %8s %6s %6s %8s %10s %10s %9s\n", "model", "MB", "prims", "nodes", "samplers", "cold ms", "warm ms", "speedup");
+    for (const auto& model : models)
+    {
+        const ModelCacheOptions options = GetOptions();
+
+        GLTFModelDesc built;
+        GLTFModelData builtData;
+        bool res = false;
+        double coldMs = Test::MeasureMs(1, [&]() { res = BuildCache(model, options, built, builtData); });
+        if (!res && !explicitModels)
+        {
+            // Some sample models are stored without binary buffers
+            printf("%s is skipped, it cannot be parsed\n", model.c_str());
+            continue;
+        }
+        TEST_CHECK(res);
+        ValidateModel(built, builtData);
+
+        // Every warm load starts from scratch, as loader does
+        double warmMs = Test::MeasureMs(3, [&]()
+        {
+            GLTFModelDesc loaded;
+            GLTFModelData loadedData;
+            res = LoadCache(model, options, loaded, loadedData);
+            Test::KeepAlive(&loaded);
+        });
+        TEST_CHECK(res);
+
+        GLTFModelDesc loaded;
+        GLTFModelData loadedData;
+        TEST_CHECK(LoadCache(model, options, loaded, loadedData));
+        ValidateModel(loaded, loadedData);
+        CompareModels(built, builtData, loaded, loadedData);
+
+        std::string name = GetParentName(model) + "/" + ShortFilename(model);
+        printf("%-40s %8.2f %6d %6d %8d %10.2f %10.2f %8.2fx\n", name.c_str(), CalcStreamBytes(builtData) / 1048576.0,
+            (int)builtData.primitives.size(), (int)built.nodes.size(), (int)built.animationSamplers.size(), coldMs, warmMs, coldMs / warmMs);
+    }
+
+    return Test::Result("model_cache_tool");
+}
@@ -0,0 +1,275 @@
+#include "stdafx.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "PlatformIO.h"
+#include "PlatformModelCache.h"
+#include "PlatformUtil.h"
+
+#include "tiny_gltf.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Peak resident set and load time of model cache loading, with streams read from mapped cache
+// against cache read into vector and streams copied into their own vectors, as loader did before.
+// Mapped pages count in resident set too, what mapping saves is private memory and the copy
+namespace
+{
+
+const char* CacheFolder = "ModelLoadTest";
+
+enum LoadPath
+{
+    PathMapped = 0,     // Streams are copied from mapped cache into upload memory
+    PathRead,           // Cache is read into vector, streams are copied into their own vectors, then into upload memory
+
+    PathCount
+};
+
+const char* PathNames[PathCount] = { "mmap", "read" };
+
+struct LoadStats
+{
+    double ms = 0.0;
+    long maxRssKB = 0;
+    size_t streamBytes = 0;
+    bool res = false;
+};
+
+ModelCacheOptions GetOptions()
+{
+    ModelCacheOptions options;
+    options.animationRotationTolerance = AnimationRotationTolerance;
+    options.animationRangeTolerance = AnimationRangeTolerance;
+    return options;
+}
+
+bool BuildCache(const std::string& modelFilename)
+{
+    const ModelCacheOptions options = GetOptions();
+
+    tinygltf::Model source;
+    GLTFModelDesc model;
+    GLTFModelData data;
+    bool res = LoadGLTFSource(modelFilename, source);
+    res = res && ScanGLTFSource(source, modelFilename, options, model, data);
+    res = res && SaveModelCache(GetModelCacheFilename(CacheFolder, modelFilename), modelFilename, options, model, data);
+    return res;
+}
+
+// Streams of cache read into vector get their own vectors, as loader did before cache was mapped
+void CopyStreams(GLTFModelData& data)
+{
+    auto copyStream = [](GLTFModelData::Stream& stream)
+    {
+        stream.data.assign(stream.pMapped, stream.pMapped + stream.mappedSize);
+        stream.pMapped = nullptr;
+        stream.mappedSize = 0;
+    };
+
+    for (auto& image : data.images)
+    {
+        copyStream(image.data);
+    }
+    for (auto& prim : data.primitives)
+    {
+        copyStream(prim.vertices);
+        copyStream(prim.indices);
+    }
+}
+
+// Same as ModelLoader: geometry is copied into upload memory, embedded images are read by decoder
+LoadStats LoadModel(const std::string& modelFilename, LoadPath path)
+{
+    LoadStats stats;
+
+    Test::Timer timer;
+
+    const std::string cacheFilename = GetModelCacheFilename(CacheFolder, modelFilename);
+    const ModelCacheOptions options = GetOptions();
+
+    GLTFModelDesc model;
+    GLTFModelData data;
+    if (path == PathMapped)
+    {
+        stats.res = LoadModelCache(cacheFilename, modelFilename, options, model, data);
+    }
+    else
+    {
+        std::vector<char> fileData;
+        FILE* pFile = fopen(cacheFilename.c_str(), "rb");
+        if (pFile != nullptr)
+        {
+            fseek(pFile, 0, SEEK_END);
+            fileData.resize((size_t)ftell(pFile));
+            fseek(pFile, 0, SEEK_SET);
+            stats.res = fread(fileData.data(), 1, fileData.size(), pFile) == fileData.size();
+            fclose(pFile);
+        }
+        stats.res = stats.res && ReadModelCache(fileData.data(), fileData.size(), modelFilename, options, model, data);
+        if (stats.res)
+        {
+            CopyStreams(data);
+        }
+    }
+    if (!stats.res)
+    {
+        return stats;
+    }
+    model.BuildHierarchy();
+
+    size_t geometryBytes = 0;
+    for (const auto& prim : data.primitives)
+    {
+        geometryBytes += prim.vertices.GetSize() + prim.indices.GetSize();
+    }
+
+    std::vector<char> upload(geometryBytes);
+    size_t offset = 0;
+    for (const auto& prim : data.primitives)
+    {
+        memcpy(upload.data() + offset, prim.vertices.GetData(), prim.vertices.GetSize());
+        offset += prim.vertices.GetSize();
+        memcpy(upload.data() + offset, prim.indices.GetData(), prim.indices.GetSize());
+        offset += prim.indices.GetSize();
+    }
+    Test::KeepAlive(upload);
+
+    UINT32 imageSum = 0;
+    stats.streamBytes = geometryBytes;
+    for (const auto& image : data.images)
+    {
+        for (size_t i = 0; i < image.data.GetSize(); i++)
+        {
+            imageSum += (unsigned char)image.data.GetData()[i];
+        }
+        stats.streamBytes += image.data.GetSize();
+    }
+    Test::KeepAlive(imageSum);
+
+    stats.ms = timer.ElapsedMs();
+
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    stats.maxRssKB = usage.ru_maxrss;
+
+    return stats;
+}
+
+// Forked child starts with fresh peak, so its maxrss counts this load only
+template <typename Func>
+bool RunInChild(Func func, LoadStats& stats)
+{
+    int fds[2] = {};
+    if (pipe(fds) != 0)
+    {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        LoadStats childStats = func();
+        ssize_t written = write(fds[1], &childStats, sizeof(childStats));
+        close(fds[1]);
+        _exit(written == (ssize_t)sizeof(childStats) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    bool res = pid > 0 && read(fds[0], &stats, sizeof(stats)) == (ssize_t)sizeof(stats);
+    close(fds[0]);
+
+    int status = 0;
+    res = pid > 0 && waitpid(pid, &status, 0) == pid && res && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return res && stats.res;
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int repeats = quick ? 1 : 5;
+
+    mkdir(CacheFolder, 0755);
+
+    // Models from command line or samples' models, quick run takes the only animated one
+    std::vector<std::string> models;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") != 0)
+        {
+            models.push_back(argv[i]);
+        }
+    }
+    const bool explicitModels = !models.empty();
+    if (models.empty())
+    {
+        const char* sampleModels[] = {
+            "Common/Models/Porsche930/scene.gltf",
+            "Common/SceneModels/GuardTower/scene.gltf",
+            "Common/PlayerModels/MechDrone/scene.gltf",
+            "Common/Models/LightSaber/scene.gltf",
+            "Common/SceneModels/Market/scene.gltf",
+            "Common/SceneModels/Well/scene.gltf"
+        };
+        for (size_t i = quick ? 2 : 0; i < sizeof(sampleModels) / sizeof(sampleModels[0]); i++)
+        {
+            models.push_back(std::string(REPO_ROOT) + "/" + sampleModels[i]);
+            if (quick)
+            {
+                break;
+            }
+        }
+    }
+
+    printf("%-40s %8s %10s %10s %12s\n", "model", "path", "MB", "load ms", "maxrss MB");
+    for (const auto& model : models)
+    {
+        const std::string name = GetParentName(model) + "/" + ShortFilename(model);
+
+        LoadStats built;
+        const bool res = RunInChild([&]() { LoadStats stats; stats.res = BuildCache(model); return stats; }, built);
+        if (!res && !explicitModels)
+        {
+            // Some sample models are stored without binary buffers
+            printf("%-40s is skipped, it cannot be parsed\n", name.c_str());
+            continue;
+        }
+        TEST_CHECK(res);
+
+        // Best time and highest peak of several loads, first one warms file cache
+        LoadStats results[PathCount];
+        for (int path = 0; path < PathCount; path++)
+        {
+            for (int i = 0; i < repeats + 1; i++)
+            {
+                LoadStats stats;
+                TEST_CHECK(RunInChild([&]() { return LoadModel(model, (LoadPath)path); }, stats));
+                if (i == 0)
+                {
+                    continue;
+                }
+                results[path].ms = i == 1 ? stats.ms : std::min(results[path].ms, stats.ms);
+                results[path].maxRssKB = std::max(results[path].maxRssKB, stats.maxRssKB);
+                results[path].streamBytes = stats.streamBytes;
+            }
+        }
+        TEST_CHECK(results[PathMapped].streamBytes == results[PathRead].streamBytes);
+
+        for (int path = 0; path < PathCount; path++)
+        {
+            printf("%-40s %8s %10.2f %10.2f %12.2f\n", path == 0 ? name.c_str() : "", PathNames[path],
+                results[path].streamBytes / 1048576.0, results[path].ms, results[path].maxRssKB / 1024.0);
+        }
+        printf("%-40s %8s %10s %9.2fx %12.2f\n", "", "read/mmap", "", results[PathRead].ms / results[PathMapped].ms,
+            (results[PathRead].maxRssKB - results[PathMapped].maxRssKB) / 1024.0);
+    }
+
+    return Test::Result("model_load_tool");
+}
@@ -0,0 +1,193 @@
+#include "stdafx.h"
+
+#include "PlatformPipelineStateKey.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Equal descriptions give equal keys, fields unused by pipeline don't get into key
+namespace
+{
+
+PSOKeyParams MakeParams()
+{
+    PSOKeyParams params;
+    params.primTopologyType = 3;
+    params.pShaderSourceName = "Simple.hlsl";
+    params.shaderDefines = { "NORMAL_MAP", "SKINNED", "ALPHA_CUTOFF" };
+
+    PSOKeyAttribute position;
+    position.semanticName = "POSITION";
+    position.format = 6;
+    PSOKeyAttribute uv;
+    uv.semanticName = "TEXCOORD";
+    uv.format = 16;
+    uv.alignedByteOffset = 12;
+    params.geomAttributes = { position, uv };
+
+    params.blendState.renderTarget[0].renderTargetWriteMask = 0xF;
+    params.rasterizerState.fillMode = 3;
+    params.rasterizerState.cullMode = 3;
+    params.rasterizerState.depthClipEnable = true;
+    params.depthStencilState.depthEnable = true;
+    params.depthStencilState.depthWriteMask = 1;
+    params.depthStencilState.depthFunc = 4;
+
+    params.rtFormats[0] = 28;
+    params.dsFormat = 45;
+
+    return params;
+}
+
+template <typename T>
+T ReadAt(const std::string& key, size_t offset)
+{
+    T value;
+    memcpy(&value, key.data() + offset, sizeof(T));
+    return value;
+}
+
+void TestLayout()
+{
+    const std::string rootKey = BuildRootSignatureKey(2, 3, 4, 5);
+    TEST_CHECK(rootKey.size() == 4 * sizeof(UINT));
+    TEST_CHECK(ReadAt<UINT>(rootKey, 0) == 2 && ReadAt<UINT>(rootKey, 12) == 5);
+
+    PSOKeyParams params = MakeParams();
+    params.rtFormats[1] = 10;
+    const std::string key = BuildPSOKey(rootKey, params);
+
+    // Root signature key with its size, then topology and shader name
+    size_t offset = 0;
+    TEST_CHECK(ReadAt<UINT32>(key, offset) == rootKey.size());
+    offset += sizeof(UINT32);
+    TEST_CHECK(key.compare(offset, rootKey.size(), rootKey) == 0);
+    offset += rootKey.size();
+    TEST_CHECK(ReadAt<UINT>(key, offset) == params.primTopologyType);
+    offset += sizeof(UINT);
+    TEST_CHECK(ReadAt<UINT32>(key, offset) == strlen(params.pShaderSourceName));
+    offset += sizeof(UINT32);
+    TEST_CHECK(key.compare(offset, strlen(params.pShaderSourceName), params.pShaderSourceName) == 0);
+    offset += strlen(params.pShaderSourceName);
+
+    // Sorted defines
+    TEST_CHECK(ReadAt<UINT32>(key, offset) == 3);
+    offset += sizeof(UINT32);
+    TEST_CHECK(ReadAt<UINT32>(key, offset) == strlen("ALPHA_CUTOFF"));
+    offset += sizeof(UINT32);
+    TEST_CHECK(key.compare(offset, strlen("ALPHA_CUTOFF"), "ALPHA_CUTOFF") == 0);
+
+    // Render target count and formats, then depth format close the key
+    const size_t tail = 3 * sizeof(UINT) + sizeof(UINT);
+    TEST_CHECK(ReadAt<UINT>(key, key.size() - tail) == 2);
+    TEST_CHECK(ReadAt<UINT>(key, key.size() - tail + 4) == 28);
+    TEST_CHECK(ReadAt<UINT>(key, key.size() - tail + 8) == 10);
+    TEST_CHECK(ReadAt<UINT>(key, key.size() - 4) == 45);
+}
+
+void TestEquivalence()
+{
+    const std::string rootKey = BuildRootSignatureKey(2, 3, 4, 0);
+    const PSOKeyParams base = MakeParams();
+    const std::string baseKey = BuildPSOKey(rootKey, base);
+
+    TEST_CHECK(BuildPSOKey(rootKey, base) == baseKey);
+
+    // Order of defines
+    PSOKeyParams params = base;
+    std::reverse(params.shaderDefines.begin(), params.shaderDefines.end());
+    TEST_CHECK(BuildPSOKey(rootKey, params) == baseKey);
+
+    // Blend factors of disabled blending and states of render targets besides the first one without independent blend
+    params = base;
+    params.blendState.renderTarget[0].srcBlend = 5;
+    params.blendState.renderTarget[0].logicOp = 4;
+    params.blendState.renderTarget[1].blendEnable = true;
+    params.blendState.renderTarget[3].renderTargetWriteMask = 1;
+    TEST_CHECK(BuildPSOKey(rootKey, params) == baseKey);
+
+    // Depth function with depth test off, stencil ops with stencil test off
+    PSOKeyParams noDepth = base;
+    noDepth.depthStencilState.depthEnable = false;
+    params = noDepth;
+    params.depthStencilState.depthFunc = 8;
+    params.depthStencilState.depthWriteMask = 0;
+    params.depthStencilState.stencilReadMask = 0xFF;
+    params.depthStencilState.frontFace.stencilFunc = 8;
+    TEST_CHECK(BuildPSOKey(rootKey, params) == BuildPSOKey(rootKey, noDepth));
+}
+
+void TestDifference()
+{
+    const std::string rootKey = BuildRootSignatureKey(2, 3, 4, 0);
+    const PSOKeyParams base = MakeParams();
+    const std::string baseKey = BuildPSOKey(rootKey, base);
+
+    TEST_CHECK(BuildPSOKey(BuildRootSignatureKey(2, 3, 4, 1), base) != baseKey);
+
+    PSOKeyParams params = base;
+    params.shaderDefines.pop_back();
+    TEST_CHECK(BuildPSOKey(rootKey, params) != baseKey);
+
+    // Define split differently is another define set
+    params = base;
+    params.shaderDefines = { "NORMAL_MAPSKINNED", "ALPHA_CUTOFF" };
+    TEST_CHECK(BuildPSOKey(rootKey, params) != baseKey);
+
+    params = base;
+    params.geomAttributes[1].semanticIndex = 1;
+    TEST_CHECK(BuildPSOKey(rootKey, params) != baseKey);
+
+    params = base;
+    params.blendState.renderTarget[0].blendEnable = true;
+    TEST_CHECK(BuildPSOKey(rootKey, params) != baseKey);
+
+    params = base;
+    params.blendState.independentBlendEnable = true;
+    TEST_CHECK(BuildPSOKey(rootKey, params) != baseKey);
+
+    params = base;
+    params.rasterizerState.slopeScaledDepthBias = 1.0f;
+    TEST_CHECK(BuildPSOKey(rootKey, params) != baseKey);
+
+    params = base;
+    params.depthStencilState.depthFunc = 2;
+    TEST_CHECK(BuildPSOKey(rootKey, params) != baseKey);
+
+    params = base;
+    params.depthStencilState.stencilEnable = true;
+    TEST_CHECK(BuildPSOKey(rootKey, params) != baseKey);
+
+    // Unknown render target in the middle still counts
+    params = base;
+    params.rtFormats[2] = 28;
+    PSOKeyParams other = params;
+    other.rtFormats[1] = 28;
+    TEST_CHECK(BuildPSOKey(rootKey, params) != BuildPSOKey(rootKey, other));
+
+    params = base;
+    params.dsFormat = 40;
+    TEST_CHECK(BuildPSOKey(rootKey, params) != baseKey);
+}
+
+void TestHash()
+{
+    // FNV-1a reference values
+    TEST_CHECK(CalcPipelineKeyHash("") == 0xcbf29ce484222325ull);
+    TEST_CHECK(CalcPipelineKeyHash("a") == 0xaf63dc4c8601ec8cull);
+    TEST_CHECK(CalcPipelineKeyHash("foobar") == 0x85944171f73967e8ull);
+    TEST_CHECK(CalcPipelineKeyHash(std::string("\0\x80", 2)) != CalcPipelineKeyHash(std::string("\x80\0", 2)));
+}
+
+} // anonymous
+
+int main()
+{
+    TestLayout();
+    TestEquivalence();
+    TestDifference();
+    TestHash();
+
+    return Test::Result("pso_key_test");
+}
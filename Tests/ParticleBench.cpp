@@ -0,0 +1,155 @@
+#include "stdafx.h"
+
+#include "ParticlePool.h"
+#include "PlatformSIMD.h"
+
+#include "TestUtil.h"
+
+// Particle pool spawn, update and instance packing cost at 1M spawns per second, without device
+namespace
+{
+
+const size_t RangeCapacity = 1024;      // Same as ParticleEmitter::MaxRangeCapacity
+const float DeltaSec = 1.0f / 60.0f;
+const float SpawnsPerSec = 1000000.0f;
+const int TemplateCount = 3;            // Smoke emitter picks one of three templates
+
+// Same fields as ParticleEmitter::Update fills
+void SpawnParticles(ParticlePool& pool, int range, size_t count, float maxLifeTime, size_t& counter)
+{
+    for (size_t i = 0; i < count; i++, counter++)
+    {
+        size_t idx = pool.Spawn(range);
+        if (idx == ParticlePool::InvalidIndex)
+        {
+            break;
+        }
+
+        const float t = (counter % 1000) / 1000.0f;
+
+        pool.templateIdx[idx] = (int)(counter % TemplateCount);
+        pool.frameCount[idx] = 64.0f;
+        pool.frameSpeed[idx] = 10.0f;
+        pool.posX[idx] = t;
+        pool.posY[idx] = 0.5f;
+        pool.posZ[idx] = 1.0f;
+        pool.velX[idx] = 0.01f * t;
+        pool.velY[idx] = 0.075f;
+        pool.velZ[idx] = -0.01f * t;
+        pool.tintR[idx] = 1.0f;
+        pool.tintG[idx] = 1.0f;
+        pool.tintB[idx] = 1.0f;
+        pool.tintA[idx] = 0.35f;
+        pool.maxLifeTime[idx] = maxLifeTime * (0.9f + 0.1f * t);
+        pool.birthMargin[idx] = 0.1f * maxLifeTime;
+        pool.deathMargin[idx] = 0.2f * maxLifeTime;
+    }
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int frameCount = quick ? 10 : 120;
+
+    // Alive particle count grows with range count, spawn rate stays the same
+    std::vector<size_t> rangeCounts = { 64, 256, 1024 };
+    if (quick)
+    {
+        rangeCounts = { 64 };
+    }
+
+    printf("%s, %.0f fps\n", SIMD::GetName(), 1.0f / DeltaSec);
+    printf("%-10s %8s %10s %10s %10s %10s %10s %8s %10s %12s\n", "alive", "ranges", "spawn/s", "spawn ns", "update ns",
+        "pack ms", "pack MB", "draws", "ms/frame", "max spawn/s");
+
+    std::vector<ParticleInstancePacker::TemplateInfo> templates(TemplateCount);
+    std::vector<int> templateIndices;
+    for (int i = 0; i < TemplateCount; i++)
+    {
+        templates[i].billboardType = PARTICLE_BILLBOARD_TYPE_FULL;
+        templates[i].frameCount = 64;
+        templates[i].flags = PARTICLE_FLAG_HAS_ALPHA;
+        templateIndices.push_back(i);
+    }
+
+    for (size_t rangeCount : rangeCounts)
+    {
+        ParticlePool pool;
+        for (size_t i = 0; i < rangeCount; i++)
+        {
+            pool.AddRange(RangeCapacity);
+        }
+
+        std::vector<ParticleInstancePacker::Source> sources(rangeCount);
+        for (size_t i = 0; i < rangeCount; i++)
+        {
+            sources[i].range = (int)i;
+            sources[i].pTemplateIndices = &templateIndices;
+        }
+        ParticleInstancePacker packer;
+
+        // Particle lives at most lifeFrames updates, so range never overflows and every frame spawns as many as die
+        const size_t spawnsPerRange = std::max<size_t>((size_t)(SpawnsPerSec * DeltaSec / rangeCount + 0.5f), 1);
+        const size_t lifeFrames = std::max<size_t>(RangeCapacity / spawnsPerRange, 2);
+        const float maxLifeTime = (lifeFrames - 1) * DeltaSec * 0.99f;
+
+        // Warm up to steady state
+        size_t counter = 0;
+        for (float time = 0.0f; time < maxLifeTime * 1.2f; time += DeltaSec)
+        {
+            for (size_t r = 0; r < rangeCount; r++)
+            {
+                SpawnParticles(pool, (int)r, spawnsPerRange, maxLifeTime, counter);
+                pool.Update((int)r, DeltaSec, DeltaSec);
+            }
+        }
+        pool.ResetStats();
+
+        double spawnMs = 0.0;
+        double updateMs = 0.0;
+        double packMs = 0.0;
+        size_t aliveSum = 0;
+        size_t packedBytes = 0;
+        size_t batchCount = 0;
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            Test::Timer spawnTimer;
+            for (size_t r = 0; r < rangeCount; r++)
+            {
+                SpawnParticles(pool, (int)r, spawnsPerRange, maxLifeTime, counter);
+            }
+            spawnMs += spawnTimer.ElapsedMs();
+
+            aliveSum += pool.GetAliveCount();
+
+            Test::Timer updateTimer;
+            for (size_t r = 0; r < rangeCount; r++)
+            {
+                pool.Update((int)r, DeltaSec, DeltaSec);
+            }
+            updateMs += updateTimer.ElapsedMs();
+
+            Test::Timer packTimer;
+            packer.Pack(pool, sources, templates);
+            packMs += packTimer.ElapsedMs();
+
+            TEST_CHECK(packer.GetStats().instances == pool.GetAliveCount());
+            packedBytes += packer.GetStats().bytes;
+            batchCount += packer.GetStats().batches;
+        }
+
+        const ParticlePool::Stats stats = pool.GetStats();
+        TEST_CHECK(stats.updated == aliveSum);
+        TEST_CHECK(stats.dropped == 0);
+
+        const double spawnNs = spawnMs * 1e6 / std::max<size_t>(stats.spawned, 1);
+        const double updateNs = updateMs * 1e6 / std::max<size_t>(stats.updated, 1);
+        printf("%-10zu %8zu %10.0f %10.2f %10.2f %10.3f %10.2f %8zu %10.3f %12.0f\n", aliveSum / frameCount, rangeCount,
+            (double)stats.spawned / (frameCount * DeltaSec), spawnNs, updateNs, packMs / frameCount,
+            packedBytes / 1048576.0 / frameCount, batchCount / frameCount, (spawnMs + updateMs + packMs) / frameCount, 1e9 / spawnNs);
+    }
+
+    return Test::Result("particle_bench");
+}
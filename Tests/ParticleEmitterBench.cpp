@@ -0,0 +1,192 @@
+#include "stdafx.h"
+
+#include "ParticleEmitter.h"
+#include "PlatformThreadPool.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Emitter spawn and simulation of a8.Particles stress scene, spread over thread pool as Renderer::Update does
+namespace
+{
+
+const float GridStep = 0.5f;            // Same as Renderer::ParticleStressGridStep
+const int RateScale = 4;                // Same as Renderer::ParticleStressRateScale
+const double DeltaSec = 1.0 / 60.0;
+
+struct Scene
+{
+    ParticlePool pool;
+    std::vector<ParticleEmitter*> emitters;
+
+    ~Scene()
+    {
+        for (auto pEmitter : emitters)
+        {
+            delete pEmitter;
+        }
+    }
+};
+
+// Flame and smoke emitters of Renderer::ParticleEmitterSetup, copied over grid
+void CreateEmitters(Scene& scene, int gridSize)
+{
+    std::vector<ParticleEmitterParams> setup(2);
+    setup[0].pos = Point3f{ 0,0,1 };
+    setup[0].tint = Point4f{ 10.0f, 10.0f, 10.0f, 1.0f };
+    setup[0].templateIndex = { 0 };
+    setup[0].particlesForEmit = 1;
+
+    setup[1].pos = Point3f{ 0,0.5f,1 };
+    setup[1].randomPosDelta = true;
+    setup[1].tint = Point4f{ 1,1,1,0.35f };
+    setup[1].templateIndex = { 1 };
+    setup[1].emitFreqSec = 0.5;
+    setup[1].lifeTimeSec = Point2d{ 9.0, 11.0 };
+    setup[1].birthMargin = Point2d{ 1.0, 1.5 };
+    setup[1].deathMargin = Point2d{ 2.0, 3.0 };
+
+    // Flame is 16x8 flipbook at default speed, smoke is three 8x8 sequences at 10 frames per second
+    std::vector<ParticleEmitter::TemplateInfo> templateInfos(2);
+    templateInfos[0].frameCount = 128;
+    templateInfos[1].frameCount = 64;
+    templateInfos[1].sequenceCount = 3;
+    templateInfos[1].animSpeed = 10.0f;
+
+    const int copies = gridSize * gridSize;
+    for (size_t i = 0; i < setup.size(); i++)
+    {
+        std::vector<ParticleEmitter::TemplateInfo> templates;
+        for (int idx : setup[i].templateIndex)
+        {
+            templates.push_back(templateInfos[idx]);
+        }
+
+        for (int j = 0; j < copies; j++)
+        {
+            ParticleEmitterParams params = setup[i];
+            const float offset = (gridSize - 1) * 0.5f;
+            params.pos.x += ((j % gridSize) - offset) * GridStep;
+            params.pos.z += ((j / gridSize) - offset) * GridStep;
+            params.emitFreqSec /= RateScale;
+
+            scene.emitters.push_back(new ParticleEmitter(params, templates, scene.pool, (UINT32)(i * copies + j)));
+        }
+    }
+}
+
+// Same job split as Renderer::Update
+void UpdateEmitters(Scene& scene, ThreadPool& pool, size_t threads, double deltaSec)
+{
+    const size_t emitterCount = scene.emitters.size();
+    const size_t grainSize = std::max((emitterCount + threads - 1) / threads, (size_t)1);
+
+    scene.pool.ResetStats();
+    pool.ParallelFor(emitterCount, grainSize, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            scene.emitters[i]->Update(scene.pool, deltaSec);
+        }
+    });
+}
+
+bool EqualPools(const ParticlePool& a, const ParticlePool& b)
+{
+    bool equal = a.GetCapacity() == b.GetCapacity() && a.GetRangeCount() == b.GetRangeCount();
+    for (size_t r = 0; r < a.GetRangeCount() && equal; r++)
+    {
+        equal = a.GetRange((int)r).count == b.GetRange((int)r).count;
+    }
+    for (auto pArray : { &ParticlePool::posX, &ParticlePool::posY, &ParticlePool::posZ, &ParticlePool::fade,
+        &ParticlePool::lifeTime, &ParticlePool::maxLifeTime, &ParticlePool::curFrame, &ParticlePool::firstFrame })
+    {
+        equal = equal && memcmp((a.*pArray).data(), (b.*pArray).data(), a.GetCapacity() * sizeof(float)) == 0;
+    }
+    return equal && a.templateIdx == b.templateIdx;
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int frameCount = quick ? 5 : 120;
+    const double warmUpSec = quick ? 1.0 : 11.0;
+
+    std::vector<size_t> threadCounts;
+    const size_t hwThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t threads = 1; threads < hwThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hwThreads);
+    if (quick && hwThreads == 1)
+    {
+        // Still runs pool code path
+        threadCounts.push_back(2);
+    }
+
+    // Renderer stress scene is 16x16 grid
+    std::vector<int> gridSizes = { 16, 32, 64 };
+    if (quick)
+    {
+        gridSizes = { 4 };
+    }
+
+    printf("%d frames, %zu hardware threads\n", frameCount, hwThreads);
+    printf("%-10s %10s %8s %12s %12s %9s\n", "emitters", "alive", "threads", "ms/frame", "ns/particle", "scaling");
+
+    for (int gridSize : gridSizes)
+    {
+        double singleMs = 0.0;
+        Scene reference;
+
+        for (size_t threads : threadCounts)
+        {
+            // Pool without workers runs everything on calling thread
+            ThreadPool pool;
+            if (threads > 1)
+            {
+                pool.Init(threads - 1);
+            }
+
+            // Steady state, where smoke particles die as fast as they spawn
+            Scene scene;
+            CreateEmitters(scene, gridSize);
+            for (double time = 0.0; time < warmUpSec; time += 0.1)
+            {
+                UpdateEmitters(scene, pool, threads, 0.1);
+            }
+
+            size_t updated = 0;
+            Test::Timer timer;
+            for (int frame = 0; frame < frameCount; frame++)
+            {
+                UpdateEmitters(scene, pool, threads, DeltaSec);
+                updated += scene.pool.GetStats().updated;
+            }
+            double frameMs = timer.ElapsedMs() / frameCount;
+
+            pool.Term();
+
+            // Emitters own their ranges and random streams, so result doesn't depend on thread count
+            if (reference.emitters.empty())
+            {
+                singleMs = frameMs;
+                std::swap(reference.pool, scene.pool);
+                std::swap(reference.emitters, scene.emitters);
+            }
+            else
+            {
+                TEST_CHECK(EqualPools(reference.pool, scene.pool));
+            }
+
+            printf("%-10zu %10zu %8zu %12.3f %12.2f %8.2fx\n", reference.emitters.size(), reference.pool.GetAliveCount(), threads, frameMs,
+                frameMs * 1e6 * frameCount / std::max<size_t>(updated, 1), singleMs / frameMs);
+        }
+    }
+
+    return Test::Result("particle_emitter_bench");
+}
@@ -0,0 +1,230 @@
+#include "stdafx.h"
+
+#include <algorithm>
+
+#include "ParticleLod.h"
+
+#include "TestUtil.h"
+
+namespace
+{
+
+const double DeltaSec = 1.0 / 60.0;
+
+struct Scene
+{
+    ParticlePool pool;
+    std::vector<ParticleEmitter*> emitters;
+
+    ~Scene()
+    {
+        for (auto pEmitter : emitters)
+        {
+            delete pEmitter;
+        }
+    }
+
+    void AddEmitter(const ParticleEmitterParams& params, UINT32 seed)
+    {
+        emitters.push_back(new ParticleEmitter(params, std::vector<ParticleEmitter::TemplateInfo>(1), pool, seed));
+    }
+};
+
+// Emitter, which spawns every emitFreqSec forever, particles live long enough to stay alive during test
+ParticleEmitterParams MakeEmitter(const Point3f& pos, double emitFreqSec, float priority)
+{
+    ParticleEmitterParams params;
+    params.pos = pos;
+    params.templateIndex = { 0 };
+    params.emitFreqSec = emitFreqSec;
+    params.lifeTimeSec = Point2d{ 100.0, 100.0 };
+    params.priority = priority;
+    return params;
+}
+
+std::vector<float> GetLifeTimes(const ParticlePool& pool, int range)
+{
+    const ParticlePool::Range& r = pool.GetRange(range);
+    std::vector<float> lifeTimes(pool.lifeTime.begin() + r.start, pool.lifeTime.begin() + r.start + r.count);
+    std::sort(lifeTimes.begin(), lifeTimes.end());
+    return lifeTimes;
+}
+
+// Emitter, which is simulated once in several frames, ages every particle by time since its spawn,
+// as emitter simulated every frame does
+void TestUpdateInterval()
+{
+    for (int interval : { 2, 3, 4 })
+    {
+        Scene scene;
+        scene.AddEmitter(MakeEmitter(Point3f{ 0,0,0 }, 0.05, 1.0f), 7);
+        scene.AddEmitter(MakeEmitter(Point3f{ 0,0,0 }, 0.05, 1.0f), 7);
+
+        ParticleEmitterLod lod;
+        lod.updateInterval = interval;
+        scene.emitters[1]->SetLod(lod);
+
+        // Frame count is multiple of every interval, so throttled emitter has no pending time in the end
+        for (int frame = 0; frame < 120; frame++)
+        {
+            scene.emitters[0]->Update(scene.pool, DeltaSec);
+            scene.emitters[1]->Update(scene.pool, DeltaSec);
+
+            if ((frame + 1) % interval == 0)
+            {
+                const std::vector<float> every = GetLifeTimes(scene.pool, scene.emitters[0]->GetRange());
+                const std::vector<float> throttled = GetLifeTimes(scene.pool, scene.emitters[1]->GetRange());
+                TEST_CHECK(every.size() == throttled.size());
+                for (size_t i = 0; i < std::min(every.size(), throttled.size()); i++)
+                {
+                    TEST_CHECK(fabsf(every[i] - throttled[i]) < 1e-5f);
+                }
+            }
+        }
+        // 2 sec at 20 spawns per sec
+        TEST_CHECK(scene.pool.GetRange(scene.emitters[1]->GetRange()).count >= 39);
+    }
+}
+
+// Budget left after alive particles goes to emitters by priority scaled by detail, equal ones keep emitter order
+void TestBudgetSplit()
+{
+    ParticleLodParams params;
+    params.budget = 100;
+
+    ParticleLodView view;
+    view.pos = Point3f{ 0,0,0 };
+
+    // Full rate emitter wants 10 spawns per 0.1 sec, the one at twice LOD distance runs at half rate
+    Scene scene;
+    scene.AddEmitter(MakeEmitter(Point3f{ 1,0,0 }, 0.01, 1.0f), 1);     // Weight 1
+    scene.AddEmitter(MakeEmitter(Point3f{ 0,1,0 }, 0.01, 3.0f), 2);     // Weight 3
+    scene.AddEmitter(MakeEmitter(Point3f{ 10,0,0 }, 0.01, 4.0f), 3);    // Weight 2, 5 spawns
+    scene.AddEmitter(MakeEmitter(Point3f{ 0,0,1 }, 0.01, 1.0f), 4);     // Weight 1, after the first one
+    const double deltaSec = 0.1 + 1e-6;
+
+    struct Case
+    {
+        size_t aliveCount;
+        int limits[4];
+        size_t throttled;
+    };
+    const Case cases[] = {
+        { 0, { 10, 10, 5, 10 }, 0 },
+        { 80, { 5, 10, 5, 0 }, 15 },
+        { 88, { 0, 10, 2, 0 }, 23 },
+        { 95, { 0, 5, 0, 0 }, 30 },
+        { 100, { 0, 0, 0, 0 }, 35 },
+        { 200, { 0, 0, 0, 0 }, 35 }
+    };
+    ParticleLodManager manager;
+    for (const auto& c : cases)
+    {
+        manager.Update(params, view, scene.emitters, c.aliveCount, deltaSec);
+        for (size_t i = 0; i < scene.emitters.size(); i++)
+        {
+            TEST_CHECK(scene.emitters[i]->GetLod().spawnLimit == c.limits[i]);
+        }
+        TEST_CHECK(manager.GetStats().throttled == c.throttled);
+        TEST_CHECK(manager.GetStats().reduced == 1 && manager.GetStats().culled == 0);
+    }
+}
+
+// Emitters spawn no more than budget lets, alive count stays within it, denied spawns are counted
+void TestThrottledSpawns()
+{
+    ParticleLodParams params;
+    params.budget = 300;
+
+    ParticleLodView view;
+    view.pos = Point3f{ 0,0,0 };
+
+    Scene scene;
+    for (int i = 0; i < 8; i++)
+    {
+        scene.AddEmitter(MakeEmitter(Point3f{ (float)i, 0, 0 }, 0.01, 1.0f + (i % 3)), i);
+    }
+
+    ParticleLodManager manager;
+    size_t throttled = 0;
+    for (int frame = 0; frame < 120; frame++)
+    {
+        const size_t aliveCount = scene.pool.GetAliveCount();
+        manager.Update(params, view, scene.emitters, aliveCount, DeltaSec);
+
+        size_t wanted = 0;
+        size_t allowed = 0;
+        for (auto pEmitter : scene.emitters)
+        {
+            wanted += pEmitter->CalcSpawnCount(DeltaSec);
+            allowed += pEmitter->GetLod().spawnLimit;
+        }
+        TEST_CHECK(manager.GetStats().throttled == wanted - allowed);
+        throttled += manager.GetStats().throttled;
+
+        scene.pool.ResetStats();
+        for (auto pEmitter : scene.emitters)
+        {
+            pEmitter->Update(scene.pool, DeltaSec);
+        }
+        TEST_CHECK(scene.pool.GetStats().spawned == allowed);
+        TEST_CHECK(scene.pool.GetAliveCount() <= params.budget);
+    }
+
+    // Budget is reached and kept
+    TEST_CHECK(scene.pool.GetAliveCount() == params.budget);
+    TEST_CHECK(throttled > 0);
+}
+
+// Rates drop with distance, emitters far away, out of view or too small on screen are culled
+void TestLod()
+{
+    ParticleLodParams params;
+
+    ParticleLodView view;
+    view.pos = Point3f{ 0,0,0 };
+    view.projScale = 2.0f;
+    view.frustum.SetPlane(Platform::Frustum::PlaneNear, Point4f{ 0, 0, 1, 0 });
+
+    ParticleEmitterParams emitter = MakeEmitter(Point3f{ 0,0,4 }, 0.01, 1.0f);
+    ParticleEmitterLod lod = ParticleLodManager::CalcLod(params, view, emitter);
+    TEST_CHECK(lod.rateScale == 1.0f && lod.animScale == 1.0f && lod.updateInterval == 1 && !lod.culled && lod.spawnLimit == -1);
+
+    emitter.pos = Point3f{ 0,0,15 };
+    lod = ParticleLodManager::CalcLod(params, view, emitter);
+    TEST_CHECK(fabsf(lod.rateScale - 1.0f / 3.0f) < 1e-6f && lod.updateInterval == 2 && !lod.culled);
+
+    emitter.pos = Point3f{ 0,0,50 };
+    lod = ParticleLodManager::CalcLod(params, view, emitter);
+    TEST_CHECK(lod.rateScale == params.minScale && lod.updateInterval == 4 && !lod.culled);
+
+    emitter.pos = Point3f{ 0,0,61 };
+    TEST_CHECK(ParticleLodManager::CalcLod(params, view, emitter).culled);
+
+    // Behind camera, bounds crossing view plane are still seen
+    emitter.pos = Point3f{ 0,0,-3 };
+    TEST_CHECK(ParticleLodManager::CalcLod(params, view, emitter).culled);
+    emitter.pos = Point3f{ 0,0,-0.5f };
+    TEST_CHECK(!ParticleLodManager::CalcLod(params, view, emitter).culled);
+
+    // Projected radius is 2 * radius / distance of half view height
+    emitter.pos = Point3f{ 0,0,40 };
+    emitter.radius = 0.25f;
+    TEST_CHECK(!ParticleLodManager::CalcLod(params, view, emitter).culled);
+    emitter.radius = 0.19f;
+    TEST_CHECK(ParticleLodManager::CalcLod(params, view, emitter).culled);
+    params.cullSize = 0.0f;
+    TEST_CHECK(!ParticleLodManager::CalcLod(params, view, emitter).culled);
+}
+
+} // anonymous
+
+int main()
+{
+    TestUpdateInterval();
+    TestBudgetSplit();
+    TestThrottledSpawns();
+    TestLod();
+
+    return Test::Result("particle_lod_test");
+}
@@ -0,0 +1,160 @@
+#include "stdafx.h"
+
+#include "ParticlePool.h"
+
+#include "TestUtil.h"
+
+namespace
+{
+
+// Particle keeps its id in position, so it can be found among packed instances
+void SpawnParticle(ParticlePool& pool, int range, int localTemplateIdx, int id)
+{
+    size_t idx = pool.Spawn(range);
+    TEST_CHECK(idx != ParticlePool::InvalidIndex);
+
+    pool.templateIdx[idx] = localTemplateIdx;
+    pool.posX[idx] = (float)id;
+    pool.posY[idx] = (float)range;
+    pool.curFrame[idx] = (float)(id % 64);
+    pool.firstFrame[idx] = (float)(id % 3 * 64);
+    pool.tintR[idx] = 1.0f + id % 3;
+    pool.tintG[idx] = 0.5f;
+    pool.tintB[idx] = 0.25f;
+    pool.tintA[idx] = 0.35f;
+    pool.fade[idx] = (id % 5) * 0.25f;
+}
+
+// Templates mix single big and a few small emitters, smoke template 3 gets more than two batches
+void TestPack()
+{
+    std::vector<ParticleInstancePacker::TemplateInfo> templates(5);
+    for (size_t i = 0; i < templates.size(); i++)
+    {
+        templates[i].billboardType = i == 0 ? PARTICLE_BILLBOARD_TYPE_VERT : PARTICLE_BILLBOARD_TYPE_FULL;
+        templates[i].frameCount = 64 * (int)(i + 1);
+        templates[i].flags = i == 0 ? PARTICLE_FLAG_USE_PALETTE : PARTICLE_FLAG_HAS_ALPHA;
+    }
+
+    // Emitters refer to global templates by local indices
+    const std::vector<int> flameTemplates = { 0 };
+    const std::vector<int> smokeTemplates = { 1, 3, 2 };
+    const std::vector<int> otherSmokeTemplates = { 3 };
+
+    ParticlePool pool;
+    std::vector<ParticleInstancePacker::Source> sources;
+    sources.push_back({ pool.AddRange(100), &flameTemplates });
+    sources.push_back({ pool.AddRange(3000), &smokeTemplates });
+    pool.AddRange(50);  // Range without source isn't packed
+    sources.push_back({ pool.AddRange(2000), &otherSmokeTemplates });
+
+    int id = 0;
+    std::vector<int> expectedCounts(templates.size(), 0);
+    for (int i = 0; i < 70; i++, id++)
+    {
+        SpawnParticle(pool, sources[0].range, 0, id);
+        ++expectedCounts[0];
+    }
+    for (int i = 0; i < 2500; i++, id++)
+    {
+        const int local = i % 7 == 0 ? 0 : (i % 7 < 3 ? 2 : 1);
+        SpawnParticle(pool, sources[1].range, local, id);
+        ++expectedCounts[smokeTemplates[local]];
+    }
+    SpawnParticle(pool, 2, 0, -1);
+    for (int i = 0; i < 1500; i++, id++)
+    {
+        SpawnParticle(pool, sources[2].range, 0, id);
+        ++expectedCounts[3];
+    }
+    // Template 4 has no particles
+    TEST_CHECK(expectedCounts[3] > 2 * PARTICLE_MAX_INSTANCES);
+
+    ParticleInstancePacker packer;
+    packer.Pack(pool, sources, templates);
+
+    const auto& instances = packer.GetInstances();
+    const auto& batches = packer.GetBatches();
+    TEST_CHECK(instances.size() == (size_t)id);
+    TEST_CHECK(packer.GetStats().instances == instances.size());
+    TEST_CHECK(packer.GetStats().bytes == instances.size() * sizeof(ParticleData));
+    TEST_CHECK(packer.GetStats().batches == batches.size());
+
+    // Batches go in template order, cover all instances contiguously and don't exceed constant buffer size
+    size_t next = 0;
+    size_t expectedBatches = 0;
+    std::vector<int> counts(templates.size(), 0);
+    for (size_t i = 0; i < batches.size(); i++)
+    {
+        const auto& batch = batches[i];
+        TEST_CHECK(batch.first == next);
+        TEST_CHECK(batch.count > 0 && batch.count <= PARTICLE_MAX_INSTANCES);
+        TEST_CHECK(i == 0 || batches[i - 1].templateIdx <= batch.templateIdx);
+        // Only the last batch of template may be partial
+        TEST_CHECK(i + 1 == batches.size() || batches[i + 1].templateIdx != batch.templateIdx || batch.count == PARTICLE_MAX_INSTANCES);
+
+        for (size_t j = batch.first; j < batch.first + batch.count; j++)
+        {
+            const auto& info = templates[batch.templateIdx];
+            TEST_CHECK(instances[j].billboardType == info.billboardType);
+            TEST_CHECK(instances[j].frameCount == info.frameCount);
+            TEST_CHECK(instances[j].particleFlags == info.flags);
+        }
+
+        counts[batch.templateIdx] += (int)batch.count;
+        next += batch.count;
+    }
+    TEST_CHECK(next == instances.size());
+    for (size_t i = 0; i < templates.size(); i++)
+    {
+        TEST_CHECK(counts[i] == expectedCounts[i]);
+        expectedBatches += (expectedCounts[i] + PARTICLE_MAX_INSTANCES - 1) / PARTICLE_MAX_INSTANCES;
+    }
+    TEST_CHECK(batches.size() == expectedBatches);
+
+    // Particles of the template keep source order, as counting sort is stable
+    for (size_t i = 1; i < instances.size(); i++)
+    {
+        const bool sameTemplate = instances[i].frameCount == instances[i - 1].frameCount;
+        TEST_CHECK(!sameTemplate || instances[i - 1].particleWorldPos.x < instances[i].particleWorldPos.x);
+    }
+
+    // Tint is premultiplied by fade
+    for (const auto& data : instances)
+    {
+        const int particleId = (int)data.particleWorldPos.x;
+        const float fade = (particleId % 5) * 0.25f;
+        TEST_CHECK(data.particleTint.x == (1.0f + particleId % 3) * fade);
+        TEST_CHECK(data.particleTint.y == 0.5f * fade);
+        TEST_CHECK(data.particleTint.z == 0.25f * fade);
+        TEST_CHECK(data.particleTint.w == 0.35f * fade);
+        // Frame is taken from the start of texture array, sequence of particle goes first
+        TEST_CHECK(data.curFrame == (float)(particleId % 3 * 64 + particleId % 64));
+        TEST_CHECK(data.particleWorldPos.w == 0.0f);
+    }
+
+    // Packer is reused between frames, empty pool gives no batches
+    for (const auto& source : sources)
+    {
+        while (pool.GetRange(source.range).count > 0)
+        {
+            size_t idx = pool.GetRange(source.range).start;
+            pool.lifeTime[idx] = 1.0f;
+            pool.maxLifeTime[idx] = 0.0f;
+            pool.Update(source.range, 0.0f, 0.0f);
+        }
+    }
+    packer.Pack(pool, sources, templates);
+    TEST_CHECK(packer.GetInstances().empty());
+    TEST_CHECK(packer.GetBatches().empty());
+    TEST_CHECK(packer.GetStats().bytes == 0);
+}
+
+} // anonymous
+
+int main()
+{
+    TestPack();
+
+    return Test::Result("particle_pack_test");
+}
@@ -0,0 +1,267 @@
+#include "stdafx.h"
+
+#include "ParticlePool.h"
+#include "PlatformSIMD.h"
+#include "PlatformUtil.h"
+
+#include "TestUtil.h"
+
+namespace
+{
+
+const float DeltaSec = 1.0f / 60.0f;
+const int StepCount = 200;
+
+// Hash of pool state, which is printed and compared between scalar, SSE2 and AVX2 builds
+const UINT64 ExpectedStateHash = 0x517b890ade18bd80ull;
+
+// Particle::Update before particle pool, life time is kept in double
+struct OldParticle
+{
+    double maxLifeTimeSec;
+    double birthMarginSec;
+    double deathMarginSec;
+    double lifeTimeSec;
+
+    Point4f tint;
+    Point4f curTint;
+    Point3f pos;
+    Point3f posDelta;
+    float curFrame;
+    int frameCount;
+    float animSpeed;
+
+    inline bool IsDead() const { return lifeTimeSec > maxLifeTimeSec; }
+
+    void Update(double deltaSec)
+    {
+        lifeTimeSec += deltaSec;
+
+        curTint = tint;
+        if (lifeTimeSec < birthMarginSec)
+        {
+            curTint = Lerp(Point4f{0,0,0,0}, tint, (float)SmoothStep(0.0, birthMarginSec, lifeTimeSec));
+        }
+        else if (lifeTimeSec > maxLifeTimeSec - deathMarginSec)
+        {
+            curTint = Lerp(tint, Point4f{0,0,0,0}, (float)SmoothStep(maxLifeTimeSec - deathMarginSec, maxLifeTimeSec, lifeTimeSec));
+        }
+
+        pos = pos + posDelta * (float)deltaSec;
+
+        curFrame += (float)deltaSec * animSpeed;
+        curFrame -= floor(curFrame / frameCount) * (float)frameCount;
+    }
+};
+
+// Particles cover birth and death margins, frame wrap and lives, which end between frames
+OldParticle MakeParticle(int i)
+{
+    OldParticle p;
+    p.maxLifeTimeSec = 0.3 + (i % 37) * 0.0871;
+    p.birthMarginSec = (i % 5) * 0.05;
+    p.deathMarginSec = (i % 7) * 0.06;
+    p.lifeTimeSec = 0.0;
+    p.tint = Point4f{ 1.0f + (i % 3), 0.5f, 0.25f * (i % 4), 0.35f };
+    p.curTint = p.tint;
+    p.pos = Point3f{ (float)(i % 11), 0.5f * (i % 13), -0.25f * (i % 17) };
+    p.posDelta = Point3f{ 0.01f * (i % 9), 0.075f, -0.3f * (i % 5) };
+    p.curFrame = (float)(i % 8);
+    p.frameCount = i % 2 == 0 ? 64 : 128;
+    p.animSpeed = i % 3 == 0 ? 10.0f : 47.5f;
+    return p;
+}
+
+// Same fields as ParticleEmitter::Update fills, template index keeps particle id, as pool reorders particles
+void SpawnParticle(ParticlePool& pool, int range, int id, const OldParticle& p)
+{
+    size_t idx = pool.Spawn(range);
+    TEST_CHECK(idx != ParticlePool::InvalidIndex);
+
+    pool.templateIdx[idx] = id;
+    pool.maxLifeTime[idx] = (float)p.maxLifeTimeSec;
+    pool.birthMargin[idx] = (float)p.birthMarginSec;
+    pool.deathMargin[idx] = (float)p.deathMarginSec;
+    pool.tintR[idx] = p.tint.x;
+    pool.tintG[idx] = p.tint.y;
+    pool.tintB[idx] = p.tint.z;
+    pool.tintA[idx] = p.tint.w;
+    pool.posX[idx] = p.pos.x;
+    pool.posY[idx] = p.pos.y;
+    pool.posZ[idx] = p.pos.z;
+    pool.velX[idx] = p.posDelta.x;
+    pool.velY[idx] = p.posDelta.y;
+    pool.velZ[idx] = p.posDelta.z;
+    pool.curFrame[idx] = p.curFrame;
+    pool.firstFrame[idx] = (float)(id % 3 * p.frameCount);
+    pool.frameCount[idx] = (float)p.frameCount;
+    pool.frameSpeed[idx] = p.animSpeed;
+}
+
+bool EqualParticles(const ParticlePool& a, size_t i, const ParticlePool& b, size_t j)
+{
+    bool equal = a.templateIdx[i] == b.templateIdx[j];
+    for (auto pArray : { &ParticlePool::posX, &ParticlePool::posY, &ParticlePool::posZ, &ParticlePool::fade,
+        &ParticlePool::lifeTime, &ParticlePool::curFrame })
+    {
+        equal = equal && memcmp(&(a.*pArray)[i], &(b.*pArray)[j], sizeof(float)) == 0;
+    }
+    return equal;
+}
+
+UINT64 HashParticle(UINT64 hash, const ParticlePool& pool, size_t idx)
+{
+    for (auto pArray : { &ParticlePool::posX, &ParticlePool::posY, &ParticlePool::posZ, &ParticlePool::fade,
+        &ParticlePool::lifeTime, &ParticlePool::curFrame })
+    {
+        UINT32 bits = 0;
+        memcpy(&bits, &(pool.*pArray)[idx], sizeof(bits));
+        hash = (hash ^ bits) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool Near(float a, float b, float tolerance)
+{
+    return fabsf(a - b) <= tolerance * std::max(1.0f, fabsf(b));
+}
+
+// Known answer of Philox4x32-10 from Random123 for zero key and counter
+void TestPhilox()
+{
+    const UINT32 expected[4] = { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 };
+
+    float values[4];
+    ParticleRandom(0).Generate(0, 0, values);
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_CHECK(values[i] == (float)(expected[i] >> 8) / 16777216.0f);
+    }
+
+    // Every counter word, stream and seed change values
+    float other[4];
+    ParticleRandom(0).Generate(1ull << 32, 0, other);
+    TEST_CHECK(memcmp(values, other, sizeof(values)) != 0);
+    ParticleRandom(0).Generate(0, 1, other);
+    TEST_CHECK(memcmp(values, other, sizeof(values)) != 0);
+    ParticleRandom(1).Generate(0, 0, other);
+    TEST_CHECK(memcmp(values, other, sizeof(values)) != 0);
+
+    // Values are in [0, 1) and don't depend on previous calls
+    for (UINT64 counter = 0; counter < 1000; counter++)
+    {
+        ParticleRandom(7).Generate(counter, 3, values);
+        for (int i = 0; i < 4; i++)
+        {
+            TEST_CHECK(values[i] >= 0.0f && values[i] < 1.0f);
+        }
+    }
+    ParticleRandom(7).Generate(123, 3, values);
+    ParticleRandom(7).Generate(123, 3, other);
+    TEST_CHECK(memcmp(values, other, sizeof(values)) == 0);
+}
+
+// SIMD kernel processes full vectors of large range, single particle ranges go through scalar kernel only,
+// so both kernels are compared on the same particles within one build.
+// Particles are compared with old Particle::Update, which kept life time in double
+void TestUpdate()
+{
+    const int count = 1001; // Not multiple of vector width, so range has scalar tail
+
+    ParticlePool pool;
+    int range = pool.AddRange(count);
+
+    ParticlePool scalarPool;
+    std::vector<OldParticle> oldParticles(count);
+    for (int i = 0; i < count; i++)
+    {
+        oldParticles[i] = MakeParticle(i);
+
+        scalarPool.AddRange(1);
+        SpawnParticle(scalarPool, i, i, oldParticles[i]);
+        SpawnParticle(pool, range, i, oldParticles[i]);
+    }
+
+    int birthSteps = 0;
+    int deathSteps = 0;
+    int wrapSteps = 0;
+    for (int step = 0; step < StepCount; step++)
+    {
+        pool.Update(range, DeltaSec, DeltaSec);
+        for (int i = 0; i < count; i++)
+        {
+            scalarPool.Update(i, DeltaSec, DeltaSec);
+
+            if (!oldParticles[i].IsDead())
+            {
+                float frame = oldParticles[i].curFrame;
+                oldParticles[i].Update(DeltaSec);
+
+                birthSteps += oldParticles[i].lifeTimeSec < oldParticles[i].birthMarginSec ? 1 : 0;
+                deathSteps += oldParticles[i].lifeTimeSec > oldParticles[i].maxLifeTimeSec - oldParticles[i].deathMarginSec ? 1 : 0;
+                wrapSteps += oldParticles[i].curFrame < frame ? 1 : 0;
+            }
+        }
+
+        // Same particles are alive in both pools and in old model
+        size_t aliveCount = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const bool alive = scalarPool.GetRange(i).count == 1;
+            TEST_CHECK(alive == !oldParticles[i].IsDead());
+            aliveCount += alive ? 1 : 0;
+        }
+        TEST_CHECK(pool.GetRange(range).count == aliveCount);
+
+        const ParticlePool::Range& r = pool.GetRange(range);
+        for (size_t idx = r.start; idx < r.start + r.count; idx++)
+        {
+            const int id = pool.templateIdx[idx];
+            TEST_CHECK(scalarPool.GetRange(id).count == 1);
+            TEST_CHECK(EqualParticles(pool, idx, scalarPool, scalarPool.GetRange(id).start));
+
+            // Float life time drifts from double one, which moves fade on short margins
+            const OldParticle& p = oldParticles[id];
+            TEST_CHECK(Near(pool.tintR[idx] * pool.fade[idx], p.curTint.x, 1e-3f));
+            TEST_CHECK(Near(pool.tintG[idx] * pool.fade[idx], p.curTint.y, 1e-3f));
+            TEST_CHECK(Near(pool.tintB[idx] * pool.fade[idx], p.curTint.z, 1e-3f));
+            TEST_CHECK(Near(pool.tintA[idx] * pool.fade[idx], p.curTint.w, 1e-3f));
+            TEST_CHECK(Near(pool.posX[idx], p.pos.x, 1e-5f));
+            TEST_CHECK(Near(pool.posY[idx], p.pos.y, 1e-5f));
+            TEST_CHECK(Near(pool.posZ[idx], p.pos.z, 1e-5f));
+            TEST_CHECK(Near(pool.curFrame[idx], p.curFrame, 1e-5f));
+            TEST_CHECK(pool.curFrame[idx] >= 0.0f && pool.curFrame[idx] < pool.frameCount[idx]);
+
+            // Sequence doesn't change while particle lives and moves in pool
+            TEST_CHECK(pool.firstFrame[idx] == (float)(id % 3 * p.frameCount));
+        }
+    }
+
+    // All cases are hit
+    TEST_CHECK(birthSteps > 0);
+    TEST_CHECK(deathSteps > 0);
+    TEST_CHECK(wrapSteps > 0);
+    TEST_CHECK(pool.GetRange(range).count > 0 && pool.GetRange(range).count < (size_t)count);
+
+    // Scalar pool doesn't reorder particles, so its state is the same in any build
+    UINT64 hash = 0xcbf29ce484222325ull;
+    for (int i = 0; i < count; i++)
+    {
+        if (scalarPool.GetRange(i).count == 1)
+        {
+            hash = HashParticle(hash, scalarPool, scalarPool.GetRange(i).start);
+        }
+    }
+    printf("%s, state hash 0x%016llx\n", SIMD::GetName(), (unsigned long long)hash);
+    TEST_CHECK(hash == ExpectedStateHash);
+}
+
+} // anonymous
+
+int main(int, char**)
+{
+    TestPhilox();
+    TestUpdate();
+
+    return Test::Result("particle_update_test");
+}
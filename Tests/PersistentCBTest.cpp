@@ -0,0 +1,245 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "PlatformPersistentCBAllocator.h"
+
+#include "TestUtil.h"
+
+using namespace Platform;
+
+// Dirty list of persistent constant buffers turns into sorted, merged copy runs
+namespace
+{
+
+using CopyRun = PersistentCBAllocator::CopyRun;
+
+const UINT64 MaxCopySize = 4 * 1024 * 1024;
+
+bool IsRun(const CopyRun& run, UINT64 offset, UINT64 size, UINT bufferCount)
+{
+    return run.offset == offset && run.size == size && run.bufferCount == bufferCount;
+}
+
+void TestAllocate()
+{
+    PersistentCBAllocator allocator;
+    allocator.Init(1024);
+
+    UINT a = allocator.Allocate(16);
+    UINT b = allocator.Allocate(300);
+    TEST_CHECK(allocator.GetOffset(a) == 0 && allocator.GetSize(a) == 256);
+    TEST_CHECK(allocator.GetOffset(b) == 256 && allocator.GetSize(b) == 512);
+    TEST_CHECK(allocator.Allocate(512) == PersistentCBAllocator::InvalidHandle);
+    TEST_CHECK(allocator.GetBufferCount() == 2 && allocator.GetUsedSize() == 768);
+
+    // Dirty since allocation, but listed only after update
+    TEST_CHECK(allocator.IsDirty(a) && allocator.GetDirtyCount() == 0);
+
+    // Freed buffer is reused for the same size only
+    allocator.Free(a);
+    TEST_CHECK(allocator.Allocate(512) == PersistentCBAllocator::InvalidHandle);
+    TEST_CHECK(allocator.Allocate(200) == a);
+}
+
+void TestMerge()
+{
+    PersistentCBAllocator allocator;
+    allocator.Init(64 * 256);
+
+    std::vector<UINT> handles;
+    for (int i = 0; i < 8; i++)
+    {
+        handles.push_back(allocator.Allocate(256));
+    }
+
+    // Updated out of order and twice, buffer 4 is left out
+    const int updates[] = { 7, 2, 0, 1, 2, 5, 6, 3, 0 };
+    for (int idx : updates)
+    {
+        allocator.MarkDirty(handles[idx]);
+    }
+    TEST_CHECK(allocator.GetDirtyCount() == 7);
+
+    std::vector<CopyRun> runs;
+    allocator.BuildCopyRuns(MaxCopySize, runs);
+    TEST_CHECK(runs.size() == 2);
+    TEST_CHECK(runs.size() == 2 && IsRun(runs[0], 0, 4 * 256, 4) && IsRun(runs[1], 5 * 256, 3 * 256, 3));
+
+    allocator.CompleteCopyRuns(runs, runs.size());
+    TEST_CHECK(allocator.GetDirtyCount() == 0);
+    TEST_CHECK(!allocator.IsDirty(handles[0]) && !allocator.IsDirty(handles[7]));
+    TEST_CHECK(allocator.IsDirty(handles[4]));
+
+    allocator.BuildCopyRuns(MaxCopySize, runs);
+    TEST_CHECK(runs.empty());
+}
+
+void TestFreed()
+{
+    PersistentCBAllocator allocator;
+    allocator.Init(64 * 256);
+
+    UINT a = allocator.Allocate(256);
+    UINT b = allocator.Allocate(256);
+    UINT c = allocator.Allocate(256);
+    allocator.MarkDirty(a);
+    allocator.MarkDirty(b);
+    allocator.MarkDirty(c);
+
+    // Freed entry is dropped, so run is split
+    allocator.Free(b);
+
+    std::vector<CopyRun> runs;
+    allocator.BuildCopyRuns(MaxCopySize, runs);
+    TEST_CHECK(runs.size() == 2 && IsRun(runs[0], 0, 256, 1) && IsRun(runs[1], 512, 256, 1));
+
+    // Reallocated after free, buffer is listed twice, but copied once
+    UINT d = allocator.Allocate(256);
+    TEST_CHECK(d == b);
+    allocator.MarkDirty(d);
+
+    allocator.BuildCopyRuns(MaxCopySize, runs);
+    TEST_CHECK(runs.size() == 1 && IsRun(runs[0], 0, 768, 3));
+    allocator.CompleteCopyRuns(runs, runs.size());
+    TEST_CHECK(allocator.GetDirtyCount() == 0);
+}
+
+void TestSplit()
+{
+    PersistentCBAllocator allocator;
+    allocator.Init(64 * 256);
+
+    std::vector<UINT> handles;
+    for (int i = 0; i < 5; i++)
+    {
+        handles.push_back(allocator.Allocate(256));
+        allocator.MarkDirty(handles.back());
+    }
+
+    std::vector<CopyRun> runs;
+    allocator.BuildCopyRuns(512, runs);
+    TEST_CHECK(runs.size() == 3);
+    TEST_CHECK(runs.size() == 3 && IsRun(runs[0], 0, 512, 2) && IsRun(runs[1], 512, 512, 2) && IsRun(runs[2], 1024, 256, 1));
+
+    // Dynamic heap is out of space after the first run, the rest stays dirty
+    allocator.CompleteCopyRuns(runs, 1);
+    TEST_CHECK(allocator.GetDirtyCount() == 3);
+    TEST_CHECK(!allocator.IsDirty(handles[1]) && allocator.IsDirty(handles[2]));
+
+    allocator.BuildCopyRuns(512, runs);
+    TEST_CHECK(runs.size() == 2 && IsRun(runs[0], 512, 512, 2) && IsRun(runs[1], 1024, 256, 1));
+
+    // Buffer larger than copy limit still goes as single run
+    UINT large = allocator.Allocate(1024);
+    allocator.MarkDirty(large);
+    allocator.BuildCopyRuns(512, runs);
+    TEST_CHECK(runs.size() == 3 && IsRun(runs[2], 1280, 1024, 1));
+}
+
+// Runs cover exactly listed buffers, in address order, without overlaps and within size limit
+void TestRandom()
+{
+    std::mt19937 random(1234);
+
+    PersistentCBAllocator allocator;
+    allocator.Init(1024 * 256);
+
+    std::vector<UINT> live;
+    std::vector<bool> listed;
+    const UINT64 maxCopySize = 4 * 256;
+
+    for (int frame = 0; frame < 200; frame++)
+    {
+        for (int op = 0; op < 50; op++)
+        {
+            int kind = random() % 4;
+            if (kind == 0 || live.empty())
+            {
+                UINT handle = allocator.Allocate(256 * (1 + random() % 3));
+                if (handle != PersistentCBAllocator::InvalidHandle)
+                {
+                    live.push_back(handle);
+                    listed.resize(std::max<size_t>(listed.size(), handle + 1), false);
+                    listed[handle] = false;
+                }
+            }
+            else if (kind == 1)
+            {
+                size_t idx = random() % live.size();
+                allocator.Free(live[idx]);
+                listed[live[idx]] = false;
+                live.erase(live.begin() + idx);
+            }
+            else
+            {
+                UINT handle = live[random() % live.size()];
+                allocator.MarkDirty(handle);
+                listed[handle] = true;
+            }
+        }
+
+        std::vector<CopyRun> runs;
+        allocator.BuildCopyRuns(maxCopySize, runs);
+
+        UINT64 expectedBytes = 0;
+        UINT expectedBuffers = 0;
+        for (UINT handle : live)
+        {
+            if (listed[handle])
+            {
+                expectedBytes += allocator.GetSize(handle);
+                ++expectedBuffers;
+
+                // Every listed buffer is within some run
+                bool covered = false;
+                for (const auto& run : runs)
+                {
+                    covered = covered || (allocator.GetOffset(handle) >= run.offset && allocator.GetOffset(handle) + allocator.GetSize(handle) <= run.offset + run.size);
+                }
+                TEST_CHECK(covered);
+            }
+        }
+
+        UINT64 bytes = 0;
+        UINT buffers = 0;
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            bytes += runs[i].size;
+            buffers += runs[i].bufferCount;
+            TEST_CHECK(runs[i].size <= maxCopySize || runs[i].bufferCount == 1);
+            TEST_CHECK(i == 0 || runs[i - 1].offset + runs[i - 1].size <= runs[i].offset);
+        }
+        TEST_CHECK(bytes == expectedBytes && buffers == expectedBuffers);
+
+        // Sometimes dynamic heap runs out
+        size_t copied = random() % 5 == 0 ? runs.size() / 2 : runs.size();
+        allocator.CompleteCopyRuns(runs, copied);
+        for (UINT handle : live)
+        {
+            bool inCopied = false;
+            for (size_t i = 0; i < copied; i++)
+            {
+                inCopied = inCopied || (allocator.GetOffset(handle) >= runs[i].offset && allocator.GetOffset(handle) < runs[i].offset + runs[i].size);
+            }
+            if (listed[handle] && inCopied)
+            {
+                listed[handle] = false;
+                TEST_CHECK(!allocator.IsDirty(handle));
+            }
+        }
+    }
+}
+
+} // anonymous
+
+int main()
+{
+    TestAllocate();
+    TestMerge();
+    TestFreed();
+    TestSplit();
+    TestRandom();
+
+    return Test::Result("persistent_cb_test");
+}
@@ -0,0 +1,103 @@
+#include "stdafx.h"
+
+#include "ShadowCache.h"
+
+#include "TestUtil.h"
+
+namespace
+{
+
+const UINT SplitCount = 4;
+
+ShadowCache::Key MakeKey(float offset, UINT64 staticVersion, UINT setup)
+{
+    ShadowCache::Key key;
+    key.viewProj.Offset(Point3f{ offset, 0.0f, 0.0f });
+    key.staticVersion = staticVersion;
+    key.setup = setup;
+    return key;
+}
+
+// Static depth is drawn the first time and after any change of the key
+void TestUpdate()
+{
+    ShadowCache cache(SplitCount);
+    for (UINT i = 0; i < SplitCount; i++)
+    {
+        TEST_CHECK(!cache.IsValid(i));
+    }
+
+    const ShadowCache::Key key = MakeKey(1.0f, 1, 0x2);
+    TEST_CHECK(cache.Update(0, key));
+    TEST_CHECK(cache.IsValid(0));
+    TEST_CHECK(!cache.IsValid(1));
+    TEST_CHECK(!cache.Update(0, key));
+    TEST_CHECK(cache.GetRebuildCount() == 1);
+
+    // Every field of the key makes new static depth
+    TEST_CHECK(cache.Update(0, MakeKey(1.0f, 2, 0x2)));
+    TEST_CHECK(cache.Update(0, MakeKey(1.0f, 2, 0x12)));
+    TEST_CHECK(cache.Update(0, MakeKey(1.5f, 2, 0x12)));
+    TEST_CHECK(!cache.Update(0, MakeKey(1.5f, 2, 0x12)));
+    TEST_CHECK(cache.GetRebuildCount() == 4);
+
+    // Matrices are compared exactly, the smallest move of split bounds is a change
+    TEST_CHECK(cache.Update(0, MakeKey(nextafterf(1.5f, 2.0f), 2, 0x12)));
+
+    // Going back to the previous key is a change too, only one key is cached per split
+    TEST_CHECK(cache.Update(0, MakeKey(1.5f, 2, 0x12)));
+    TEST_CHECK(cache.GetRebuildCount() == 6);
+}
+
+// Splits are cached on their own
+void TestSplits()
+{
+    ShadowCache cache(SplitCount);
+    for (UINT i = 0; i < SplitCount; i++)
+    {
+        TEST_CHECK(cache.Update(i, MakeKey((float)i, 1, 0)));
+    }
+
+    // The same key in other split is a change for it
+    TEST_CHECK(cache.Update(1, MakeKey(0.0f, 1, 0)));
+    TEST_CHECK(!cache.Update(0, MakeKey(0.0f, 1, 0)));
+    TEST_CHECK(!cache.Update(2, MakeKey(2.0f, 1, 0)));
+    TEST_CHECK(!cache.Update(3, MakeKey(3.0f, 1, 0)));
+    TEST_CHECK(cache.GetRebuildCount() == SplitCount + 1);
+}
+
+// Invalidated splits are drawn again with the same key, as caching is turned back on
+void TestInvalidate()
+{
+    ShadowCache cache(SplitCount);
+    for (UINT i = 0; i < SplitCount; i++)
+    {
+        cache.Update(i, MakeKey((float)i, 1, 0));
+    }
+
+    cache.Invalidate();
+    for (UINT i = 0; i < SplitCount; i++)
+    {
+        TEST_CHECK(!cache.IsValid(i));
+        TEST_CHECK(cache.Update(i, MakeKey((float)i, 1, 0)));
+        TEST_CHECK(!cache.Update(i, MakeKey((float)i, 1, 0)));
+    }
+    TEST_CHECK(cache.GetRebuildCount() == SplitCount * 2);
+
+    // Invalidate of empty cache changes nothing
+    ShadowCache empty(SplitCount);
+    empty.Invalidate();
+    TEST_CHECK(empty.GetRebuildCount() == 0);
+    TEST_CHECK(empty.Update(0, MakeKey(0.0f, 0, 0)));
+}
+
+} // anonymous
+
+int main()
+{
+    TestUpdate();
+    TestSplits();
+    TestInvalidate();
+
+    return Test::Result("shadow_cache_test");
+}
@@ -0,0 +1,222 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "ShadowCasterCull.h"
+
+#include "TestUtil.h"
+
+namespace
+{
+
+// Boxes closer than this to volume sides are not checked, float plane test may go either way there
+const double BorderEps = 1e-3;
+
+std::mt19937 s_random(1234);
+
+float RandomFloat(float low, float high)
+{
+    return std::uniform_real_distribution<float>(low, high)(s_random);
+}
+
+Point3f RandomPoint(float low, float high)
+{
+    return Point3f{ RandomFloat(low, high), RandomFloat(low, high), RandomFloat(low, high) };
+}
+
+// Orthonormal light basis of random direction, light is placed away from the scene against it
+LightSpace RandomLight()
+{
+    Point3f dir = RandomPoint(-1.0f, 1.0f);
+    dir.normalize();
+    Point3f right = Point3f{ 0.0f, 1.0f, 0.0f }.cross(dir);
+    right.normalize();
+    const Point3f up = dir.cross(right);
+
+    LightSpace light;
+    light.pos = RandomPoint(-10.0f, 10.0f) - dir * 100.0f;
+    light.right = right;
+    light.up = up;
+    light.dir = dir;
+    return light;
+}
+
+// Light space bounds of box corners, computed in double
+void CalcLightBox(const LightSpace& light, const Point3f& center, const Point3f& extent, double lightMin[3], double lightMax[3])
+{
+    const Point3f* axes[3] = { &light.right, &light.up, &light.dir };
+    for (int a = 0; a < 3; a++)
+    {
+        lightMin[a] = std::numeric_limits<double>::max();
+        lightMax[a] = -std::numeric_limits<double>::max();
+    }
+    for (int corner = 0; corner < 8; corner++)
+    {
+        const double x = (double)center.x + ((corner & 1) ? extent.x : -extent.x) - light.pos.x;
+        const double y = (double)center.y + ((corner & 2) ? extent.y : -extent.y) - light.pos.y;
+        const double z = (double)center.z + ((corner & 4) ? extent.z : -extent.z) - light.pos.z;
+        for (int a = 0; a < 3; a++)
+        {
+            const double value = x * axes[a]->x + y * axes[a]->y + z * axes[a]->z;
+            lightMin[a] = std::min(lightMin[a], value);
+            lightMax[a] = std::max(lightMax[a], value);
+        }
+    }
+}
+
+void AddRandomBoxes(Platform::BoxList& boxes, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        boxes.Add(RandomPoint(-50.0f, 50.0f), RandomPoint(0.0f, 10.0f));
+    }
+}
+
+// Box is visible, if its light space bounds overlap volume, volume is open toward the light
+void TestLightVolume()
+{
+    size_t checked = 0;
+    size_t visibleCount = 0;
+    for (int i = 0; i < 200; i++)
+    {
+        const LightSpace light = RandomLight();
+
+        const Point3f bbMin{ RandomFloat(-40.0f, 0.0f), RandomFloat(-40.0f, 0.0f), RandomFloat(0.0f, 100.0f) };
+        const Point3f bbMax{ RandomFloat(0.0f, 40.0f), RandomFloat(0.0f, 40.0f), RandomFloat(100.0f, 200.0f) };
+
+        Platform::Frustum frustum;
+        SetLightVolume(frustum, light, bbMin, bbMax);
+
+        Platform::BoxList boxes;
+        AddRandomBoxes(boxes, 100);
+        std::vector<UINT8> visible(boxes.GetSize());
+        const size_t count = frustum.TestBoxes(boxes, visible.data());
+        TEST_CHECK(count == (size_t)std::count(visible.begin(), visible.end(), (UINT8)1));
+
+        for (size_t b = 0; b < boxes.GetSize(); b++)
+        {
+            const Point3f center{ boxes.centerX[b], boxes.centerY[b], boxes.centerZ[b] };
+            const Point3f extent{ boxes.extentX[b], boxes.extentY[b], boxes.extentZ[b] };
+
+            double lightMin[3];
+            double lightMax[3];
+            CalcLightBox(light, center, extent, lightMin, lightMax);
+
+            // Distance to the nearest side, either outside or inside
+            const double gaps[] = {
+                lightMin[0] - bbMax.x, bbMin.x - lightMax[0],
+                lightMin[1] - bbMax.y, bbMin.y - lightMax[1],
+                lightMin[2] - bbMax.z
+            };
+            bool outside = false;
+            bool border = false;
+            for (double gap : gaps)
+            {
+                outside = outside || gap > 0.0;
+                border = border || fabs(gap) < BorderEps;
+            }
+            if (border)
+            {
+                continue;
+            }
+
+            TEST_CHECK(visible[b] == (outside ? 0 : 1));
+            ++checked;
+            visibleCount += outside ? 0 : 1;
+        }
+    }
+    // Both outcomes are covered
+    TEST_CHECK(visibleCount > checked / 10 && visibleCount < checked * 9 / 10);
+
+    // Empty box culls everything, near plane doesn't cull boxes behind the light
+    const LightSpace light = RandomLight();
+    Platform::BoxList boxes;
+    AddRandomBoxes(boxes, 100);
+    std::vector<UINT8> visible(boxes.GetSize());
+
+    Platform::Frustum empty;
+    SetLightVolume(empty, light, Point3f{ 1.0f, -10.0f, 0.0f }, Point3f{ -1.0f, 10.0f, 200.0f });
+    TEST_CHECK(empty.TestBoxes(boxes, visible.data()) == 0);
+
+    Platform::Frustum behind;
+    SetLightVolume(behind, light, Point3f{ -1000.0f, -1000.0f, 50.0f }, Point3f{ 1000.0f, 1000.0f, 1000.0f });
+    Platform::BoxList back;
+    back.Add(light.pos - light.dir * 50.0f, Point3f{ 1.0f, 1.0f, 1.0f });
+    TEST_CHECK(behind.TestBoxes(back, visible.data()) == 1);
+}
+
+// Box is culled, if all its corners are strictly inside inner rect shrunk by margin, hidden boxes stay hidden
+void TestInnerCasters()
+{
+    size_t checked = 0;
+    size_t culledTotal = 0;
+    for (int i = 0; i < 200; i++)
+    {
+        const LightSpace light = RandomLight();
+
+        const Point2f innerMin{ RandomFloat(-60.0f, -10.0f), RandomFloat(-60.0f, -10.0f) };
+        const Point2f innerMax{ RandomFloat(10.0f, 60.0f), RandomFloat(10.0f, 60.0f) };
+        const float margin = RandomFloat(0.0f, 2.0f);
+
+        Platform::BoxList boxes;
+        AddRandomBoxes(boxes, 100);
+        std::vector<UINT8> visible(boxes.GetSize());
+        for (auto& flag : visible)
+        {
+            flag = RandomFloat(0.0f, 1.0f) < 0.8f ? 1 : 0;
+        }
+        const std::vector<UINT8> before = visible;
+
+        const size_t culled = CullInnerCasters(light, boxes, innerMin, innerMax, margin, visible.data());
+
+        size_t culledCount = 0;
+        for (size_t b = 0; b < boxes.GetSize(); b++)
+        {
+            TEST_CHECK(visible[b] <= before[b]);
+            culledCount += before[b] - visible[b];
+            if (before[b] == 0)
+            {
+                continue;
+            }
+
+            const Point3f center{ boxes.centerX[b], boxes.centerY[b], boxes.centerZ[b] };
+            const Point3f extent{ boxes.extentX[b], boxes.extentY[b], boxes.extentZ[b] };
+
+            double lightMin[3];
+            double lightMax[3];
+            CalcLightBox(light, center, extent, lightMin, lightMax);
+
+            const double gaps[] = {
+                lightMin[0] - (innerMin.x + margin), (innerMax.x - margin) - lightMax[0],
+                lightMin[1] - (innerMin.y + margin), (innerMax.y - margin) - lightMax[1]
+            };
+            bool inside = true;
+            bool border = false;
+            for (double gap : gaps)
+            {
+                inside = inside && gap > 0.0;
+                border = border || fabs(gap) < BorderEps;
+            }
+            if (border)
+            {
+                continue;
+            }
+
+            TEST_CHECK(visible[b] == (inside ? 0 : 1));
+            ++checked;
+        }
+        TEST_CHECK(culled == culledCount);
+        culledTotal += culled;
+    }
+    TEST_CHECK(culledTotal > checked / 10 && culledTotal < checked * 9 / 10);
+}
+
+} // anonymous
+
+int main()
+{
+    TestLightVolume();
+    TestInnerCasters();
+
+    return Test::Result("shadow_caster_cull_test");
+}
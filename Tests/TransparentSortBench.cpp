@@ -0,0 +1,179 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "TransparentSort.h"
+#include "ParticleData.h"
+
+#include "TestUtil.h"
+
+// Back to front sort of particle instances and batches, which are left after it
+namespace
+{
+
+const float FarPlane = 200.0f;          // Same as a8.Particles camera
+const int SmokeTemplateCount = 3;
+
+struct Particle
+{
+    float depth;
+    int emitter;
+};
+
+// Smoke columns on grid in front of camera, particles of emitter rise and spread around it
+std::vector<Particle> CreateParticles(size_t count, size_t emitterCount, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> spread(-0.5f, 0.5f);
+    std::uniform_real_distribution<float> height(0.0f, 3.0f);
+
+    std::vector<Particle> particles(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const int emitter = (int)(i % emitterCount);
+        const float x = (emitter % 16) * 4.0f - 30.0f + spread(random) * (1.0f + height(random));
+        const float z = (emitter / 16) * 4.0f + 5.0f + spread(random);
+        const float y = height(random) - 1.5f;
+
+        particles[i].depth = sqrtf(x * x + y * y + z * z);
+        particles[i].emitter = emitter;
+    }
+    return particles;
+}
+
+// Same as Renderer::RenderParticles, adjacent items of the same template make single draw
+size_t CountBatches(const std::vector<TransparentSorter::Item>& items)
+{
+    size_t batches = 0;
+    size_t i = 0;
+    while (i < items.size())
+    {
+        const UINT32 templateIdx = TransparentSorter::GetTie(items[i]);
+        const size_t first = i;
+        while (i < items.size() && TransparentSorter::GetTie(items[i]) == templateIdx && i - first < PARTICLE_MAX_INSTANCES)
+        {
+            ++i;
+        }
+        ++batches;
+    }
+    return batches;
+}
+
+enum TemplateMode
+{
+    TemplateModeSingle = 0,     // One template, smoke sequences are in its texture array
+    TemplateModePerEmitter,     // Emitter picks one template for all its particles
+    TemplateModePerParticle,    // Emitter picks template for every particle, as smoke did with template per sequence
+
+    TemplateModeCount
+};
+
+const char* TemplateModeNames[TemplateModeCount] = { "single", "per emitter", "per particle" };
+
+UINT32 GetTemplate(TemplateMode mode, const Particle& particle, size_t idx)
+{
+    switch (mode)
+    {
+    case TemplateModePerEmitter:
+        return (UINT32)(particle.emitter % SmokeTemplateCount);
+    case TemplateModePerParticle:
+        return (UINT32)((idx * 2654435761u >> 16) % SmokeTemplateCount);
+    default:
+        return 0;
+    }
+}
+
+// Depths of particles grouped by template, as ParticleInstancePacker gives them to Renderer::RenderTransparents.
+// Particles of template t are in [offsets[t], offsets[t + 1])
+std::vector<float> PackByTemplate(TemplateMode mode, const std::vector<Particle>& particles, std::vector<size_t>& offsets)
+{
+    offsets.assign(SmokeTemplateCount + 1, 0);
+    for (size_t i = 0; i < particles.size(); i++)
+    {
+        ++offsets[GetTemplate(mode, particles[i], i) + 1];
+    }
+    for (int t = 0; t < SmokeTemplateCount; t++)
+    {
+        offsets[t + 1] += offsets[t];
+    }
+
+    std::vector<float> depths(particles.size());
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < particles.size(); i++)
+    {
+        depths[next[GetTemplate(mode, particles[i], i)]++] = particles[i].depth;
+    }
+    return depths;
+}
+
+void AddParticles(TransparentSorter& sorter, const std::vector<float>& depths, const std::vector<size_t>& offsets)
+{
+    sorter.Begin(FarPlane);
+    for (int t = 0; t < SmokeTemplateCount; t++)
+    {
+        sorter.Add(depths.data() + offsets[t], offsets[t + 1] - offsets[t], (UINT32)t, (UINT32)offsets[t]);
+    }
+}
+
+} // anonymous
+
+int main(int argc, char** argv)
+{
+    const bool quick = Test::IsQuick(argc, argv);
+    const int repeats = quick ? 1 : 20;
+
+    std::vector<size_t> counts = { 1000, 10000, 100000 };
+    if (quick)
+    {
+        counts = { 1000 };
+    }
+
+    std::mt19937 random(1234);
+
+    printf("%-10s %-14s %10s %10s %12s %12s %9s %10s\n", "items", "templates", "add us", "sort us", "radix us", "std::sort us", "speedup", "batches");
+    for (size_t count : counts)
+    {
+        const size_t emitterCount = std::max<size_t>(count / 1000, 1) * 16;
+        std::vector<Particle> particles = CreateParticles(count, emitterCount, random);
+
+        for (int mode = 0; mode < TemplateModeCount; mode++)
+        {
+            std::vector<size_t> offsets;
+            const std::vector<float> depths = PackByTemplate((TemplateMode)mode, particles, offsets);
+
+            // Sort time is left after adding, as histograms are counted by Add
+            TransparentSorter sorter;
+            double addMs = Test::MeasureMs(repeats, [&]()
+            {
+                AddParticles(sorter, depths, offsets);
+                Test::KeepAlive(sorter.GetItems().data());
+            });
+            double radixMs = Test::MeasureMs(repeats, [&]()
+            {
+                AddParticles(sorter, depths, offsets);
+                sorter.Sort();
+            });
+
+            // Same keys, sorted by comparison
+            std::vector<TransparentSorter::Item> items;
+            double stdMs = Test::MeasureMs(repeats, [&]()
+            {
+                TransparentSorter keys;
+                AddParticles(keys, depths, offsets);
+                items = keys.GetItems();
+                std::stable_sort(items.begin(), items.end(), [](const TransparentSorter::Item& a, const TransparentSorter::Item& b) { return a.key < b.key; });
+            });
+
+            bool equal = items.size() == sorter.GetItems().size();
+            for (size_t i = 0; i < items.size() && equal; i++)
+            {
+                equal = items[i].key == sorter.GetItems()[i].key && items[i].index == sorter.GetItems()[i].index;
+            }
+            TEST_CHECK(equal);
+
+            printf("%-10zu %-14s %10.1f %10.1f %12.1f %12.1f %8.2fx %10zu\n", count, TemplateModeNames[mode], addMs * 1000.0,
+                std::max(radixMs - addMs, 0.0) * 1000.0, radixMs * 1000.0, stdMs * 1000.0, stdMs / radixMs, CountBatches(sorter.GetItems()));
+        }
+    }
+
+    return Test::Result("transparent_sort_bench");
+}
@@ -0,0 +1,151 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include "TransparentSort.h"
+
+#include "TestUtil.h"
+
+namespace
+{
+
+bool KeyLess(const TransparentSorter::Item& a, const TransparentSorter::Item& b)
+{
+    return a.key < b.key;
+}
+
+bool EqualItems(const std::vector<TransparentSorter::Item>& a, const std::vector<TransparentSorter::Item>& b)
+{
+    bool equal = a.size() == b.size();
+    for (size_t i = 0; i < a.size() && equal; i++)
+    {
+        equal = a[i].key == b[i].key && a[i].tie == b[i].tie && a[i].index == b[i].index;
+    }
+    return equal;
+}
+
+// Radix sort gives the same order as stable comparison sort, equal keys keep input order
+void TestRadixSort()
+{
+    std::mt19937 random(1234);
+
+    std::vector<size_t> counts = { 0, 1, 2, 17, 1000, 100000 };
+    for (size_t count : counts)
+    {
+        // Full range keys, keys with few distinct values and keys, which differ only in some digits
+        for (UINT32 mask : { 0xFFFFu, 0x7u, 0xFF00u, 0x00FFu })
+        {
+            std::vector<TransparentSorter::Item> items(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                items[i].key = (UINT16)(random() & mask);
+                items[i].tie = (UINT16)random();
+                items[i].index = (UINT32)i;
+            }
+
+            std::vector<TransparentSorter::Item> expected = items;
+            std::stable_sort(expected.begin(), expected.end(), KeyLess);
+
+            // std::sort doesn't keep order of equal keys, it is compared by keys only
+            std::vector<TransparentSorter::Item> unstable = items;
+            std::sort(unstable.begin(), unstable.end(), KeyLess);
+
+            std::vector<TransparentSorter::Item> temp;
+            TransparentSorter::RadixSort(items, temp);
+
+            TEST_CHECK(EqualItems(items, expected));
+            bool equalKeys = items.size() == unstable.size();
+            for (size_t i = 0; i < items.size() && equalKeys; i++)
+            {
+                equalKeys = items[i].key == unstable[i].key;
+            }
+            TEST_CHECK(equalKeys);
+        }
+    }
+
+    // Already sorted input skips all passes and stays in place
+    std::vector<TransparentSorter::Item> items(10);
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        items[i].key = 5;
+        items[i].tie = 0;
+        items[i].index = (UINT32)i;
+    }
+    std::vector<TransparentSorter::Item> expected = items;
+    std::vector<TransparentSorter::Item> temp;
+    TransparentSorter::RadixSort(items, temp);
+    TEST_CHECK(EqualItems(items, expected));
+}
+
+// Items go back to front, items of the same depth keep the order they are added in, so they stay grouped by tie
+void TestSorter()
+{
+    TransparentSorter sorter;
+    sorter.Begin(100.0f);
+    sorter.Add(50.0f, 0, 1);
+    sorter.Add(-1.0f, 0, 5);                        // Behind camera
+    sorter.Add(10.0f, 1, 2);
+    sorter.Add(10.0f, 2, 0);
+    sorter.Add(10.0f, 2, 3);
+    sorter.Add(250.0f, 3, 4);                       // Beyond max depth
+    sorter.Add(10.0f, TransparentSorter::MaxTie, 6);
+    sorter.Sort();
+
+    const std::vector<UINT32> expectedOrder = { 4, 1, 2, 0, 3, 6, 5 };
+    const auto& items = sorter.GetItems();
+    TEST_CHECK(items.size() == expectedOrder.size());
+    for (size_t i = 0; i < items.size() && i < expectedOrder.size(); i++)
+    {
+        TEST_CHECK(items[i].index == expectedOrder[i]);
+    }
+    TEST_CHECK(TransparentSorter::GetTie(items[0]) == 3);
+    TEST_CHECK(TransparentSorter::GetTie(items[5]) == TransparentSorter::MaxTie);
+
+    // Random depths give the same order as comparison sort by depth
+    std::mt19937 random(4321);
+    std::uniform_real_distribution<float> dist(0.0f, 200.0f);
+
+    std::vector<float> depths(5000);
+    sorter.Begin(200.0f);
+    for (size_t i = 0; i < depths.size(); i++)
+    {
+        depths[i] = dist(random);
+        sorter.Add(depths[i], (UINT32)(i % 3), (UINT32)i);
+    }
+    sorter.Sort();
+
+    // Depth step of key is about 0.003 here, farther item never goes after nearer one
+    const float depthStep = 200.0f / ((1u << TransparentSorter::DepthBits) - 1);
+    bool backToFront = true;
+    for (size_t i = 1; i < sorter.GetItems().size(); i++)
+    {
+        backToFront = backToFront && depths[sorter.GetItems()[i - 1].index] + depthStep >= depths[sorter.GetItems()[i].index];
+    }
+    TEST_CHECK(backToFront);
+
+    // Items added at once get the same keys and order as added one by one
+    TransparentSorter bulk;
+    bulk.Begin(200.0f);
+    bulk.Add(depths.data(), 2000, 7, 0);
+    bulk.Add(depths.data() + 2000, depths.size() - 2000, 8, 2000);
+    bulk.Add(depths.data(), 0, 9, 0);
+    bulk.Sort();
+
+    sorter.Begin(200.0f);
+    for (size_t i = 0; i < depths.size(); i++)
+    {
+        sorter.Add(depths[i], i < 2000 ? 7 : 8, (UINT32)i);
+    }
+    sorter.Sort();
+    TEST_CHECK(EqualItems(bulk.GetItems(), sorter.GetItems()));
+}
+
+} // anonymous
+
+int main()
+{
+    TestRadixSort();
+    TestSorter();
+
+    return Test::Result("transparent_sort_test");
+}
@@ -3324,7 +3324,7 @@ Platform::GLTFModelInstance* Renderer::CreateInstance(const Platform::GLTFModel*
 
     pInstance->instObjData = pModel->objData;
 
-    pInstance->nodes = pModel->nodes;
+    pInstance->pose = pModel->bindPose;
 
     return pInstance;
 }
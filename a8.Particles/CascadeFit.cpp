@@ -0,0 +1,62 @@
+#include "stdafx.h"
+#include "CascadeFit.h"
+
+#include <algorithm>
+#include <cmath>
+
+CascadeSphere CalcCascadeSphere(float nearPlane, float farPlane, float tanHalfDiag)
+{
+    assert(nearPlane < farPlane);
+
+    const float k2 = tanHalfDiag * tanHalfDiag;
+
+    // Center is equidistant from near and far corners, for wide slices it can't go beyond far plane
+    CascadeSphere sphere;
+    sphere.centerDist = std::min((farPlane + nearPlane) * (1.0f + k2) * 0.5f, farPlane);
+
+    const float nearDist = sphere.centerDist - nearPlane;
+    const float farDist = farPlane - sphere.centerDist;
+    sphere.radius = sqrtf(std::max(nearDist * nearDist + nearPlane * nearPlane * k2, farDist * farDist + farPlane * farPlane * k2));
+
+    return sphere;
+}
+
+void CalcCascadeRect(const Point2f& center, float radius, UINT mapSize, Point2f& bbMin, Point2f& bbMax)
+{
+    // Snapping moves center by up to half texel. Rect is grown by radius / (mapSize - 1),
+    // which is exactly half texel of the grown rect, so the sphere stays inside
+    const float halfSize = radius * mapSize / (mapSize - 1);
+    const float texelSize = 2.0f * halfSize / mapSize;
+
+    Point2f snapped{ floorf(center.x / texelSize + 0.5f) * texelSize, floorf(center.y / texelSize + 0.5f) * texelSize };
+
+    bbMin = Point2f{ snapped.x - halfSize, snapped.y - halfSize };
+    bbMax = Point2f{ snapped.x + halfSize, snapped.y + halfSize };
+}
+
+void CalcSplitDists(float minDist, float maxDist, float logWeight, UINT splitCount, float* pDists)
+{
+    assert(minDist > 0.0f && minDist < maxDist);
+
+    for (UINT i = 0; i < splitCount; i++)
+    {
+        float t = (float)(i + 1) / splitCount;
+
+        float logDist = minDist * powf(maxDist / minDist, t);
+        float uniformDist = minDist + (maxDist - minDist) * t;
+
+        pDists[i] = logWeight * logDist + (1.0f - logWeight) * uniformDist;
+    }
+}
+
+float QuantizeSplitDist(float dist, bool roundUp)
+{
+    if (dist <= 0.0f)
+    {
+        return dist;
+    }
+
+    const float step = ldexpf(1.0f, ilogbf(dist) - 3);
+
+    return (roundUp ? ceilf(dist / step) : floorf(dist / step)) * step;
+}
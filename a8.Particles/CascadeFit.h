@@ -0,0 +1,24 @@
+#pragma once
+
+#include "PlatformPoint.h"
+
+// Shadow cascade fitting math, distances are given along camera view direction
+struct CascadeSphere
+{
+    float centerDist = 0.0f;
+    float radius = 0.0f;
+};
+
+// Minimal sphere around camera frustum slice between nearPlane and farPlane, tanHalfDiag is tangent of
+// the angle between view direction and frustum edge. Sphere depends on slice only, so it stays the same, while camera rotates
+CascadeSphere CalcCascadeSphere(float nearPlane, float farPlane, float tanHalfDiag);
+
+// Square light space rect, which covers circle of radius around center. Center is snapped to texel grid of the map,
+// which is anchored at light space origin, so the rect moves by whole texels
+void CalcCascadeRect(const Point2f& center, float radius, UINT mapSize, Point2f& bbMin, Point2f& bbMax);
+
+// Splits visible depth range with blend of logarithmic and uniform distributions
+void CalcSplitDists(float minDist, float maxDist, float logWeight, UINT splitCount, float* pDists);
+
+// Rounds distance to 1/8 of its power of two range, so fitted splits don't change every frame
+float QuantizeSplitDist(float dist, bool roundUp);
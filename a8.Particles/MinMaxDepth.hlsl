@@ -15,6 +15,7 @@ RWTexture2D<uint4> lightGrid : register(u2);
 
 groupshared uint uintMaxDepth;
 groupshared uint uintMinDepth;
+groupshared uint uintGeomMaxDepth;
 groupshared uint opaqueLightsCount;
 groupshared uint transLightsCount;
 
@@ -29,6 +30,7 @@ void CS( uint3 groupId : SV_GroupID, uint3 threadId : SV_GroupThreadID )
     {
         uintMaxDepth = 0;
         uintMinDepth = 0xffffffff;
+        uintGeomMaxDepth = 0;
 
         opaqueLightsCount = 0;
         transLightsCount = 0;
@@ -49,6 +51,11 @@ void CS( uint3 groupId : SV_GroupID, uint3 threadId : SV_GroupThreadID )
 
         InterlockedMin(uintMinDepth, uintDepth);
         InterlockedMax(uintMaxDepth, uintDepth);
+        // Cleared depth is not geometry
+        if (depth < 1.0)
+        {
+            InterlockedMax(uintGeomMaxDepth, uintDepth);
+        }
     }
     GroupMemoryBarrierWithGroupSync();
 
@@ -65,6 +72,13 @@ void CS( uint3 groupId : SV_GroupID, uint3 threadId : SV_GroupThreadID )
         float4 homoViewPos = mul(cullInverseProj, ndc);
         maxDepth = homoViewPos.z / homoViewPos.w;
     }
+    float geomMaxDepth = 0.0;
+    if (uintGeomMaxDepth != 0)
+    {
+        float4 ndc = float4(0, 0, asfloat(uintGeomMaxDepth), 1);
+        float4 homoViewPos = mul(cullInverseProj, ndc);
+        geomMaxDepth = homoViewPos.z / homoViewPos.w;
+    }
 
     // Perform light culling
     const LightgridCell lightgridCell = lightgridCells[groupId.y*lightgridCellsX + groupId.x];
@@ -159,11 +173,14 @@ void CS( uint3 groupId : SV_GroupID, uint3 threadId : SV_GroupThreadID )
         lightGrid[uint2(groupId.x, groupId.y)] = uint4(
             transLightsCount, opaqueLightsCount, transStartIndex, opaqueStartIndex
         );
+
+        // Visible depth range of tile for shadow splits fitting, zero for tile without geometry
+        dstTexture[uint2(groupId.x, groupId.y)] = uintGeomMaxDepth != 0 ? float2(minDepth, geomMaxDepth) : float2(0, 0);
     }
 
     // Test - write number of non-culled lights
-    if (x < width && y < height)
-    {
-        //dstTexture[uint2(x,y)] = float2((float)transLightsCount / lightCullCount, (float)opaqueLightsCount / lightCullCount);
-    }
+    //if (x < width && y < height)
+    //{
+    //    dstTexture[uint2(x,y)] = float2((float)transLightsCount / lightCullCount, (float)opaqueLightsCount / lightCullCount);
+    //}
 }
\ No newline at end of file
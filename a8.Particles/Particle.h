@@ -11,7 +11,12 @@
 CONST_BUFFER(SplitData, 2)
 GLTF_SPLIT_DATA
 
-CONST_BUFFER(ObjectData, 3)
+struct ParticleData
 PARTICLE_DATA
 
+CONST_BUFFER(ObjectData, 3)
+{
+    ParticleData particles[PARTICLE_MAX_INSTANCES];
+};
+
 #endif // _PARTICLE_H
@@ -12,22 +12,25 @@ struct VSOut
 {
     float4 pos : SV_POSITION;
     float2 uv : TEXCOORD;
+    nointerpolation uint instance : INSTANCE;
 };
 
-VSOut VS(float3 pos : POSITION, float2 uv : TEXCOORD)
+VSOut VS(float3 pos : POSITION, float2 uv : TEXCOORD, uint instance : SV_InstanceID)
 {
     VSOut output;
 
     float4x4 _transform = transform;
 
-    float3 basePos = particleWorldPos.xyz;
+    ParticleData particle = particles[instance];
+
+    float3 basePos = particle.particleWorldPos.xyz;
     float3 xAxis = float3(1,0,0);
     float3 yAxis = float3(0,1,0);
-    if (billboardType == PARTICLE_BILLBOARD_TYPE_VERT)
+    if (particle.billboardType == PARTICLE_BILLBOARD_TYPE_VERT)
     {
         xAxis = inverseView._m00_m10_m20;
     }
-    else if (billboardType == PARTICLE_BILLBOARD_TYPE_FULL)
+    else if (particle.billboardType == PARTICLE_BILLBOARD_TYPE_FULL)
     {
         xAxis = inverseView._m00_m10_m20;
         yAxis = inverseView._m01_m11_m21;
@@ -39,6 +42,7 @@ VSOut VS(float3 pos : POSITION, float2 uv : TEXCOORD)
     );
     output.pos = mul(VP, worldPos);
     output.uv = uv;
+    output.instance = instance;
 
     return output;
 }
@@ -49,19 +53,23 @@ struct PSOut
     float4 emissive : SV_TARGET1;
 };
 
-float4 SampleDiffuse(in float2 uv)
+// Frame counts from start of the texture array, sequences of frameCount frames go one after another
+float4 SampleDiffuse(in float2 uv, in float curFrame, in int frameCount)
 {
     float ratio = frac(curFrame);
     int idx = (int)(curFrame - ratio);
+    int first = idx - idx % frameCount;
 
     return DiffuseTexture.Sample(MinMagMipLinear, float3(uv, idx)) * (1.0 - ratio)
-        + DiffuseTexture.Sample(MinMagMipLinear, float3(uv, (idx + 1) % frameCount)) * ratio;
+        + DiffuseTexture.Sample(MinMagMipLinear, float3(uv, first + (idx - first + 1) % frameCount)) * ratio;
 }
 
 PSOut PS(VSOut input)
 {
-    float4 color = SampleDiffuse(input.uv);
-    if ((particleFlags & PARTICLE_FLAG_USE_PALETTE) != 0)
+    ParticleData particle = particles[input.instance];
+
+    float4 color = SampleDiffuse(input.uv, particle.curFrame, particle.frameCount);
+    if ((particle.particleFlags & PARTICLE_FLAG_USE_PALETTE) != 0)
     {
         color.w = color.r;
         float val = color.r;
@@ -69,7 +77,7 @@ PSOut PS(VSOut input)
     }
     else
     {
-        if ((particleFlags & PARTICLE_FLAG_HAS_ALPHA) == 0)
+        if ((particle.particleFlags & PARTICLE_FLAG_HAS_ALPHA) == 0)
         {
             float lum = 0.2126*color.r + 0.7152*color.g + 0.0722*color.b;
             color.w = lum;
@@ -77,8 +85,8 @@ PSOut PS(VSOut input)
     }
 
     PSOut psOut;
-    psOut.color.xyz = color.xyz * particleTint.xyz;
-    psOut.color.w = color.w * particleTint.w;
+    psOut.color.xyz = color.xyz * particle.particleTint.xyz;
+    psOut.color.w = color.w * particle.particleTint.w;
     psOut.emissive = float4(0,0,0,0);
 
     return psOut;
@@ -8,6 +8,9 @@
 #define PARTICLE_BILLBOARD_TYPE_VERT 1
 #define PARTICLE_BILLBOARD_TYPE_FULL 2
 
+// Particle instances per draw, their data fits into single constant buffer
+#define PARTICLE_MAX_INSTANCES 1024
+
 #define PARTICLE_DATA \
 {\
     float4 particleWorldPos;\
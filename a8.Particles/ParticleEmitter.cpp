@@ -0,0 +1,131 @@
+#include "stdafx.h"
+#include "ParticleEmitter.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "PlatformUtil.h"
+
+namespace
+{
+
+double RandRange(const Point2d& range, float t)
+{
+    return range.x == range.y ? range.x : Lerp(range.x, range.y, t);
+}
+
+}
+
+size_t ParticleEmitter::CalcRangeCapacity() const
+{
+    if (m_params.particlesForEmit != -1)
+    {
+        return std::min((size_t)m_params.particlesForEmit, MaxRangeCapacity);
+    }
+    if (m_params.emitFreqSec <= 0.0 || m_params.lifeTimeSec.y == std::numeric_limits<double>::infinity())
+    {
+        return MaxRangeCapacity;
+    }
+
+    // Longest living particles overlap with the ones emitted during their life, plus spare for long frames
+    return std::min((size_t)ceil(m_params.lifeTimeSec.y / m_params.emitFreqSec) + 2, MaxRangeCapacity);
+}
+
+int ParticleEmitter::CalcSpawnCount(double deltaSec) const
+{
+    if (m_particlesForEmit == -1)
+    {
+        const double emitTimeSec = m_emitTimeSec + deltaSec * m_lod.rateScale;
+        return (int)(floor(emitTimeSec / m_params.emitFreqSec) - floor(m_emitTimeSec / m_params.emitFreqSec));
+    }
+
+    return m_particlesForEmit > 0 ? 1 : 0;
+}
+
+void ParticleEmitter::Update(ParticlePool& pool, double deltaSec)
+{
+    int newParticles = CalcSpawnCount(deltaSec);
+    if (m_lod.spawnLimit >= 0)
+    {
+        newParticles = std::min(newParticles, m_lod.spawnLimit);
+    }
+    if (m_particlesForEmit > 0)
+    {
+        m_particlesForEmit -= newParticles;
+    }
+
+    // Time accumulated before this frame belongs to alive particles only, so it is simulated before spawn.
+    // Frame count is kept, so emitter is still updated on its usual frames
+    if (newParticles > 0 && m_pendingSec > 0.0)
+    {
+        pool.Update(m_range, (float)m_pendingSec, (float)(m_pendingSec * m_lod.animScale));
+
+        m_pendingSec = 0.0;
+    }
+
+    for (int i = 0; i < newParticles; i++)
+    {
+        float rand0[4];
+        float rand1[4];
+        m_random.Generate(m_spawnCount, 0, rand0);
+        m_random.Generate(m_spawnCount, 1, rand1);
+        ++m_spawnCount;
+
+        int templateIdx = std::min((int)(rand0[0] * m_templates.size()), (int)m_templates.size() - 1);
+        const TemplateInfo& info = m_templates[templateIdx];
+        int sequence = std::min((int)(rand1[2] * info.sequenceCount), info.sequenceCount - 1);
+
+        size_t idx = pool.Spawn(m_range);
+        if (idx == ParticlePool::InvalidIndex)
+        {
+            break;
+        }
+
+        pool.templateIdx[idx] = templateIdx;
+        pool.firstFrame[idx] = (float)(sequence * info.frameCount);
+        pool.frameCount[idx] = (float)info.frameCount;
+        pool.frameSpeed[idx] = info.animSpeed;
+
+        pool.posX[idx] = m_params.pos.x;
+        pool.posY[idx] = m_params.pos.y;
+        pool.posZ[idx] = m_params.pos.z;
+
+        pool.tintR[idx] = m_params.tint.x;
+        pool.tintG[idx] = m_params.tint.y;
+        pool.tintB[idx] = m_params.tint.z;
+        pool.tintA[idx] = m_params.tint.w;
+
+        if (m_params.randomPosDelta)
+        {
+            static const float spread = 0.35f;
+
+            float x = Lerp(-spread, spread, rand0[1]);
+            float z = Lerp(-spread, spread, rand0[2]);
+            Point3f posDelta = Point3f{ x, 1.0f, z };
+            posDelta.normalize();
+            posDelta = posDelta * 0.075f;
+
+            pool.velX[idx] = posDelta.x;
+            pool.velY[idx] = posDelta.y;
+            pool.velZ[idx] = posDelta.z;
+        }
+
+        // Equal bounds are taken as is, so infinite life time stays infinite
+        pool.maxLifeTime[idx] = (float)RandRange(m_params.lifeTimeSec, rand0[3]);
+        pool.birthMargin[idx] = (float)RandRange(m_params.birthMargin, rand1[0]);
+        pool.deathMargin[idx] = (float)RandRange(m_params.deathMargin, rand1[1]);
+    }
+
+    m_emitTimeSec += deltaSec * m_lod.rateScale;
+
+    // Reduced detail emitters simulate accumulated time at once
+    m_pendingSec += deltaSec;
+    if (++m_pendingFrames >= m_lod.updateInterval)
+    {
+        pool.Update(m_range, (float)m_pendingSec, (float)(m_pendingSec * m_lod.animScale));
+
+        m_pendingSec = 0.0;
+        m_pendingFrames = 0;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include "PlatformPoint.h"
+#include "ParticlePool.h"
+
+struct ParticleEmitterParams
+{
+    Point3f pos;
+    bool randomPosDelta = false;
+    Point4f tint = Point4f{ 1,1,1,1 };
+    std::vector<int> templateIndex = {};
+    int particlesForEmit = -1;
+    double emitFreqSec = 0.0;
+    Point2d lifeTimeSec = Point2d{ std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() };
+    Point2d birthMargin = Point2d{ 0,0 };
+    Point2d deathMargin = Point2d{ 0,0 };
+    float priority = 1.0f;          // Emitters with higher priority take particle budget first
+    float radius = 1.0f;            // Bounding sphere of emitted particles around pos, for culling
+};
+
+// Emitter detail, which is chosen every frame by camera distance and particle budget
+struct ParticleEmitterLod
+{
+    float rateScale = 1.0f;         // Spawn rate multiplier
+    float animScale = 1.0f;         // Flipbook speed multiplier
+    int updateInterval = 1;         // Particles are simulated once in this number of frames
+    int spawnLimit = -1;            // Spawns allowed by budget in the next update, -1 means no limit
+    bool culled = false;            // Particles are simulated, but not drawn
+};
+
+// Emitter spawns particles into its own range of particle pool
+class ParticleEmitter
+{
+public:
+    // Particles, which don't die or are emitted without limit, fit into range of this size
+    static const size_t MaxRangeCapacity = 1024;
+
+    // Flipbook of emitter template, which spawned particles take.
+    // Template texture may hold several sequences one after another, particle plays one of them
+    struct TemplateInfo
+    {
+        int frameCount = 1;         // Frames of single sequence
+        int sequenceCount = 1;
+        float animSpeed = 60.0f;    // Frames per second
+    };
+
+public:
+    // Emitters with different seeds get independent random streams
+    ParticleEmitter(const ParticleEmitterParams& params, const std::vector<TemplateInfo>& templates, ParticlePool& pool, UINT32 seed)
+        : m_params(params)
+        , m_templates(templates)
+        , m_emitTimeSec(0.0)
+        , m_random(seed)
+        , m_spawnCount(0)
+        , m_pendingSec(0.0)
+        , m_pendingFrames(0)
+    {
+        m_particlesForEmit = m_params.particlesForEmit;
+        m_range = pool.AddRange(CalcRangeCapacity());
+    }
+
+    // Particles to be spawned by Update with current LOD, spawn limit is not applied
+    int CalcSpawnCount(double deltaSec) const;
+    // Spawns new particles and advances the alive ones. With update interval above one,
+    // particles are advanced by accumulated time, new ones are aged by time since their spawn only
+    void Update(ParticlePool& pool, double deltaSec);
+
+    inline void SetLod(const ParticleEmitterLod& lod) { m_lod = lod; }
+    inline const ParticleEmitterLod& GetLod() const { return m_lod; }
+
+    inline const ParticleEmitterParams& GetParams() const { return m_params; }
+    inline const TemplateInfo& GetTemplate(int i) const { return m_templates[i]; }
+    inline const std::vector<int>& GetTemplateIndices() const { return m_params.templateIndex; }
+    inline int GetRange() const { return m_range; }
+
+private:
+    size_t CalcRangeCapacity() const;
+
+private:
+    const ParticleEmitterParams m_params;
+    const std::vector<TemplateInfo> m_templates;
+
+    int m_particlesForEmit;
+    double m_emitTimeSec;       // Emission time, it runs slower with lower spawn rate
+    int m_range;
+
+    ParticleRandom m_random;
+    UINT64 m_spawnCount;        // Random counter, every spawn takes its own
+
+    ParticleEmitterLod m_lod;
+    double m_pendingSec;        // Time, which is not simulated yet due to update interval
+    int m_pendingFrames;
+};
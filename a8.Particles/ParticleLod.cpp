@@ -0,0 +1,75 @@
+#include "stdafx.h"
+#include "ParticleLod.h"
+
+#include <algorithm>
+
+ParticleEmitterLod ParticleLodManager::CalcLod(const ParticleLodParams& params, const ParticleLodView& view, const ParticleEmitterParams& emitter)
+{
+    const float dist = (emitter.pos - view.pos).length();
+    const float scale = dist > params.lodDistance ? std::max(params.lodDistance / dist, params.minScale) : 1.0f;
+
+    ParticleEmitterLod lod;
+    lod.rateScale = scale;
+    lod.animScale = scale;
+    lod.updateInterval = scale > 0.5f ? 1 : (scale > 0.25f ? 2 : 4);
+
+    // Camera inside of emitter bounds always sees it
+    const float radius = emitter.radius;
+    const bool small = dist > radius && radius * view.projScale < params.cullSize * dist;
+    lod.culled = dist > params.cullDistance || small
+        || !view.frustum.TestBox(emitter.pos, Point3f{ radius, radius, radius });
+
+    return lod;
+}
+
+void ParticleLodManager::Update(const ParticleLodParams& params, const ParticleLodView& view, const std::vector<ParticleEmitter*>& emitters,
+    size_t aliveCount, double deltaSec)
+{
+    m_stats = Stats();
+
+    const size_t emitterCount = emitters.size();
+    m_weights.resize(emitterCount);
+    m_order.resize(emitterCount);
+
+    for (size_t i = 0; i < emitterCount; i++)
+    {
+        ParticleEmitter* pEmitter = emitters[i];
+
+        const ParticleEmitterLod lod = CalcLod(params, view, pEmitter->GetParams());
+        pEmitter->SetLod(lod);
+
+        if (lod.rateScale < 1.0f)
+        {
+            ++m_stats.reduced;
+        }
+        if (lod.culled)
+        {
+            ++m_stats.culled;
+        }
+
+        m_weights[i] = pEmitter->GetParams().priority * lod.rateScale;
+        m_order[i] = i;
+    }
+
+    // Particles, which die this frame, are not taken into account, so budget is never exceeded
+    size_t available = params.budget > aliveCount ? params.budget - aliveCount : 0;
+
+    std::stable_sort(m_order.begin(), m_order.end(), [this](size_t a, size_t b)
+    {
+        return m_weights[a] > m_weights[b];
+    });
+    for (size_t i : m_order)
+    {
+        ParticleEmitter* pEmitter = emitters[i];
+
+        const size_t spawnCount = (size_t)pEmitter->CalcSpawnCount(deltaSec);
+        const size_t allowed = std::min(spawnCount, available);
+
+        ParticleEmitterLod lod = pEmitter->GetLod();
+        lod.spawnLimit = (int)allowed;
+        pEmitter->SetLod(lod);
+
+        available -= allowed;
+        m_stats.throttled += spawnCount - allowed;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "PlatformFrustum.h"
+#include "ParticleEmitter.h"
+
+// Emitter LOD and particle budget settings
+struct ParticleLodParams
+{
+    float lodDistance = 5.0f;       // Emitters are at full detail up to this distance, rates drop with distance beyond it
+    float minScale = 0.125f;        // Lowest rate multiplier
+    float cullDistance = 60.0f;
+    float cullSize = 0.01f;         // Emitters with smaller projected radius, as share of half view height, are culled
+    size_t budget = 16 * 1024;      // Alive particles
+};
+
+// Camera, which emitters are seen from
+struct ParticleLodView
+{
+    Point3f pos;
+    Platform::Frustum frustum;
+    float projScale = 1.0f;         // Vertical projection scale, projected radius is radius * projScale / distance
+};
+
+// Chooses emitter LODs every frame, so particle cost stays bounded: spawn, flipbook and update rates drop with
+// camera distance, emitters out of view or too small on screen are culled, and spawns are limited by particle budget
+class ParticleLodManager
+{
+public:
+    // Counters of the last update
+    struct Stats
+    {
+        size_t throttled = 0;       // Spawns denied by budget
+        size_t culled = 0;          // Emitters, which are not drawn
+        size_t reduced = 0;         // Emitters below full detail
+    };
+
+    // LOD of emitter by its distance and projected size, spawns are not limited
+    static ParticleEmitterLod CalcLod(const ParticleLodParams& params, const ParticleLodView& view, const ParticleEmitterParams& emitter);
+
+    // Sets LOD of every emitter. Budget, which is left after alive particles, is given to emitters
+    // in order of priority scaled by detail, the ones with equal weight keep emitter order
+    void Update(const ParticleLodParams& params, const ParticleLodView& view, const std::vector<ParticleEmitter*>& emitters,
+        size_t aliveCount, double deltaSec);
+
+    inline const Stats& GetStats() const { return m_stats; }
+
+private:
+    std::vector<size_t> m_order;    // Emitters in budget priority order
+    std::vector<float> m_weights;
+
+    Stats m_stats;
+};
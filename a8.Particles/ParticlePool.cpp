@@ -0,0 +1,391 @@
+#include "stdafx.h"
+#include "ParticlePool.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "PlatformUtil.h"
+#include "PlatformSIMD.h"
+
+namespace
+{
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2
+
+using Vec = __m256;
+const size_t VecWidth = 8;
+
+PLATFORM_FORCEINLINE Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+PLATFORM_FORCEINLINE void Store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+PLATFORM_FORCEINLINE Vec Set(float v) { return _mm256_set1_ps(v); }
+PLATFORM_FORCEINLINE Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Less(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+PLATFORM_FORCEINLINE Vec Select(Vec mask, Vec a, Vec b) { return _mm256_blendv_ps(b, a, mask); }
+PLATFORM_FORCEINLINE Vec Floor(Vec v) { return _mm256_floor_ps(v); }
+
+#elif PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+
+using Vec = __m128;
+const size_t VecWidth = 4;
+
+PLATFORM_FORCEINLINE Vec Load(const float* p) { return _mm_loadu_ps(p); }
+PLATFORM_FORCEINLINE void Store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+PLATFORM_FORCEINLINE Vec Set(float v) { return _mm_set1_ps(v); }
+PLATFORM_FORCEINLINE Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Less(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+PLATFORM_FORCEINLINE Vec Select(Vec mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+// No rounding instructions before SSE4.1, truncated value is corrected for negative input.
+// Frame numbers are far below 2^31, where conversion is exact
+PLATFORM_FORCEINLINE Vec Floor(Vec v)
+{
+    Vec t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+}
+
+#endif
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2 || PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+
+// Same operation order as scalar SmoothStep, so results match bit for bit.
+// Max goes first with x, so NaN turns into zero as in std::max
+PLATFORM_FORCEINLINE Vec SmoothStep(Vec edge0, Vec edge1, Vec x)
+{
+    Vec t = Min(Max(Div(Sub(x, edge0), Sub(edge1, edge0)), Set(0.0f)), Set(1.0f));
+
+    return Mul(Mul(t, t), Sub(Set(3.0f), Mul(Set(2.0f), t)));
+}
+
+#endif
+
+// Philox4x32 constants
+const UINT32 PhiloxM0 = 0xD2511F53;
+const UINT32 PhiloxM1 = 0xCD9E8D57;
+const UINT32 PhiloxW0 = 0x9E3779B9;
+const UINT32 PhiloxW1 = 0xBB67AE85;
+
+inline void MulHiLo(UINT32 a, UINT32 b, UINT32& hi, UINT32& lo)
+{
+    UINT64 product = (UINT64)a * b;
+    hi = (UINT32)(product >> 32);
+    lo = (UINT32)product;
+}
+
+}
+
+ParticleRandom::ParticleRandom(UINT32 seed)
+    : m_key(seed)
+{
+}
+
+void ParticleRandom::Generate(UINT64 counter, UINT32 stream, float values[4]) const
+{
+    UINT32 c[4] = { (UINT32)counter, (UINT32)(counter >> 32), stream, 0 };
+    UINT32 k[2] = { m_key, 0 };
+
+    for (int round = 0; round < 10; round++)
+    {
+        UINT32 hi0, lo0, hi1, lo1;
+        MulHiLo(PhiloxM0, c[0], hi0, lo0);
+        MulHiLo(PhiloxM1, c[2], hi1, lo1);
+
+        c[0] = hi1 ^ c[1] ^ k[0];
+        c[1] = lo1;
+        c[2] = hi0 ^ c[3] ^ k[1];
+        c[3] = lo0;
+
+        k[0] += PhiloxW0;
+        k[1] += PhiloxW1;
+    }
+
+    // Upper 24 bits give exactly representable values in [0, 1)
+    for (int i = 0; i < 4; i++)
+    {
+        values[i] = (float)(c[i] >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+ParticlePool::Stats& ParticlePool::Stats::operator+=(const Stats& other)
+{
+    spawned += other.spawned;
+    died += other.died;
+    dropped += other.dropped;
+    updated += other.updated;
+
+    return *this;
+}
+
+ParticlePool::ParticlePool()
+{
+}
+
+int ParticlePool::AddRange(size_t capacity)
+{
+    Range range;
+    range.start = GetCapacity();
+    range.capacity = capacity;
+
+    Resize(range.start + capacity);
+
+    m_ranges.push_back(range);
+    m_rangeStats.push_back(Stats());
+
+    return (int)m_ranges.size() - 1;
+}
+
+void ParticlePool::Clear()
+{
+    m_ranges.clear();
+    m_rangeStats.clear();
+    Resize(0);
+}
+
+size_t ParticlePool::GetAliveCount() const
+{
+    size_t count = 0;
+    for (const auto& range : m_ranges)
+    {
+        count += range.count;
+    }
+    return count;
+}
+
+ParticlePool::Stats ParticlePool::GetStats() const
+{
+    Stats stats;
+    for (const auto& rangeStats : m_rangeStats)
+    {
+        stats += rangeStats;
+    }
+    return stats;
+}
+
+void ParticlePool::ResetStats()
+{
+    std::fill(m_rangeStats.begin(), m_rangeStats.end(), Stats());
+}
+
+size_t ParticlePool::Spawn(int range)
+{
+    Range& r = m_ranges[range];
+    if (r.count == r.capacity)
+    {
+        ++m_rangeStats[range].dropped;
+        return InvalidIndex;
+    }
+
+    size_t idx = r.start + r.count;
+    ++r.count;
+
+    Reset(idx);
+
+    ++m_rangeStats[range].spawned;
+
+    return idx;
+}
+
+void ParticlePool::Update(int range, float deltaSec, float frameDeltaSec)
+{
+    Range& r = m_ranges[range];
+
+    const size_t begin = r.start;
+    size_t end = r.start + r.count;
+
+    size_t i = UpdateSIMD(begin, end, deltaSec, frameDeltaSec);
+    UpdateScalar(i, end, deltaSec, frameDeltaSec);
+
+    m_rangeStats[range].updated += end - begin;
+
+    // Swap-remove dead particles
+    i = begin;
+    while (i < end)
+    {
+        if (lifeTime[i] > maxLifeTime[i])
+        {
+            --end;
+            Move(i, end);
+
+            ++m_rangeStats[range].died;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    r.count = end - begin;
+}
+
+void ParticlePool::UpdateScalar(size_t begin, size_t end, float deltaSec, float frameDeltaSec)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        lifeTime[i] += deltaSec;
+
+        float f = 1.0f;
+        if (lifeTime[i] < birthMargin[i])
+        {
+            f = SmoothStep(0.0f, birthMargin[i], lifeTime[i]);
+        }
+        else if (lifeTime[i] > maxLifeTime[i] - deathMargin[i])
+        {
+            f = 1.0f - SmoothStep(maxLifeTime[i] - deathMargin[i], maxLifeTime[i], lifeTime[i]);
+        }
+        fade[i] = f;
+
+        posX[i] += velX[i] * deltaSec;
+        posY[i] += velY[i] * deltaSec;
+        posZ[i] += velZ[i] * deltaSec;
+
+        curFrame[i] += frameDeltaSec * frameSpeed[i];
+        curFrame[i] -= floorf(curFrame[i] / frameCount[i]) * frameCount[i];
+    }
+}
+
+size_t ParticlePool::UpdateSIMD(size_t begin, size_t end, float deltaSec, float frameDeltaSec)
+{
+    size_t i = begin;
+
+#if PLATFORM_SIMD == PLATFORM_SIMD_AVX2 || PLATFORM_SIMD == PLATFORM_SIMD_SSE2
+    const Vec dt = Set(deltaSec);
+    const Vec frameDt = Set(frameDeltaSec);
+    const Vec zero = Set(0.0f);
+    const Vec one = Set(1.0f);
+
+    for (; i + VecWidth <= end; i += VecWidth)
+    {
+        Vec life = Add(Load(&lifeTime[i]), dt);
+        Store(&lifeTime[i], life);
+
+        // Both fades are calculated, the one for current life phase is selected
+        Vec birth = Load(&birthMargin[i]);
+        Vec maxLife = Load(&maxLifeTime[i]);
+        Vec deathStart = Sub(maxLife, Load(&deathMargin[i]));
+
+        Vec birthFade = SmoothStep(zero, birth, life);
+        Vec deathFade = Sub(one, SmoothStep(deathStart, maxLife, life));
+
+        Vec f = Select(Less(deathStart, life), deathFade, one);
+        f = Select(Less(life, birth), birthFade, f);
+        Store(&fade[i], f);
+
+        Store(&posX[i], Add(Load(&posX[i]), Mul(Load(&velX[i]), dt)));
+        Store(&posY[i], Add(Load(&posY[i]), Mul(Load(&velY[i]), dt)));
+        Store(&posZ[i], Add(Load(&posZ[i]), Mul(Load(&velZ[i]), dt)));
+
+        Vec count = Load(&frameCount[i]);
+        Vec frame = Add(Load(&curFrame[i]), Mul(frameDt, Load(&frameSpeed[i])));
+        frame = Sub(frame, Mul(Floor(Div(frame, count)), count));
+        Store(&curFrame[i], frame);
+    }
+#else
+    // No SIMD kernel, scalar one processes the whole range
+    (void)end;
+    (void)deltaSec;
+    (void)frameDeltaSec;
+#endif
+
+    return i;
+}
+
+void ParticlePool::Resize(size_t capacity)
+{
+    for (auto pArray : { &posX, &posY, &posZ, &velX, &velY, &velZ, &tintR, &tintG, &tintB, &tintA, &fade,
+        &lifeTime, &maxLifeTime, &birthMargin, &deathMargin, &curFrame, &firstFrame, &frameCount, &frameSpeed })
+    {
+        pArray->resize(capacity, 0.0f);
+    }
+    templateIdx.resize(capacity, 0);
+}
+
+void ParticlePool::Move(size_t dst, size_t src)
+{
+    if (dst == src)
+    {
+        return;
+    }
+
+    for (auto pArray : { &posX, &posY, &posZ, &velX, &velY, &velZ, &tintR, &tintG, &tintB, &tintA, &fade,
+        &lifeTime, &maxLifeTime, &birthMargin, &deathMargin, &curFrame, &firstFrame, &frameCount, &frameSpeed })
+    {
+        (*pArray)[dst] = (*pArray)[src];
+    }
+    templateIdx[dst] = templateIdx[src];
+}
+
+void ParticlePool::Reset(size_t idx)
+{
+    for (auto pArray : { &posX, &posY, &posZ, &velX, &velY, &velZ, &tintR, &tintG, &tintB, &tintA, &fade,
+        &lifeTime, &maxLifeTime, &birthMargin, &deathMargin, &curFrame, &firstFrame, &frameCount, &frameSpeed })
+    {
+        (*pArray)[idx] = 0.0f;
+    }
+    templateIdx[idx] = 0;
+}
+
+void ParticleInstancePacker::Pack(const ParticlePool& pool, const std::vector<Source>& sources, const std::vector<TemplateInfo>& templates)
+{
+    // Counting sort by template, the first pass counts particles of every template
+    m_offsets.assign(templates.size() + 1, 0);
+    for (const auto& source : sources)
+    {
+        const ParticlePool::Range& range = pool.GetRange(source.range);
+        for (size_t idx = range.start; idx < range.start + range.count; idx++)
+        {
+            ++m_offsets[(*source.pTemplateIndices)[pool.templateIdx[idx]] + 1];
+        }
+    }
+
+    m_batches.clear();
+    for (size_t i = 0; i < templates.size(); i++)
+    {
+        const size_t first = m_offsets[i];
+        const size_t count = m_offsets[i + 1];
+        for (size_t j = 0; j < count; j += PARTICLE_MAX_INSTANCES)
+        {
+            Batch batch;
+            batch.templateIdx = (int)i;
+            batch.first = first + j;
+            batch.count = std::min(count - j, (size_t)PARTICLE_MAX_INSTANCES);
+            m_batches.push_back(batch);
+        }
+
+        m_offsets[i + 1] = first + count;
+    }
+
+    m_instances.resize(m_offsets.back());
+
+    // The second pass writes particles to their template places
+    for (const auto& source : sources)
+    {
+        const ParticlePool::Range& range = pool.GetRange(source.range);
+        for (size_t idx = range.start; idx < range.start + range.count; idx++)
+        {
+            const int templateIdx = (*source.pTemplateIndices)[pool.templateIdx[idx]];
+            const TemplateInfo& info = templates[templateIdx];
+
+            ParticleData& data = m_instances[m_offsets[templateIdx]++];
+            data.particleWorldPos = Point4f{ pool.posX[idx], pool.posY[idx], pool.posZ[idx], 0.0f };
+            data.curFrame = pool.firstFrame[idx] + pool.curFrame[idx];
+            data.billboardType = info.billboardType;
+            data.frameCount = info.frameCount;
+            data.particleFlags = info.flags;
+            data.particleTint = Point4f{ pool.tintR[idx], pool.tintG[idx], pool.tintB[idx], pool.tintA[idx] } * pool.fade[idx];
+        }
+    }
+
+    m_stats.instances = m_instances.size();
+    m_stats.bytes = m_instances.size() * sizeof(ParticleData);
+    m_stats.batches = m_batches.size();
+}
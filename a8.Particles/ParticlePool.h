@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vector>
+
+#include "PlatformPoint.h"
+#include "ParticleData.h"
+
+// Per instance particle data, as it is read by particle shader
+struct ParticleData
+PARTICLE_DATA
+
+// Counter-based random numbers (Philox4x32-10). Values depend only on seed and counter,
+// so they don't depend on update order or thread count
+class ParticleRandom
+{
+public:
+    ParticleRandom(UINT32 seed = 0);
+
+    // Four uniform values in [0, 1), different streams give independent values for the same counter
+    void Generate(UINT64 counter, UINT32 stream, float values[4]) const;
+
+private:
+    UINT32 m_key;
+};
+
+// Fixed capacity particle storage in structure-of-arrays form.
+// Every emitter owns a range of slots, alive particles of the range are packed at its start.
+// Dead particle is replaced with the last alive one of the range, so particle order within range is not kept.
+// Spawn and Update touch only the given range, so different ranges may be processed on different threads
+class ParticlePool
+{
+public:
+    static const size_t InvalidIndex = (size_t)-1;
+
+    struct Range
+    {
+        size_t start = 0;
+        size_t capacity = 0;
+        size_t count = 0;       // Alive particles
+    };
+
+    // Counters since the last ResetStats
+    struct Stats
+    {
+        size_t spawned = 0;
+        size_t died = 0;
+        size_t dropped = 0;     // Spawns, which didn't fit into emitter range
+        size_t updated = 0;
+
+        Stats& operator+=(const Stats& other);
+    };
+
+    ParticlePool();
+
+    // Ranges are added on setup, arrays are not reallocated after particles start to spawn
+    int AddRange(size_t capacity);
+    // Removes all ranges and particles
+    void Clear();
+
+    inline size_t GetRangeCount() const { return m_ranges.size(); }
+    inline const Range& GetRange(int range) const { return m_ranges[range]; }
+    inline size_t GetCapacity() const { return lifeTime.size(); }
+    size_t GetAliveCount() const;
+
+    // Returns particle index with all fields zeroed, or InvalidIndex if range is full
+    size_t Spawn(int range);
+
+    // Advances particles of the range by deltaSec and removes the ones, which outlive their life time.
+    // Flipbooks advance by frameDeltaSec, so animation may run slower than particle life.
+    // Particles are processed with SIMD kernel, which gives the same result as scalar one
+    void Update(int range, float deltaSec, float frameDeltaSec);
+
+    // Sum of all ranges
+    Stats GetStats() const;
+    void ResetStats();
+
+public:
+    // Particle data, valid in [start, start + count) of every range
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> velX, velY, velZ;        // Position change per second
+    std::vector<float> tintR, tintG, tintB, tintA;
+    std::vector<float> fade;                    // Tint multiplier, particle fades in on birth margin and out on death margin
+    std::vector<float> lifeTime;
+    std::vector<float> maxLifeTime;
+    std::vector<float> birthMargin;
+    std::vector<float> deathMargin;
+    std::vector<float> curFrame;                // Frame within sequence
+    std::vector<float> firstFrame;              // Texture array slice of sequence start
+    std::vector<float> frameCount;
+    std::vector<float> frameSpeed;              // Flipbook frames per second
+    std::vector<int> templateIdx;               // Emitter template of particle
+
+private:
+    void UpdateScalar(size_t begin, size_t end, float deltaSec, float frameDeltaSec);
+    // Returns index of the first particle left for scalar kernel
+    size_t UpdateSIMD(size_t begin, size_t end, float deltaSec, float frameDeltaSec);
+
+    void Resize(size_t capacity);
+    void Move(size_t dst, size_t src);
+    void Reset(size_t idx);
+
+private:
+    std::vector<Range> m_ranges;
+    std::vector<Stats> m_rangeStats;   // Kept per range, as ranges are updated in parallel
+};
+
+// Packs alive particles of the pool into instance array, grouped by emitter template,
+// so all particles of the template are drawn with few instanced draws
+class ParticleInstancePacker
+{
+public:
+    // Data, which is the same for all particles of template
+    struct TemplateInfo
+    {
+        int billboardType = PARTICLE_BILLBOARD_TYPE_NONE;
+        int frameCount = 1;         // Frames of single sequence
+        int flags = 0;
+    };
+
+    // Emitter range and global indices of emitter templates, particles store local ones
+    struct Source
+    {
+        int range = 0;
+        const std::vector<int>* pTemplateIndices = nullptr;
+    };
+
+    // Instances [first, first + count) of single template, count doesn't exceed PARTICLE_MAX_INSTANCES
+    struct Batch
+    {
+        int templateIdx = 0;
+        size_t first = 0;
+        size_t count = 0;
+    };
+
+    struct Stats
+    {
+        size_t instances = 0;
+        size_t bytes = 0;       // Size of instance data
+        size_t batches = 0;
+    };
+
+    // Batches follow template order, particles of the template keep source order
+    void Pack(const ParticlePool& pool, const std::vector<Source>& sources, const std::vector<TemplateInfo>& templates);
+
+    inline const std::vector<ParticleData>& GetInstances() const { return m_instances; }
+    inline const std::vector<Batch>& GetBatches() const { return m_batches; }
+    inline const Stats& GetStats() const { return m_stats; }
+
+private:
+    std::vector<ParticleData> m_instances;
+    std::vector<Batch> m_batches;
+    std::vector<size_t> m_offsets;      // Next instance of every template while packing
+
+    Stats m_stats;
+};
@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include "Renderer.h"
+#include "CascadeFit.h"
+#include "ShadowCasterCull.h"
 
 #include "Platform.h"
 #include "PlatformDevice.h"
@@ -74,11 +76,29 @@ const std::vector<const char*> RenderModeNames = { "Lighting", "SSAO Mask" };
 const std::vector<const char*> ShadowMapModeNames = { "Simple", "PSSM", "CSM" };
 const std::vector<const char*> SSAOModeNames = { "Basic", "Half sphere", "Half sphere + noise", "Half sphere + noise, blur" };
 
+double GetMSecSince(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+}
+
 float RandFloat(float minValue, float maxValue)
 {
     return minValue + ((float)rand() / RAND_MAX)*(maxValue - minValue);
 }
 
+// Origin of geometry node in world space, it stands for geometry position in transparent sort
+Point3f CalcGeometryPos(const Platform::GLTFObjectData& objData, const Platform::GLTFSplitData& splitData)
+{
+    Point4f pos{ 0, 0, 0, 1 };
+    if (splitData.nodeIndex.x >= 0 && splitData.nodeIndex.x < MAX_NODES)
+    {
+        pos = objData.nodeTransforms[splitData.nodeIndex.x] * pos;
+    }
+    pos = objData.modelTransform * pos;
+
+    return Point3f{ pos.x, pos.y, pos.z };
+}
+
 float CalculateLightSize(const Point3f& color, float intensity, float threshold)
 {
     float maxValue = std::max(color.x, std::max(color.y, color.z)) * intensity;
@@ -243,7 +263,7 @@ bool ParticleEmitterTemplate::Init(Renderer* pRenderer)
 
     Platform::GPUResource texture;
     Platform::GPUResource paletteTexture = { 0 };
-    bool res = Platform::CreateTextureArrayFromFile(m_params.srcFilename.c_str(), m_params.grid, pRenderer->GetDevice(), pRenderer->GetCurrentUploadCommandList(), texture);
+    bool res = Platform::CreateTextureArrayFromFiles(m_params.srcFilenames, m_params.grid, pRenderer->GetDevice(), pRenderer->GetCurrentUploadCommandList(), texture);
     if (res && !m_params.srcPaletteFilename.empty())
     {
         res = Platform::CreateTextureFromFile(m_params.srcPaletteFilename.c_str(), pRenderer->GetDevice(), paletteTexture, true);
@@ -302,6 +322,13 @@ SceneParameters::SceneParameters()
     , deferredLightsTest(false)
     , animated(true)
     , showGPUCounters(false)
+    , frustumCulling(true)
+    , shadowCasterCulling(true)
+    , shadowCache(true)
+    , stableCascades(true)
+    , sampleDistribution(false)
+    , particleStress(false)
+    , particleThreads(0)
     , ssaoSamplesCount(32)
     , ssaoKernelRadius(0.25f)
     , ssaoNoiseSize(4)
@@ -364,6 +391,14 @@ const Point4f Renderer::BackColor = Point4f{0.25f,0.25f,0.25f,1};
 const Point4f Renderer::BlackBackColor = Point4f{ 0,0,0,0 };
 const DXGI_FORMAT Renderer::HDRFormat = DXGI_FORMAT_R11G11B10_FLOAT;
 const float Renderer::LocalCubemapSize = 5.0f;
+const float Renderer::ParticleStressGridStep = 0.5f;
+const float Renderer::ParticleLodDistance = 5.0f;
+const float Renderer::ParticleLodMinScale = 0.125f;
+const float Renderer::ParticleCullDistance = 60.0f;
+const float Renderer::ParticleCullSize = 0.01f;
+const float Renderer::ShadowLightSnap = 16.0f;
+const float Renderer::SplitLogWeight = 0.75f;
+const float Renderer::BVHRebuildCostRatio = 1.5f;
 const int LocalCubemapIrradianceRes = 32;
 const int LocalCubemapEnvironmentRes = 128;
 const bool UseLocalCubemaps = false;
@@ -376,106 +411,18 @@ const Platform::CubemapBuilder::InitParams& Renderer::CubemapBuilderParams = {
     5       // Roughness mips
 };
 
-void ParticleEmitter::Update(Renderer* pRenderer, double deltaSec)
-{
-    int newParticles = 0;
-    if (m_particlesForEmit == -1)
-    {
-        newParticles = (int)(floor((m_lifeTimeSec + deltaSec) / m_params.emitFreqSec) - floor(m_lifeTimeSec / m_params.emitFreqSec));
-    }
-    else
-    {
-        if (m_particlesForEmit > 0)
-        {
-            newParticles = 1;
-            --m_particlesForEmit;
-        }
-    }
-
-    for (int i = 0; i < newParticles; i++)
-    {
-        int templateIdx = (int)RandFloat(0.0, (float)m_templates.size() - 0.0001f);
-
-        Particle* pNewParticle = new Particle(templateIdx, this);
-
-        pNewParticle->m_objData.billboardType = GetTemplate(templateIdx)->GetParams().billType;
-        pNewParticle->m_objData.curFrame = 0;
-        pNewParticle->m_objData.frameCount = GetTemplate(templateIdx)->GetFrameCount();
-        pNewParticle->m_objData.particleFlags = 0;
-        if (GetTemplate(templateIdx)->GetUsePalette())
-        {
-            pNewParticle->m_objData.particleFlags |= PARTICLE_FLAG_USE_PALETTE;
-        }
-        if (GetTemplate(templateIdx)->GetParams().hasAlpha)
-        {
-            pNewParticle->m_objData.particleFlags |= PARTICLE_FLAG_HAS_ALPHA;
-        }
-        pNewParticle->m_objData.particleWorldPos = m_params.pos;
-        pNewParticle->m_tint = m_params.tint;
-
-        if (m_params.randomPosDelta)
-        {
-            static const float spread = 0.35f;
-
-            float x = RandFloat(-spread, spread);
-            float z = RandFloat(-spread, spread);
-            pNewParticle->m_posDelta = Point3f{ x, 1.0f, z };
-            pNewParticle->m_posDelta.normalize();
-            pNewParticle->m_posDelta = pNewParticle->m_posDelta * 0.075f;
-        }
-        else
-        {
-            pNewParticle->m_posDelta = Point3f{ 0,0,0 };
-        }
-
-        pNewParticle->m_maxLifeTimeSec = Lerp(m_params.lifeTimeSec.x, m_params.lifeTimeSec.y, RandFloat(0.0f, 1.0f));
-        pNewParticle->m_birthMarginSec = Lerp(m_params.birthMargin.x, m_params.birthMargin.y, RandFloat(0.0f, 1.0f));
-        pNewParticle->m_deathMarginSec = Lerp(m_params.deathMargin.x, m_params.deathMargin.y, RandFloat(0.0f, 1.0f));
-
-        pRenderer->AddParticle(pNewParticle);
-    }
-
-    m_lifeTimeSec += deltaSec;
-}
-
-void Particle::Update(double deltaSec)
-{
-    if (IsDead())
-    {
-        return;
-    }
-
-    m_lifeTimeSec += deltaSec;
-
-    Point4f tint = m_tint;
-    if (m_lifeTimeSec < m_birthMarginSec)
-    {
-        tint = Lerp(Point4f{0,0,0,0}, m_tint, (float)SmoothStep(0.0, m_birthMarginSec, m_lifeTimeSec));
-    }
-    else if (m_lifeTimeSec > m_maxLifeTimeSec - m_deathMarginSec)
-    {
-        tint = Lerp(m_tint, Point4f{ 0,0,0,0 }, (float)SmoothStep(m_maxLifeTimeSec - m_deathMarginSec, m_maxLifeTimeSec, m_lifeTimeSec));
-    }
-    m_objData.particleTint = tint;
-
-    // Move particle
-    m_objData.particleWorldPos = m_objData.particleWorldPos + m_posDelta * (float)deltaSec;
-
-    // Calculate current frame
-    m_objData.curFrame += (float)deltaSec * (float)m_pEmitter->GetTemplate(m_templateIdx)->GetParams().animSpeed;
-    m_objData.curFrame -= floor(m_objData.curFrame / m_objData.frameCount) * (float)m_objData.frameCount;
-}
-
 const std::vector<ParticleEmitterTemplateParams> Renderer::ParticleEmitterTemplateSetup = {
-    {_T("../Common/Textures/Flame.png"), Point2i{ 16, 8 }, Point2f{0.5f, 1.0f}, PARTICLE_BILLBOARD_TYPE_VERT, _T("../Common/Textures/FlamePalette.png")},
-    {_T("../Common/Textures/test/sequence/wispy_smoke01_8x8.png"), Point2i{8,8}, Point2f{0.5f, 0.5f}, PARTICLE_BILLBOARD_TYPE_FULL, _T(""), true, 10.0f},
-    {_T("../Common/Textures/test/sequence/wispy_smoke03_8x8.png"), Point2i{8,8}, Point2f{0.5f, 0.5f}, PARTICLE_BILLBOARD_TYPE_FULL, _T(""), true, 10.0f},
-    {_T("../Common/Textures/test/sequence/wispy_smoke04_8x8.png"), Point2i{8,8}, Point2f{0.5f, 0.5f}, PARTICLE_BILLBOARD_TYPE_FULL, _T(""), true, 10.0f}
+    {{_T("../Common/Textures/Flame.png")}, Point2i{ 16, 8 }, Point2f{0.5f, 1.0f}, PARTICLE_BILLBOARD_TYPE_VERT, _T("../Common/Textures/FlamePalette.png")},
+    // Smoke sequences share single texture array, so smoke particles of all sequences are batched together
+    {{_T("../Common/Textures/test/sequence/wispy_smoke01_8x8.png"), _T("../Common/Textures/test/sequence/wispy_smoke03_8x8.png"), _T("../Common/Textures/test/sequence/wispy_smoke04_8x8.png")},
+        Point2i{8,8}, Point2f{0.5f, 0.5f}, PARTICLE_BILLBOARD_TYPE_FULL, _T(""), true, 10.0f}
 };
 
+// Emitter with several templates splits back to front order into a batch per template change, so every emitter has
+// single template: transparent_sort_bench gives 98 batches for 100k particles against 32542 with template picked per particle
 const std::vector<ParticleEmitterParams> Renderer::ParticleEmitterSetup = {
     { Point3f{0,0,1}, false, Point4f{10.0f, 10.0f, 10.0f, 1.0f}, {0}, 1 },
-    { Point3f{0,0.5f,1}, true, Point4f{1,1,1,0.35f}, {1,2,3}, -1, 0.5, Point2d{9.0, 11.0}, Point2d{1.0, 1.5}, Point2d{2.0, 3.0} }
+    { Point3f{0,0.5f,1}, true, Point4f{1,1,1,0.35f}, {1}, -1, 0.5, Point2d{9.0, 11.0}, Point2d{1.0, 1.5}, Point2d{2.0, 3.0} }
 };
 
 Renderer::Renderer(Platform::Device* pDevice)
@@ -489,6 +436,9 @@ Renderer::Renderer(Platform::Device* pDevice)
     , m_pLuminanceRS(nullptr)
     , m_pMinMaxDepthPSO(nullptr)
     , m_pMinMaxDepthRS(nullptr)
+    , m_depthFrame(0)
+    , m_visibleDepthRange()
+    , m_shadowSplitsNear(0.0f)
     , m_pLuminanceFinalPSO(nullptr)
     , m_pLuminanceFinalRS(nullptr)
     , m_pComputeBlurHorzPSO(nullptr)
@@ -507,11 +457,43 @@ Renderer::Renderer(Platform::Device* pDevice)
     , m_rotationDir(0)
     , m_modelAngle(0.0f)
     , m_lightgridUpdateNeeded(true)
+    , m_animationUSec(0.0)
+    , m_staticFrame(0)
+    , m_shaderCacheLoadMSec(0.0)
+    , m_pipelineCacheLoadMSec(0.0)
+    , m_initMSec(0.0)
+    , m_particleUSec(0.0)
+    , m_particleThreads(0)
+    , m_particleCulledCount(0)
+    , m_particleStress(false)
+    , m_particlePackUSec(0.0)
+    , m_particleBatchCount(0)
+    , m_particleDrawCount(0)
+    , m_transparentSortUSec(0.0)
+    , m_pCullSet(nullptr)
+    , m_cullDynamic(false)
+    , m_cullUSec(0.0)
+    , m_shadowCasterCount(0)
+    , m_shadowCullUSec(0.0)
+    , m_shadowCache(ShadowSplits)
+    , m_staticCasterVersion(0)
+    , m_shadowCacheRebuilds(0)
+    , m_bvhRefitNodes(0)
+    , m_bvhRebuilds(0)
+    , m_bvhUSec(0.0)
 {
     m_color[0] = m_color[1] = m_color[2] = 1.0f;
 
     m_sceneTimeSec = 0.0f;
 
+    m_passUploadBytes.fill(0);
+    m_lastPassUploadBytes.fill(0);
+
+    for (int i = 0; i < ShadowSplits; i++)
+    {
+        m_shadowSplitsDist[i] = m_sceneParams.shadowSplitsDist[i];
+    }
+
     srand(12345);
     for (int i = 0; i < SceneParameters::MaxSSAOSamples; i++)
     {
@@ -549,7 +531,7 @@ Renderer::~Renderer()
     assert(m_pModelInstance == nullptr);
     assert(m_pFullScreenLight == nullptr);
     assert(m_pPointLight == nullptr);
-    assert(m_particles.empty());
+    assert(m_particlePool.GetCapacity() == 0);
 }
 
 bool Renderer::Init(HWND hWnd)
@@ -565,14 +547,36 @@ bool Renderer::Init(HWND hWnd)
     std::vector<TextureVertex> sphereVertices;
     std::vector<UINT16> indices;
 
+    m_startupStart = std::chrono::steady_clock::now();
+
     bool res = Platform::BaseRenderer::Init(hWnd);
     if (res)
     {
+        auto start = std::chrono::steady_clock::now();
 #ifdef _DEBUG
         res = GetShaderCache()->LoadCache(_T("shader_cache.bin"));
 #else
         res = GetShaderCache()->LoadCache(_T("shader_cache_optimized.bin"));
 #endif
+        m_shaderCacheLoadMSec = GetMSecSince(start);
+    }
+    if (res)
+    {
+        auto start = std::chrono::steady_clock::now();
+#ifdef _DEBUG
+        res = LoadPipelineCache(_T("pipeline_cache.bin"));
+#else
+        res = LoadPipelineCache(_T("pipeline_cache_optimized.bin"));
+#endif
+        m_pipelineCacheLoadMSec = GetMSecSince(start);
+    }
+    if (res)
+    {
+        res = m_threadPool.Init();
+    }
+    if (res)
+    {
+        res = m_staticCBStorage.Init(GetDevice(), StaticCBStorageSize);
     }
     if (res)
     {
@@ -590,6 +594,11 @@ bool Renderer::Init(HWND hWnd)
         m_counters[(size_t)CounterType::MeasureLuminance    ] = std::make_pair(_T("Measure luminance     "), Platform::DeviceTimeQuery(GetDevice()));
         m_counters[(size_t)CounterType::Tonemapping         ] = std::make_pair(_T("Tonemapping           "), Platform::DeviceTimeQuery(GetDevice()));
         m_counters[(size_t)CounterType::Full                ] = std::make_pair(_T("Frame time            "), Platform::DeviceTimeQuery(GetDevice()));
+
+        for (UINT i = 0; i < ShadowSplits; i++)
+        {
+            m_shadowSplitTimes[i] = Platform::DeviceTimeQuery(GetDevice());
+        }
     }
     if (res)
     {
@@ -704,19 +713,23 @@ bool Renderer::Init(HWND hWnd)
             for (int i = 0; i < ParticleEmitterTemplateSetup.size(); i++)
             {
                 m_particleEmitterTemplates.push_back(new ParticleEmitterTemplate(ParticleEmitterTemplateSetup[i], this));
-            }
-            for (int i = 0; i < ParticleEmitterSetup.size(); i++)
-            {
-                std::vector<const ParticleEmitterTemplate*> templates;
-                for (int j = 0; j < ParticleEmitterSetup[i].templateIndex.size(); j++)
+
+                const ParticleEmitterTemplate* pTemplate = m_particleEmitterTemplates.back();
+
+                ParticleInstancePacker::TemplateInfo info;
+                info.billboardType = pTemplate->GetParams().billType;
+                info.frameCount = pTemplate->GetFrameCount();
+                if (pTemplate->GetUsePalette())
                 {
-                    templates.push_back(m_particleEmitterTemplates[ParticleEmitterSetup[i].templateIndex[j]]);
+                    info.flags |= PARTICLE_FLAG_USE_PALETTE;
                 }
-
-                m_particleEmitters.push_back(
-                    new ParticleEmitter(ParticleEmitterSetup[i], templates)
-                );
+                if (pTemplate->GetParams().hasAlpha)
+                {
+                    info.flags |= PARTICLE_FLAG_HAS_ALPHA;
+                }
+                m_particleTemplateInfos.push_back(info);
             }
+            CreateParticleEmitters(m_sceneParams.particleStress);
         }
         if (res)
         {
@@ -946,14 +959,14 @@ bool Renderer::Init(HWND hWnd)
             m_pModelLoader = new Platform::ModelLoader(true);
             std::vector<std::tstring> modelFiles = Platform::ScanDirectories(_T("../Common/SceneModels"), _T("scene.gltf"));
             //std::vector<std::tstring> modelFiles;
-            res = m_pModelLoader->Init(this, modelFiles, HDRFormat, DXGI_FORMAT_R32G32B32A32_FLOAT, true, false);
+            res = m_pModelLoader->Init(this, modelFiles, HDRFormat, DXGI_FORMAT_R32G32B32A32_FLOAT, true, false, &m_threadPool);
         }
 
         if (res)
         {
             m_pPlayerModelLoader = new Platform::ModelLoader(true);
             std::vector<std::tstring> modelFiles = Platform::ScanDirectories(_T("../Common/PlayerModels"), _T("scene.gltf"));
-            m_pPlayerModelLoader->Init(this, modelFiles, HDRFormat, DXGI_FORMAT_R32G32B32A32_FLOAT, true, UseLocalCubemaps);
+            m_pPlayerModelLoader->Init(this, modelFiles, HDRFormat, DXGI_FORMAT_R32G32B32A32_FLOAT, true, UseLocalCubemaps, &m_threadPool);
         }
     }
 
@@ -985,11 +998,15 @@ bool Renderer::Init(HWND hWnd)
         m_brdfReady = false;
     }
 
+    m_initMSec = GetMSecSince(m_startupStart);
+
     return res;
 }
 
 void Renderer::Term()
 {
+    m_threadPool.Term();
+
     delete m_pModelInstance;
     m_pModelInstance = nullptr;
 
@@ -999,6 +1016,14 @@ void Renderer::Term()
         GetShaderCache()->SaveCache(_T("shader_cache.bin"));
 #else
         GetShaderCache()->SaveCache(_T("shader_cache_optimized.bin"));
+#endif
+    }
+    if (IsPipelineCacheModified())
+    {
+#ifdef _DEBUG
+        SavePipelineCache(_T("pipeline_cache.bin"));
+#else
+        SavePipelineCache(_T("pipeline_cache_optimized.bin"));
 #endif
     }
     SaveScene();
@@ -1008,25 +1033,19 @@ void Renderer::Term()
         delete model;
     }
     m_currentModels.clear();
+    m_staticInstanceCBs.clear();
 
     GetDevice()->WaitGPUIdle();
 
+    m_staticCBStorage.Term();
+
     m_pTerrainModel->Term(this);
     delete m_pTerrainModel;
     m_pTerrainModel = nullptr;
 
-    // Delete particles
-    for (int i = 0; i < m_particles.size(); i++)
-    {
-        delete m_particles[i];
-    }
-    m_particles.clear();
-    // Delete emitters
-    for (int i = 0; i < m_particleEmitters.size(); i++)
-    {
-        delete m_particleEmitters[i];
-    }
-    m_particleEmitters.clear();
+    // Delete emitters and particles
+    DestroyParticleEmitters();
+    m_particleTemplateInfos.clear();
     // Delete emitter templates
     for (int i = 0; i < m_particleEmitterTemplates.size(); i++)
     {
@@ -1127,23 +1146,35 @@ bool Renderer::Update(double elapsedSec, double deltaSec)
         m_sceneParams.lights[i].intensity = m_sceneParams.lightAnims[i - 1].amplitude * 0.66f + m_sceneParams.lightAnims[i - 1].amplitude * 0.33f * sinf((float)elapsed);
     }
 
-    // Update particle emitters
-    for (int i = 0; i < m_particleEmitters.size(); i++)
+    if (m_sceneParams.particleStress != m_particleStress)
     {
-        m_particleEmitters[i]->Update(this, deltaSec);
+        DestroyParticleEmitters();
+        CreateParticleEmitters(m_sceneParams.particleStress);
     }
-    // Update particles
-    for (auto it = m_particles.begin(); it != m_particles.end();)
+
+    // Update particle emitters, each one advances its particles
     {
-        if ((*it)->IsDead())
-        {
-            it = m_particles.erase(it);
-        }
-        else
+        auto start = std::chrono::steady_clock::now();
+
+        // Emitters own separate pool ranges and random streams, so result doesn't depend on thread count.
+        // Thread count is limited by the number of jobs
+        const size_t emitterCount = m_particleEmitters.size();
+        m_particleThreads = m_sceneParams.particleThreads > 0 ? std::min((size_t)m_sceneParams.particleThreads, m_threadPool.GetThreadCount()) : m_threadPool.GetThreadCount();
+        m_particleThreads = std::max(std::min(m_particleThreads, emitterCount), (size_t)1);
+        const size_t grainSize = std::max((emitterCount + m_particleThreads - 1) / m_particleThreads, (size_t)1);
+
+        UpdateParticleLods(deltaSec);
+
+        m_particlePool.ResetStats();
+        m_threadPool.ParallelFor(emitterCount, grainSize, [this, deltaSec](size_t begin, size_t end)
         {
-            (*it)->Update(deltaSec);
-            ++it;
-        }
+            for (size_t i = begin; i < end; i++)
+            {
+                m_particleEmitters[i]->Update(m_particlePool, deltaSec);
+            }
+        });
+
+        m_particleUSec = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
     }
 
     m_lastUpdateDelta = (float)(deltaSec);
@@ -1199,14 +1230,6 @@ bool Renderer::Update(double elapsedSec, double deltaSec)
     {
         if (m_pModelInstance != nullptr)
         {
-            // Apply animations here
-            if (m_sceneParams.animated)
-            {
-                m_pModelInstance->animationTime += (float)deltaSec;
-                m_pModelInstance->ApplyAnimation();
-                m_pModelInstance->UpdateMatrices();
-            }
-
             if (cameraMoveDir.lengthSqr() > 0.00001f)
             {
                 Point3f newModelDir;
@@ -1219,6 +1242,12 @@ bool Renderer::Update(double elapsedSec, double deltaSec)
         }
     }
 
+    // Apply animations here
+    if (m_sceneParams.animated)
+    {
+        UpdateAnimations((float)deltaSec, !m_sceneParams.editMode);
+    }
+
     if (elapsedSec - m_prevFPS >= 1.0)
     {
         m_fps = m_fpsCount;
@@ -1248,6 +1277,9 @@ bool Renderer::Render()
     std::wstring modelName;
     if (BeginRender(beginParams))
     {
+        m_lastPassUploadBytes = m_passUploadBytes;
+        m_passUploadBytes.fill(0);
+
         if (IsCreationFrame())
         {
             IntegrateBRDF();
@@ -1256,6 +1288,8 @@ bool Renderer::Render()
         }
         else
         {
+            UpdateStaticInstances();
+
             if (m_pPlayerModelLoader->HasModelsToLoad())
             {
                 m_pTextDraw->DrawText(m_fontId, Point3f{ 1,1,1 }, _T("Loading model: %ls"), GetParentName(m_pPlayerModelLoader->GetCurrentModelName()).c_str());
@@ -1291,6 +1325,8 @@ bool Renderer::Render()
                     }
 
                     LoadScene(m_pModelLoader);
+
+                    ReportStartupTimeline();
                 }
             }
             else if (m_pCubemapBuilder->HasCubemapsToBuild())
@@ -1334,8 +1370,13 @@ bool Renderer::Render()
 
                 PresetupLights();
 
+                UpdateSceneBVH();
+                CullShadowCasters();
+
                 RenderShadows(reinterpret_cast<SceneCommon*>(dynCBData[0]));
 
+                CullCameraGeometries(*GetCamera(), aspectRatioHdivW);
+
                 PrepareColorPass(*GetCamera(), GetRect());
 
                 if (m_sceneParams.renderArch == SceneParameters::Deferred)
@@ -1366,6 +1407,11 @@ bool Renderer::Render()
                     {
                         LightCulling();
                         LightCulling();
+
+                        if (m_sceneParams.sampleDistribution && m_sceneParams.shadowMode == SceneParameters::ShadowModePSSM)
+                        {
+                            ReadbackDepthRange();
+                        }
                     }
                 }
                 if (m_sceneParams.renderArch == SceneParameters::ForwardPlus)
@@ -1494,22 +1540,13 @@ bool Renderer::Render()
 
                     m_counters[(size_t)CounterType::TransparentColorPass].second.Start(GetCurrentCommandList());
 
-                    for (int i = 0; i < m_particles.size(); i++)
-                    {
-                        RenderParticle(m_particles[i]);
-                    }
-                    for (size_t i = 0; i < m_currentModels.size(); i++)
-                    {
-                        RenderModel(m_currentModels[i], false);
-                    }
-                    if (m_pModelInstance != nullptr)
-                    {
-                        RenderModel(m_pModelInstance, false);
-                    }
+                    RenderTransparents();
 
                     m_counters[(size_t)CounterType::TransparentColorPass].second.Stop(GetCurrentCommandList());
                 }
 
+                m_pCullSet = nullptr;
+
                 GetDevice()->TransitResourceState(GetCurrentCommandList(), m_hdrRT.pResource, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
                 SetBackBufferRT(); // Return current back buffer as render target
@@ -1577,6 +1614,13 @@ bool Renderer::Render()
                     }
                     ImGui::Checkbox("Animated", &m_sceneParams.animated);
                     ImGui::Checkbox("GPU counters", &m_sceneParams.showGPUCounters);
+                    ImGui::Checkbox("Frustum culling", &m_sceneParams.frustumCulling);
+                    ImGui::Checkbox("Shadow caster culling", &m_sceneParams.shadowCasterCulling);
+                    ImGui::Checkbox("Cached static shadows", &m_sceneParams.shadowCache);
+                    ImGui::Checkbox("Stable cascades", &m_sceneParams.stableCascades);
+                    ImGui::Checkbox("Sample distribution splits", &m_sceneParams.sampleDistribution);
+                    ImGui::Checkbox("Particle stress", &m_sceneParams.particleStress);
+                    ImGui::SliderInt("Particle threads", &m_sceneParams.particleThreads, 0, (int)m_threadPool.GetThreadCount());
 
                     //ImGui::SliderInt("Lights", &m_sceneParams.activeLightCount, 1, 4);
                     ImGui::ListBox("Render mode", (int*)&m_sceneParams.renderMode, RenderModeNames.data(), (int)RenderModeNames.size());
@@ -2255,6 +2299,8 @@ bool Renderer::BlitTexture(D3D12_GPU_DESCRIPTOR_HANDLE srcTexHandle)
 
 void Renderer::PresetupLights()
 {
+    FitSplitDists();
+
     int dirLightIdx = -1;
     for (int i = 0; i < m_sceneParams.activeLightCount; i++)
     {
@@ -2278,42 +2324,88 @@ void Renderer::PresetupLights()
         return;
     }
 
+    const bool stable = m_sceneParams.stableCascades && m_sceneParams.shadowMode != SceneParameters::ShadowModeSimple;
+
     // Convert from light params to scene light objects
     {
         const auto& light = m_sceneParams.lights[dirLightIdx];
 
         m_lights[dirLightIdx].SetLatLon(light.inverseDirSphere.y, light.inverseDirSphere.x);
-        m_lights[dirLightIdx].SetLookAt(GetCamera()->GetLookAt());
+
+        Point3f lookAt = GetCamera()->GetLookAt();
+        if (stable)
+        {
+            Point3f right, up, dir;
+            m_lights[dirLightIdx].GetCamera().CalcDirection(right, up, dir);
+
+            auto snap = [](float v) { return floorf(v / ShadowLightSnap + 0.5f) * ShadowLightSnap; };
+
+            lookAt = right * snap(lookAt.dot(right)) + up * snap(lookAt.dot(up)) + dir * snap(lookAt.dot(dir));
+        }
+        m_lights[dirLightIdx].SetLookAt(lookAt);
 
         float scale = m_sceneParams.shadowAreaScale * 0.5f;
         m_lights[dirLightIdx].SetRect(Point2f{ -scale, -scale }, Point2f{ scale, scale });
     }
 
+    // Light space origin of split rects
+    Point3f right, up, dir;
+    m_lights[dirLightIdx].GetCamera().CalcDirection(right, up, dir);
+    Point4f pos4 = m_lights[dirLightIdx].GetCamera().CalcPos();
+    Point3f pos{ pos4.x, pos4.y, pos4.z };
+
     if (m_sceneParams.shadowMode == SceneParameters::ShadowModeSimple)
     {
         float scale = m_sceneParams.shadowAreaScale * 0.5f;
         m_lights[dirLightIdx].SetSplitRect(0, Point2f{ -scale, -scale }, Point2f{ scale, scale });
     }
+    else if (m_sceneParams.shadowMode == SceneParameters::ShadowModePSSM && stable)
+    {
+        // Split sphere doesn't change, while camera rotates, and its rect moves by whole texels, so shadow edges don't shimmer
+        D3D12_RECT rect = GetRect();
+        float aspectRatioHdivW = (float)(rect.bottom - rect.top) / (rect.right - rect.left);
+
+        float tanHalfX = tanf(GetCamera()->GetHorzFOV() / 2.0f);
+        float tanHalfY = tanHalfX * aspectRatioHdivW;
+        float tanHalfDiag = sqrtf(tanHalfX * tanHalfX + tanHalfY * tanHalfY);
+
+        Point3f camRight, camUp, camDir;
+        GetCamera()->CalcDirection(camRight, camUp, camDir);
+        Point4f camPos4 = GetCamera()->CalcPos();
+        Point3f camPos{ camPos4.x, camPos4.y, camPos4.z };
+
+        float nearPlane = m_shadowSplitsNear;
+        for (int i = 0; i < 4; i++)
+        {
+            float farPlane = m_shadowSplitsDist[i];
+
+            CascadeSphere sphere = CalcCascadeSphere(nearPlane, farPlane, tanHalfDiag);
+            Point3f center = camPos + camDir * sphere.centerDist;
+
+            Point2f splitBBMin, splitBBMax;
+            CalcCascadeRect(Point2f{ center.dot(right), center.dot(up) }, sphere.radius, ShadowSplitMapSize, splitBBMin, splitBBMax);
+
+            Point2f origin{ pos.dot(right), pos.dot(up) };
+            m_lights[dirLightIdx].SetSplitRect(i, splitBBMin - origin, splitBBMax - origin);
+
+            nearPlane = farPlane;
+        }
+    }
     else if (m_sceneParams.shadowMode == SceneParameters::ShadowModePSSM)
     {
         // Setup light shadow cameras
         D3D12_RECT rect = GetRect();
         float aspectRatioHdivW = (float)(rect.bottom - rect.top) / (rect.right - rect.left);
 
-        float nearPlane = GetCamera()->GetNear();
+        float nearPlane = m_shadowSplitsNear;
         for (int i = 0; i < 4; i++)
         {
-            float farPlane = m_sceneParams.shadowSplitsDist[i];
+            float farPlane = m_shadowSplitsDist[i];
 
             std::vector<Point3f> pts;
             GetCamera()->CalcFrustumPoints(pts, nearPlane, farPlane, aspectRatioHdivW);
 
             // Calculate light space bounding box for this split frustum
-            Point3f right, up, dir;
-            m_lights[dirLightIdx].GetCamera().CalcDirection(right, up, dir);
-            Point4f pos4 = m_lights[dirLightIdx].GetCamera().CalcPos();
-            Point3f pos{ pos4.x, pos4.y, pos4.z };
-
             Point3f splitBBMin{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
             Point3f splitBBMax{ std::numeric_limits<float>::min(), std::numeric_limits<float>::min(), std::numeric_limits<float>::min() };
             for (size_t j = 0; j < pts.size(); j++)
@@ -2350,8 +2442,22 @@ void Renderer::PresetupLights()
     {
         for (int i = 0; i < 4; i++)
         {
-            float scale = m_sceneParams.shadowSplitsDist[i] * 0.5f;
-            m_lights[dirLightIdx].SetSplitRect(i, Point2f{ -scale, -scale }, Point2f{ scale, scale });
+            float scale = m_shadowSplitsDist[i] * 0.5f;
+            if (stable)
+            {
+                // Splits are centered at camera look at point, every one is snapped to its own texel grid
+                Point3f center = GetCamera()->GetLookAt();
+
+                Point2f splitBBMin, splitBBMax;
+                CalcCascadeRect(Point2f{ center.dot(right), center.dot(up) }, scale, ShadowSplitMapSize, splitBBMin, splitBBMax);
+
+                Point2f origin{ pos.dot(right), pos.dot(up) };
+                m_lights[dirLightIdx].SetSplitRect(i, splitBBMin - origin, splitBBMax - origin);
+            }
+            else
+            {
+                m_lights[dirLightIdx].SetSplitRect(i, Point2f{ -scale, -scale }, Point2f{ scale, scale });
+            }
         }
     }
     else
@@ -2360,6 +2466,65 @@ void Renderer::PresetupLights()
     }
 }
 
+void Renderer::FitSplitDists()
+{
+    ++m_depthFrame;
+
+    // Frames up to the one, which has used the current command list before, are finished on GPU,
+    // readback memory of them is reused by the next allocation, so it is read first
+    const UINT64 framesInFlight = GetDevice()->GetFramesInFlight();
+    while (!m_depthReadbacks.empty() && m_depthReadbacks.front().frame + framesInFlight <= m_depthFrame)
+    {
+        const DepthReadback& readback = m_depthReadbacks.front();
+
+        Point2f range{ std::numeric_limits<float>::max(), 0.0f };
+        for (UINT y = 0; y < readback.height; y++)
+        {
+            const Point2f* pRow = reinterpret_cast<const Point2f*>(readback.pData + y * readback.rowPitch);
+            for (UINT x = 0; x < readback.width; x++)
+            {
+                if (pRow[x].y > 0.0f)
+                {
+                    range.x = std::min(range.x, pRow[x].x);
+                    range.y = std::max(range.y, pRow[x].y);
+                }
+            }
+        }
+        m_visibleDepthRange = range.y > 0.0f ? range : Point2f{};
+
+        m_depthReadbacks.erase(m_depthReadbacks.begin());
+    }
+    if (!m_sceneParams.sampleDistribution || m_sceneParams.renderArch != SceneParameters::ForwardPlus)
+    {
+        m_visibleDepthRange = Point2f{};
+    }
+
+    const float camNear = GetCamera()->GetNear();
+    const float shadowDist = m_sceneParams.shadowSplitsDist[ShadowSplits - 1];
+
+    m_shadowSplitsNear = camNear;
+    for (int i = 0; i < ShadowSplits; i++)
+    {
+        m_shadowSplitsDist[i] = m_sceneParams.shadowSplitsDist[i];
+    }
+
+    if (m_sceneParams.sampleDistribution && m_sceneParams.shadowMode == SceneParameters::ShadowModePSSM
+        && m_sceneParams.renderArch == SceneParameters::ForwardPlus && m_visibleDepthRange.y > 0.0f)
+    {
+        // Range is a few frames old, margin covers camera movement since then.
+        // Splits depend on quantized ends only, so they stay the same, while range changes a little
+        float minDist = std::max(QuantizeSplitDist(m_visibleDepthRange.x * 0.9f, false), camNear);
+        float maxDist = std::min(QuantizeSplitDist(m_visibleDepthRange.y * 1.1f, true), shadowDist);
+        if (minDist < maxDist)
+        {
+            CalcSplitDists(minDist, maxDist, SplitLogWeight, ShadowSplits, m_shadowSplitsDist);
+            m_shadowSplitsDist[ShadowSplits - 1] = maxDist;
+
+            m_shadowSplitsNear = minDist;
+        }
+    }
+}
+
 void Renderer::SetupLights(Lights* pLights)
 {
     // Setup lights constant buffer
@@ -2398,7 +2563,7 @@ void Renderer::SetupLights(Lights* pLights)
         {
             assert(!hasDirectional);
 
-            float prev = m_sceneParams.shadowSplitsDist[0];
+            float prev = m_shadowSplitsDist[0];
             for (int j = 0; j < ShadowSplits; j++)
             {
                 const auto& splitRect = m_lights[i].GetSplitRect(j);
@@ -2409,13 +2574,13 @@ void Renderer::SetupLights(Lights* pLights)
 
                 pLights->lights[i].worldToLight[j] = lightSpace * lightProj * uvTrans;
 
-                prev = m_sceneParams.shadowSplitsDist[j];
+                prev = m_shadowSplitsDist[j];
             }
             pLights->lights[i].csmRatio = Point4f{
                 1.0f, 
-                m_sceneParams.shadowSplitsDist[0] / m_sceneParams.shadowSplitsDist[1],
-                m_sceneParams.shadowSplitsDist[1] / m_sceneParams.shadowSplitsDist[2],
-                m_sceneParams.shadowSplitsDist[2] / m_sceneParams.shadowSplitsDist[3]
+                m_shadowSplitsDist[0] / m_shadowSplitsDist[1],
+                m_shadowSplitsDist[1] / m_shadowSplitsDist[2],
+                m_shadowSplitsDist[2] / m_shadowSplitsDist[3]
             };
 
             hasDirectional = true;
@@ -2964,11 +3129,47 @@ bool Renderer::CreateShadowMap()
         }
     }
 
+    // Create static caster caches, they are copy sources except for cache update
+    if (res)
+    {
+        Platform::CreateTextureParams params;
+        params.format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+        params.height = ShadowMapSize;
+        params.width = ShadowMapSize;
+        params.enableDS = true;
+        params.initialState = D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+        D3D12_CLEAR_VALUE clearValue;
+        clearValue.Format = params.format;
+        clearValue.DepthStencil.Depth = 1.0f;
+        clearValue.DepthStencil.Stencil = 0;
+        params.pOptimizedClearValue = &clearValue;
+
+        res = Platform::CreateTexture(params, false, GetDevice(), m_shadowMapCache);
+        if (res)
+        {
+            params.height = ShadowSplitMapSize;
+            params.width = ShadowSplitMapSize;
+            params.arraySize = ShadowSplits;
+
+            res = Platform::CreateTexture(params, false, GetDevice(), m_shadowMapSplitsCache);
+        }
+    }
+    if (res)
+    {
+        m_shadowMapCache.pResource->SetName(_T("Shadow map cache"));
+        m_shadowMapSplitsCache.pResource->SetName(_T("Splits shadow map cache"));
+
+        m_shadowCache.Invalidate();
+    }
+
     return res;
 }
 
 void Renderer::DestroyShadowMap()
 {
+    GetDevice()->ReleaseGPUResource(m_shadowMapSplitsCache);
+    GetDevice()->ReleaseGPUResource(m_shadowMapCache);
     GetDevice()->ReleaseGPUResource(m_shadowMapSplits);
     GetDevice()->ReleaseGPUResource(m_shadowMap);
 }
@@ -3485,6 +3686,8 @@ bool Renderer::CreateTerrainGeometry()
     {
         vertices[i].normal = Point3f{ 0, 1, 0 };
         vertices[i].tangent = Point3f{ 0, 0, 1 };
+
+        pTerrainGeometry->bounds.Add(vertices[i].pos);
     }
 
     indices[0] = 0;
@@ -3637,6 +3840,8 @@ bool Renderer::CreatePlayerSphereGeometry()
     for (auto& vertex : sphereVertices)
     {
         vertex.pos.y += 0.5;
+
+        pSphereGeometry->bounds.Add(vertex.pos);
     }
 
     CreateGeometryParams params;
@@ -3718,6 +3923,83 @@ bool Renderer::CreatePlayerSphereGeometry()
     return res;
 }
 
+void Renderer::CreateParticleEmitters(bool stress)
+{
+    const int copies = stress ? ParticleStressGridSize * ParticleStressGridSize : 1;
+
+    for (int i = 0; i < ParticleEmitterSetup.size(); i++)
+    {
+        std::vector<ParticleEmitter::TemplateInfo> templates;
+        for (int j = 0; j < ParticleEmitterSetup[i].templateIndex.size(); j++)
+        {
+            const ParticleEmitterTemplate* pTemplate = m_particleEmitterTemplates[ParticleEmitterSetup[i].templateIndex[j]];
+
+            ParticleEmitter::TemplateInfo info;
+            info.frameCount = pTemplate->GetFrameCount();
+            info.sequenceCount = pTemplate->GetSequenceCount();
+            info.animSpeed = (float)pTemplate->GetParams().animSpeed;
+            templates.push_back(info);
+        }
+
+        for (int j = 0; j < copies; j++)
+        {
+            ParticleEmitterParams params = ParticleEmitterSetup[i];
+            if (stress)
+            {
+                const float offset = (ParticleStressGridSize - 1) * 0.5f;
+                params.pos.x += ((j % ParticleStressGridSize) - offset) * ParticleStressGridStep;
+                params.pos.z += ((j / ParticleStressGridSize) - offset) * ParticleStressGridStep;
+                params.emitFreqSec /= ParticleStressRateScale;
+            }
+
+            m_particleEmitters.push_back(
+                new ParticleEmitter(params, templates, m_particlePool, (UINT32)(i * copies + j))
+            );
+
+            ParticleInstancePacker::Source source;
+            source.range = m_particleEmitters.back()->GetRange();
+            source.pTemplateIndices = &m_particleEmitters.back()->GetTemplateIndices();
+            m_particleSources.push_back(source);
+        }
+    }
+
+    m_particleStress = stress;
+}
+
+void Renderer::UpdateParticleLods(double deltaSec)
+{
+    ParticleLodParams params;
+    params.lodDistance = ParticleLodDistance;
+    params.minScale = ParticleLodMinScale;
+    params.cullDistance = ParticleCullDistance;
+    params.cullSize = ParticleCullSize;
+    params.budget = ParticleBudget;
+
+    D3D12_RECT rect = GetRect();
+    float aspectRatioHdivW = (float)(rect.bottom - rect.top) / (rect.right - rect.left);
+    const Matrix4f proj = GetCamera()->CalcProjMatrix(aspectRatioHdivW);
+
+    ParticleLodView view;
+    const Point4f cameraPos4 = GetCamera()->CalcPos();
+    view.pos = Point3f{ cameraPos4.x, cameraPos4.y, cameraPos4.z };
+    view.frustum.Build(GetCamera()->CalcViewMatrix() * proj);
+    view.projScale = proj.m[5];
+
+    m_particleLod.Update(params, view, m_particleEmitters, m_particlePool.GetAliveCount(), deltaSec);
+}
+
+void Renderer::DestroyParticleEmitters()
+{
+    m_particleSources.clear();
+    m_particlePool.Clear();
+
+    for (int i = 0; i < m_particleEmitters.size(); i++)
+    {
+        delete m_particleEmitters[i];
+    }
+    m_particleEmitters.clear();
+}
+
 void Renderer::SetCurrentModel(Platform::GLTFModel* pModel)
 {
     if (m_pModelInstance != nullptr)
@@ -3781,21 +4063,577 @@ float Renderer::CalcModelAutoRotate(const Point3f& cameraDir, float deltaSec, Po
     return modelAngle;
 }
 
-void Renderer::RenderParticle(const Particle* pParticle)
+void Renderer::UpdateAnimations(float deltaSec, bool animatePlayer)
 {
-    const auto& geometries = pParticle->GetEmitter()->GetTemplate(pParticle->GetTemplateIdx())->GetGeometries();
-    for (size_t i = 0; i < geometries.size(); i++)
+    auto start = std::chrono::steady_clock::now();
+
+    m_animatedInstances.clear();
+    if (animatePlayer && m_pModelInstance != nullptr)
     {
-        RenderGeometry(*geometries[i], nullptr, 0, nullptr, {}, pParticle->GetData(), sizeof(ParticleData));
+        m_animatedInstances.push_back(m_pModelInstance);
+    }
+    for (auto pInst : m_currentModels)
+    {
+        if (pInst->pModel->maxAnimationTime != 0.0f)
+        {
+            m_animatedInstances.push_back(pInst);
+        }
     }
-}
+
+    // Instances don't share any mutable state, so result doesn't depend on thread count
+    m_threadPool.ParallelFor(m_animatedInstances.size(), AnimationGrainSize, [this, deltaSec](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            Platform::GLTFModelInstance* pInst = m_animatedInstances[i];
+
+            pInst->animationTime += deltaSec;
+            pInst->ApplyAnimation();
+            pInst->UpdateMatrices();
+        }
+    });
+
+    m_animationUSec = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+}
+
+void Renderer::UpdateStaticInstances()
+{
+    ++m_staticFrame;
+
+    for (auto pInst : m_currentModels)
+    {
+        // Animated instances change every frame, they stay on dynamic heap
+        if (pInst->pModel->maxAnimationTime != 0.0f)
+        {
+            continue;
+        }
+
+        auto it = m_staticInstanceCBs.find(pInst);
+        if (it == m_staticInstanceCBs.end())
+        {
+            StaticInstanceCB instCB;
+            if (!AllocateStaticInstanceCB(pInst, instCB))
+            {
+                continue; // Storage is full, instance is rendered from dynamic heap
+            }
+            it = m_staticInstanceCBs.insert(std::make_pair(pInst, instCB)).first;
+        }
+
+        StaticInstanceCB& instCB = it->second;
+        instCB.frame = m_staticFrame;
+
+        // Split data of instance changes together with its transform, so object data version covers both
+        if (instCB.version != pInst->instObjDataVersion)
+        {
+            m_staticCBStorage.Update(instCB.objCB, &pInst->instObjData);
+            for (size_t i = 0; i < instCB.geomCBs.size(); i++)
+            {
+                m_staticCBStorage.Update(instCB.geomCBs[i], &pInst->instGeomData[i]);
+            }
+            for (size_t i = 0; i < instCB.blendGeomCBs.size(); i++)
+            {
+                m_staticCBStorage.Update(instCB.blendGeomCBs[i], &pInst->instBlendGeomData[i]);
+            }
+
+            instCB.version = pInst->instObjDataVersion;
+        }
+    }
+
+    // Instances, which have left the scene, return their buffers
+    for (auto it = m_staticInstanceCBs.begin(); it != m_staticInstanceCBs.end();)
+    {
+        if (it->second.frame != m_staticFrame)
+        {
+            FreeStaticInstanceCB(it->second);
+            it = m_staticInstanceCBs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    m_staticCBStorage.Flush(GetCurrentCommandList());
+}
+
+bool Renderer::AllocateStaticInstanceCB(const Platform::GLTFModelInstance* pInst, StaticInstanceCB& instCB)
+{
+    instCB.objCB = m_staticCBStorage.Allocate(sizeof(Platform::GLTFObjectData));
+
+    bool res = instCB.objCB != Platform::PersistentCBStorage::InvalidHandle;
+
+    for (size_t i = 0; i < pInst->instGeomData.size() && res; i++)
+    {
+        instCB.geomCBs.push_back(m_staticCBStorage.Allocate(sizeof(Platform::GLTFSplitData)));
+        res = instCB.geomCBs.back() != Platform::PersistentCBStorage::InvalidHandle;
+    }
+    for (size_t i = 0; i < pInst->instBlendGeomData.size() && res; i++)
+    {
+        instCB.blendGeomCBs.push_back(m_staticCBStorage.Allocate(sizeof(Platform::GLTFSplitData)));
+        res = instCB.blendGeomCBs.back() != Platform::PersistentCBStorage::InvalidHandle;
+    }
+
+    if (!res)
+    {
+        FreeStaticInstanceCB(instCB);
+    }
+
+    return res;
+}
+
+void Renderer::FreeStaticInstanceCB(StaticInstanceCB& instCB)
+{
+    if (instCB.objCB != Platform::PersistentCBStorage::InvalidHandle)
+    {
+        m_staticCBStorage.Free(instCB.objCB);
+        instCB.objCB = Platform::PersistentCBStorage::InvalidHandle;
+    }
+    for (UINT handle : instCB.geomCBs)
+    {
+        if (handle != Platform::PersistentCBStorage::InvalidHandle)
+        {
+            m_staticCBStorage.Free(handle);
+        }
+    }
+    instCB.geomCBs.clear();
+    for (UINT handle : instCB.blendGeomCBs)
+    {
+        if (handle != Platform::PersistentCBStorage::InvalidHandle)
+        {
+            m_staticCBStorage.Free(handle);
+        }
+    }
+    instCB.blendGeomCBs.clear();
+}
+
+void Renderer::UpdateSceneBVH()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    if (m_bvhInstances.size() != m_currentModels.size() || !std::equal(m_bvhInstances.begin(), m_bvhInstances.end(), m_currentModels.begin()))
+    {
+        m_bvhInstances.assign(m_currentModels.begin(), m_currentModels.end());
+        m_bvhVersions.resize(m_bvhInstances.size());
+        m_bvhIndices.clear();
+
+        size_t maxGeometries = 0;
+        std::vector<AABB<float>> boxes(m_bvhInstances.size());
+        for (size_t i = 0; i < m_bvhInstances.size(); i++)
+        {
+            const Platform::GLTFModelInstance* pInst = m_bvhInstances[i];
+
+            boxes[i] = CalcInstanceBox(pInst);
+            m_bvhVersions[i] = pInst->instObjDataVersion;
+            m_bvhIndices[pInst] = (UINT)i;
+
+            maxGeometries = std::max(maxGeometries, pInst->pModel->geometries.size() + pInst->pModel->blendGeometries.size());
+        }
+
+        m_sceneBVH.Build(boxes);
+        m_cullHidden.assign(maxGeometries, 0);
+        m_bvhRefitNodes = 0;
+
+        ++m_staticCasterVersion;
+    }
+    else
+    {
+        // Moved or animated instances change their data version
+        for (size_t i = 0; i < m_bvhInstances.size(); i++)
+        {
+            if (m_bvhVersions[i] != m_bvhInstances[i]->instObjDataVersion)
+            {
+                m_sceneBVH.Update((UINT)i, CalcInstanceBox(m_bvhInstances[i]));
+                m_bvhVersions[i] = m_bvhInstances[i]->instObjDataVersion;
+
+                // Cached shadows have static casters only
+                if (m_bvhInstances[i]->pModel->maxAnimationTime == 0.0f)
+                {
+                    ++m_staticCasterVersion;
+                }
+            }
+        }
+
+        m_bvhRefitNodes = m_sceneBVH.Refit();
+
+        // Rotations can't fix tree, which objects have moved across, it is built anew over current boxes
+        if (m_bvhRefitNodes != 0 && m_sceneBVH.CalcStats().sahCost > m_sceneBVH.GetBuildSAHCost() * BVHRebuildCostRatio)
+        {
+            m_sceneBVH.Rebuild();
+            ++m_bvhRebuilds;
+        }
+    }
+
+    m_bvhUSec = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+}
+
+AABB<float> Renderer::CalcInstanceBox(const Platform::GLTFModelInstance* pInst) const
+{
+    const Platform::GLTFObjectData& objData = pInst->instObjData;
+
+    // Geometries without bounds are covered by model box
+    AABB<float> res;
+    bool useModelBox = pInst->pModel->geometries.empty() && pInst->pModel->blendGeometries.empty();
+    for (const auto* pGeometries : { &pInst->pModel->geometries, &pInst->pModel->blendGeometries })
+    {
+        for (const Platform::GLTFGeometry* pGeometry : *pGeometries)
+        {
+            const int node = pGeometry->splitData.nodeIndex.x;
+            if (pGeometry->bounds.IsEmpty() || node < 0 || node >= MAX_NODES)
+            {
+                useModelBox = true;
+                continue;
+            }
+
+            Point3f center;
+            Point3f extent;
+            Platform::TransformBox(objData.nodeTransforms[node] * objData.modelTransform, pGeometry->bounds.bbMin, pGeometry->bounds.bbMax, center, extent);
+
+            res.Add(center - extent);
+            res.Add(center + extent);
+        }
+    }
+
+    if (useModelBox)
+    {
+        Point3f center;
+        Point3f extent;
+        Platform::TransformBox(objData.modelTransform, pInst->pModel->bbMin, pInst->pModel->bbMax, center, extent);
+
+        res.Add(center - extent);
+        res.Add(center + extent);
+    }
+
+    return res;
+}
+
+void Renderer::CullGeometries(CullSet& cullSet, bool addTerrain)
+{
+    cullSet.boxes.Clear();
+    cullSet.offsets.clear();
+    cullSet.opaqueRanges.clear();
+
+    // Only geometries of instances, which boxes are in frustum, are tested
+    cullSet.instances.clear();
+    m_sceneBVH.QueryFrustum(cullSet.frustum, cullSet.instances);
+
+    if (addTerrain)
+    {
+        AddCullBoxes(cullSet, m_pTerrainModel, m_pTerrainModel, m_pTerrainModel->objData);
+    }
+    for (UINT idx : cullSet.instances)
+    {
+        AddCullBoxes(cullSet, m_bvhInstances[idx], m_bvhInstances[idx]->pModel, m_bvhInstances[idx]->instObjData);
+    }
+    if (m_pModelInstance != nullptr)
+    {
+        AddCullBoxes(cullSet, m_pModelInstance, m_pModelInstance->pModel, m_pModelInstance->instObjData);
+    }
+
+    cullSet.visible.resize(cullSet.boxes.GetSize());
+    cullSet.visibleCount = cullSet.frustum.TestBoxes(cullSet.boxes, cullSet.visible.data());
+}
+
+void Renderer::AddCullBoxes(CullSet& cullSet, const void* pKey, const Platform::GLTFModel* pModel, const Platform::GLTFObjectData& objData)
+{
+    cullSet.offsets[pKey] = cullSet.boxes.GetSize();
+    cullSet.opaqueRanges.push_back(std::make_pair(cullSet.boxes.GetSize(), pModel->geometries.size()));
+
+    for (const auto* pGeometries : { &pModel->geometries, &pModel->blendGeometries })
+    {
+        for (const Platform::GLTFGeometry* pGeometry : *pGeometries)
+        {
+            Point3f center;
+            Point3f extent{ Platform::Frustum::InfiniteExtent, Platform::Frustum::InfiniteExtent, Platform::Frustum::InfiniteExtent };
+
+            const int node = pGeometry->splitData.nodeIndex.x;
+            if (!pGeometry->bounds.IsEmpty() && node >= 0 && node < MAX_NODES)
+            {
+                Platform::TransformBox(objData.nodeTransforms[node] * objData.modelTransform, pGeometry->bounds.bbMin, pGeometry->bounds.bbMax, center, extent);
+            }
+
+            cullSet.boxes.Add(center, extent);
+        }
+    }
+}
+
+void Renderer::CountVisibleOpaque(CullSet& cullSet)
+{
+    cullSet.opaqueVisibleCount = 0;
+    for (const auto& range : cullSet.opaqueRanges)
+    {
+        auto first = cullSet.visible.begin() + range.first;
+        cullSet.opaqueVisibleCount += (size_t)std::count(first, first + range.second, (UINT8)1);
+    }
+}
+
+void Renderer::CullCameraGeometries(const Platform::Camera& camera, float aspectRatioHdivW)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    m_cameraCull.frustum.Build(camera.CalcViewMatrix() * camera.CalcProjMatrix(aspectRatioHdivW));
+
+    CullGeometries(m_cameraCull, true);
+
+    m_pCullSet = m_sceneParams.frustumCulling ? &m_cameraCull : nullptr;
+
+    m_cullUSec = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+}
+
+void Renderer::CullShadowCasters()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Terrain is not drawn into shadow maps
+    m_shadowCasterCount = m_pModelInstance != nullptr ? m_pModelInstance->pModel->geometries.size() : 0;
+    for (const Platform::GLTFModelInstance* pInst : m_bvhInstances)
+    {
+        m_shadowCasterCount += pInst->pModel->geometries.size();
+    }
+
+    const Platform::Camera& lightCamera = m_lights[0].GetCamera();
+
+    LightSpace light;
+    lightCamera.CalcDirection(light.right, light.up, light.dir);
+    Point4f pos4 = lightCamera.CalcPos();
+    light.pos = Point3f{ pos4.x, pos4.y, pos4.z };
+
+    D3D12_RECT rect = GetRect();
+    float aspectRatioHdivW = (float)(rect.bottom - rect.top) / (rect.right - rect.left);
+
+    const UINT splitCount = m_sceneParams.shadowMode == SceneParameters::ShadowModeSimple ? 1 : ShadowSplits;
+    for (UINT j = 0; j < splitCount; j++)
+    {
+        CullSet& cullSet = m_shadowCull[j];
+
+        // PSSM split is sampled in its slice of camera frustum only, other modes select split by light space position
+        float sliceNear = GetCamera()->GetNear();
+        float sliceFar = GetCamera()->GetFar();
+        if (m_sceneParams.shadowMode == SceneParameters::ShadowModePSSM)
+        {
+            sliceNear = j == 0 ? m_shadowSplitsNear : m_shadowSplitsDist[j - 1];
+            sliceFar = m_shadowSplitsDist[j];
+        }
+
+        std::vector<Point3f> pts;
+        GetCamera()->CalcFrustumPoints(pts, sliceNear, sliceFar, aspectRatioHdivW);
+
+        // Light space box of receivers
+        AABB<float> receivers;
+        for (const Point3f& pt : pts)
+        {
+            receivers.Add(Point3f{ (pt - light.pos).dot(light.right), (pt - light.pos).dot(light.up), (pt - light.pos).dot(light.dir) });
+        }
+
+        // Split volume is clipped to receivers, so casters, which don't shadow them, are skipped
+        const auto& splitRect = m_lights[0].GetSplitRect(j);
+        const Point3f bbMin{ splitRect.first.x, splitRect.first.y, lightCamera.GetNear() };
+        const Point3f bbMax{ splitRect.second.x, splitRect.second.y, lightCamera.GetFar() };
+        const Point3f clipMin{ std::max(bbMin.x, receivers.bbMin.x), std::max(bbMin.y, receivers.bbMin.y), bbMin.z };
+        const Point3f clipMax{ std::min(bbMax.x, receivers.bbMax.x), std::min(bbMax.y, receivers.bbMax.y), std::min(bbMax.z, receivers.bbMax.z) };
+
+        // Caster, which is fully over the previous split rect, shadows receivers of the previous split only.
+        // One texel margin keeps casters on rect border
+        const bool cullInner = m_sceneParams.shadowMode == SceneParameters::ShadowModeCSM && j > 0;
+        const auto& innerRect = m_lights[0].GetSplitRect(cullInner ? j - 1 : j);
+        const float margin = (innerRect.second.x - innerRect.first.x) / ShadowSplitMapSize;
+
+        if (m_sceneParams.shadowCache)
+        {
+            // Cached static depth is kept while camera moves, so static casters are culled by whole split volume.
+            // Dynamic ones are drawn every frame, so they are clipped to receivers of the frame
+            SetLightVolume(cullSet.frustum, light, bbMin, bbMax);
+            CullGeometries(cullSet, false);
+
+            Platform::Frustum clipped;
+            SetLightVolume(clipped, light, clipMin, clipMax);
+            cullSet.dynamicVisible.resize(cullSet.boxes.GetSize());
+            clipped.TestBoxes(cullSet.boxes, cullSet.dynamicVisible.data());
+            if (cullInner)
+            {
+                CullInnerCasters(light, cullSet.boxes, innerRect.first, innerRect.second, margin, cullSet.dynamicVisible.data());
+            }
+        }
+        else
+        {
+            SetLightVolume(cullSet.frustum, light, clipMin, clipMax);
+            CullGeometries(cullSet, false);
+            if (cullInner)
+            {
+                cullSet.visibleCount -= CullInnerCasters(light, cullSet.boxes, innerRect.first, innerRect.second, margin, cullSet.visible.data());
+            }
+
+            cullSet.dynamicVisible.clear();
+        }
+
+        CountVisibleOpaque(cullSet);
+    }
+
+    m_shadowCullUSec = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+}
+
+const UINT8* Renderer::GetGeometryVisibility(const void* pKey, const Platform::GLTFModel* pModel, bool opaque) const
+{
+    if (m_pCullSet == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto it = m_pCullSet->offsets.find(pKey);
+    if (it == m_pCullSet->offsets.end())
+    {
+        // Scene instance with no boxes is out of frustum
+        return m_bvhIndices.count(pKey) != 0 ? m_cullHidden.data() : nullptr;
+    }
+
+    const std::vector<UINT8>& visible = m_cullDynamic && !m_pCullSet->dynamicVisible.empty() ? m_pCullSet->dynamicVisible : m_pCullSet->visible;
+    return visible.data() + it->second + (opaque ? 0 : pModel->geometries.size());
+}
+
+void Renderer::RenderTransparents()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Particles of culled emitters are not drawn
+    m_particleDrawSources.clear();
+    m_particleCulledCount = 0;
+    for (size_t i = 0; i < m_particleEmitters.size(); i++)
+    {
+        if (m_particleEmitters[i]->GetLod().culled)
+        {
+            m_particleCulledCount += m_particlePool.GetRange(m_particleSources[i].range).count;
+        }
+        else
+        {
+            m_particleDrawSources.push_back(m_particleSources[i]);
+        }
+    }
+
+    m_particlePacker.Pack(m_particlePool, m_particleDrawSources, m_particleTemplateInfos);
+
+    m_particlePackUSec = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+
+    start = std::chrono::steady_clock::now();
+
+    const Point4f cameraPos4 = GetCamera()->CalcPos();
+    const Point3f cameraPos{ cameraPos4.x, cameraPos4.y, cameraPos4.z };
+
+    m_transparentSorter.Begin(GetCamera()->GetFar());
+
+    const auto& instances = m_particlePacker.GetInstances();
+
+    m_particleDepths.resize(instances.size());
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        const Point4f& pos = instances[i].particleWorldPos;
+        m_particleDepths[i] = (Point3f{ pos.x, pos.y, pos.z } - cameraPos).length();
+    }
+
+    // Particles are tied by template, so the ones at the same depth form single batch
+    for (const auto& batch : m_particlePacker.GetBatches())
+    {
+        assert(batch.templateIdx < (int)TransparentSorter::MaxTie);
+        m_transparentSorter.Add(m_particleDepths.data() + batch.first, batch.count, (UINT32)batch.templateIdx, (UINT32)batch.first);
+    }
+
+    // Geometries go after particles at the same depth
+    const UINT32 particleCount = (UINT32)instances.size();
+
+    m_transparentGeometries.clear();
+    for (size_t i = 0; i <= m_currentModels.size(); i++)
+    {
+        const Platform::GLTFModelInstance* pInst = i < m_currentModels.size() ? m_currentModels[i] : m_pModelInstance;
+        if (pInst == nullptr)
+        {
+            continue;
+        }
+
+        const UINT8* pVisible = GetGeometryVisibility(pInst, pInst->pModel, false);
+        for (size_t j = 0; j < pInst->pModel->blendGeometries.size(); j++)
+        {
+            if (pVisible != nullptr && pVisible[j] == 0)
+            {
+                continue;
+            }
+
+            Point3f pos = CalcGeometryPos(pInst->instObjData, pInst->instBlendGeomData[j]);
+            m_transparentSorter.Add((pos - cameraPos).length(), TransparentSorter::MaxTie, particleCount + (UINT32)m_transparentGeometries.size());
+
+            TransparentGeometry geom;
+            geom.pInst = pInst;
+            geom.geomIdx = (int)j;
+            m_transparentGeometries.push_back(geom);
+        }
+    }
+
+    m_transparentSorter.Sort();
+
+    m_transparentSortUSec = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+
+    const auto& items = m_transparentSorter.GetItems();
+
+    m_sortedParticles.resize(instances.size());
+
+    m_particleBatchCount = 0;
+    m_particleDrawCount = 0;
+
+    size_t packed = 0;
+    size_t i = 0;
+    while (i < items.size())
+    {
+        if (items[i].index >= particleCount)
+        {
+            const TransparentGeometry& geom = m_transparentGeometries[items[i].index - particleCount];
+            RenderModel(geom.pInst, false, RenderPassColor, geom.geomIdx);
+
+            ++i;
+            continue;
+        }
+
+        // Adjacent particles of the same template are uploaded once and drawn instanced,
+        // so templates mixed within emitter would split batches (see ParticleEmitterSetup)
+        const UINT32 templateIdx = TransparentSorter::GetTie(items[i]);
+        const size_t first = packed;
+        while (i < items.size() && items[i].index < particleCount && TransparentSorter::GetTie(items[i]) == templateIdx
+            && packed - first < PARTICLE_MAX_INSTANCES)
+        {
+            m_sortedParticles[packed++] = instances[items[i].index];
+            ++i;
+        }
+
+        D3D12_GPU_VIRTUAL_ADDRESS address = UploadDynamicCB(&m_sortedParticles[first], (packed - first) * sizeof(ParticleData));
+
+        const auto& geometries = m_particleEmitterTemplates[templateIdx]->GetGeometries();
+        for (size_t j = 0; j < geometries.size(); j++)
+        {
+            RenderGeometry(*geometries[j], nullptr, 0, nullptr, {}, address, (UINT)(packed - first));
+            ++m_particleDrawCount;
+        }
+
+        ++m_particleBatchCount;
+    }
+}
 
 void Renderer::RenderModel(const Platform::GLTFModel* pModel, bool opaque, const RenderPass& pass)
 {
     const auto& geometries = opaque ? pModel->geometries : pModel->blendGeometries;
+    if (geometries.empty())
+    {
+        return;
+    }
+
+    const UINT64 uploadStart = GetCurrentDynamicCBStats().bytes;
+
+    // Object data is shared by all geometries and passes of the frame
+    D3D12_GPU_VIRTUAL_ADDRESS objectAddress = UploadObjectCB(pModel->objCB, &pModel->objData, sizeof(Platform::GLTFObjectData), pModel->objDataVersion);
 
+    const UINT8* pVisible = GetGeometryVisibility(pModel, pModel, opaque);
     for (size_t i = 0; i < geometries.size(); i++)
     {
+        if (pVisible != nullptr && pVisible[i] == 0)
+        {
+            continue;
+        }
+
         GeometryState* pState = nullptr;
         if (pass == RenderPassZ)
         {
@@ -3818,17 +4656,49 @@ void Renderer::RenderModel(const Platform::GLTFModel* pModel, bool opaque, const
             pState = pModel->zPassGeomStates[i].states[Platform::ZPassGBuffer];
         }
 
-        RenderGeometry(*geometries[i], nullptr, 0, pState, {}, &pModel->objData, sizeof(Platform::GLTFObjectData));
+        RenderGeometry(*geometries[i], nullptr, 0, pState, {}, objectAddress);
     }
+
+    m_passUploadBytes[pass] += GetCurrentDynamicCBStats().bytes - uploadStart;
 }
 
-void Renderer::RenderModel(const Platform::GLTFModelInstance* pInst, bool opaque, const RenderPass& pass)
+void Renderer::RenderModel(const Platform::GLTFModelInstance* pInst, bool opaque, const RenderPass& pass, int geomIdx)
 {
     const auto& geometries = opaque ? pInst->pModel->geometries : pInst->pModel->blendGeometries;
     const auto& data = opaque ? pInst->instGeomData : pInst->instBlendGeomData;
+    if (geometries.empty())
+    {
+        return;
+    }
 
-    for (size_t i = 0; i < geometries.size(); i++)
+    const UINT64 uploadStart = GetCurrentDynamicCBStats().bytes;
+
+    // Static instance is rendered from persistent storage, when its buffers are uploaded already
+    auto staticIt = m_staticInstanceCBs.find(pInst);
+    const StaticInstanceCB* pStaticCB = staticIt != m_staticInstanceCBs.end() ? &staticIt->second : nullptr;
+    const std::vector<UINT>* pStaticGeomCBs = pStaticCB != nullptr ? (opaque ? &pStaticCB->geomCBs : &pStaticCB->blendGeomCBs) : nullptr;
+
+    // Object data is shared by all geometries and passes of the frame
+    D3D12_GPU_VIRTUAL_ADDRESS objectAddress = 0;
+    if (pStaticCB != nullptr && !m_staticCBStorage.IsDirty(pStaticCB->objCB))
+    {
+        objectAddress = m_staticCBStorage.GetAddress(pStaticCB->objCB);
+    }
+    else
+    {
+        objectAddress = UploadObjectCB(pInst->instObjCB, &pInst->instObjData, sizeof(Platform::GLTFObjectData), pInst->instObjDataVersion);
+    }
+
+    const size_t first = geomIdx < 0 ? 0 : (size_t)geomIdx;
+    const size_t last = geomIdx < 0 ? geometries.size() : first + 1;
+    const UINT8* pVisible = GetGeometryVisibility(pInst, pInst->pModel, opaque);
+    for (size_t i = first; i < last; i++)
     {
+        if (pVisible != nullptr && pVisible[i] == 0)
+        {
+            continue;
+        }
+
         GeometryState* pState = nullptr;
         if (pass == RenderPassZ)
         {
@@ -3851,8 +4721,17 @@ void Renderer::RenderModel(const Platform::GLTFModelInstance* pInst, bool opaque
             pState = pInst->pModel->zPassGeomStates[i].states[Platform::ZPassGBuffer];
         }
 
-        RenderGeometry(*geometries[i], &data[i], sizeof(Platform::GLTFSplitData), pState, {}, &pInst->instObjData, sizeof(Platform::GLTFObjectData));
+        if (pStaticGeomCBs != nullptr && !m_staticCBStorage.IsDirty((*pStaticGeomCBs)[i]))
+        {
+            RenderGeometry(*geometries[i], m_staticCBStorage.GetAddress((*pStaticGeomCBs)[i]), pState, {}, objectAddress);
+        }
+        else
+        {
+            RenderGeometry(*geometries[i], &data[i], sizeof(Platform::GLTFSplitData), pState, {}, objectAddress);
+        }
     }
+
+    m_passUploadBytes[pass] += GetCurrentDynamicCBStats().bytes - uploadStart;
 }
 
 Platform::GLTFModelInstance* Renderer::CreateInstance(const Platform::GLTFModel* pModel)
@@ -3874,7 +4753,7 @@ Platform::GLTFModelInstance* Renderer::CreateInstance(const Platform::GLTFModel*
 
     pInstance->instObjData = pModel->objData;
 
-    pInstance->nodes = pModel->nodes;
+    pInstance->pose = pModel->bindPose;
 
     return pInstance;
 }
@@ -4000,14 +4879,9 @@ void Renderer::LoadScene(Platform::ModelLoader* pSceneModelLoader)
 
     if (UseLocalCubemaps)
     {
-        // Process scene to calculate overall bounding box
-        AABB<float> sceneBB;
-        for (size_t i = 0; i < m_currentModels.size(); i++)
-        {
-            Matrix4f instBB = m_currentModels[i]->CalcTransform();
-            sceneBB.Add(instBB * m_currentModels[i]->pModel->bbMin);
-            sceneBB.Add(instBB * m_currentModels[i]->pModel->bbMax);
-        }
+        // Overall scene bounding box is the root of scene BVH
+        UpdateSceneBVH();
+        AABB<float> sceneBB = m_sceneBVH.GetBounds();
 
         // For empty scene
         if (sceneBB.IsEmpty())
@@ -4081,45 +4955,38 @@ void Renderer::SaveScene()
     }
 }
 
+void Renderer::ReportStartupTimeline()
+{
+    const PipelineStateStats& stats = GetPipelineStateStats();
+
+    // Geometry states are created both in init and while models are loaded, so their time is reported separately
+    TCHAR buffer[512];
+    _stprintf_s(buffer, _T("Startup: init %.2fms (shader cache load %.2fms, pipeline cache load %.2fms), models loaded at %.2fms, geometry states creation %.2fms (%d created, %d from pipeline cache)\n"),
+        m_initMSec, m_shaderCacheLoadMSec, m_pipelineCacheLoadMSec,
+        GetMSecSince(m_startupStart),
+        stats.createUSec / 1000.0, (int)stats.psoMisses, (int)stats.libraryHits
+    );
+    OutputDebugString(buffer);
+}
+
 void Renderer::RenderShadows(SceneCommon* pSceneCommonCB)
 {
     PIX_MARKER_SCOPE(RenderShadows);
 
     m_counters[(size_t)CounterType::ShadowMap].second.Start(GetCurrentCommandList());
 
+    const size_t rebuildCount = m_shadowCache.GetRebuildCount();
+
     if (m_sceneParams.shadowMode == SceneParameters::ShadowModeSimple)
     {
-        if (GetDevice()->TransitResourceState(GetCurrentCommandList(), m_shadowMap.pResource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE))
-        {
-            GetCurrentCommandList()->OMSetRenderTargets(0, nullptr, TRUE, &m_shadowMapDSV);
-
-            D3D12_RECT rect;
-            rect.left = rect.top = 0;
-            rect.right = rect.bottom = ShadowMapSize;
-            GetCurrentCommandList()->ClearDepthStencilView(m_shadowMapDSV, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 1, &rect);
-
-            D3D12_VIEWPORT viewport;
-            viewport.TopLeftX = viewport.TopLeftY = 0.0f;
-            viewport.Height = (float)ShadowMapSize;
-            viewport.Width = (float)ShadowMapSize;
-            viewport.MinDepth = 0.0f;
-            viewport.MaxDepth = 1.0f;
-            GetCurrentCommandList()->RSSetViewports(1, &viewport);
-            GetCurrentCommandList()->RSSetScissorRects(1, &rect);
-
-            pSceneCommonCB->VP = m_lights[0].GetCamera().CalcViewMatrix() * m_lights[0].GetCamera().CalcProjMatrix(1.0f);
+        Matrix4f viewProj = m_lights[0].GetCamera().CalcViewMatrix() * m_lights[0].GetCamera().CalcProjMatrix(1.0f);
+        pSceneCommonCB->VP = viewProj;
 
-            for (size_t i = 0; i < m_currentModels.size(); i++)
-            {
-                RenderModel(m_currentModels[i], true, RenderPassZ);
-            }
-            if (m_pModelInstance != nullptr)
-            {
-                RenderModel(m_pModelInstance, true, RenderPassZ);
-            }
+        m_pCullSet = m_sceneParams.shadowCasterCulling ? &m_shadowCull[0] : nullptr;
 
-            GetDevice()->TransitResourceState(GetCurrentCommandList(), m_shadowMap.pResource, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        }
+        m_shadowSplitTimes[0].Start(GetCurrentCommandList());
+        RenderShadowLayer(m_shadowMap, m_shadowMapCache, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, m_shadowMapDSV, ShadowMapSize, 0, viewProj);
+        m_shadowSplitTimes[0].Stop(GetCurrentCommandList());
     }
     else
     {
@@ -4130,40 +4997,17 @@ void Renderer::RenderShadows(SceneCommon* pSceneCommonCB)
 
             PIX_MARKER_SCOPE_STR(ShadowSplit, pixName.c_str());
 
-            if (GetDevice()->TransitResourceState(GetCurrentCommandList(), m_shadowMapSplits.pResource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE, j))
-            {
-                GetCurrentCommandList()->OMSetRenderTargets(0, nullptr, TRUE, &m_shadowMapSplitDSV[j]);
-
-                D3D12_RECT rect;
-                rect.left = rect.top = 0;
-                rect.right = rect.bottom = ShadowSplitMapSize;
-                GetCurrentCommandList()->ClearDepthStencilView(m_shadowMapSplitDSV[j], D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 1, &rect);
-
-                D3D12_VIEWPORT viewport;
-                viewport.TopLeftX = viewport.TopLeftY = 0.0f;
-                viewport.Height = (float)ShadowSplitMapSize;
-                viewport.Width = (float)ShadowSplitMapSize;
-                viewport.MinDepth = 0.0f;
-                viewport.MaxDepth = 1.0f;
-                GetCurrentCommandList()->RSSetViewports(1, &viewport);
-                GetCurrentCommandList()->RSSetScissorRects(1, &rect);
+            auto const& splitRect = m_lights[0].GetSplitRect(j);
+            m_lights[0].SetRect(splitRect.first, splitRect.second);
 
-                auto const& splitRect = m_lights[0].GetSplitRect(j);
-                m_lights[0].SetRect(splitRect.first, splitRect.second);
+            Matrix4f viewProj = m_lights[0].GetCamera().CalcViewMatrix() * m_lights[0].GetCamera().CalcProjMatrix(1.0f);
+            pSceneCommonCB->VP = viewProj;
 
-                pSceneCommonCB->VP = m_lights[0].GetCamera().CalcViewMatrix() * m_lights[0].GetCamera().CalcProjMatrix(1.0f);
+            m_pCullSet = m_sceneParams.shadowCasterCulling ? &m_shadowCull[j] : nullptr;
 
-                for (size_t i = 0; i < m_currentModels.size(); i++)
-                {
-                    RenderModel(m_currentModels[i], true, RenderPassZ);
-                }
-                if (m_pModelInstance != nullptr)
-                {
-                    RenderModel(m_pModelInstance, true, RenderPassZ);
-                }
-
-                GetDevice()->TransitResourceState(GetCurrentCommandList(), m_shadowMapSplits.pResource, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, j);
-            }
+            m_shadowSplitTimes[j].Start(GetCurrentCommandList());
+            RenderShadowLayer(m_shadowMapSplits, m_shadowMapSplitsCache, j, m_shadowMapSplitDSV[j], ShadowSplitMapSize, j, viewProj);
+            m_shadowSplitTimes[j].Stop(GetCurrentCommandList());
 
             UINT8* dynCBData[2] = {};
             BeginRenderParams beginParams = {
@@ -4176,12 +5020,123 @@ void Renderer::RenderShadows(SceneCommon* pSceneCommonCB)
         }
     }
 
+    m_shadowCacheRebuilds = m_shadowCache.GetRebuildCount() - rebuildCount;
+
     m_counters[(size_t)CounterType::ShadowMap].second.Stop(GetCurrentCommandList());
 
+    m_pCullSet = nullptr;
+
     auto const& splitRect = m_lights[0].GetSplitRect(0);
     m_lights[0].SetRect(splitRect.first, splitRect.second);
 }
 
+void Renderer::RenderShadowLayer(const Platform::GPUResource& shadowMap, const Platform::GPUResource& cache, UINT subresource, D3D12_CPU_DESCRIPTOR_HANDLE dsv, UINT size, UINT split, const Matrix4f& viewProj)
+{
+    ShadowCache::Key key;
+    key.viewProj = viewProj;
+    key.staticVersion = m_staticCasterVersion;
+    key.setup = (UINT)m_sceneParams.shadowMode | (m_sceneParams.useBias ? 0x10 : 0) | (m_sceneParams.useSlopeScale ? 0x20 : 0);
+
+    const bool useCache = m_sceneParams.shadowCache;
+    const bool drawStatic = !useCache || m_shadowCache.Update(split, key);
+    if (!useCache)
+    {
+        // Cache is not updated, so it is rebuilt, when it is turned on
+        m_shadowCache.Invalidate();
+    }
+
+    // Depth is copied as whole subresource
+    const UINT copyIdx = subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES ? 0 : subresource;
+    CD3DX12_TEXTURE_COPY_LOCATION layerLoc{ shadowMap.pResource, copyIdx };
+    CD3DX12_TEXTURE_COPY_LOCATION cacheLoc{ cache.pResource, copyIdx };
+
+    D3D12_RECT rect;
+    rect.left = rect.top = 0;
+    rect.right = rect.bottom = size;
+
+    bool res = true;
+    if (drawStatic)
+    {
+        res = GetDevice()->TransitResourceState(GetCurrentCommandList(), shadowMap.pResource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE, subresource);
+        if (res)
+        {
+            GetCurrentCommandList()->OMSetRenderTargets(0, nullptr, TRUE, &dsv);
+            GetCurrentCommandList()->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 1, &rect);
+        }
+    }
+    else
+    {
+        res = GetDevice()->TransitResourceState(GetCurrentCommandList(), shadowMap.pResource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST, subresource);
+        if (res)
+        {
+            GetCurrentCommandList()->CopyTextureRegion(&layerLoc, 0, 0, 0, &cacheLoc, nullptr);
+
+            res = GetDevice()->TransitResourceState(GetCurrentCommandList(), shadowMap.pResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_DEPTH_WRITE, subresource);
+        }
+        if (res)
+        {
+            GetCurrentCommandList()->OMSetRenderTargets(0, nullptr, TRUE, &dsv);
+        }
+    }
+
+    if (res)
+    {
+        D3D12_VIEWPORT viewport;
+        viewport.TopLeftX = viewport.TopLeftY = 0.0f;
+        viewport.Height = (float)size;
+        viewport.Width = (float)size;
+        viewport.MinDepth = 0.0f;
+        viewport.MaxDepth = 1.0f;
+        GetCurrentCommandList()->RSSetViewports(1, &viewport);
+        GetCurrentCommandList()->RSSetScissorRects(1, &rect);
+    }
+
+    if (res && drawStatic)
+    {
+        RenderShadowCasters(false);
+
+        if (useCache)
+        {
+            res = GetDevice()->TransitResourceState(GetCurrentCommandList(), shadowMap.pResource, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE, subresource)
+                && GetDevice()->TransitResourceState(GetCurrentCommandList(), cache.pResource, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST, subresource);
+            if (res)
+            {
+                GetCurrentCommandList()->CopyTextureRegion(&cacheLoc, 0, 0, 0, &layerLoc, nullptr);
+
+                res = GetDevice()->TransitResourceState(GetCurrentCommandList(), cache.pResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE, subresource)
+                    && GetDevice()->TransitResourceState(GetCurrentCommandList(), shadowMap.pResource, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE, subresource);
+            }
+        }
+    }
+
+    if (res)
+    {
+        RenderShadowCasters(true);
+
+        GetDevice()->TransitResourceState(GetCurrentCommandList(), shadowMap.pResource, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, subresource);
+    }
+}
+
+void Renderer::RenderShadowCasters(bool dynamic)
+{
+    m_cullDynamic = dynamic;
+
+    // Animated instances are dynamic casters, as well as player model
+    for (size_t i = 0; i < m_currentModels.size(); i++)
+    {
+        if ((m_currentModels[i]->pModel->maxAnimationTime != 0.0f) == dynamic)
+        {
+            RenderModel(m_currentModels[i], true, RenderPassZ);
+        }
+    }
+    if (dynamic && m_pModelInstance != nullptr)
+    {
+        RenderModel(m_pModelInstance, true, RenderPassZ);
+    }
+
+    m_cullDynamic = false;
+}
+
 void Renderer::PrepareColorPass(const Platform::Camera& camera, const D3D12_RECT& rect)
 {
     UINT8* dynCBData[2] = {};
@@ -4224,10 +5179,10 @@ void Renderer::PrepareColorPass(const Platform::Camera& camera, const D3D12_RECT
     camera.CalcDirection(right, up, dir);
     pCommonCB->cameraWorldPosNear = Point4f{ camPos.x, camPos.y, camPos.z, camera.GetNear()};
     pCommonCB->cameraWorldDirFar = Point4f{ dir.x, dir.y, dir.z, camera.GetFar() };
-    pCommonCB->shadowSplitDists.x = m_sceneParams.shadowSplitsDist[0];
-    pCommonCB->shadowSplitDists.y = m_sceneParams.shadowSplitsDist[1];
-    pCommonCB->shadowSplitDists.z = m_sceneParams.shadowSplitsDist[2];
-    pCommonCB->shadowSplitDists.w = m_sceneParams.shadowSplitsDist[3];
+    pCommonCB->shadowSplitDists.x = m_shadowSplitsDist[0];
+    pCommonCB->shadowSplitDists.y = m_shadowSplitsDist[1];
+    pCommonCB->shadowSplitDists.z = m_shadowSplitsDist[2];
+    pCommonCB->shadowSplitDists.w = m_shadowSplitsDist[3];
 
     pCommonCB->localCubemapBasePosSize = Point4f( m_pCubemapBuilder->GetLocalParams().pos.x, 0, m_pCubemapBuilder->GetLocalParams().pos.y, m_pCubemapBuilder->GetLocalParams().size);
     pCommonCB->localCubemapGrid = Point4i(m_pCubemapBuilder->GetLocalParams().grid.x, m_pCubemapBuilder->GetLocalParams().grid.y, 0, 0);
@@ -4721,6 +5676,44 @@ void Renderer::LightCulling()
     m_counters[(size_t)CounterType::LightCulling].second.Stop(GetCurrentCommandList());
 }
 
+void Renderer::ReadbackDepthRange()
+{
+    PIX_MARKER_SCOPE(ReadbackDepthRange);
+
+    // Tile per texel in the corner of min max depth texture
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+    footprint.Footprint.Format = m_minMaxDepth.pResource->GetDesc().Format;
+    footprint.Footprint.Width = m_lightGridCells.x;
+    footprint.Footprint.Height = m_lightGridCells.y;
+    footprint.Footprint.Depth = 1;
+    footprint.Footprint.RowPitch = Align((UINT)(m_lightGridCells.x * sizeof(Point2f)), (UINT)D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+
+    void* pData = nullptr;
+    ID3D12Resource* pReadbackBuffer = nullptr;
+    bool res = GetDevice()->AllocateReadbackBuffer(footprint.Footprint.RowPitch * m_lightGridCells.y, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &pData, &pReadbackBuffer, footprint.Offset);
+    if (res)
+    {
+        res = GetDevice()->TransitResourceState(GetCurrentCommandList(), m_minMaxDepth.pResource, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    }
+    if (res)
+    {
+        CD3DX12_TEXTURE_COPY_LOCATION dst{ pReadbackBuffer, footprint };
+        CD3DX12_TEXTURE_COPY_LOCATION src{ m_minMaxDepth.pResource, 0 };
+        D3D12_BOX box = { 0, 0, 0, (UINT)m_lightGridCells.x, (UINT)m_lightGridCells.y, 1 };
+        GetCurrentCommandList()->CopyTextureRegion(&dst, 0, 0, 0, &src, &box);
+
+        GetDevice()->TransitResourceState(GetCurrentCommandList(), m_minMaxDepth.pResource, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        DepthReadback readback;
+        readback.pData = reinterpret_cast<const UINT8*>(pData);
+        readback.frame = m_depthFrame;
+        readback.rowPitch = footprint.Footprint.RowPitch;
+        readback.width = m_lightGridCells.x;
+        readback.height = m_lightGridCells.y;
+        m_depthReadbacks.push_back(readback);
+    }
+}
+
 void Renderer::DrawCounters()
 {
     static const std::vector<size_t> ForwardIds = {
@@ -4771,6 +5764,61 @@ void Renderer::DrawCounters()
         m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("%s: %6.2fus"), m_counters[id].first.c_str(), m_counters[id].second.GetUSec());
 #endif
     }
+
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Animation (CPU)       : %6.2fus, %d instances, %d threads"), m_animationUSec, (int)m_animatedInstances.size(), (int)m_threadPool.GetThreadCount());
+
+    const ParticlePool::Stats particleStats = m_particlePool.GetStats();
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Particles (CPU)       : %6.2fus, %d emitters, %d threads, %d alive of %d, %d spawned, %d died, %d dropped"),
+        m_particleUSec, (int)m_particleEmitters.size(), (int)m_particleThreads, (int)m_particlePool.GetAliveCount(), (int)m_particlePool.GetCapacity(), (int)particleStats.spawned, (int)particleStats.died, (int)particleStats.dropped);
+    const ParticleLodManager::Stats& lodStats = m_particleLod.GetStats();
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Particle LOD          : %d of %d budget, %d simulated, %d spawned, %d throttled, %d culled, %d drawn, %d reduced and %d culled emitters"),
+        (int)m_particlePool.GetAliveCount(), (int)ParticleBudget, (int)particleStats.updated, (int)particleStats.spawned, (int)lodStats.throttled,
+        (int)m_particleCulledCount, (int)m_particlePacker.GetStats().instances, (int)lodStats.reduced, (int)lodStats.culled);
+    const ParticleInstancePacker::Stats& packStats = m_particlePacker.GetStats();
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Particle draws        : %6.2fus pack, %d instances, %.2fKB, %d batches, %d draws"),
+        m_particlePackUSec, (int)packStats.instances, packStats.bytes / 1024.0, (int)m_particleBatchCount, (int)m_particleDrawCount);
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Transparent sort      : %6.2fus, %d items, %d geometries"),
+        m_transparentSortUSec, (int)m_transparentSorter.GetItems().size(), (int)m_transparentGeometries.size());
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Frustum culling       : %6.2fus, %d of %d instances, %d of %d geometries visible%s"),
+        m_cullUSec, (int)m_cameraCull.instances.size(), (int)m_bvhInstances.size(), (int)m_cameraCull.visibleCount, (int)m_cameraCull.boxes.GetSize(), m_sceneParams.frustumCulling ? _T("") : _T(", off"));
+    if (m_sceneParams.shadowMode == SceneParameters::ShadowModeSimple)
+    {
+        m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Shadow casters        : %6.2fus, %d of %d draws%s"),
+            m_shadowCullUSec, (int)m_shadowCull[0].opaqueVisibleCount, (int)m_shadowCasterCount, m_sceneParams.shadowCasterCulling ? _T("") : _T(", off"));
+    }
+    else
+    {
+        m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Shadow casters        : %6.2fus, %d/%d/%d/%d of %d draws per split%s"),
+            m_shadowCullUSec, (int)m_shadowCull[0].opaqueVisibleCount, (int)m_shadowCull[1].opaqueVisibleCount, (int)m_shadowCull[2].opaqueVisibleCount, (int)m_shadowCull[3].opaqueVisibleCount,
+            (int)m_shadowCasterCount, m_sceneParams.shadowCasterCulling ? _T("") : _T(", off"));
+    }
+    if (m_sceneParams.shadowMode == SceneParameters::ShadowModeSimple)
+    {
+        m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Shadow layers (GPU)   : %6.2fus, %d static rebuilt, %d rebuilds total%s"),
+            m_shadowSplitTimes[0].GetUSec(), (int)m_shadowCacheRebuilds, (int)m_shadowCache.GetRebuildCount(), m_sceneParams.shadowCache ? _T("") : _T(", cache off"));
+    }
+    else
+    {
+        m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Shadow layers (GPU)   : %6.2f/%6.2f/%6.2f/%6.2fus, %d static rebuilt, %d rebuilds total%s"),
+            m_shadowSplitTimes[0].GetUSec(), m_shadowSplitTimes[1].GetUSec(), m_shadowSplitTimes[2].GetUSec(), m_shadowSplitTimes[3].GetUSec(),
+            (int)m_shadowCacheRebuilds, (int)m_shadowCache.GetRebuildCount(), m_sceneParams.shadowCache ? _T("") : _T(", cache off"));
+        m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Shadow splits         : %.1f/%.1f/%.1f/%.1f, visible depth %.1f-%.1f%s"),
+            m_shadowSplitsDist[0], m_shadowSplitsDist[1], m_shadowSplitsDist[2], m_shadowSplitsDist[3], m_visibleDepthRange.x, m_visibleDepthRange.y,
+            m_sceneParams.stableCascades ? _T(", stable") : _T(""));
+    }
+    const Platform::BVH::Stats bvhStats = m_sceneBVH.CalcStats();
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Scene BVH             : %6.2fus, %d nodes, depth %d, SAH %.1f of %.1f built, %d refitted, %d rotations, %d rebuilds"),
+        m_bvhUSec, (int)bvhStats.nodes, (int)bvhStats.depth, bvhStats.sahCost, m_sceneBVH.GetBuildSAHCost(), (int)m_bvhRefitNodes,
+        (int)m_sceneBVH.GetRotationCount(), (int)m_bvhRebuilds);
+
+    const DynamicCBStats& cbStats = GetDynamicCBStats();
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Dynamic CB upload     : %6.2fKB, %d object uploads, %d reused"), cbStats.bytes / 1024.0, (int)cbStats.objectUploads, (int)cbStats.objectReuses);
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Model CB upload       : color %.2fKB, z %.2fKB, cubemap %.2fKB, gbuffer %.2fKB"),
+        m_lastPassUploadBytes[RenderPassColor] / 1024.0, m_lastPassUploadBytes[RenderPassZ] / 1024.0, m_lastPassUploadBytes[RenderPassCubemap] / 1024.0, m_lastPassUploadBytes[RenderPassGBuffer] / 1024.0);
+
+    const Platform::PersistentCBStorage::FlushStats& flushStats = m_staticCBStorage.GetLastFlushStats();
+    m_pTextDraw->DrawText(m_counterFontId, Point3f{ 1,1,1 }, _T("Static CB storage     : %d instances, %6.2fMB, flushed %6.2fKB in %d copies, %d pending"),
+        (int)m_staticInstanceCBs.size(), m_staticCBStorage.GetUsedSize() / (1024.0 * 1024.0), flushStats.bytes / 1024.0, (int)flushStats.copies, (int)flushStats.pending);
 }
 
 bool Renderer::SSAOMaskGeneration()
@@ -5000,8 +6048,3 @@ void Renderer::GenerateSSAOKernel(Point4f* pSamples, int sampleCount, Point4f* p
         }
     }
 }
-
-void Renderer::AddParticle(Particle* pParticle)
-{
-    m_particles.push_back(pParticle);
-}
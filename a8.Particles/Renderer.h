@@ -5,6 +5,10 @@
 #include "PlatformTextDraw.h"
 #include "PlatformCubemapBuilder.h"
 #include "PlatformModelLoader.h"
+#include "PlatformThreadPool.h"
+#include "PlatformPersistentCBStorage.h"
+#include "PlatformFrustum.h"
+#include "PlatformBVH.h"
 #include "CameraControl/PlatformCameraControlEuler.h"
 
 #include "Object.h"
@@ -15,9 +19,16 @@
 
 #include "..\..\Common\Shaders\GLTFObjectData.h"
 #include "ParticleData.h"
+#include "ParticlePool.h"
+#include "ParticleEmitter.h"
+#include "ParticleLod.h"
+#include "TransparentSort.h"
+#include "ShadowCache.h"
 
 #include <queue>
 #include <array>
+#include <chrono>
+#include <unordered_map>
 
 namespace tinygltf
 {
@@ -111,6 +122,15 @@ struct SceneParameters
 
     bool animated;
     bool showGPUCounters;
+    bool frustumCulling;
+    bool shadowCasterCulling;
+    bool shadowCache;
+    bool stableCascades;
+    bool sampleDistribution;    // PSSM splits are fitted to visible depth range, it is known in ForwardPlus only
+
+    // Particles setup
+    bool particleStress;
+    int particleThreads;        // Threads for emitter update, zero means all pool threads
 
     bool vsync;
     bool editMode;
@@ -171,7 +191,7 @@ class Renderer;
 
 struct ParticleEmitterTemplateParams
 {
-    std::wstring srcFilename;
+    std::vector<std::wstring> srcFilenames;     // Flipbook sequences of the same grid, particle plays one of them
     Point2i grid;
     Point2f size = Point2f{1,1};
     int billType = PARTICLE_BILLBOARD_TYPE_NONE;
@@ -192,6 +212,7 @@ public:
 
     inline const ParticleEmitterTemplateParams& GetParams() const { return m_params; }
     inline int GetFrameCount() const { return m_frameCount; }
+    inline int GetSequenceCount() const { return (int)m_params.srcFilenames.size(); }
     inline bool GetUsePalette() const { return m_textures[1].pResource != nullptr; }
     inline const auto& GetGeometries() const { return m_geometries; }
 
@@ -206,74 +227,6 @@ private:
     std::vector<Platform::GPUResource> m_textures;
 };
 
-struct ParticleEmitterParams
-{
-    Point3f pos;
-    bool randomPosDelta = false;
-    Point4f tint = Point4f{ 1,1,1,1 };
-    std::vector<int> templateIndex = {};
-    int particlesForEmit = -1;
-    double emitFreqSec = 0.0;
-    Point2d lifeTimeSec = Point2d{ std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() };
-    Point2d birthMargin = Point2d{ 0,0 };
-    Point2d deathMargin = Point2d{ 0,0 };
-};
-
-class ParticleEmitter
-{
-public:
-    ParticleEmitter(const ParticleEmitterParams& params, const std::vector<const ParticleEmitterTemplate*>& templates)
-        : m_params(params)
-        , m_templates(templates)
-        , m_lifeTimeSec(0.0)
-    {
-        m_particlesForEmit = m_params.particlesForEmit;
-    }
-
-    void Update(Renderer* pRenderer, double deltaSec);
-
-    inline const ParticleEmitterTemplate* GetTemplate(int i) const { return m_templates[i]; }
-
-private:
-    const ParticleEmitterParams m_params;
-    const std::vector<const ParticleEmitterTemplate*> m_templates;
-
-    int m_particlesForEmit;
-    double m_lifeTimeSec;
-};
-
-struct ParticleData
-PARTICLE_DATA
-
-class Particle
-{
-    friend class ParticleEmitter;
-
-public:
-    Particle(const int templateIdx, const ParticleEmitter* pEmitter) : m_templateIdx(templateIdx), m_pEmitter(pEmitter) {}
-
-    void Update(double deltaSec);
-    inline bool IsDead() const { return m_lifeTimeSec > m_maxLifeTimeSec; }
-
-    inline const ParticleEmitter* GetEmitter() const { return m_pEmitter; }
-    inline const ParticleData* GetData() const { return &m_objData; }
-    inline const int GetTemplateIdx() const { return m_templateIdx; }
-
-private:
-    const int m_templateIdx;
-    const ParticleEmitter* m_pEmitter;
-
-    double m_maxLifeTimeSec;
-    double m_birthMarginSec;
-    double m_deathMarginSec;
-
-    Point4f m_tint;
-
-    double m_lifeTimeSec;
-    Point3f m_posDelta;
-    ParticleData m_objData;
-};
-
 class Renderer : public Platform::BaseRenderer, public Platform::CameraControlEuler
 {
     static const std::vector<ParticleEmitterTemplateParams> ParticleEmitterTemplateSetup;
@@ -297,8 +250,6 @@ public:
 
     virtual bool RenderScene(const Platform::Camera& camera) override;
 
-    void AddParticle(Particle* pParticle);
-
 protected:
     virtual bool Resize(const D3D12_VIEWPORT& viewport, const D3D12_RECT& rect) override;
 
@@ -309,7 +260,33 @@ private:
         RenderPassColor = 0,
         RenderPassZ,
         RenderPassCubemap,
-        RenderPassGBuffer
+        RenderPassGBuffer,
+
+        RenderPassCount
+    };
+
+    // Persistent constant buffers of static scene instance
+    struct StaticInstanceCB
+    {
+        UINT64 version = 0;     // Uploaded instObjDataVersion
+        UINT64 frame = 0;       // The last frame the instance is in the scene
+        UINT objCB = Platform::PersistentCBStorage::InvalidHandle;
+        std::vector<UINT> geomCBs;
+        std::vector<UINT> blendGeomCBs;
+    };
+
+    // Geometry boxes tested against frustum, every model has boxes of its geometries followed by boxes of blend geometries
+    struct CullSet
+    {
+        Platform::Frustum frustum;
+        Platform::BoxList boxes;
+        std::vector<UINT8> visible;
+        std::vector<UINT8> dynamicVisible;  // Shadow split with cached static depth, dynamic casters clipped to receivers
+        std::unordered_map<const void*, size_t> offsets;     // First box of model or instance
+        std::vector<std::pair<size_t, size_t>> opaqueRanges;    // First box and count of opaque geometries
+        std::vector<UINT> instances;    // Scene instances, which boxes are in frustum
+        size_t visibleCount = 0;
+        size_t opaqueVisibleCount = 0;  // Opaque geometries, which are drawn in depth passes
     };
 
     struct TestGeometry : public Geometry
@@ -335,11 +312,35 @@ private:
     static const UINT BlurStepsCompute = 3;
 
     static const UINT ShadowMapSize = 4096;
-    //static const UINT ShadowSplitMapSize = 2048;
-    static const UINT ShadowSplitMapSize = 4096;
+    static const UINT ShadowSplitMapSize = 2048;
+
+    // Directional light look at point moves by whole steps, so light view stays the same, while camera moves within step
+    static const float ShadowLightSnap;
+    // Share of logarithmic distribution in fitted splits, the rest is uniform
+    static const float SplitLogWeight;
 
     static const float LocalCubemapSize;
 
+    static const size_t AnimationGrainSize = 8; // Instances per thread pool job
+
+    // Stress setup repeats every emitter on square grid with higher emit rate
+    static const int ParticleStressGridSize = 16;
+    static const float ParticleStressGridStep;
+    static const int ParticleStressRateScale = 4;
+
+    // Emitters are at full detail up to LOD distance, spawn and flipbook rates drop with distance beyond it.
+    // Emitters farther than cull distance, out of view or smaller than cull size on screen are not drawn
+    static const float ParticleLodDistance;
+    static const float ParticleLodMinScale;
+    static const float ParticleCullDistance;
+    static const float ParticleCullSize;
+    static const size_t ParticleBudget = 16 * 1024;    // Alive particles
+
+    static const UINT64 StaticCBStorageSize = 64 * 1024 * 1024;
+
+    // Scene BVH is rebuilt, when refitted tree SAH cost exceeds cost after build this many times
+    static const float BVHRebuildCostRatio;
+
 private:
     void MeasureLuminance();
 
@@ -352,6 +353,8 @@ private:
     bool BlitTexture(D3D12_GPU_DESCRIPTOR_HANDLE srcTexHandle);
 
     void PresetupLights();
+    // Effective split distances of the frame, either user ones or fitted to visible depth range
+    void FitSplitDists();
     void SetupLights(Lights* pLights);
     void SetupLightsCull(LightsCull* pLightsCull);
 
@@ -383,19 +386,50 @@ private:
 
     bool CreateTerrainGeometry();
     bool CreatePlayerSphereGeometry();
+    void CreateParticleEmitters(bool stress);
+    void DestroyParticleEmitters();
+    // Chooses LOD of every emitter and shares particle budget between them
+    void UpdateParticleLods(double deltaSec);
     void SetCurrentModel(Platform::GLTFModel* pModel);
     float CalcModelAutoRotate(const Point3f& cameraDir, float deltaSec, Point3f& newModelDir) const;
-
-    void RenderParticle(const Particle* pParticle);
+    void UpdateAnimations(float deltaSec, bool animatePlayer);
+    void UpdateStaticInstances();
+    bool AllocateStaticInstanceCB(const Platform::GLTFModelInstance* pInst, StaticInstanceCB& instCB);
+    void FreeStaticInstanceCB(StaticInstanceCB& instCB);
+
+    // Keeps scene BVH in sync with current models, it is rebuilt when instances are added or removed
+    void UpdateSceneBVH();
+    AABB<float> CalcInstanceBox(const Platform::GLTFModelInstance* pInst) const;
+    // Tests geometries of scene instances and player model against frustum of cull set, terrain is added for camera only
+    void CullGeometries(CullSet& cullSet, bool addTerrain);
+    void AddCullBoxes(CullSet& cullSet, const void* pKey, const Platform::GLTFModel* pModel, const Platform::GLTFObjectData& objData);
+    void CountVisibleOpaque(CullSet& cullSet);
+    // The result is used by camera passes of the frame
+    void CullCameraGeometries(const Platform::Camera& camera, float aspectRatioHdivW);
+    // Split gets casters in its light volume extended toward the light, which may shadow receivers of the split.
+    // CSM split drops casters, which are fully over the previous split rect
+    void CullShadowCasters();
+    // Visibility flags of model geometries, nullptr means all geometries are drawn
+    const UINT8* GetGeometryVisibility(const void* pKey, const Platform::GLTFModel* pModel, bool opaque) const;
+
+    // Draws particles and blend geometries back to front
+    void RenderTransparents();
     void RenderModel(const Platform::GLTFModel* pModel, bool opaque, const RenderPass& pass = RenderPassColor);
-    void RenderModel(const Platform::GLTFModelInstance* pInst, bool opaque, const RenderPass& pass = RenderPassColor);
+    // Renders single geometry of the instance, if geomIdx is given
+    void RenderModel(const Platform::GLTFModelInstance* pInst, bool opaque, const RenderPass& pass = RenderPassColor, int geomIdx = -1);
 
     Platform::GLTFModelInstance* CreateInstance(const Platform::GLTFModel* pModel);
 
     void LoadScene(Platform::ModelLoader* pSceneModelLoader);
     void SaveScene();
 
+    void ReportStartupTimeline();
+
     void RenderShadows(SceneCommon* pSceneCommonCB);
+    // Draws casters into layer of shadow map. Static casters are copied from cache, when it is valid for the split,
+    // otherwise they are drawn and copied into cache. Dynamic casters are drawn over them every frame
+    void RenderShadowLayer(const Platform::GPUResource& shadowMap, const Platform::GPUResource& cache, UINT subresource, D3D12_CPU_DESCRIPTOR_HANDLE dsv, UINT size, UINT split, const Matrix4f& viewProj);
+    void RenderShadowCasters(bool dynamic);
     void PrepareColorPass(const Platform::Camera& camera, const D3D12_RECT& rect);
 
     bool CreateCubemapTests();
@@ -407,6 +441,8 @@ private:
     void ForwardPlusRenderDepthPrepass();
 
     void LightCulling();
+    // Copies tile depth ranges of light culling to CPU, they are read in FitSplitDists, when GPU has finished the frame
+    void ReadbackDepthRange();
 
     void DrawCounters();
 
@@ -453,6 +489,14 @@ private:
     Platform::GPUResource m_shadowMapSplits;
     D3D12_CPU_DESCRIPTOR_HANDLE m_shadowMapSplitDSV[ShadowSplits];
 
+    // Static caster depth of shadow map layers, animated instances and player model are dynamic casters
+    Platform::GPUResource m_shadowMapCache;
+    Platform::GPUResource m_shadowMapSplitsCache;
+    ShadowCache m_shadowCache;
+    UINT64 m_staticCasterVersion;
+    size_t m_shadowCacheRebuilds;   // Layers, which static casters are drawn into this frame
+    Platform::DeviceTimeQuery m_shadowSplitTimes[ShadowSplits];
+
     bool m_brdfReady;
     Platform::GPUResource m_brdf;
     D3D12_CPU_DESCRIPTOR_HANDLE m_brdfRTV;
@@ -515,7 +559,7 @@ private:
     Platform::ModelLoader* m_pModelLoader;
     Platform::ModelLoader* m_pPlayerModelLoader;
 
-    std::vector<const Platform::GLTFModelInstance*> m_currentModels;// Current models to be drawn
+    std::vector<Platform::GLTFModelInstance*> m_currentModels;// Current models to be drawn
 
     Platform::GLTFModel* m_pTerrainModel;
     Platform::GLTFModel* m_pSphereModel;
@@ -541,9 +585,91 @@ private:
     ID3D12PipelineState* m_pMinMaxDepthPSO;
     ID3D12RootSignature* m_pMinMaxDepthRS;
 
+    // Tile min/max view depth copy, tiles without geometry are zero
+    struct DepthReadback
+    {
+        const UINT8* pData = nullptr;
+        UINT64 frame = 0;
+        UINT rowPitch = 0;
+        UINT width = 0;
+        UINT height = 0;
+    };
+    std::vector<DepthReadback> m_depthReadbacks;
+    UINT64 m_depthFrame;
+    Point2f m_visibleDepthRange;    // Of the latest finished frame, zero if unknown
+    float m_shadowSplitsNear;
+    float m_shadowSplitsDist[ShadowSplits];
+
     std::vector<std::pair<std::tstring, Platform::DeviceTimeQuery>> m_counters;
 
+    Platform::ThreadPool m_threadPool;
+    std::vector<Platform::GLTFModelInstance*> m_animatedInstances;
+    double m_animationUSec;     // CPU time spent on animations last frame
+
+    // Instances without animation keep their data in persistent storage, it is updated on change only
+    Platform::PersistentCBStorage m_staticCBStorage;
+    std::unordered_map<const Platform::GLTFModelInstance*, StaticInstanceCB> m_staticInstanceCBs;
+    UINT64 m_staticFrame;
+
+    // Dynamic heap bytes uploaded by models in each pass
+    std::array<UINT64, RenderPassCount> m_passUploadBytes;
+    std::array<UINT64, RenderPassCount> m_lastPassUploadBytes;
+
+    // Startup timeline, reported when scene models are loaded
+    std::chrono::steady_clock::time_point m_startupStart;
+    double m_shaderCacheLoadMSec;
+    double m_pipelineCacheLoadMSec;
+    double m_initMSec;
+
     std::vector<ParticleEmitterTemplate*> m_particleEmitterTemplates;
     std::vector<ParticleEmitter*> m_particleEmitters;
-    std::vector<Particle*> m_particles;
+    ParticlePool m_particlePool;
+    double m_particleUSec;      // CPU time spent on particle update last frame
+    size_t m_particleThreads;   // Threads used for particle update last frame
+
+    ParticleLodManager m_particleLod;
+    size_t m_particleCulledCount;   // Alive particles of culled emitters last frame
+    std::vector<ParticleInstancePacker::Source> m_particleDrawSources;
+    bool m_particleStress;      // Emitters are created for stress setup
+
+    // Particles are packed by template and drawn instanced
+    ParticleInstancePacker m_particlePacker;
+    std::vector<ParticleInstancePacker::Source> m_particleSources;
+    std::vector<ParticleInstancePacker::TemplateInfo> m_particleTemplateInfos;
+    double m_particlePackUSec;
+    size_t m_particleBatchCount;
+    size_t m_particleDrawCount;
+
+    // Blend geometry, which takes part in transparent sort
+    struct TransparentGeometry
+    {
+        const Platform::GLTFModelInstance* pInst = nullptr;
+        int geomIdx = 0;
+    };
+
+    // Transparent items are sorted back to front every frame, particles go before geometries in item indices
+    TransparentSorter m_transparentSorter;
+    std::vector<TransparentGeometry> m_transparentGeometries;
+    std::vector<float> m_particleDepths;        // Camera distance of packed particle instances
+    std::vector<ParticleData> m_sortedParticles;
+    double m_transparentSortUSec;
+
+    // Frustum culling of camera and shadow passes
+    CullSet m_cameraCull;
+    CullSet m_shadowCull[ShadowSplits];
+    const CullSet* m_pCullSet;      // Set for camera and shadow passes, cubemap passes draw everything
+    bool m_cullDynamic;             // Dynamic shadow casters are drawn, they use dynamicVisible of cull set, if it is there
+    std::vector<UINT8> m_cullHidden;    // Flags of instances, which are culled as a whole
+    double m_cullUSec;
+    size_t m_shadowCasterCount;     // Opaque geometries, which are drawn into every split with no culling
+    double m_shadowCullUSec;
+
+    // Scene instances in bounding volume hierarchy, boxes follow instance transforms and animation
+    Platform::BVH m_sceneBVH;
+    std::vector<const Platform::GLTFModelInstance*> m_bvhInstances;
+    std::vector<UINT64> m_bvhVersions;     // Instance data version, which box was calculated for
+    std::unordered_map<const void*, UINT> m_bvhIndices;
+    size_t m_bvhRefitNodes;
+    size_t m_bvhRebuilds;
+    double m_bvhUSec;
 };
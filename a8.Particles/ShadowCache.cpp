@@ -0,0 +1,37 @@
+#include "stdafx.h"
+#include "ShadowCache.h"
+
+#include <cstring>
+
+ShadowCache::ShadowCache(UINT splitCount)
+    : m_keys(splitCount)
+    , m_valid(splitCount, false)
+    , m_rebuildCount(0)
+{
+}
+
+void ShadowCache::Invalidate()
+{
+    m_valid.assign(m_valid.size(), false);
+}
+
+bool ShadowCache::Update(UINT split, const Key& key)
+{
+    assert(split < m_keys.size());
+
+    // Matrices are compared exactly, any change of light or split bounds gives new static depth
+    Key& cached = m_keys[split];
+    if (m_valid[split]
+        && cached.staticVersion == key.staticVersion
+        && cached.setup == key.setup
+        && memcmp(cached.viewProj.m, key.viewProj.m, sizeof(key.viewProj.m)) == 0)
+    {
+        return false;
+    }
+
+    cached = key;
+    m_valid[split] = true;
+    ++m_rebuildCount;
+
+    return true;
+}
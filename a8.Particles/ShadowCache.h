@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "PlatformMatrix.h"
+
+// Tracks static caster depth cached for every shadow split.
+// Cached depth stays valid while the split is rendered with the same light view projection,
+// the same setup and the same static casters, so only dynamic casters are drawn over it
+class ShadowCache
+{
+public:
+    struct Key
+    {
+        Matrix4f viewProj;          // Light view projection of the split, covers light direction and split bounds
+        UINT64 staticVersion = 0;   // Changes, when static casters are added, removed or moved
+        UINT setup = 0;             // Shadow mode and depth bias flags, packed by caller
+    };
+
+    ShadowCache(UINT splitCount);
+
+    void Invalidate();
+    // Returns true, if static casters of the split are to be rendered again, key becomes the cached one
+    bool Update(UINT split, const Key& key);
+
+    inline bool IsValid(UINT split) const { return m_valid[split]; }
+    inline size_t GetRebuildCount() const { return m_rebuildCount; }
+
+private:
+    std::vector<Key> m_keys;
+    std::vector<bool> m_valid;
+
+    size_t m_rebuildCount;
+};
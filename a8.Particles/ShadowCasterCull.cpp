@@ -0,0 +1,53 @@
+#include "stdafx.h"
+#include "ShadowCasterCull.h"
+
+#include <cmath>
+
+void SetLightVolume(Platform::Frustum& frustum, const LightSpace& light, const Point3f& bbMin, const Point3f& bbMax)
+{
+    const Point3f& pos = light.pos;
+    frustum.SetPlane(Platform::Frustum::PlaneLeft, Point4f{ light.right, -pos.dot(light.right) - bbMin.x });
+    frustum.SetPlane(Platform::Frustum::PlaneRight, Point4f{ -light.right, pos.dot(light.right) + bbMax.x });
+    frustum.SetPlane(Platform::Frustum::PlaneBottom, Point4f{ light.up, -pos.dot(light.up) - bbMin.y });
+    frustum.SetPlane(Platform::Frustum::PlaneTop, Point4f{ -light.up, pos.dot(light.up) + bbMax.y });
+    frustum.SetPlane(Platform::Frustum::PlaneNear, Point4f{ 0, 0, 0, 1 });
+    frustum.SetPlane(Platform::Frustum::PlaneFar, Point4f{ -light.dir, pos.dot(light.dir) + bbMax.z });
+    if (bbMin.x > bbMax.x || bbMin.y > bbMax.y || bbMin.z > bbMax.z)
+    {
+        frustum.SetPlane(Platform::Frustum::PlaneFar, Point4f{ 0, 0, 0, -1 });
+    }
+}
+
+size_t CullInnerCasters(const LightSpace& light, const Platform::BoxList& boxes, const Point2f& innerMin, const Point2f& innerMax,
+    float margin, UINT8* pVisible)
+{
+    // Light space half size of world box along an axis is the sum of its extents projected on that axis
+    const Point3f absRight{ fabsf(light.right.x), fabsf(light.right.y), fabsf(light.right.z) };
+    const Point3f absUp{ fabsf(light.up.x), fabsf(light.up.y), fabsf(light.up.z) };
+
+    size_t culledCount = 0;
+    for (size_t i = 0; i < boxes.GetSize(); i++)
+    {
+        if (pVisible[i] == 0)
+        {
+            continue;
+        }
+
+        const Point3f center = Point3f{ boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i] } - light.pos;
+        const Point3f extent{ boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i] };
+
+        const float x = center.dot(light.right);
+        const float y = center.dot(light.up);
+        const float extentX = absRight.dot(extent);
+        const float extentY = absUp.dot(extent);
+
+        if (x - extentX > innerMin.x + margin && x + extentX < innerMax.x - margin
+            && y - extentY > innerMin.y + margin && y + extentY < innerMax.y - margin)
+        {
+            pVisible[i] = 0;
+            ++culledCount;
+        }
+    }
+
+    return culledCount;
+}
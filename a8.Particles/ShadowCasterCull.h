@@ -0,0 +1,22 @@
+#pragma once
+
+#include "PlatformFrustum.h"
+
+// Shadow caster culling in light space of directional light. Light space axes are right, up and dir,
+// with origin in light position, light space boxes are given in these coordinates
+struct LightSpace
+{
+    Point3f pos;
+    Point3f right;
+    Point3f up;
+    Point3f dir;
+};
+
+// Light space box of split volume, near plane is dropped, as casters between the light and receivers shadow them.
+// Empty box culls everything
+void SetLightVolume(Platform::Frustum& frustum, const LightSpace& light, const Point3f& bbMin, const Point3f& bbMax);
+
+// Caster, which is fully over inner rect shrunk by margin, shadows receivers of the inner split only, so it is culled.
+// Returns count of culled casters
+size_t CullInnerCasters(const LightSpace& light, const Platform::BoxList& boxes, const Point2f& innerMin, const Point2f& innerMax,
+    float margin, UINT8* pVisible);
@@ -73,29 +73,28 @@ bool IsInside(in float2 uv)
     return uv.x >= 0 && uv.x <= 1.0 && uv.y >= 0 && uv.y <= 1.0;
 }
 
-float CalculateShadowCSM(in int lightIdx, in float3 worldPos)
+// Stable split rects are snapped independently, so they are not scaled copies of each other
+bool IsInsideSplit(in int lightIdx, in float3 worldPos, in int splitIdx)
 {
-    float4x4 worldToLight = lights[lightIdx].worldToLight[0];
-    float4 lightSpacePos = mul(worldToLight, float4(worldPos, 1.0));
+    float4 lightSpacePos = mul(lights[lightIdx].worldToLight[splitIdx], float4(worldPos, 1.0));
+
+    return IsInside(lightSpacePos.xy);
+}
 
-    if (IsInside(lightSpacePos.xy))
+float CalculateShadowCSM(in int lightIdx, in float3 worldPos)
+{
+    if (IsInsideSplit(lightIdx, worldPos, 0))
     {
         return SampleShadow(lightIdx, worldPos, 0);
     }
-
-    lightSpacePos.xy = (lightSpacePos.xy - float2(0.5,0.5))*lights[0].csmRatio.y + float2(0.5,0.5);
-    if (IsInside(lightSpacePos.xy))
+    if (IsInsideSplit(lightIdx, worldPos, 1))
     {
         return SampleShadow(lightIdx, worldPos, 1);
     }
-
-    lightSpacePos.xy = (lightSpacePos.xy - float2(0.5,0.5))*lights[0].csmRatio.z + float2(0.5,0.5);
-    if (IsInside(lightSpacePos.xy))
+    if (IsInsideSplit(lightIdx, worldPos, 2))
     {
         return SampleShadow(lightIdx, worldPos, 2);
     }
-
-    lightSpacePos.xy = (lightSpacePos.xy - float2(0.5,0.5))*lights[0].csmRatio.w + float2(0.5,0.5);
     return SampleShadow(lightIdx, worldPos, 3);
 }
 
@@ -147,24 +146,18 @@ float3 GetSplitTint(in float3 worldPos)
         }
         else if (shadowMode == SHADOW_MODE_CSM)
         {
-            float4x4 worldToLight = lights[0].worldToLight[0];
-            float4 lightSpacePos = mul(worldToLight, float4(worldPos, 1.0));
-
-            if (IsInside(lightSpacePos.xy))
+            if (IsInsideSplit(0, worldPos, 0))
             {
                 return float3(2,1,1);
             }
-            lightSpacePos.xy = (lightSpacePos.xy - float2(0.5,0.5))*lights[0].csmRatio.y + float2(0.5,0.5);
-            if (IsInside(lightSpacePos.xy))
+            if (IsInsideSplit(0, worldPos, 1))
             {
                 return float3(1,2,1);
             }
-            lightSpacePos.xy = (lightSpacePos.xy - float2(0.5,0.5))*lights[0].csmRatio.z + float2(0.5,0.5);
-            if (IsInside(lightSpacePos.xy))
+            if (IsInsideSplit(0, worldPos, 2))
             {
                 return float3(1,1,2);
             }
-            lightSpacePos.xy = (lightSpacePos.xy - float2(0.5,0.5))*lights[0].csmRatio.w + float2(0.5,0.5);
             return float3(2,1,2);
         }
     }
@@ -0,0 +1,98 @@
+#include "stdafx.h"
+#include "TransparentSort.h"
+
+#include <algorithm>
+
+TransparentSorter::TransparentSorter()
+    : m_depthScale(0.0f)
+{
+    memset(m_histograms, 0, sizeof(m_histograms));
+}
+
+void TransparentSorter::Begin(float maxDepth)
+{
+    m_items.clear();
+    m_depthScale = maxDepth > 0.0f ? MaxDepthKey / maxDepth : 0.0f;
+    memset(m_histograms, 0, sizeof(m_histograms));
+}
+
+void TransparentSorter::Add(const float* pDepths, size_t count, UINT32 tie, UINT32 firstIndex)
+{
+    assert(tie <= MaxTie);
+
+    // Items are written to place, push_back per item costs more than building the key
+    const size_t first = m_items.size();
+    m_items.resize(first + count);
+
+    Item* pItems = m_items.data() + first;
+    for (size_t i = 0; i < count; i++)
+    {
+        // Far items get small keys, so ascending order is back to front
+        const UINT32 depthKey = (UINT32)std::min(std::max(pDepths[i] * m_depthScale, 0.0f), (float)MaxDepthKey);
+        const UINT16 key = (UINT16)(MaxDepthKey - depthKey);
+
+        pItems[i].key = key;
+        pItems[i].tie = (UINT16)tie;
+        pItems[i].index = firstIndex + (UINT32)i;
+
+        ++m_histograms[0][key & (RadixSize - 1)];
+        ++m_histograms[1][key >> RadixBits];
+    }
+}
+
+void TransparentSorter::Sort()
+{
+    RadixSort(m_items, m_temp, m_histograms);
+}
+
+void TransparentSorter::RadixSort(std::vector<Item>& items, std::vector<Item>& temp)
+{
+    // Histograms of all passes are built at once
+    UINT32 histograms[RadixPasses][RadixSize] = {};
+    for (const Item& item : items)
+    {
+        ++histograms[0][item.key & (RadixSize - 1)];
+        ++histograms[1][item.key >> RadixBits];
+    }
+
+    RadixSort(items, temp, histograms);
+}
+
+void TransparentSorter::RadixSort(std::vector<Item>& items, std::vector<Item>& temp, UINT32 histograms[RadixPasses][RadixSize])
+{
+    const size_t count = items.size();
+    temp.resize(count);
+
+    Item* pSrc = items.data();
+    Item* pDst = temp.data();
+    for (int pass = 0; pass < RadixPasses; pass++)
+    {
+        const UINT32 shift = pass * RadixBits;
+        UINT32* offsets = histograms[pass];
+
+        if (count == 0 || offsets[(pSrc[0].key >> shift) & (RadixSize - 1)] == count)
+        {
+            continue;
+        }
+
+        UINT32 sum = 0;
+        for (UINT32 i = 0; i < RadixSize; i++)
+        {
+            const UINT32 digitCount = offsets[i];
+            offsets[i] = sum;
+            sum += digitCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            pDst[offsets[(pSrc[i].key >> shift) & (RadixSize - 1)]++] = pSrc[i];
+        }
+
+        std::swap(pSrc, pDst);
+    }
+
+    if (pSrc != items.data())
+    {
+        items.swap(temp);
+    }
+}
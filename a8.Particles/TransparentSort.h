@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+// Orders transparent draw items back to front by view depth.
+// Depth is quantized into 16 bit sort key, sort is stable, so items at the same depth keep the order they are added in.
+// Items added grouped by tie value (template or material) stay grouped at the same depth and can be batched
+class TransparentSorter
+{
+public:
+    static const UINT32 DepthBits = 16;
+    static const UINT32 MaxTie = 0xFFFF;
+
+    // 16 bit keys are sorted in two passes, histograms and pass destinations stay in L1 cache
+    static const UINT32 RadixBits = 8;
+    static const UINT32 RadixSize = 1u << RadixBits;
+    static const int RadixPasses = 2;
+
+    struct Item
+    {
+        UINT16 key;
+        UINT16 tie;
+        UINT32 index;       // Caller defined item index
+    };
+
+    TransparentSorter();
+
+    // Depths beyond maxDepth share the farthest key
+    void Begin(float maxDepth);
+    inline void Add(float depth, UINT32 tie, UINT32 index) { Add(&depth, 1, tie, index); }
+    // Adds count items of the same tie with indices from firstIndex, as instances of the particle batch go.
+    // Histograms of sort passes are counted while keys are built, so Sort reads items only to move them
+    void Add(const float* pDepths, size_t count, UINT32 tie, UINT32 firstIndex);
+    void Sort();
+
+    inline const std::vector<Item>& GetItems() const { return m_items; }
+    inline static UINT32 GetTie(const Item& item) { return item.tie; }
+
+    // Stable LSD radix sort by ascending key. Passes, where all keys share the digit, are skipped
+    static void RadixSort(std::vector<Item>& items, std::vector<Item>& temp);
+
+private:
+    static const UINT32 MaxDepthKey = (1u << DepthBits) - 1;
+
+    // Histograms are turned into offsets in place
+    static void RadixSort(std::vector<Item>& items, std::vector<Item>& temp, UINT32 histograms[RadixPasses][RadixSize]);
+
+private:
+    std::vector<Item> m_items;
+    std::vector<Item> m_temp;
+
+    float m_depthScale;
+    UINT32 m_histograms[RadixPasses][RadixSize];
+};